@@ -28,3 +28,7 @@ lccrf = ops.LinearChainCRF(model_file)
 # inference
 values = lccrf.predict(2, [(0, 0, 1.0), (1, 1, 1.0)]) # hello tom
 print(values)
+
+# batch inference, in parallel and without holding the GIL
+values = lccrf.predict_batch([2, 2], [[(0, 0, 1.0), (1, 1, 1.0)], [(0, 0, 1.0), (1, 2, 1.0)]]) # hello tom, hello jerry
+print(values)
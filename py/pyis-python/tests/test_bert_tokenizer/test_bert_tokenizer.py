@@ -4,7 +4,9 @@
 import transformers
 import unittest
 from pyis.python import ops
+import gc
 import os
+import threading
 
 class TestBertTokenizer(unittest.TestCase):
     
@@ -25,5 +27,84 @@ class TestBertTokenizer(unittest.TestCase):
         self._run_basic_test('The quick brown fox jumps over the lazy dog.')
         self._run_basic_test('It\'s high noon, isn\'t it?')
 
+    def test_tokenize_non_ascii(self):
+        self._run_basic_test('Ærø Ωμέγα ÀÉÎÕÜ Ŋŉ Ǆemal')
+        self._run_basic_test('МИР Բարեւ ԱՇԽԱՐՀ ᲒᲐᲛᲐᲠᲯᲝᲑᲐ')
+        self._run_basic_test('ＡＢＣ Ⅻ ⒶⒷ 𐐀𐐁')
+        self._run_basic_test('他吃了两碗粉 東京タワー 한국어')
+
+    def _char_offsets(self, query, offsets):
+        # the characters each token comes from, for the utf-8 byte offsets of the tokens
+        data = query.encode('utf-8')
+        def chars_before(pos):
+            return len(data[:pos].decode('utf-8', 'ignore'))
+        def chars_until(pos):
+            return chars_before(pos) + (1 if pos < len(data) and data[pos] & 0xC0 == 0x80 else 0)
+        return [(chars_before(begin), chars_until(end)) for begin, end in offsets]
+
+    def test_encode_plus_with_offsets(self):
+        os.makedirs('tmp',511,True)
+        standard = transformers.BertTokenizerFast.from_pretrained('bert-base-uncased')
+        standard.save_vocabulary('tmp')
+        tokenizer = ops.BertTokenizer('tmp/vocab.txt')
+        for query in ['hello world', 'unaffable, isn\'t it?', '  Ærø Ωμέγα  ÀÉÎ ', '他吃了两碗粉 D.Va爱你呦😙❤']:
+            result, offsets = tokenizer.encode_plus_with_offsets(query)
+            expected = standard(query, return_offsets_mapping=True)
+            self.assertEqual([x[0] for x in result], expected['input_ids'])
+            self.assertEqual(self._char_offsets(query, offsets), [tuple(x) for x in expected['offset_mapping']])
+        result, offsets = tokenizer.encode_plus_with_offsets('The quick brown fox jumps over the lazy dog.', max_length=4)
+        expected = standard('The quick brown fox jumps over the lazy dog.', max_length=6, truncation=True, return_offsets_mapping=True)
+        self.assertEqual([x[0] for x in result], expected['input_ids'])
+        self.assertEqual(offsets, [tuple(x) for x in expected['offset_mapping']])
+
+    def _check_encode_batch(self, tokenizer, queries, **kwargs):
+        batch = tokenizer.encode_batch(queries, **kwargs)
+        self.assertEqual(batch['input_ids'].shape, batch['attention_mask'].shape)
+        self.assertEqual(batch['input_ids'].shape[0], len(queries))
+        for i, query in enumerate(queries):
+            code = tokenizer.encode(query, **({'max_length': kwargs['max_length']} if 'max_length' in kwargs else {}))
+            self.assertEqual(batch['input_ids'][i][:len(code)].tolist(), code)
+            self.assertEqual(batch['attention_mask'][i].tolist(), [1] * len(code) + [0] * (batch['input_ids'].shape[1] - len(code)))
+            self.assertEqual(batch['token_type_ids'][i].tolist(), [0] * batch['input_ids'].shape[1])
+
+    def test_encode_batch(self):
+        os.makedirs('tmp',511,True)
+        standard = transformers.BertTokenizer.from_pretrained('bert-base-uncased')
+        standard.save_vocabulary('tmp/vocab.txt')
+        tokenizer = ops.BertTokenizer('tmp/vocab.txt')
+        queries = ['hello world', 'The quick brown fox jumps over the lazy dog.', '', 'It\'s high noon, isn\'t it?'] * 50
+        self._check_encode_batch(tokenizer, queries)
+        self._check_encode_batch(tokenizer, queries, max_length=6)
+        self.assertEqual(tokenizer.encode_batch(queries, max_length=6, padding='max_length')['input_ids'].shape, (len(queries), 8))
+        tokenizer.set_thread_num(3)
+        self._check_encode_batch(tokenizer, queries)
+
+        # the arrays own their ids, and outlive the dict and the tokenizer
+        batch = tokenizer.encode_batch(queries)
+        input_ids = batch['input_ids']
+        expected = [tokenizer.encode(query) for query in queries]
+        del batch
+        del tokenizer
+        gc.collect()
+        for i, code in enumerate(expected):
+            self.assertEqual(input_ids[i][:len(code)].tolist(), code)
+
+    def test_set_thread_num_during_encode_batch(self):
+        os.makedirs('tmp',511,True)
+        standard = transformers.BertTokenizer.from_pretrained('bert-base-uncased')
+        standard.save_vocabulary('tmp/vocab.txt')
+        tokenizer = ops.BertTokenizer('tmp/vocab.txt')
+        queries = ['The quick brown fox jumps over the lazy dog.'] * 2000
+        expected = tokenizer.encode_batch(queries)['input_ids'].tolist()
+        results = []
+        workers = [threading.Thread(target=lambda: results.append(tokenizer.encode_batch(queries)['input_ids'].tolist())) for _ in range(4)]
+        for worker in workers:
+            worker.start()
+        for thread_num in [1, 2, 3, 0] * 5:
+            tokenizer.set_thread_num(thread_num)
+        for worker in workers:
+            worker.join()
+        self.assertEqual(results, [expected] * 4)
+
 if __name__ == '__main__':
     unittest.main()
\ No newline at end of file
@@ -4,7 +4,9 @@
 import transformers
 import unittest
 from pyis.python import ops
+import gc
 import os
+import threading
 
 class TestBertTokenizer(unittest.TestCase):
     
@@ -35,6 +37,91 @@ class TestBertTokenizer(unittest.TestCase):
         self._run_encode_test_2('他吃了两碗粉','却只给了一碗的   钱')
         self._run_encode_test_2('😙','❤')
 
+    def _run_decode_test(self, code, **kwargs):
+        text = self.tokenizer.decode(code, **kwargs)
+        self.assertEqual(text, self.standard.decode(code, **kwargs))
+        decoder = self.tokenizer.incremental_decoder(**kwargs)
+        pieces = [decoder.step(id) for id in code]
+        pieces.append(decoder.flush())
+        self.assertEqual(''.join(pieces), text)
+        return pieces
+
+    def test_decode(self):
+        for query in ['hello world', 'It\'s high noon,  isn\'t it? I\'m sure they\'ve left .', 'D.Va爱你呦😙❤', '他吃了两碗粉 却只给了一碗的   钱']:
+            code = self.tokenizer.encode(query)
+            for clean_up_tokenization_spaces in [True, False]:
+                self._run_decode_test(code, clean_up_tokenization_spaces=clean_up_tokenization_spaces)
+        eos = self.standard.eos_token_id
+        code = [eos] + self.tokenizer.encode('hello world') + [eos]
+        self._run_decode_test(code, clean_up_tokenization_spaces=False)
+        self._run_decode_test(code, skip_special_tokens=True, clean_up_tokenization_spaces=False)
+
+        # the bytes of a character split across ids are held back until it is complete
+        code = self.tokenizer.encode('😙')
+        self.assertGreater(len(code), 1)
+        pieces = self._run_decode_test(code, clean_up_tokenization_spaces=False)
+        self.assertEqual(pieces[:-1], [''] * (len(code) - 1) + ['😙'])
+        self.assertEqual(pieces[-1], '')
+
+    def _char_offsets(self, query, offsets):
+        # the characters each token comes from, for the utf-8 byte offsets of the tokens
+        data = query.encode('utf-8')
+        def chars_before(pos):
+            return len(data[:pos].decode('utf-8', 'ignore'))
+        def chars_until(pos):
+            return chars_before(pos) + (1 if pos < len(data) and data[pos] & 0xC0 == 0x80 else 0)
+        return [(chars_before(begin), chars_until(end)) for begin, end in offsets]
+
+    def test_encode_plus_with_offsets(self):
+        standard = transformers.GPT2TokenizerFast.from_pretrained('gpt2')
+        for query in ['hello world', 'It\'s high noon,  isn\'t it?\t\n', 'D.Va爱你呦😙❤', '他吃了两碗粉 却只给了一碗的   钱']:
+            result, offsets = self.tokenizer.encode_plus_with_offsets(query)
+            expected = standard(query, return_offsets_mapping=True)
+            self.assertEqual([x[0] for x in result], expected['input_ids'])
+            self.assertEqual(self._char_offsets(query, offsets), [tuple(x) for x in expected['offset_mapping']])
+        result, offsets = self.tokenizer.encode_plus_with_offsets('The quick brown fox jumps over the lazy dog.', max_length=4)
+        expected = standard('The quick brown fox jumps over the lazy dog.', max_length=4, truncation=True, return_offsets_mapping=True)
+        self.assertEqual([x[0] for x in result], expected['input_ids'])
+        self.assertEqual(offsets, [tuple(x) for x in expected['offset_mapping']])
+
+    def _check_encode_batch(self, queries, **kwargs):
+        batch = self.tokenizer.encode_batch(queries, **kwargs)
+        self.assertEqual(batch['input_ids'].shape, batch['attention_mask'].shape)
+        self.assertEqual(batch['input_ids'].shape[0], len(queries))
+        for i, query in enumerate(queries):
+            code = self.tokenizer.encode(query, **({'max_length': kwargs['max_length']} if 'max_length' in kwargs else {}))
+            self.assertEqual(batch['input_ids'][i][:len(code)].tolist(), code)
+            self.assertEqual(batch['attention_mask'][i].tolist(), [1] * len(code) + [0] * (batch['input_ids'].shape[1] - len(code)))
+
+    def test_encode_batch(self):
+        queries = ['hello world', 'D.Va爱你呦😙❤', '', 'It\'s high noon, isn\'t it?'] * 50
+        self._check_encode_batch(queries)
+        self._check_encode_batch(queries, max_length=4)
+        self.tokenizer.set_thread_num(3)
+        self._check_encode_batch(queries)
+
+        # the arrays own their ids, and outlive the dict and the tokenizer
+        batch = self.tokenizer.encode_batch(queries)
+        attention_mask = batch['attention_mask']
+        expected = [len(self.tokenizer.encode(query)) for query in queries]
+        del batch
+        del self.tokenizer
+        gc.collect()
+        self.assertEqual(attention_mask.sum(axis=1).tolist(), expected)
+
+    def test_set_thread_num_during_encode_batch(self):
+        queries = ['The quick brown fox jumps over the lazy dog.'] * 2000
+        expected = self.tokenizer.encode_batch(queries)['input_ids'].tolist()
+        results = []
+        workers = [threading.Thread(target=lambda: results.append(self.tokenizer.encode_batch(queries)['input_ids'].tolist())) for _ in range(4)]
+        for worker in workers:
+            worker.start()
+        for thread_num in [1, 2, 3, 0] * 5:
+            self.tokenizer.set_thread_num(thread_num)
+        for worker in workers:
+            worker.join()
+        self.assertEqual(results, [expected] * 4)
+
     def setUp(self):
         os.makedirs('tmp',511,True)
         self.standard = transformers.GPT2Tokenizer.from_pretrained('gpt2')
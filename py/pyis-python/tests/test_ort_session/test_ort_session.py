@@ -1,7 +1,7 @@
 # Copyright (c) Microsoft Corporation. All rights reserved.
 # Licensed under the MIT license.
 
-import unittest, os
+import unittest, os, asyncio
 from unittest.case import skip
 import numpy as np
 from pyis.python import ops 
@@ -48,6 +48,22 @@ class TestOrtSessionSimple(unittest.TestCase):
         x, y = o1.tolist(), o2.tolist()
         self.assertListEqual(x, [3])
         self.assertListEqual(y, [3])
+
+    def test_run_async(self):
+        async def run():
+            i1 = np.array([1], dtype=np.int64)
+            i2 = np.array([2], dtype=np.int64)
+            return await self.ort_session.run_async([i1, i2])
+        o1, o2 = asyncio.new_event_loop().run_until_complete(run())
+        x, y = o1.tolist(), o2.tolist()
+        self.assertListEqual(x, [3])
+        self.assertListEqual(y, [3])
+
+    def test_run_async_without_running_loop(self):
+        i1 = np.array([1], dtype=np.int64)
+        i2 = np.array([2], dtype=np.int64)
+        with self.assertRaises(RuntimeError):
+            self.ort_session.run_async([i1, i2])
         
     def test_save(self):
         save(self.ort_session, 'tmp/test_ort_session/model.pkl')
@@ -59,5 +75,47 @@ class TestOrtSessionSimple(unittest.TestCase):
         self.assertListEqual(x, [3])
         self.assertListEqual(y, [3])
 
+class TestOrtSessionPadding(unittest.TestCase):
+    @classmethod
+    def setUpClass(self) -> None:
+        ops.OrtSession.initialize_ort()
+        # r = x * mask along the sequence, z2 = z + z of 4 values per row, which is not a sequence
+        self.model_path = os.path.join(os.path.dirname(__file__), 'data', 'x_mul_mask.onnx')
+        self.ort_session: ops.OrtSession = ops.OrtSession(
+            model_path = self.model_path,
+            input_names = ['x', 'mask', 'z'],
+            output_names = ['r', 'z2'],
+            dynamic_batching = True,
+            batch_size = 4,
+            max_queue_delay_us = 100000,
+            preferred_batch_sizes = [3],
+            padding_buckets = [4, 8],
+            pad_values = [-1, 0, 0],
+            sequence_inputs = ['x'],
+            sequence_outputs = ['r'],
+            attention_mask_input = 'mask'
+        )
+
+    def test_run_async(self):
+        async def run():
+            requests = []
+            for length in [2, 3, 4]:
+                x = np.arange(1, length + 1, dtype=np.int64).reshape(1, length)
+                z = np.full((1, 4), length, dtype=np.int64)
+                requests.append(self.ort_session.run_async([x, z]))
+            return await asyncio.gather(*requests)
+        results = asyncio.new_event_loop().run_until_complete(run())
+        for length, (r, z2) in zip([2, 3, 4], results):
+            self.assertListEqual(r.tolist(), [list(range(1, length + 1))])
+            self.assertListEqual(z2.tolist(), [[2 * length] * 4])
+
+    def test_bad_request(self):
+        async def run():
+            x = np.array([[1, 2]], dtype=np.int64)
+            z = np.zeros((1, 4), dtype=np.int64)
+            return await self.ort_session.run_async([x, z, z])
+        with self.assertRaises(RuntimeError):
+            asyncio.new_event_loop().run_until_complete(run())
+
 if __name__ == "__main__":
     unittest.main()
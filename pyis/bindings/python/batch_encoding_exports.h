@@ -0,0 +1,48 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "pybind11/numpy.h"
+#include "pybind11/pybind11.h"
+#include "pybind11/stl.h"
+#include "pyis/ops/tokenizer/tokenizer_base.h"
+
+namespace pyis {
+namespace python {
+
+namespace py = pybind11;
+
+// Wrap buffer as a [rows, cols] numpy array which owns it, without copying the ids.
+inline py::array_t<int64_t> ToNumpyArray(std::vector<int64_t>&& buffer, int64_t rows, int64_t cols) {
+    auto* owner = new std::vector<int64_t>(std::move(buffer));
+    py::capsule free_owner(owner, [](void* p) { delete static_cast<std::vector<int64_t>*>(p); });
+    return py::array_t<int64_t>({static_cast<py::ssize_t>(rows), static_cast<py::ssize_t>(cols)}, owner->data(),
+                                free_owner);
+}
+
+// EncodeBatch without the GIL, returning a dict of numpy arrays like transformers' BatchEncoding
+template <typename T>
+py::dict EncodeBatch(T& self, const std::vector<std::string>& queries, int64_t max_length,
+                     const std::string& padding) {
+    ops::BatchEncoding encoding;
+    {
+        py::gil_scoped_release release;
+        encoding = self.EncodeBatch(queries, max_length, padding);
+    }
+    py::dict result;
+    result["input_ids"] =
+        ToNumpyArray(std::move(encoding.input_ids_), encoding.batch_size_, encoding.sequence_length_);
+    result["attention_mask"] =
+        ToNumpyArray(std::move(encoding.attention_mask_), encoding.batch_size_, encoding.sequence_length_);
+    result["token_type_ids"] =
+        ToNumpyArray(std::move(encoding.token_type_ids_), encoding.batch_size_, encoding.sequence_length_);
+    return result;
+}
+
+}  // namespace python
+}  // namespace pyis
@@ -6,6 +6,8 @@
 
 #include "pybind11/pybind11.h"
 #include "pybind11/stl.h"
+#include "pyis/bindings/python/batch_encoding_exports.h"
+#include "pyis/bindings/python/incremental_decoder_exports.h"
 #include "pyis/ops/tokenizer/bert_tokenizer.h"
 #include "pyis/share/model_context.h"
 
@@ -16,6 +18,7 @@ namespace py = pybind11;
 using pyis::ops::BertTokenizer;
 
 void init_bert_tokenizer(py::module& m) {
+    init_incremental_decoder(m);
     py::class_<BertTokenizer, std::shared_ptr<BertTokenizer>>(m, "BertTokenizer",
                                                               R"pbdoc(
             For tokenizing text into id sequences (same as Bert Tokenizer Fast)
@@ -116,6 +119,44 @@ void init_bert_tokenizer(py::module& m) {
             Returns:
                     output list of tuple, each tuple contains (ids, type ids, attention mask)
             )pbdoc")
+        .def(
+            "encode_plus_with_offsets",
+            [](BertTokenizer& self, const std::string& str, int64_t max_length) {
+                std::vector<std::pair<int64_t, int64_t>> offset_mapping;
+                auto result = self.EncodePlus(str, max_length, offset_mapping);
+                return std::make_pair(std::move(result), std::move(offset_mapping));
+            },
+            py::arg("str"), py::arg("max_length") = static_cast<int64_t>(1e15),
+            R"pbdoc(
+            Same as encode_plus, and also return where each token comes from in the input string.
+
+            Args:
+                    query (str): input query to be tokenized
+                    max_length (int): max acceptable length for truncation. default to 1e15
+
+            Returns:
+                    output list of tuple (ids, type ids, attention mask), and list of tuple (begin, end) of each token, the byte offsets in the utf-8 encoded query, (0, 0) for special tokens
+            )pbdoc")
+        .def("encode_batch", &EncodeBatch<BertTokenizer>, py::arg("queries"),
+             py::arg("max_length") = static_cast<int64_t>(1e15), py::arg("padding") = "longest",
+             R"pbdoc(
+            Tokenize a batch of strings in parallel, without holding the GIL, and pad their token indices (ids).
+
+            Args:
+                    queries (List[str]): input queries to be tokenized
+                    max_length (int): max acceptable length for truncation. default to 1e15
+                    padding (str): 'longest' (default) to pad to the longest query, or 'max_length' to pad to max_length plus the special tokens
+
+            Returns:
+                    dict of 'input_ids', 'attention_mask' and 'token_type_ids', each an int64 numpy array of shape [len(queries), padded length]
+            )pbdoc")
+        .def("set_thread_num", &BertTokenizer::SetThreadNum, py::arg("thread_num"),
+             R"pbdoc(
+            Set the number of threads of encode_batch.
+
+            Args:
+                    thread_num (int): number of threads, 0 for one per core (default)
+            )pbdoc")
         .def("decode", &BertTokenizer::Decode, py::arg("ids"), py::arg("skip_special_tokens") = false,
              py::arg("clean_up_tokenization_spaces") = true, R"pbdoc(
             Decode a list of token indices, turn them into a string.
@@ -128,6 +169,17 @@ void init_bert_tokenizer(py::module& m) {
             Returns:
                     output the corresponding string to the list.
         )pbdoc")
+        .def("incremental_decoder", &BertTokenizer::CreateIncrementalDecoder, py::arg("skip_special_tokens") = false,
+             py::arg("clean_up_tokenization_spaces") = true, py::keep_alive<0, 1>(), R"pbdoc(
+            Create a decoder of a stream of token indices, which returns the text of decode piece by piece.
+
+            Args:
+                    skip_special_tokens (bool): should the decoder ignore special tokens. default to false.
+                    clean_up_tokenization_spaces (bool): should the output string be clean up to fit for English.
+
+            Returns:
+                    IncrementalDecoder
+        )pbdoc")
         .def("convert_id_to_token", &BertTokenizer::ConvertIdToToken, py::arg("id"), py::return_value_policy::automatic,
              R"pbdoc(
             Convert token id to token text
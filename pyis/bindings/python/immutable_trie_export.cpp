@@ -78,15 +78,75 @@ void init_immutable_trie(py::module& m) {
                 Returns:
                     result (bool) : True if the trie contains the key, False otherwise.
         )pbdoc")
+        .def(
+            "match_all",
+            [](ImmutableTrie& self, const std::vector<std::string>& tokens) {
+                py::gil_scoped_release release;
+                return self.MatchAll(tokens);
+            },
+            py::arg("tokens"), R"pbdoc(
+                Find all keys made of consecutive tokens in one pass.
+
+                Args:
+                    tokens (List[str]): The token sequence to scan.
+
+                Returns:
+                    hits (List[Tuple[int, int, int]]): (start, end, value) of each key found, start and end are token indices, end is exclusive.
+        )pbdoc")
+        .def(
+            "match_all",
+            [](ImmutableTrie& self, const std::string& sentence) {
+                py::gil_scoped_release release;
+                return self.MatchAll(sentence);
+            },
+            py::arg("sentence"), R"pbdoc(
+                Find all keys made of consecutive space separated tokens of the sentence in one pass.
+
+                Args:
+                    sentence (str): The sentence to scan.
+
+                Returns:
+                    hits (List[Tuple[int, int, int]]): (start, end, value) of each key found, start and end are byte offsets in the utf-8 encoded sentence, end is exclusive.
+        )pbdoc")
+        .def(
+            "match_all_batch",
+            [](ImmutableTrie& self, const std::vector<std::vector<std::string>>& sentences) {
+                py::gil_scoped_release release;
+                return self.MatchAllBatch(sentences);
+            },
+            py::arg("sentences"), R"pbdoc(
+                Batch version of match_all over token sequences.
+
+                Args:
+                    sentences (List[List[str]]): The token sequences to scan.
+
+                Returns:
+                    hits (List[List[Tuple[int, int, int]]]): The hits of each token sequence.
+        )pbdoc")
+        .def(
+            "match_all_batch",
+            [](ImmutableTrie& self, const std::vector<std::string>& sentences) {
+                py::gil_scoped_release release;
+                return self.MatchAllBatch(sentences);
+            },
+            py::arg("sentences"), R"pbdoc(
+                Batch version of match_all over sentences.
+
+                Args:
+                    sentences (List[str]): The sentences to scan.
+
+                Returns:
+                    hits (List[List[Tuple[int, int, int]]]): The hits of each sentence.
+        )pbdoc")
         .def_static(
             "compile",
-            [](const std::vector<std::tuple<std::string, uint32_t>>& data, const std::string& path) {
-                auto result = ImmutableTrie::Compile(data, path);
+            [](const std::vector<std::tuple<std::string, uint32_t>>& data, const std::string& path, bool mapped) {
+                auto result = ImmutableTrie::Compile(data, path, mapped);
                 if (result.has_error()) {
                     throw result.error();
                 }
             },
-            py::arg("data"), py::arg("path"),
+            py::arg("data"), py::arg("path"), py::arg("mapped") = false,
             R"pbdoc(
                 Compile a list of key-value pairs into a immutable trie file. This process could costs lots of memory.
                 Values in the list should not exceeded the presenting capacity of unsigned 32bit integer.
@@ -95,6 +155,7 @@ void init_immutable_trie(py::module& m) {
                 Args:
                     data (List[Tuple[str, int]]): The key-value pairs to be compiled.
                     path (str): The path the compiled file to be stored.
+                    mapped (bool): Write the page aligned format, which is memory mapped when loaded instead of being read into memory. Default to False.
                 
         )pbdoc")
         .def(py::pickle(
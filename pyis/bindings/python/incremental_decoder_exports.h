@@ -0,0 +1,42 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <memory>
+
+#include "pybind11/pybind11.h"
+#include "pybind11/stl.h"
+#include "pyis/ops/tokenizer/incremental_decoder.h"
+
+namespace pyis {
+namespace python {
+
+namespace py = pybind11;
+
+// Register IncrementalDecoder once, for the tokenizers which create it
+inline void init_incremental_decoder(py::module& m) {
+    if (py::hasattr(m, "IncrementalDecoder")) {
+        return;
+    }
+    py::class_<ops::IncrementalDecoder, std::shared_ptr<ops::IncrementalDecoder>>(m, "IncrementalDecoder",
+                                                                                  R"pbdoc(
+            Decode a stream of token indices one at a time, e.g. the output of a generation model.
+
+        )pbdoc")
+        .def("step", &ops::IncrementalDecoder::Step, py::arg("id"), R"pbdoc(
+            Decode one more token index.
+
+            Args:
+                    id (int): token index
+
+            Returns:
+                    the text which is final, empty if the text of id may still change, e.g. when it ends with part of a character.
+        )pbdoc")
+        .def("flush", &ops::IncrementalDecoder::Flush, R"pbdoc(
+            Return the text held back, and start a new stream. The text returned by step and flush adds up to the decode of all the indices.
+        )pbdoc");
+}
+
+}  // namespace python
+}  // namespace pyis
@@ -40,8 +40,33 @@ void init_linear_chain_crf(py::module& m) {
                 Returns:
                     List of labels.
             )pbdoc")
+        .def(
+            "predict_batch",
+            [](LinearChainCRF& self, const std::vector<uint16_t>& lens,
+               const std::vector<std::vector<std::tuple<uint16_t, uint32_t, double>>>& features) {
+                py::gil_scoped_release release;
+                return self.PredictBatch(lens, features);
+            },
+            py::arg("lens"), py::arg("features"),
+            R"pbdoc(
+                Predict a batch of inputs in parallel, without holding the GIL.
+
+                Args:
+                    lens (List[int]): token number of each input.
+                    features (List[List[Tuple[int, int, float]]]): features of each input, as in predict.
+
+                Returns:
+                    List of the labels of each input.
+            )pbdoc")
+        .def("set_thread_num", &LinearChainCRF::SetThreadNum, py::arg("thread_num"),
+             R"pbdoc(
+                Set the number of threads of predict_batch.
+
+                Args:
+                    thread_num (int): number of threads, 0 for one per core (default)
+            )pbdoc")
         .def_static("train", &LinearChainCRF::Train, py::arg("data_file"), py::arg("model_file"),
-                    py::arg("alg") = "l1sgd", py::arg("max_iter") = 150,
+                    py::arg("alg") = "l1sgd", py::arg("max_iter") = 150, py::arg("threads") = 1,
                     R"pbdoc(
                 Train a crf model.
 
@@ -50,8 +75,11 @@ void init_linear_chain_crf(py::module& m) {
                     model_file (str): Target file for the generated model file.
                     alg (str): The training algorithm. 
                                perceptron: `Structured Perceptron <https://people.cs.umass.edu/~brenocon/inlp2015/09-discseq-perc.pdf>`_, 
-                               l1sgd: `Stochastic Gradient Descent Training for L1-regularized Log-linear Models <https://dl.acm.org/doi/pdf/10.5555/1687878.1687946>`_
+                               l1sgd: `Stochastic Gradient Descent Training for L1-regularized Log-linear Models <https://dl.acm.org/doi/pdf/10.5555/1687878.1687946>`_, 
+                               lbfgs: L-BFGS on the gradients of the whole data set
                     max_iter (int): Maximun iterations.
+                    threads (int): Number of threads training with lbfgs or l1sgd, 0 for one per core. l1sgd with
+                        more than one thread updates the weights without locks, so its result varies between runs.
             )pbdoc")
         .def(py::pickle(
             [](LinearChainCRF& self) {
@@ -2,6 +2,7 @@
 // Licensed under the MIT license.
 
 #include <algorithm>
+#include <atomic>
 #include <cstdlib>
 
 #include "pybind11/numpy.h"
@@ -70,15 +71,69 @@ inline std::shared_ptr<Ort::Value> ToOrtTensor(py::buffer_info& buffer_info) {
     return tensor_ptr;
 }
 
+inline std::vector<std::shared_ptr<Ort::Value>> ToOrtTensors(std::vector<py::array>& inputs) {
+    std::vector<std::shared_ptr<Ort::Value>> input_tensors;
+    for (const auto& buffer : inputs) {
+        auto buffer_info = buffer.request();
+        input_tensors.emplace_back(ToOrtTensor(buffer_info));
+    }
+    return input_tensors;
+}
+
+inline std::vector<py::array> ToNumpyArrays(const std::vector<std::shared_ptr<Ort::Value>>& outputs) {
+    std::vector<py::array> ret;
+    ret.reserve(outputs.size());
+
+    for (const auto& output : outputs) {
+        switch (output->GetTensorTypeAndShapeInfo().GetElementType()) {
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT:
+                ret.emplace_back(ConvertToNumpyArray<float>(output));
+                break;
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_BOOL:
+                ret.emplace_back(ConvertToNumpyArray<bool>(output));
+                break;
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64:
+                ret.emplace_back(ConvertToNumpyArray<int64_t>(output));
+                break;
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_DOUBLE:
+                ret.emplace_back(ConvertToNumpyArray<double>(output));
+                break;
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT32:
+                ret.emplace_back(ConvertToNumpyArray<int>(output));
+                break;
+            default:
+                break;
+        }
+    }
+    return ret;
+}
+
+// Python objects a pending run_async request refers to. The callback of the request runs on a batch worker
+// thread, so they must only be released while holding the GIL.
+struct AsyncRunState {
+    py::object loop;
+    py::object future;
+    // keeps the session alive until the result is delivered on the event loop thread. It must never be released
+    // on a worker thread, whose session would then have to join it.
+    std::shared_ptr<OrtSession> session;
+};
+
 void init_ort_session(py::module& m) {
     py::class_<OrtSession, std::shared_ptr<OrtSession>>(m, "OrtSession",
                                                         R"pbdoc(
             Augmented OrtSession ONNX Runtime Session
 
         )pbdoc")
-        .def(py::init<std::string&, std::vector<std::string>&, std::vector<std::string>&, int, int, bool, int>(),
+        .def(py::init<std::string&, std::vector<std::string>&, std::vector<std::string>&, int, int, bool, int, int64_t,
+                      std::vector<int>&, int, bool, bool, std::vector<int>&, std::vector<int>&, std::vector<std::string>&,
+                      std::vector<std::string>&, std::string&>(),
              py::arg("model_path"), py::arg("input_names"), py::arg("output_names"), py::arg("inter_op_thread_num") = 1,
              py::arg("intra_op_thread_num") = 0, py::arg("dynamic_batching") = false, py::arg("batch_size") = 1,
+             py::arg("max_queue_delay_us") = 0, py::arg("preferred_batch_sizes") = std::vector<int>(),
+             py::arg("worker_num") = 1, py::arg("session_per_worker") = false, py::arg("pin_workers") = false,
+             py::arg("padding_buckets") = std::vector<int>(), py::arg("pad_values") = std::vector<int>(),
+             py::arg("sequence_inputs") = std::vector<std::string>(),
+             py::arg("sequence_outputs") = std::vector<std::string>(), py::arg("attention_mask_input") = "",
              R"pbdoc(
                 Create an ORT(ONNX Runtime) Session.
 
@@ -89,7 +144,17 @@ void init_ort_session(py::module& m) {
                     inter_op_thread_num (int): inter-op thread num, default to 1,
                     intra_op_thread_num (int): intra-op thread num, default to 0, use all cores
                     dynamic_batching (bool): use dynamic batching or not,
-                    batch_size (int): dynamic batch size
+                    batch_size (int): dynamic batch size, i.e. the max number of rows along the first dimension of a batch,
+                    max_queue_delay_us (int): how long in microseconds a batch may wait for more requests before it is run, default to 0, run as soon as possible,
+                    preferred_batch_sizes (List[int]): batch sizes that are run right away without waiting for the delay to expire,
+                    worker_num (int): number of threads running batches concurrently, default to 1,
+                    session_per_worker (bool): give each worker its own session, whose intra-op threads default to an equal share of the cores,
+                    pin_workers (bool): bind each worker and its session to its own group of cores, NUMA nodes aware,
+                    padding_buckets (List[int]): sequence lengths to pad the sequence inputs to, so that requests of different lengths share a batch, default to no padding,
+                    pad_values (List[int]): value to pad each input with, default to 0 for all inputs,
+                    sequence_inputs (List[str]): inputs whose second dimension is the sequence length, the only ones padded,
+                    sequence_outputs (List[str]): outputs whose second dimension is the sequence length, cut back to the length of each request after padding,
+                    attention_mask_input (str): int64 input generated by the session instead of passed to run, ones along the sequence length and 0 on the padding, default to none
 
             )pbdoc")
         .def_static("initialize_ort", &OrtSession::InitializeOrt, py::arg("ort_dll_file") = "",
@@ -103,40 +168,12 @@ void init_ort_session(py::module& m) {
         .def(
             "run",
             [](OrtSession& self, std::vector<py::array>& inputs) -> std::vector<py::array> {
-                std::vector<std::shared_ptr<Ort::Value>> input_tensors;
-                for (const auto& buffer : inputs) {
-                    auto buffer_info = buffer.request();
-                    input_tensors.emplace_back(ToOrtTensor(buffer_info));
-                }
+                auto input_tensors = ToOrtTensors(inputs);
                 py::gil_scoped_release release;
                 auto outputs = self.Run(input_tensors);
                 py::gil_scoped_acquire acquire;
 
-                std::vector<py::array> ret;
-                ret.reserve(outputs.size());
-
-                for (const auto& output : outputs) {
-                    switch (output->GetTensorTypeAndShapeInfo().GetElementType()) {
-                        case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT:
-                            ret.emplace_back(ConvertToNumpyArray<float>(output));
-                            break;
-                        case ONNX_TENSOR_ELEMENT_DATA_TYPE_BOOL:
-                            ret.emplace_back(ConvertToNumpyArray<bool>(output));
-                            break;
-                        case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64:
-                            ret.emplace_back(ConvertToNumpyArray<int64_t>(output));
-                            break;
-                        case ONNX_TENSOR_ELEMENT_DATA_TYPE_DOUBLE:
-                            ret.emplace_back(ConvertToNumpyArray<double>(output));
-                            break;
-                        case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT32:
-                            ret.emplace_back(ConvertToNumpyArray<int>(output));
-                            break;
-                        default:
-                            break;
-                    }
-                }
-                return ret;
+                return ToNumpyArrays(outputs);
             },
             R"pbdoc(
             Run Ort Session with input tensors as list of numpy array.
@@ -148,6 +185,77 @@ void init_ort_session(py::module& m) {
                     output tensors as list of numpy array
 
 
+        )pbdoc")
+        .def(
+            "run_async",
+            [](std::shared_ptr<OrtSession> self, std::vector<py::array>& inputs, int64_t timeout_ms) -> py::object {
+                auto input_tensors = ToOrtTensors(inputs);
+
+                // raises before anything is queued when not called from a coroutine of a running loop
+                py::object loop = py::module::import("asyncio").attr("get_running_loop")();
+                py::object future = loop.attr("create_future")();
+
+                // drop the request before its batch runs once the caller cancels the future
+                auto cancelled = std::make_shared<std::atomic<bool>>(false);
+                future.attr("add_done_callback")(py::cpp_function([cancelled](py::object f) {
+                    if (f.attr("cancelled")().cast<bool>()) {
+                        *cancelled = true;
+                    }
+                }));
+
+                auto state = std::shared_ptr<AsyncRunState>(new AsyncRunState{loop, future, self},
+                                                             [](AsyncRunState* p) {
+                                                                 py::gil_scoped_acquire acquire;
+                                                                 delete p;
+                                                             });
+
+                py::gil_scoped_release release;
+                self->RunAsync(
+                    input_tensors,
+                    [state](std::vector<std::shared_ptr<Ort::Value>>& outputs, const std::string& error_message) {
+                        py::gil_scoped_acquire acquire;
+                        py::object result;
+                        if (error_message.empty()) {
+                            result = py::cast(ToNumpyArrays(outputs));
+                        }
+                        auto session = std::move(state->session);
+                        auto set_result = py::cpp_function([future = state->future, result, error_message,
+                                                            session]() {
+                            // the future may have been cancelled meanwhile
+                            if (future.attr("done")().cast<bool>()) {
+                                return;
+                            }
+                            if (error_message.empty()) {
+                                future.attr("set_result")(result);
+                            } else {
+                                future.attr("set_exception")(
+                                    py::module::import("builtins").attr("RuntimeError")(error_message));
+                            }
+                        });
+                        try {
+                            state->loop.attr("call_soon_threadsafe")(set_result);
+                        } catch (py::error_already_set&) {
+                            // the event loop is closed, nobody waits for the result anymore
+                        }
+                    },
+                    timeout_ms, cancelled);
+                py::gil_scoped_acquire acquire;
+
+                return future;
+            },
+            py::arg("inputs"), py::arg("timeout_ms") = 0,
+            R"pbdoc(
+            Queue input tensors to Ort Session without blocking, the outputs are delivered to the running asyncio event loop.
+            Must be called from a coroutine or a callback of that loop, and raises RuntimeError otherwise.
+
+            Args:
+                    inputs (List[numpy.ndarray]): input tensors as list of numpy array.
+                    timeout_ms (int): fail the request if its batch has not run in time, default to 0, no timeout. Cancelling the returned future drops the request before its batch runs.
+
+            Returns:
+                    asyncio.Future resolving to output tensors as list of numpy array. Without dynamic batching, the session runs before run_async returns.
+
+
         )pbdoc")
         .def(py::pickle(
             [](OrtSession& self) {
@@ -55,6 +55,13 @@ void init_ngram_featurizer(py::module& m) {
              R"pbdoc(
                 Extract ngrams given the token list based on known ngrams.
 
+                Args:
+                    tokens (List[str]): The token list.
+             )pbdoc")
+        .def("transform_all_orders", &NGramFeaturizer::TransformAllOrders, py::arg("tokens"),
+             R"pbdoc(
+                Extract known ngrams of every length from 1 to n given the token list, in a single pass.
+
                 Args:
                     tokens (List[str]): The token list.
              )pbdoc")
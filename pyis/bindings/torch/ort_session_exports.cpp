@@ -21,9 +21,18 @@ class OrtSessionAdaptor : public ::torch::CustomClassHolder {
   public:
     OrtSessionAdaptor(const std::string& model_path, const std::vector<std::string>& input_names,
                       const std::vector<std::string>& output_names, int64_t inter_op_thread_num,
-                      int64_t intra_op_thread_num, bool dynamic_batching, int64_t batch_size) {
+                      int64_t intra_op_thread_num, bool dynamic_batching, int64_t batch_size,
+                      int64_t max_queue_delay_us, const std::vector<int64_t>& preferred_batch_sizes, int64_t worker_num,
+                      bool session_per_worker, bool pin_workers, const std::vector<int64_t>& padding_buckets,
+                      const std::vector<int64_t>& pad_values, const std::vector<std::string>& sequence_inputs,
+                      const std::vector<std::string>& sequence_outputs, const std::string& attention_mask_input) {
+        std::vector<int> preferred_sizes(preferred_batch_sizes.begin(), preferred_batch_sizes.end());
+        std::vector<int> buckets(padding_buckets.begin(), padding_buckets.end());
+        std::vector<int> values(pad_values.begin(), pad_values.end());
         obj_ = std::make_shared<OrtSession>(model_path, input_names, output_names, inter_op_thread_num,
-                                            intra_op_thread_num, dynamic_batching, batch_size);
+                                            intra_op_thread_num, dynamic_batching, batch_size, max_queue_delay_us,
+                                            preferred_sizes, worker_num, session_per_worker, pin_workers, buckets,
+                                            values, sequence_inputs, sequence_outputs, attention_mask_input);
     }
 
     explicit OrtSessionAdaptor(std::shared_ptr<OrtSession>& obj) { obj_ = obj; }
@@ -54,11 +63,19 @@ class OrtSessionAdaptor : public ::torch::CustomClassHolder {
 void init_ort_session(::torch::Library& m) {
     m.class_<OrtSessionAdaptor>("OrtSession")
         .def(::torch::init<const std::string&, const std::vector<std::string>&, const std::vector<std::string>&,
-                           int64_t, int64_t, bool, int64_t>(),
+                           int64_t, int64_t, bool, int64_t, int64_t, const std::vector<int64_t>&, int64_t, bool, bool,
+                           const std::vector<int64_t>&, const std::vector<int64_t>&, const std::vector<std::string>&,
+                           const std::vector<std::string>&, const std::string&>(),
              "",
              {torch::arg("model_path"), torch::arg("input_names"), torch::arg("output_names"),
               torch::arg("inter_op_thread_num") = 1, torch::arg("intra_op_thread_num") = 0,
-              torch::arg("dynamic_batching") = false, torch::arg("batch_size") = 1})
+              torch::arg("dynamic_batching") = false, torch::arg("batch_size") = 1,
+              torch::arg("max_queue_delay_us") = 0, torch::arg("preferred_batch_sizes") = std::vector<int64_t>(),
+              torch::arg("worker_num") = 1, torch::arg("session_per_worker") = false,
+              torch::arg("pin_workers") = false, torch::arg("padding_buckets") = std::vector<int64_t>(),
+              torch::arg("pad_values") = std::vector<int64_t>(),
+              torch::arg("sequence_inputs") = std::vector<std::string>(),
+              torch::arg("sequence_outputs") = std::vector<std::string>(), torch::arg("attention_mask_input") = ""})
         .def("run", &OrtSessionAdaptor::run, "", {torch::arg("inputs")})
         .def_static("initialize_ort", &OrtSessionAdaptor::InitializeOrt, "")
         .def_pickle(
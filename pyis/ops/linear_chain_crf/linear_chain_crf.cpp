@@ -23,9 +23,9 @@ LinearChainCRF::LinearChainCRF(const std::string& model_file) : LinearChainCRF()
 LinearChainCRF::~LinearChainCRF() { SparseLinearChainCRFDelete(crf_); }
 
 void LinearChainCRF::Train(const std::string& data_file, const std::string& model_file, const std::string& alg,
-                           int max_iter) {
+                           int max_iter, int threads) {
     std::string tmp_dir = FileSystem::dirname(model_file);
-    SparseLinearChainCRFTrain(model_file.c_str(), data_file.c_str(), tmp_dir.c_str(), alg.c_str(), max_iter);
+    SparseLinearChainCRFTrain(model_file.c_str(), data_file.c_str(), tmp_dir.c_str(), alg.c_str(), max_iter, threads);
 }
 
 std::vector<uint16_t> LinearChainCRF::Predict(uint16_t len,
@@ -33,6 +33,25 @@ std::vector<uint16_t> LinearChainCRF::Predict(uint16_t len,
     return SparseLinearChainCRFDecode(crf_, len, features);
 }
 
+std::vector<std::vector<uint16_t>> LinearChainCRF::PredictBatch(
+    const std::vector<uint16_t>& lens,
+    const std::vector<std::vector<std::tuple<uint16_t, uint32_t, double>>>& features) {
+    if (lens.size() != features.size()) {
+        PYIS_THROW("PredictBatch got %zu lengths and %zu feature lists", lens.size(), features.size());
+    }
+    std::vector<std::vector<uint16_t>> tags(lens.size());
+    std::shared_ptr<ThreadPool> pool = std::atomic_load(&thread_pool_);
+    if (pool == nullptr) {
+        pool = ThreadPool::Default();
+    }
+    pool->ParallelFor(lens.size(), [&](size_t i) { tags[i] = SparseLinearChainCRFDecode(crf_, lens[i], features[i]); });
+    return tags;
+}
+
+void LinearChainCRF::SetThreadNum(size_t thread_num) {
+    std::atomic_store(&thread_pool_, std::make_shared<ThreadPool>(thread_num));
+}
+
 void LinearChainCRF::SaveModel(const std::string& model_file, ModelStorage& storage) {
     auto fp = storage.open_ostream(model_file);
     SparseLinearChainCRFSave(crf_, *(fp.get()));
@@ -3,12 +3,15 @@
 
 #pragma once
 
+#include <memory>
 #include <string>
+#include <tuple>
 #include <vector>
 
 #include "pyis/ops/text/text_feature.h"
 #include "pyis/share/cached_object.h"
 #include "pyis/share/model_storage.h"
+#include "pyis/share/thread_pool.h"
 #include "sparse_linear_chain_crf_api.h"
 
 namespace SparseLinearChainCRF {
@@ -30,9 +33,19 @@ class LinearChainCRF : public CachedObject<LinearChainCRF> {
     LinearChainCRF(const LinearChainCRF& o) = delete;
     LinearChainCRF& operator=(const LinearChainCRF& o) = delete;
 
+    // threads applies to lbfgs, which computes the gradients on that many threads, and to l1sgd, whose threads update
+    // the weights without locks. 0 means one per core.
     static void Train(const std::string& data_file, const std::string& model_file, const std::string& alg,
-                      int max_iter);
+                      int max_iter, int threads = 1);
     std::vector<uint16_t> Predict(uint16_t len, std::vector<std::tuple<uint16_t, uint32_t, double>>& features);
+    // Predict sentence i of lens[i] tokens and features[i] for every i, in parallel. Each thread decodes in its own
+    // buffers, kept from one call to the next.
+    std::vector<std::vector<uint16_t>> PredictBatch(
+        const std::vector<uint16_t>& lens,
+        const std::vector<std::vector<std::tuple<uint16_t, uint32_t, double>>>& features);
+    // Run PredictBatch on thread_num threads, 0 for one per core. The calls of PredictBatch already running keep their
+    // pool.
+    void SetThreadNum(size_t thread_num);
 
     std::string Serialize(ModelStorage& storage);
     void Deserialize(const std::string& state, ModelStorage& storage);
@@ -42,6 +55,9 @@ class LinearChainCRF : public CachedObject<LinearChainCRF> {
     void LoadModel(const std::string& model_file, ModelStorage& storage);
 
     SparseLinearChainCRF::VanillaCRF* crf_;
+    // the default pool if null. Only accessed with std::atomic_load and std::atomic_store, as PredictBatch runs
+    // without the GIL.
+    std::shared_ptr<ThreadPool> thread_pool_;
 };
 
 }  // namespace ops
@@ -34,10 +34,10 @@ void* SparseLinearChainCRFCreate() {
     return crf;
 }
 
-void SparseLinearChainCRFDelete(void* crf) { delete crf; }
+void SparseLinearChainCRFDelete(void* crf) { delete reinterpret_cast<VanillaCRF*>(crf); }
 
 void SparseLinearChainCRFTrain(const char* model_file, const char* data_file, const char* tmp_dir, const char* alg,
-                               int max_iter) {
+                               int max_iter, int threads) {
     CommandFactory cmd_factory;
     std::shared_ptr<ICommand> cmd(nullptr);
 
@@ -61,7 +61,8 @@ void SparseLinearChainCRFTrain(const char* model_file, const char* data_file, co
                    {"sparsity", "0.1"},
                    {"iter.warm", "10"},
                    {"online.decay", "exp"},
-                   {"iter.save", "1"}};
+                   {"iter.save", "1"},
+                   {"threads", std::to_string(threads)}};
     } else if (std::strcmp(alg, "perceptron") == 0) {
         options = {{"verbose", "1"},
                    {"force", "1"},
@@ -70,6 +71,15 @@ void SparseLinearChainCRFTrain(const char* model_file, const char* data_file, co
                    {"algo", alg},
                    {"stream.temp", tmp_dir},
                    {"iter.max", std::to_string(max_iter)}};
+    } else if (std::strcmp(alg, "lbfgs") == 0) {
+        options = {{"verbose", "1"},
+                   {"force", "1"},
+                   {"model", model_file},
+                   {"train", data_file},
+                   {"algo", alg},
+                   {"stream.temp", tmp_dir},
+                   {"iter.max", std::to_string(max_iter)},
+                   {"threads", std::to_string(threads)}};
     } else {
         PYIS_THROW("unknown training algorithm for lccrf");
     }
@@ -117,22 +127,14 @@ void SparseLinearChainCRFDecode(void* crf, int word_cnt, int* word_feat_cnt, int
 }
 
 std::vector<uint16_t> SparseLinearChainCRFDecode(void* crf, uint16_t len,
-                                                 std::vector<std::tuple<uint16_t, uint32_t, double>>& features) {
+                                                 const std::vector<std::tuple<uint16_t, uint32_t, double>>& features) {
     VanillaCRF* obj = reinterpret_cast<VanillaCRF*>(crf);
-    IndexedSentence index_sentence;
-    index_sentence.Resize(len, Word<IndexedParameterType>(0, 1.0, ""));
-    for (auto& f : features) {
-        Word<IndexedParameterType> index_word(0, 1.0, "");
-        // Note: the first argument of FindFeautureIdMap is set to be 1.
-        // It must be the same number when generatring lccrf data file.
-        size_t index_id = obj->m_LinearModel->FindFeautureIdMap(1, std::get<1>(f));
-        if (index_id != INDEX_NOT_FOUND) {
-            index_sentence.GetWord(std::get<0>(f)).Append(std::make_pair(index_id, static_cast<float>(std::get<2>(f))));
-        }
-    }
-
+    // the lattices of a thread grow to its longest sentence, and are reused for the next ones
+    static thread_local VanillaCRF::DecodeWorkspace workspace;
     vector<uint16_t> tags;
-    obj->Decode(index_sentence, tags);
+    // Note: the features are in set 1.
+    // It must be the same number when generatring lccrf data file.
+    obj->Decode(len, features, 1, workspace, tags);
     return tags;
 }
 
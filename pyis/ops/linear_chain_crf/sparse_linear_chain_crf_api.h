@@ -8,13 +8,15 @@
 #include <istream>
 #include <ostream>
 #include <string>
+#include <tuple>
 #include <vector>
 
 void* SparseLinearChainCRFCreate();
 void SparseLinearChainCRFDelete(void* crf);
 
+// threads is the number of threads training with lbfgs or l1sgd, 0 for one per core
 void SparseLinearChainCRFTrain(const char* model_file, const char* data_file, const char* tmp_dir, const char* alg,
-                               int max_iter);
+                               int max_iter, int threads = 1);
 
 void SparseLinearChainCRFLoad(void* crf, const char* model_file);
 void SparseLinearChainCRFLoad(void* crf, std::istream& model_stream);
@@ -22,7 +24,8 @@ void SparseLinearChainCRFSave(void* crf, std::ostream& model_stream);
 
 void SparseLinearChainCRFDecode(void* crf, int word_cnt, int* word_feat_cnt, int* features, std::vector<int>* tags);
 
+// Decode in buffers local to the calling thread, so threads may decode with the same crf concurrently
 std::vector<uint16_t> SparseLinearChainCRFDecode(void* crf, uint16_t len,
-                                                 std::vector<std::tuple<uint16_t, uint32_t, double>>& features);
+                                                 const std::vector<std::tuple<uint16_t, uint32_t, double>>& features);
 
 int32_t GenerateHash(int tag_a, int tag_b);
@@ -0,0 +1,292 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PYIS_CRF_KERNELS_SSE2
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PYIS_CRF_KERNELS_AVX2
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define PYIS_CRF_KERNELS_NEON
+#endif
+
+namespace SparseLinearChainCRF {
+// ------------------------------------------------
+// CRF Kernels
+// One time step of the Viterbi, forward and backward recurrences over N
+// labels. trans[j * N + i] is the transition from label j to label i, so
+// the kernels read whole rows of it and vectorize over i, with AVX2 when
+// the compiler targets it, else SSE2 or NEON, else scalar code only.
+// ------------------------------------------------
+
+// Labels from begin of ViterbiStep, in scalar code.
+template <typename T>
+void ViterbiStepScalar(const T* prev, const T* trans, const T* obs, uint16_t N, T* score, uint16_t* back,
+                       uint16_t begin = 0) {
+    for (uint16_t i = begin; i < N; ++i) {
+        T maxScore = std::numeric_limits<T>::lowest();
+        uint16_t backTracer = UINT16_MAX;
+        for (uint16_t j = 0; j < N; ++j) {
+            T s = prev[j] + trans[j * N + i];
+            if (maxScore < s) {
+                maxScore = s;
+                backTracer = j;
+            }
+        }
+        score[i] = maxScore + obs[i];
+        back[i] = backTracer;
+    }
+}
+
+// Labels from begin of ForwardStep, in scalar code.
+template <typename T>
+void ForwardStepScalar(const T* prev, const T* trans, const T* obs, uint16_t N, T* cur, uint16_t begin = 0) {
+    for (uint16_t i = begin; i < N; ++i) {
+        T sum = 0;
+        for (uint16_t j = 0; j < N; ++j) {
+            sum += trans[j * N + i] * prev[j];
+        }
+        cur[i] = sum * obs[i];
+    }
+}
+
+// BackwardStep in scalar code.
+template <typename T>
+void BackwardStepScalar(const T* column, const T* trans, uint16_t N, T* cur) {
+    for (uint16_t j = 0; j < N; ++j) {
+        T sum = 0;
+        for (uint16_t i = 0; i < N; ++i) {
+            sum += column[i] * trans[j * N + i];
+        }
+        cur[j] = sum;
+    }
+}
+
+#if defined(PYIS_CRF_KERNELS_SSE2) || defined(PYIS_CRF_KERNELS_NEON)
+#define PYIS_CRF_KERNELS_SIMD
+
+// The vector operations the kernels need, for float and double lanes
+template <typename T>
+struct SimdOf;
+
+#if defined(PYIS_CRF_KERNELS_AVX2)
+
+template <>
+struct SimdOf<float> {
+    using Vec = __m256;
+    using Mask = __m256;
+    static const uint16_t WIDTH = 8;
+    static Vec Load(const float* p) { return _mm256_loadu_ps(p); }
+    static void Store(float* p, Vec v) { _mm256_storeu_ps(p, v); }
+    static Vec Set1(float v) { return _mm256_set1_ps(v); }
+    static Vec Add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+    static Vec Mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+    static Mask Greater(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+    static Vec Select(Mask mask, Vec a, Vec b) { return _mm256_blendv_ps(b, a, mask); }
+};
+
+template <>
+struct SimdOf<double> {
+    using Vec = __m256d;
+    using Mask = __m256d;
+    static const uint16_t WIDTH = 4;
+    static Vec Load(const double* p) { return _mm256_loadu_pd(p); }
+    static void Store(double* p, Vec v) { _mm256_storeu_pd(p, v); }
+    static Vec Set1(double v) { return _mm256_set1_pd(v); }
+    static Vec Add(Vec a, Vec b) { return _mm256_add_pd(a, b); }
+    static Vec Mul(Vec a, Vec b) { return _mm256_mul_pd(a, b); }
+    static Mask Greater(Vec a, Vec b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+    static Vec Select(Mask mask, Vec a, Vec b) { return _mm256_blendv_pd(b, a, mask); }
+};
+
+#elif defined(PYIS_CRF_KERNELS_SSE2)
+
+template <>
+struct SimdOf<float> {
+    using Vec = __m128;
+    using Mask = __m128;
+    static const uint16_t WIDTH = 4;
+    static Vec Load(const float* p) { return _mm_loadu_ps(p); }
+    static void Store(float* p, Vec v) { _mm_storeu_ps(p, v); }
+    static Vec Set1(float v) { return _mm_set1_ps(v); }
+    static Vec Add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+    static Vec Mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+    static Mask Greater(Vec a, Vec b) { return _mm_cmpgt_ps(a, b); }
+    static Vec Select(Mask mask, Vec a, Vec b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+};
+
+template <>
+struct SimdOf<double> {
+    using Vec = __m128d;
+    using Mask = __m128d;
+    static const uint16_t WIDTH = 2;
+    static Vec Load(const double* p) { return _mm_loadu_pd(p); }
+    static void Store(double* p, Vec v) { _mm_storeu_pd(p, v); }
+    static Vec Set1(double v) { return _mm_set1_pd(v); }
+    static Vec Add(Vec a, Vec b) { return _mm_add_pd(a, b); }
+    static Vec Mul(Vec a, Vec b) { return _mm_mul_pd(a, b); }
+    static Mask Greater(Vec a, Vec b) { return _mm_cmpgt_pd(a, b); }
+    static Vec Select(Mask mask, Vec a, Vec b) { return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b)); }
+};
+
+#else
+
+template <>
+struct SimdOf<float> {
+    using Vec = float32x4_t;
+    using Mask = uint32x4_t;
+    static const uint16_t WIDTH = 4;
+    static Vec Load(const float* p) { return vld1q_f32(p); }
+    static void Store(float* p, Vec v) { vst1q_f32(p, v); }
+    static Vec Set1(float v) { return vdupq_n_f32(v); }
+    static Vec Add(Vec a, Vec b) { return vaddq_f32(a, b); }
+    static Vec Mul(Vec a, Vec b) { return vmulq_f32(a, b); }
+    static Mask Greater(Vec a, Vec b) { return vcgtq_f32(a, b); }
+    static Vec Select(Mask mask, Vec a, Vec b) { return vbslq_f32(mask, a, b); }
+};
+
+template <>
+struct SimdOf<double> {
+    using Vec = float64x2_t;
+    using Mask = uint64x2_t;
+    static const uint16_t WIDTH = 2;
+    static Vec Load(const double* p) { return vld1q_f64(p); }
+    static void Store(double* p, Vec v) { vst1q_f64(p, v); }
+    static Vec Set1(double v) { return vdupq_n_f64(v); }
+    static Vec Add(Vec a, Vec b) { return vaddq_f64(a, b); }
+    static Vec Mul(Vec a, Vec b) { return vmulq_f64(a, b); }
+    static Mask Greater(Vec a, Vec b) { return vcgtq_f64(a, b); }
+    static Vec Select(Mask mask, Vec a, Vec b) { return vbslq_f64(mask, a, b); }
+};
+
+#endif
+#endif
+
+#ifdef PYIS_CRF_KERNELS_SIMD
+
+// ViterbiStep for the labels from begin, BLOCKS vectors of them at a time, so that the max of each vector is an
+// independent chain of instructions. Return the first label left.
+template <typename T, int BLOCKS>
+uint16_t ViterbiStepBlocks(const T* prev, const T* trans, const T* obs, uint16_t N, T* score, uint16_t* back,
+                           uint16_t begin) {
+    using S = SimdOf<T>;
+    for (; begin + BLOCKS * S::WIDTH <= N; begin += BLOCKS * S::WIDTH) {
+        // the index of the max is tracked in lanes of T, which hold any uint16_t exactly
+        typename S::Vec best[BLOCKS];
+        typename S::Vec arg[BLOCKS];
+        for (int b = 0; b < BLOCKS; ++b) {
+            best[b] = S::Set1(std::numeric_limits<T>::lowest());
+            arg[b] = S::Set1(static_cast<T>(UINT16_MAX));
+        }
+        for (uint16_t j = 0; j < N; ++j) {
+            typename S::Vec from = S::Set1(prev[j]);
+            typename S::Vec label = S::Set1(static_cast<T>(j));
+            const T* row = &trans[j * N + begin];
+            for (int b = 0; b < BLOCKS; ++b) {
+                typename S::Vec s = S::Add(from, S::Load(&row[b * S::WIDTH]));
+                typename S::Mask greater = S::Greater(s, best[b]);
+                best[b] = S::Select(greater, s, best[b]);
+                arg[b] = S::Select(greater, label, arg[b]);
+            }
+        }
+        T args[BLOCKS * S::WIDTH];
+        for (int b = 0; b < BLOCKS; ++b) {
+            S::Store(&score[begin + b * S::WIDTH], S::Add(best[b], S::Load(&obs[begin + b * S::WIDTH])));
+            S::Store(&args[b * S::WIDTH], arg[b]);
+        }
+        for (int k = 0; k < BLOCKS * S::WIDTH; ++k) {
+            back[begin + k] = static_cast<uint16_t>(args[k]);
+        }
+    }
+    return begin;
+}
+
+// ForwardStep for the labels from begin, BLOCKS vectors of them at a time. Return the first label left.
+template <typename T, int BLOCKS>
+uint16_t ForwardStepBlocks(const T* prev, const T* trans, const T* obs, uint16_t N, T* cur, uint16_t begin) {
+    using S = SimdOf<T>;
+    for (; begin + BLOCKS * S::WIDTH <= N; begin += BLOCKS * S::WIDTH) {
+        typename S::Vec sum[BLOCKS];
+        for (int b = 0; b < BLOCKS; ++b) {
+            sum[b] = S::Set1(0);
+        }
+        for (uint16_t j = 0; j < N; ++j) {
+            typename S::Vec from = S::Set1(prev[j]);
+            const T* row = &trans[j * N + begin];
+            for (int b = 0; b < BLOCKS; ++b) {
+                sum[b] = S::Add(sum[b], S::Mul(S::Load(&row[b * S::WIDTH]), from));
+            }
+        }
+        for (int b = 0; b < BLOCKS; ++b) {
+            S::Store(&cur[begin + b * S::WIDTH], S::Mul(sum[b], S::Load(&obs[begin + b * S::WIDTH])));
+        }
+    }
+    return begin;
+}
+
+#endif
+
+// Max-plus step of Viterbi: score[i] = max_j(prev[j] + trans[j * N + i]) + obs[i], and back[i] is the first j of the
+// max, or UINT16_MAX if there is none. The same as ViterbiStepScalar, bit for bit.
+template <typename T>
+void ViterbiStep(const T* prev, const T* trans, const T* obs, uint16_t N, T* score, uint16_t* back) {
+    uint16_t begin = 0;
+#ifdef PYIS_CRF_KERNELS_SIMD
+    begin = ViterbiStepBlocks<T, 4>(prev, trans, obs, N, score, back, begin);
+    begin = ViterbiStepBlocks<T, 1>(prev, trans, obs, N, score, back, begin);
+#endif
+    ViterbiStepScalar(prev, trans, obs, N, score, back, begin);
+}
+
+// Sum-product step of the forward algorithm: cur[i] = sum_j(prev[j] * trans[j * N + i]) * obs[i]. The same as
+// ForwardStepScalar, bit for bit, since every lane adds up the terms in the same order.
+template <typename T>
+void ForwardStep(const T* prev, const T* trans, const T* obs, uint16_t N, T* cur) {
+    uint16_t begin = 0;
+#ifdef PYIS_CRF_KERNELS_SIMD
+    begin = ForwardStepBlocks<T, 4>(prev, trans, obs, N, cur, begin);
+    begin = ForwardStepBlocks<T, 1>(prev, trans, obs, N, cur, begin);
+#endif
+    ForwardStepScalar(prev, trans, obs, N, cur, begin);
+}
+
+// Sum-product step of the backward algorithm: cur[j] = sum_i(column[i] * trans[j * N + i]), where column is the
+// next beta times its observations. The lanes of 2 vectors add up the terms in another order than
+// BackwardStepScalar, so the sums may differ in the last bits.
+template <typename T>
+void BackwardStep(const T* column, const T* trans, uint16_t N, T* cur) {
+#ifdef PYIS_CRF_KERNELS_SIMD
+    using S = SimdOf<T>;
+    uint16_t end = N - N % (2 * S::WIDTH);
+    for (uint16_t j = 0; j < N; ++j) {
+        const T* row = &trans[j * N];
+        typename S::Vec sums[2] = {S::Set1(0), S::Set1(0)};
+        for (uint16_t i = 0; i < end; i += 2 * S::WIDTH) {
+            sums[0] = S::Add(sums[0], S::Mul(S::Load(&column[i]), S::Load(&row[i])));
+            sums[1] = S::Add(sums[1], S::Mul(S::Load(&column[i + S::WIDTH]), S::Load(&row[i + S::WIDTH])));
+        }
+        T lanes[S::WIDTH];
+        S::Store(lanes, S::Add(sums[0], sums[1]));
+        T sum = 0;
+        for (uint16_t k = 0; k < S::WIDTH; ++k) {
+            sum += lanes[k];
+        }
+        for (uint16_t i = end; i < N; ++i) {
+            sum += column[i] * row[i];
+        }
+        cur[j] = sum;
+    }
+#else
+    BackwardStepScalar(column, trans, N, cur);
+#endif
+}
+
+}  // namespace SparseLinearChainCRF
@@ -13,6 +13,9 @@ namespace SparseLinearChainCRF {
 using namespace std;
 
 namespace {
+// sentences whose transition gradients the threads sum before the transition weights are updated
+const size_t SENTENCES_PER_ROUND = 16;
+
 void AddVec(vector<float>& vec_a, const vector<float>& vec_b) {
     LogAssert(vec_a.size() == vec_b.size(), "vec_a.size() == vec_b.size()");
 
@@ -33,7 +36,7 @@ inline void ApplyPenalty(float* weight, float* penalty, size_t fid, float u) {
 }
 
 void UpdateNodeWeight(const Word<IndexedParameterType>& word, const float* prob, float l, float u,
-                      shared_ptr<SparseLinearModel> linearModel, vector<float>& penalty) {
+                      const shared_ptr<SparseLinearModel>& linearModel, vector<float>& penalty) {
     LogAssert(linearModel != nullptr, "Model is null");
     float* weight = linearModel->WeightVector().data();
     for (const IndexedParameterType& feature : word.Features()) {
@@ -47,33 +50,28 @@ void UpdateNodeWeight(const Word<IndexedParameterType>& word, const float* prob,
     }
 }
 
-void UpdateEdgeWeightOverSentence(const float* empiricalCount, const float* prob, float l, float u,
-                                  shared_ptr<SparseLinearModel> linearModel, vector<float>& penalty) {
+// Add the gradient of the transition weights over a sentence, times the learning rate l, to gradient
+void AddEdgeGradient(const float* empiricalCount, const float* prob, float l, size_t N, float* gradient) {
+    for (size_t i = 0; i < N * N; ++i) {
+        gradient[i] += l * (empiricalCount[i] - prob[i]);
+    }
+}
+
+void UpdateEdgeWeight(const float* gradient, float u, const shared_ptr<SparseLinearModel>& linearModel,
+                      vector<float>& penalty) {
     LogAssert(linearModel != nullptr, "Model is null");
-    uint16_t N = linearModel->MaxLabel();
-    float* transitionCache = linearModel->GetTransitionCache();
-    for (uint16_t outgoing = 0; outgoing < N; ++outgoing) {
-        float* trans = &transitionCache[outgoing * N];
-        const float* expectedProb = &prob[outgoing * N];
-        const float* empiricalProb = &empiricalCount[outgoing * N];
-        for (uint16_t incoming = 0; incoming < N; ++incoming) {
-            float delta = empiricalProb[incoming] - expectedProb[incoming];
-            trans[incoming] += l * delta;
-            size_t fid = outgoing * N + incoming;
-            float z = trans[incoming];
-            if (z > 0) {
-                trans[incoming] = max(0.0f, trans[incoming] - (u + penalty[fid]));
-            } else {
-                trans[incoming] = min(0.0f, trans[incoming] + (u - penalty[fid]));
-            }
-            penalty[fid] += trans[incoming] - z;
-        }
+    size_t N = linearModel->MaxLabel();
+    float* trans = linearModel->GetTransitionCache();
+    for (size_t fid = 0; fid < N * N; ++fid) {
+        trans[fid] += gradient[fid];
+        ApplyPenalty(trans, penalty.data(), fid, u);
     }
 }
 }  // namespace
 
 CumulativeL1SGDLearner::CumulativeL1SGDLearner() {
     m_OptionDesc["sparsity"] = "0.1";  // "float, Sparsity parameter (i.e. L1 penality parameter)"
+    m_OptionDesc["threads"] = "1";     // "int, threads updating the weights asynchronously, 0 for one per core"
 }
 
 void CumulativeL1SGDLearner::Initialize(shared_ptr<ILinearChainCRF> crf, shared_ptr<SparseLinearModel> model,
@@ -88,6 +86,42 @@ void CumulativeL1SGDLearner::Initialize(shared_ptr<ILinearChainCRF> crf, shared_
     size_t N = m_LinearModel->MaxLabel();
     m_CumulativeL1PenalizedTransitionWeight.resize(N * N);
     memset(m_CumulativeL1PenalizedTransitionWeight.data(), 0, sizeof(float) * N * N);
+
+    int threads = std::stoi(m_Options["threads"]);
+    LogAssert(threads >= 0, "threads must be 0 or positive, got %d", threads);
+    m_ThreadPool = threads == 1 ? nullptr : std::make_shared<pyis::ThreadPool>(threads);
+}
+
+double CumulativeL1SGDLearner::UpdateOverSentence(const IndexedSentence& sentence, float learningRate,
+                                                  float* edgeGradient) {
+    uint16_t N = m_LinearModel->MaxLabel();
+    uint16_t T = (uint16_t)sentence.Size();
+
+    std::vector<float> probNode(T * N, 0.0f);
+    std::vector<float> probEdge(N * N, 0.0f);
+
+    double logli = m_CRF->Infer(sentence, probNode.data(), probEdge.data());
+    LogAssert(!std::isnan(logli), "Log-likelihood is NaN");
+    LogAssert(std::isfinite(logli), "Log-likelihood is infinite");
+
+    std::vector<float> empiricalCountOfTransition(N * N, 0.0f);
+    uint16_t prevLabel = 0;
+    for (int t = 0; t < T; ++t) {
+        const auto& word = sentence.GetWord(t);
+        uint16_t label = word.GetLabel();
+
+        // Update node parameters
+        UpdateNodeWeight(word, &probNode[t * N], learningRate, m_CumulativeL1Penalty, m_LinearModel,
+                         m_CumulativeL1PenalizedWeight);
+
+        // Update edge parameters
+        if (t > 0) {
+            empiricalCountOfTransition[prevLabel * N + label] += 1.0;
+        }
+        prevLabel = label;
+    }
+    AddEdgeGradient(empiricalCountOfTransition.data(), probEdge.data(), learningRate, N, edgeGradient);
+    return logli;
 }
 
 double CumulativeL1SGDLearner::SinglePassTraining(shared_ptr<StreamDataManager> trainData,
@@ -95,41 +129,48 @@ double CumulativeL1SGDLearner::SinglePassTraining(shared_ptr<StreamDataManager>
     // UNREFERENCED_PARAMETER(devData);
     m_CumulativeL1Penalty += learningRate * m_L1Penalty;
 
-    uint16_t N = m_LinearModel->MaxLabel();
     double ontheflyLL = 0.0;
 
-    while (!trainData->Empty()) {
-        const auto& trainSet = trainData->Next();
-        for (const auto& sentence : trainSet) {
-            uint16_t T = (uint16_t)sentence.Size();
-
-            std::vector<float> probNode(T * N, 0.0f);
-            std::vector<float> probEdge(N * N, 0.0f);
-
-            double logli = m_CRF->Infer(sentence, probNode.data(), probEdge.data());
-            LogAssert(!std::isnan(logli), "Log-likelihood is NaN");
-            LogAssert(std::isfinite(logli), "Log-likelihood is infinite");
-            ontheflyLL += logli;
-
-            std::vector<float> empiricalCountOfTransition(N * N, 0.0f);
-            memset(empiricalCountOfTransition.data(), 0, sizeof(float) * N * N);
-            uint16_t prevLabel = 0;
-            for (int t = 0; t < T; ++t) {
-                const auto& word = sentence.GetWord(t);
-                uint16_t label = word.GetLabel();
-
-                // Update node parameters
-                UpdateNodeWeight(word, &probNode[t * N], learningRate, m_CumulativeL1Penalty, m_LinearModel,
-                                 m_CumulativeL1PenalizedWeight);
-
-                // Update edge parameters
-                if (t > 0) {
-                    empiricalCountOfTransition[prevLabel * N + label] += 1.0;
+    size_t N = m_LinearModel->MaxLabel();
+    if (m_ThreadPool == nullptr) {
+        vector<float> edgeGradient(N * N);
+        while (!trainData->Empty()) {
+            for (const auto& sentence : trainData->Next()) {
+                std::fill(edgeGradient.begin(), edgeGradient.end(), 0.0f);
+                ontheflyLL += UpdateOverSentence(sentence, learningRate, edgeGradient.data());
+                UpdateEdgeWeight(edgeGradient.data(), m_CumulativeL1Penalty, m_LinearModel,
+                                 m_CumulativeL1PenalizedTransitionWeight);
+            }
+        }
+    } else {
+        // The cumulative penalty only grows between passes, so the threads share it. The penalty applied to each
+        // weight is shared as the weight is, since the copies of a thread would apply the penalty once per thread.
+        // Every sentence updates all the transition weights, so the threads run rounds of a few sentences, each
+        // summing their transition gradient on its own, and the sums are applied between the rounds.
+        size_t shards = m_ThreadPool->size();
+        vector<double> shardLL(shards, 0.0);
+        vector<vector<float>> shardEdgeGradient(shards, vector<float>(N * N));
+        while (!trainData->Empty()) {
+            const auto& trainSet = trainData->Next();
+            for (size_t begin = 0; begin < trainSet.size(); begin += SENTENCES_PER_ROUND) {
+                size_t count = std::min(SENTENCES_PER_ROUND, trainSet.size() - begin);
+                m_ThreadPool->ParallelFor(shards, [&](size_t shard) {
+                    vector<float>& edgeGradient = shardEdgeGradient[shard];
+                    std::fill(edgeGradient.begin(), edgeGradient.end(), 0.0f);
+                    size_t end = begin + count * (shard + 1) / shards;
+                    for (size_t i = begin + count * shard / shards; i < end; ++i) {
+                        shardLL[shard] += UpdateOverSentence(trainSet[i], learningRate, edgeGradient.data());
+                    }
+                });
+                for (size_t shard = 1; shard < shards; ++shard) {
+                    AddVec(shardEdgeGradient[0], shardEdgeGradient[shard]);
                 }
-                prevLabel = label;
+                UpdateEdgeWeight(shardEdgeGradient[0].data(), m_CumulativeL1Penalty, m_LinearModel,
+                                 m_CumulativeL1PenalizedTransitionWeight);
             }
-            UpdateEdgeWeightOverSentence(empiricalCountOfTransition.data(), probEdge.data(), learningRate,
-                                         m_CumulativeL1Penalty, m_LinearModel, m_CumulativeL1PenalizedTransitionWeight);
+        }
+        for (double ll : shardLL) {
+            ontheflyLL += ll;
         }
     }
     m_LinearModel->BackPropagateTransitionWeight();
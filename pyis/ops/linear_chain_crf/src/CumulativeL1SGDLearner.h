@@ -10,6 +10,7 @@
 #include "Common.h"
 #include "ILinearChainCRF.h"
 #include "SparseLinearModel.h"
+#include "pyis/share/thread_pool.h"
 
 namespace SparseLinearChainCRF {
 // ------------------------------------------------
@@ -19,6 +20,13 @@ namespace SparseLinearChainCRF {
 // ACL 2009. This algorithm updates the weight vector by SGD for a
 // single example (aka Perceptron-style update) and then applies L1
 // penalty for clipping.
+// With more than one thread, the sentences of a chunk are split among
+// the threads, which update the shared feature weights without locks as
+// in Hogwild! (Niu et al., NIPS 2011). The feature updates of a sentence
+// are sparse, so they rarely overlap, and the ones lost to a race are
+// tolerated. The transition weights are dense, so the threads run rounds
+// of a few sentences, summing their transition gradients on their own,
+// and the sums are applied between the rounds.
 // ------------------------------------------------
 class CumulativeL1SGDLearner : public BaseSupervisedLearner {
   public:
@@ -30,10 +38,14 @@ class CumulativeL1SGDLearner : public BaseSupervisedLearner {
   private:
     virtual double SinglePassTraining(std::shared_ptr<StreamDataManager> trainData,
                                       std::shared_ptr<StreamDataManager> devData, float learningRate);
+    // Update the feature weights by the gradient of sentence, add the gradient of the transition weights times the
+    // learning rate to edgeGradient, and return the log-likelihood of sentence
+    double UpdateOverSentence(const IndexedSentence& sentence, float learningRate, float* edgeGradient);
 
     std::vector<float> m_CumulativeL1PenalizedWeight;
     std::vector<float> m_CumulativeL1PenalizedTransitionWeight;
     float m_CumulativeL1Penalty;
     float m_L1Penalty;
+    std::shared_ptr<pyis::ThreadPool> m_ThreadPool;
 };
 }  // namespace SparseLinearChainCRF
\ No newline at end of file
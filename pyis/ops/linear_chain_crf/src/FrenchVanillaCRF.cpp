@@ -23,8 +23,8 @@ void FrenchVanillaCRF::Initialize(shared_ptr<SparseLinearModel> model) {
         m_SparseTransition.push_back(emptyVector);
         size_t id = m_LinearModel->FindFeautureIdMap(EDGE_FEATURE_SET, i);
         if (id != INDEX_NOT_FOUND) {
-            for (const auto& iter : m_LinearModel->FindWeightIds(id)) {
-                m_SparseTransition[i].push_back(iter.first);
+            for (const auto& param : m_LinearModel->FindParameterVector(id)) {
+                m_SparseTransition[i].push_back(param.first);
                 count += 1;
             }
         }
@@ -23,7 +23,7 @@ using namespace std;
 
 namespace {
 void UpdateNodeGradient(const Word<IndexedParameterType>& word, const float* prob,
-                        shared_ptr<SparseLinearModel> linearModel, vector<float>& gradient) {
+                        const shared_ptr<SparseLinearModel>& linearModel, vector<float>& gradient) {
     LogAssert(linearModel != nullptr, "Model is null");
     for (const IndexedParameterType& feature : word.Features()) {
         size_t id = feature.first;
@@ -38,7 +38,7 @@ void UpdateNodeGradient(const Word<IndexedParameterType>& word, const float* pro
 }
 
 void UpdateEdgeGradientOverSentence(const float* empiricalCount, const float* prob,
-                                    shared_ptr<SparseLinearModel> linearModel, vector<float>& gradient) {
+                                    const shared_ptr<SparseLinearModel>& linearModel, vector<float>& gradient) {
     LogAssert(linearModel != nullptr, "Model is null");
     uint16_t N = linearModel->MaxLabel();
     for (uint16_t outgoing = 0; outgoing < N; ++outgoing) {
@@ -60,6 +60,7 @@ void UpdateEdgeGradientOverSentence(const float* empiricalCount, const float* pr
 LBFGSLearner::LBFGSLearner() {
     m_OptionDesc["l1"] = "0.0";  // "float, L1 regularizer parameter"
     m_OptionDesc["l2"] = "0.0";  // "float, L2 regularizer parameter"
+    m_OptionDesc["threads"] = "1";  // "int, threads computing the gradient, 0 for one per core"
 }
 
 void LBFGSLearner::Initialize(shared_ptr<ILinearChainCRF> crf, shared_ptr<SparseLinearModel> model,
@@ -67,6 +68,34 @@ void LBFGSLearner::Initialize(shared_ptr<ILinearChainCRF> crf, shared_ptr<Sparse
     BaseSupervisedLearner::Initialize(crf, model, options);
     m_L1Penalty = std::stof(m_Options["l1"]);
     m_L2Penalty = std::stof(m_Options["l2"]);
+    int threads = std::stoi(m_Options["threads"]);
+    LogAssert(threads >= 0, "threads must be 0 or positive, got %d", threads);
+    m_ThreadPool = threads == 1 ? nullptr : std::make_shared<pyis::ThreadPool>(threads);
+}
+
+double LBFGSLearner::AccumulateGradient(const IndexedSentence& sentence, vector<float>& gradient) const {
+    uint16_t N = m_LinearModel->MaxLabel();
+    uint16_t T = (uint16_t)sentence.Size();
+    std::vector<float> probNode(T * N, 0.0f);
+    std::vector<float> probEdge(N * N, 0.0f);
+    double logli = m_CRF->Infer(sentence, probNode.data(), probEdge.data());
+    LogAssert(!std::isnan(logli), "Log-likelihood is NaN");
+    LogAssert(std::isfinite(logli), "Log-likelihood is infinite");
+
+    std::vector<float> empiricalCountOfTransition(N * N, 0.0f);
+    uint16_t prevLabel = 0;
+    for (int t = 0; t < T; ++t) {
+        const auto& word = sentence.GetWord(t);
+        uint16_t label = word.GetLabel();
+        UpdateNodeGradient(word, &probNode[t * N], m_LinearModel, gradient);
+
+        if (t > 0) {
+            empiricalCountOfTransition[prevLabel * N + label] += 1.0f;
+        }
+        prevLabel = label;
+    }
+    UpdateEdgeGradientOverSentence(empiricalCountOfTransition.data(), probEdge.data(), m_LinearModel, gradient);
+    return logli;
 }
 
 double LBFGSLearner::SinglePassTraining(shared_ptr<StreamDataManager> trainData, shared_ptr<StreamDataManager> devData,
@@ -76,36 +105,46 @@ double LBFGSLearner::SinglePassTraining(shared_ptr<StreamDataManager> trainData,
 
     LBFGS lbfgsSolver;
     vector<float> gradientVector(m_LinearModel->Size());
-
-    uint16_t N = m_LinearModel->MaxLabel();
     double ontheflyLL = 0.0;
 
-    while (!trainData->Empty()) {
-        const auto& trainSet = trainData->Next();
-        for (const auto& sentence : trainSet) {
-            uint16_t T = (uint16_t)sentence.Size();
-            std::vector<float> probNode(T * N, 0.0f);
-            std::vector<float> probEdge(N * N, 0.0f);
-            double logli = m_CRF->Infer(sentence, probNode.data(), probEdge.data());
-            LogAssert(!std::isnan(logli), "Log-likelihood is NaN");
-            LogAssert(std::isfinite(logli), "Log-likelihood is infinite");
-            ontheflyLL -= logli;
-
-            std::vector<float> empiricalCountOfTransition(N * N, 0.0f);
-            memset(empiricalCountOfTransition.data(), 0, sizeof(float) * N * N);
-            uint16_t prevLabel = 0;
-            for (int t = 0; t < T; ++t) {
-                const auto& word = sentence.GetWord(t);
-                uint16_t label = word.GetLabel();
-                UpdateNodeGradient(word, &probNode[t * N], m_LinearModel, gradientVector);
-
-                if (t > 0) {
-                    empiricalCountOfTransition[prevLabel * N + label] += 1.0f;
+    if (m_ThreadPool == nullptr) {
+        while (!trainData->Empty()) {
+            for (const auto& sentence : trainData->Next()) {
+                ontheflyLL -= AccumulateGradient(sentence, gradientVector);
+            }
+        }
+    } else {
+        // shard 0 accumulates into gradientVector itself
+        size_t shards = m_ThreadPool->size();
+        m_ShardGradients.resize(shards - 1);
+        for (auto& shardGradient : m_ShardGradients) {
+            shardGradient.assign(m_LinearModel->Size(), 0.0f);
+        }
+        vector<double> shardLL(shards, 0.0);
+        while (!trainData->Empty()) {
+            const auto& trainSet = trainData->Next();
+            m_ThreadPool->ParallelFor(shards, [&](size_t shard) {
+                vector<float>& gradient = shard == 0 ? gradientVector : m_ShardGradients[shard - 1];
+                size_t end = trainSet.size() * (shard + 1) / shards;
+                for (size_t i = trainSet.size() * shard / shards; i < end; ++i) {
+                    shardLL[shard] -= AccumulateGradient(trainSet[i], gradient);
+                }
+            });
+        }
+
+        // reduce blocks of the parameters in parallel, adding the shards in the same order for every block
+        const size_t blockSize = 1 << 16;
+        size_t blocks = (gradientVector.size() + blockSize - 1) / blockSize;
+        m_ThreadPool->ParallelFor(blocks, [&](size_t block) {
+            size_t end = std::min(gradientVector.size(), (block + 1) * blockSize);
+            for (const auto& shardGradient : m_ShardGradients) {
+                for (size_t i = block * blockSize; i < end; ++i) {
+                    gradientVector[i] += shardGradient[i];
                 }
-                prevLabel = label;
             }
-            UpdateEdgeGradientOverSentence(empiricalCountOfTransition.data(), probEdge.data(), m_LinearModel,
-                                           gradientVector);
+        });
+        for (double ll : shardLL) {
+            ontheflyLL += ll;
         }
     }
 
@@ -11,6 +11,7 @@
 #include "ILinearChainCRF.h"
 #include "SparseLinearModel.h"
 #include "StreamDataManager.h"
+#include "pyis/share/thread_pool.h"
 
 namespace SparseLinearChainCRF {
 // ------------------------------------------------
@@ -27,8 +28,14 @@ class LBFGSLearner : public BaseSupervisedLearner {
   private:
     virtual double SinglePassTraining(std::shared_ptr<StreamDataManager> trainData,
                                       std::shared_ptr<StreamDataManager> devData, float learningRate);
+    // Add the gradient of the negative log-likelihood of sentence to gradient, and return the log-likelihood
+    double AccumulateGradient(const IndexedSentence& sentence, std::vector<float>& gradient) const;
 
     float m_L1Penalty;
     float m_L2Penalty;
+    // Each chunk is split into one shard of sentences per thread, and every shard has its own gradient, which are
+    // summed in shard order at the end of the pass. The result only depends on the number of threads.
+    std::shared_ptr<pyis::ThreadPool> m_ThreadPool;
+    std::vector<std::vector<float>> m_ShardGradients;
 };
 }  // namespace SparseLinearChainCRF
\ No newline at end of file
@@ -26,10 +26,9 @@ void UpdateNodeWeight(const Word<IndexedParameterType>& word, uint16_t label, fl
     for (const IndexedParameterType& feature : word.Features()) {
         size_t id = feature.first;
         float val = feature.second;
-        const auto& paramIndex = linearModel->FindWeightIds(id);
-        const auto& iter = paramIndex.find(label);
-        if (iter != paramIndex.end()) {
-            weight[iter->second] += delta * val;
+        size_t paramId = linearModel->FindParameterId(id, label);
+        if (paramId != INDEX_NOT_FOUND) {
+            weight[paramId] += delta * val;
         }
     }
 }
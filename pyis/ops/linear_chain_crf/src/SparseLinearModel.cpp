@@ -3,10 +3,10 @@
 
 #include "SparseLinearModel.h"
 
+#include <algorithm>
 #include <cstring>
 #include <fstream>
 #include <iostream>
-#include <map>
 #include <string>
 #include <tuple>
 #include <unordered_map>
@@ -19,8 +19,6 @@ namespace SparseLinearChainCRF {
 using namespace std;
 
 namespace {
-std::unordered_map<uint16_t, size_t> defaultAttribute;
-
 void PushIndex(unordered_map<uint32_t, size_t>& featureToUid, vector<unordered_map<uint16_t, size_t>>& weightIndex,
                uint32_t featId, uint16_t labId, size_t paramId) {
     if (featureToUid.find(featId) == featureToUid.end()) {
@@ -37,11 +35,23 @@ void PushIndex(unordered_map<uint32_t, size_t>& featureToUid, vector<unordered_m
     }
 }
 
+// power of 2 with at most half of the slots used
+size_t SlotCount(size_t count) {
+    size_t slots = 16;
+    while (slots < count * 2) {
+        slots *= 2;
+    }
+    return slots;
+}
+
+// Fibonacci hashing, which spreads the consecutive feature ids
+size_t HashFeature(uint32_t featId) { return static_cast<size_t>((featId * 0x9E3779B97F4A7C15ULL) >> 32); }
+
 const int HEADER_SIZE = 4096;
 const char* V1_MAGIC_WORD = "__LCCRF__v1";
 }  // namespace
 
-SparseLinearModel::SparseLinearModel() : m_MaxLabelState(0) {}
+SparseLinearModel::SparseLinearModel() : m_ParameterOffsets(1, 0), m_MaxLabelState(0) {}
 
 SparseLinearModel::SparseLinearModel(const string& filename) {
     ifstream stream(filename, ios::in | ios::binary);
@@ -60,11 +70,14 @@ void SparseLinearModel::Reset(const std::vector<float>& vec) {
 }
 
 bool SparseLinearModel::Serialize(ostream& stream) const {
-    size_t bytesToWrite = (m_FeatureToUid.size() + 1) * sizeof(uint32_t) * 2 +
+    uint32_t featureSetSize = (uint32_t)m_FeatureTables.size();
+    size_t bytesToWrite = (featureSetSize + 1) * sizeof(uint32_t) * 2 +
                           m_WeightVector.size() * (sizeof(uint16_t) + sizeof(float)) + HEADER_SIZE;
 
-    for (const auto& featureIndex : m_FeatureToUid) {
-        bytesToWrite += featureIndex.size() * (sizeof(uint32_t) + sizeof(uint16_t));
+    vector<vector<pair<uint32_t, size_t>>> orderedFeatureIndexes;
+    for (uint32_t featureSetIter = 0; featureSetIter < featureSetSize; ++featureSetIter) {
+        orderedFeatureIndexes.push_back(SortedFeatures(featureSetIter));
+        bytesToWrite += orderedFeatureIndexes.back().size() * (sizeof(uint32_t) + sizeof(uint16_t));
     }
 
     stream.write((char*)&bytesToWrite, sizeof(uint32_t));
@@ -74,29 +87,25 @@ bool SparseLinearModel::Serialize(ostream& stream) const {
     strcpy(header, V1_MAGIC_WORD);
     stream.write(header, HEADER_SIZE);
 
-    uint32_t featureSetSize = (uint32_t)m_FeatureToUid.size();
-
     uint32_t m_MaxLabelState32 = (uint32_t)m_MaxLabelState;
     stream.write((char*)&m_MaxLabelState32, sizeof(uint32_t));
     stream.write((char*)&featureSetSize, sizeof(uint32_t));
 
     size_t paramsWritten = 0;
     for (uint32_t featureSetIter = 0; featureSetIter < featureSetSize; ++featureSetIter) {
-        const auto& featureIndex = m_FeatureToUid[featureSetIter];
-        uint32_t numFeatures = (uint32_t)featureIndex.size();
+        const auto& orderedFeatureIndex = orderedFeatureIndexes[featureSetIter];
+        uint32_t numFeatures = (uint32_t)orderedFeatureIndex.size();
         stream.write((char*)&featureSetIter, sizeof(uint32_t));
         stream.write((char*)&numFeatures, sizeof(uint32_t));
 
-        map<uint32_t, size_t> orderedFeatureIndex(featureIndex.begin(), featureIndex.end());
         for (const auto& featureIndexIter : orderedFeatureIndex) {
             uint32_t featureId = featureIndexIter.first;
-            const auto& attributeList = m_WeightIndex[featureIndexIter.second];
+            ParameterRange orderedAttribute = FindParameterVector(featureIndexIter.second);
 
-            uint16_t numAttribute = (uint16_t)attributeList.size();
+            uint16_t numAttribute = (uint16_t)orderedAttribute.size();
             stream.write((char*)&featureId, sizeof(uint32_t));
             stream.write((char*)&numAttribute, sizeof(uint16_t));
 
-            map<uint16_t, size_t> orderedAttribute(attributeList.begin(), attributeList.end());
             for (const auto& attribute : orderedAttribute) {
                 uint16_t labelId = attribute.first;
                 float weight = m_WeightVector[attribute.second];
@@ -116,22 +125,9 @@ bool SparseLinearModel::Serialize(ostream& stream) const {
 }
 
 bool SparseLinearModel::Serialize(const std::string& txtModelFile) const {
-    size_t bytesToWrite = (m_FeatureToUid.size() + 1) * sizeof(uint32_t) * 2 +
-                          m_WeightVector.size() * (sizeof(uint16_t) + sizeof(float)) + HEADER_SIZE;
-
-    for (const auto& featureIndex : m_FeatureToUid) {
-        bytesToWrite += featureIndex.size() * (sizeof(uint32_t) + sizeof(uint16_t));
-    }
-
     std::ofstream txtModel(txtModelFile.c_str(), std::ofstream::out);
 
-    char header[HEADER_SIZE];
-    memset(header, 0, HEADER_SIZE);
-    strcpy(header, V1_MAGIC_WORD);
-
-    uint32_t featureSetSize = (uint32_t)m_FeatureToUid.size();
-
-    uint32_t m_MaxLabelState32 = (uint32_t)m_MaxLabelState;
+    uint32_t featureSetSize = (uint32_t)m_FeatureTables.size();
 
     txtModel << "MaxLabelState:" << m_MaxLabelState << " "
              << "FeatureSetSize:" << featureSetSize << std::endl;
@@ -139,24 +135,22 @@ bool SparseLinearModel::Serialize(const std::string& txtModelFile) const {
 
     size_t paramsWritten = 0;
     for (uint32_t featureSetIter = 0; featureSetIter < featureSetSize; ++featureSetIter) {
-        const auto& featureIndex = m_FeatureToUid[featureSetIter];
-        uint32_t numFeatures = (uint32_t)featureIndex.size();
+        auto orderedFeatureIndex = SortedFeatures(featureSetIter);
+        uint32_t numFeatures = (uint32_t)orderedFeatureIndex.size();
 
         txtModel << "FeatureSetIter:" << featureSetIter << " "
                  << "NumFeatures:" << numFeatures << std::endl;
         txtModel << std::endl;
 
-        map<uint32_t, size_t> orderedFeatureIndex(featureIndex.begin(), featureIndex.end());
         for (const auto& featureIndexIter : orderedFeatureIndex) {
             uint32_t featureId = featureIndexIter.first;
-            const auto& attributeList = m_WeightIndex[featureIndexIter.second];
+            ParameterRange orderedAttribute = FindParameterVector(featureIndexIter.second);
 
-            uint16_t numAttribute = (uint16_t)attributeList.size();
+            uint16_t numAttribute = (uint16_t)orderedAttribute.size();
 
             txtModel << "featureId:" << featureId << " "
                      << "numAttribute:" << numAttribute << std::endl;
 
-            map<uint16_t, size_t> orderedAttribute(attributeList.begin(), attributeList.end());
             for (const auto& attribute : orderedAttribute) {
                 uint16_t labelId = attribute.first;
                 float weight = m_WeightVector[attribute.second];
@@ -177,6 +171,9 @@ bool SparseLinearModel::Deserialize(istream& stream) {
     m_WeightVector.clear();
     m_FeatureToUid.clear();
     m_WeightIndex.clear();
+    m_FeatureTables.clear();
+    m_ParameterOffsets.assign(1, 0);
+    m_Parameters.clear();
 
     uint32_t bytesToRead = 0;
     stream.read((char*)&bytesToRead, sizeof(uint32_t));
@@ -187,21 +184,21 @@ bool SparseLinearModel::Deserialize(istream& stream) {
         LogAssert(false, "Model file doesn't match with LCCRF V1 format.");
     }
 
-    stream.read((char*)&m_MaxLabelState, sizeof(uint32_t));
+    uint32_t maxLabelState32 = 0;
+    stream.read((char*)&maxLabelState32, sizeof(uint32_t));
+    m_MaxLabelState = (uint16_t)maxLabelState32;
 
     uint32_t nFeatureSets = 0;
     stream.read((char*)&nFeatureSets, sizeof(uint32_t));
-    m_FeatureToUid.reserve(nFeatureSets);
+    m_FeatureTables.reserve(nFeatureSets);
 
     for (uint32_t featureSetIter = 0; featureSetIter < nFeatureSets; ++featureSetIter) {
-        unordered_map<uint32_t, size_t> mlgFeatureIdToUid;
-
         uint32_t featureSetId = UINT32_MAX;
         uint32_t numFeatures = 0;
 
         stream.read((char*)&featureSetId, sizeof(uint32_t));
         stream.read((char*)&numFeatures, sizeof(uint32_t));
-        mlgFeatureIdToUid.reserve(numFeatures);
+        vector<FeatureSlot> featureTable(SlotCount(numFeatures), FeatureSlot{0, 0});
 
         LogAssert(featureSetId == featureSetIter, "Model doesn't have all lists of feature sets. Please verify it.");
 
@@ -211,9 +208,7 @@ bool SparseLinearModel::Deserialize(istream& stream) {
             stream.read((char*)&featureId, sizeof(uint32_t));
             stream.read((char*)&numAttribute, sizeof(uint16_t));
 
-            unordered_map<uint16_t, size_t> attributes;
-            attributes.reserve(numAttribute);
-
+            size_t begin = m_Parameters.size();
             for (uint16_t attributeIter = 0; attributeIter < numAttribute; ++attributeIter) {
                 uint16_t labelId = UINT16_MAX;
                 float weight = 0.0f;
@@ -224,26 +219,35 @@ bool SparseLinearModel::Deserialize(istream& stream) {
                 LogAssert(labelId != UINT16_MAX, "");
                 LogAssert(weight != 0.0f && !std::isnan(weight), "");
 
-                size_t paramId = m_WeightVector.size();
+                LogAssert(m_WeightVector.size() < UINT32_MAX, "");
+                m_Parameters.emplace_back(labelId, (uint32_t)m_WeightVector.size());
                 m_WeightVector.push_back(weight);
-
-                auto ret = attributes.insert(make_pair(labelId, paramId));
-                LogAssert(ret.second, "");
             }
 
-            size_t uid = m_WeightIndex.size();
-            m_WeightIndex.push_back(std::move(attributes));
-            auto ret = mlgFeatureIdToUid.insert(make_pair(featureId, uid));
-            LogAssert(ret.second, "Found duplicate in feature Id. Maybe due to corrupted model file.");
+            // the labels are written in order, but are sorted in case a model was written otherwise
+            auto attributes = m_Parameters.begin() + begin;
+            std::sort(attributes, m_Parameters.end());
+            auto duplicate = std::adjacent_find(attributes, m_Parameters.end(),
+                                                [](const ParameterType& a, const ParameterType& b) {
+                                                    return a.first == b.first;
+                                                });
+            LogAssert(duplicate == m_Parameters.end(), "");
+
+            size_t uid = m_ParameterOffsets.size() - 1;
+            m_ParameterOffsets.push_back((uint32_t)m_Parameters.size());
+            bool inserted = InsertFeatureSlot(featureTable, featureId, uid);
+            LogAssert(inserted, "Found duplicate in feature Id. Maybe due to corrupted model file.");
         }
-        m_FeatureToUid.push_back(std::move(mlgFeatureIdToUid));
+        m_FeatureTables.push_back(std::move(featureTable));
     }
 
     uint32_t bytesRead = (uint32_t)stream.tellg();
     LogAssert(bytesRead - sizeof(uint32_t) == bytesToRead, "Invalid model file.");
+    m_WeightVector.shrink_to_fit();
+    m_ParameterOffsets.shrink_to_fit();
+    m_Parameters.shrink_to_fit();
 
     RefreshCache();
-    CreateParameterVectorIndex();
 
     return true;
 }
@@ -261,14 +265,15 @@ void SparseLinearModel::RefreshCache() {
     for (int i = 0; i < m_MaxLabelState; ++i) {
         size_t id = FindFeautureIdMap(EDGE_FEATURE_SET, i);
         if (id != INDEX_NOT_FOUND) {
-            for (const auto& iter : FindWeightIds(id)) {
-                m_TrainsitionCache[i * m_MaxLabelState + iter.first] = m_WeightVector[iter.second];
+            for (const auto& param : FindParameterVector(id)) {
+                m_TrainsitionCache[i * m_MaxLabelState + param.first] = m_WeightVector[param.second];
             }
         }
     }
 }
 
 size_t SparseLinearModel::Shrink(float truncation) {
+    CreateHashIndex();
     vector<unordered_map<uint32_t, size_t>> featureToUid;
     vector<unordered_map<uint16_t, size_t>> weightIndex;
     vector<float> weightVector;
@@ -298,17 +303,22 @@ size_t SparseLinearModel::Shrink(float truncation) {
     m_WeightVector = std::move(weightVector);
     m_FeatureToUid = std::move(featureToUid);
     m_WeightIndex = std::move(weightIndex);
+    CreateParameterVectorIndex();
+
+    // free the hash maps, which Expand would create again
+    m_FeatureToUid = vector<unordered_map<uint32_t, size_t>>();
+    m_WeightIndex = vector<unordered_map<uint16_t, size_t>>();
 
     return m_WeightVector.size();
 }
 
 void SparseLinearModel::InsertParameter(uint32_t setId, uint32_t featId, uint16_t labId) {
+    // the flat index is out of date until the end of Expand, so look the features up in the hash maps
     bool weightExists = false;
-    size_t uid = FindFeautureIdMap(setId, featId);
-    if (uid != INDEX_NOT_FOUND) {
-        const auto& iter = m_WeightIndex[uid].find(labId);
-        if (iter != m_WeightIndex[uid].end()) {
-            weightExists = true;
+    if (m_FeatureToUid.size() > setId) {
+        const auto& featureIndex = m_FeatureToUid[setId].find(featId);
+        if (featureIndex != m_FeatureToUid[setId].end()) {
+            weightExists = m_WeightIndex[featureIndex->second].count(labId) != 0;
         }
     }
 
@@ -329,6 +339,7 @@ void SparseLinearModel::InsertParameter(uint32_t setId, uint32_t featId, uint16_
 size_t SparseLinearModel::Expand(const std::vector<MLGFeatureSentence>& data) {
     // Note: m_MaxLabelState is defined by max(label ids) + 1
     uint16_t maxLabelId = m_MaxLabelState;
+    CreateHashIndex();
 
     for (const MLGFeatureSentence& sentence : data) {
         uint16_t prevLabId = 0;
@@ -355,42 +366,107 @@ size_t SparseLinearModel::Expand(const std::vector<MLGFeatureSentence>& data) {
     }
 
     m_MaxLabelState = maxLabelId + 1;
-    RefreshCache();
     CreateParameterVectorIndex();
+    RefreshCache();
 
     return m_WeightVector.size();
 }
 
 void SparseLinearModel::CreateParameterVectorIndex() {
-    m_ParameterVectorIndex.clear();
+    LogAssert(m_WeightIndex.size() < UINT32_MAX && m_WeightVector.size() <= UINT32_MAX, "Too many parameters.");
+    m_ParameterOffsets.assign(1, 0);
+    m_ParameterOffsets.reserve(m_WeightIndex.size() + 1);
+    m_Parameters.clear();
+    m_Parameters.reserve(m_WeightVector.size());
     for (const auto& paramIndex : m_WeightIndex) {
-        vector<pair<uint16_t, size_t>> index;
+        size_t begin = m_Parameters.size();
         for (const auto& param : paramIndex) {
-            index.push_back(param);
+            m_Parameters.emplace_back(param.first, (uint32_t)param.second);
         }
-        m_ParameterVectorIndex.push_back(index);
+        std::sort(m_Parameters.begin() + begin, m_Parameters.end());
+        m_ParameterOffsets.push_back((uint32_t)m_Parameters.size());
+    }
+
+    m_FeatureTables.clear();
+    m_FeatureTables.reserve(m_FeatureToUid.size());
+    for (const auto& featureIndex : m_FeatureToUid) {
+        vector<FeatureSlot> featureTable(SlotCount(featureIndex.size()), FeatureSlot{0, 0});
+        for (const auto& feature : featureIndex) {
+            InsertFeatureSlot(featureTable, feature.first, feature.second);
+        }
+        m_FeatureTables.push_back(std::move(featureTable));
     }
 }
 
-size_t SparseLinearModel::FindFeautureIdMap(uint32_t setId, uint32_t featId) {
-    if (m_FeatureToUid.size() > setId) {
-        const auto& featureMap = m_FeatureToUid[setId];
-        const auto& iter = featureMap.find(featId);
-        if (iter != featureMap.end()) {
-            return iter->second;
+void SparseLinearModel::CreateHashIndex() {
+    if (!m_FeatureToUid.empty() || m_FeatureTables.empty()) {
+        return;
+    }
+    m_WeightIndex.resize(m_ParameterOffsets.size() - 1);
+    for (size_t uid = 0; uid < m_WeightIndex.size(); ++uid) {
+        for (const auto& param : FindParameterVector(uid)) {
+            m_WeightIndex[uid].insert(make_pair(param.first, (size_t)param.second));
+        }
+    }
+    m_FeatureToUid.resize(m_FeatureTables.size());
+    for (uint32_t setId = 0; setId < m_FeatureTables.size(); ++setId) {
+        for (const auto& feature : SortedFeatures(setId)) {
+            m_FeatureToUid[setId].insert(feature);
+        }
+    }
+}
+
+bool SparseLinearModel::InsertFeatureSlot(vector<FeatureSlot>& table, uint32_t featId, size_t uid) {
+    size_t mask = table.size() - 1;
+    size_t slot = HashFeature(featId) & mask;
+    for (; table[slot].uidPlusOne != 0; slot = (slot + 1) & mask) {
+        if (table[slot].featId == featId) {
+            return false;
+        }
+    }
+    table[slot] = FeatureSlot{featId, (uint32_t)(uid + 1)};
+    return true;
+}
+
+vector<pair<uint32_t, size_t>> SparseLinearModel::SortedFeatures(uint32_t setId) const {
+    vector<pair<uint32_t, size_t>> features;
+    for (const auto& slot : m_FeatureTables[setId]) {
+        if (slot.uidPlusOne != 0) {
+            features.emplace_back(slot.featId, slot.uidPlusOne - 1);
+        }
+    }
+    std::sort(features.begin(), features.end());
+    return features;
+}
+
+size_t SparseLinearModel::FindFeautureIdMap(uint32_t setId, uint32_t featId) const {
+    if (m_FeatureTables.size() > setId) {
+        const auto& featureTable = m_FeatureTables[setId];
+        size_t mask = featureTable.size() - 1;
+        for (size_t slot = HashFeature(featId) & mask; featureTable[slot].uidPlusOne != 0; slot = (slot + 1) & mask) {
+            if (featureTable[slot].featId == featId) {
+                return featureTable[slot].uidPlusOne - 1;
+            }
         }
     }
     return INDEX_NOT_FOUND;
 }
 
+size_t SparseLinearModel::FindParameterId(size_t uid, uint16_t labId) const {
+    ParameterRange params = FindParameterVector(uid);
+    const auto* param = std::lower_bound(params.begin(), params.end(), labId,
+                                         [](const ParameterType& p, uint16_t label) { return p.first < label; });
+    return param != params.end() && param->first == labId ? param->second : INDEX_NOT_FOUND;
+}
+
 void SparseLinearModel::BackPropagateTransitionWeight() {
     size_t N = MaxLabel();
     for (uint16_t outgoing = 0; outgoing < N; ++outgoing) {
         float* trans = &m_TrainsitionCache[outgoing * N];
         size_t uid = FindFeautureIdMap(EDGE_FEATURE_SET, outgoing);
         if (uid == INDEX_NOT_FOUND) continue;
-        for (const auto& iter : FindWeightIds(uid)) {
-            m_WeightVector[iter.second] = trans[iter.first];
+        for (const auto& param : FindParameterVector(uid)) {
+            m_WeightVector[param.second] = trans[param.first];
         }
     }
 }
@@ -7,6 +7,7 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "Common.h"
@@ -16,8 +17,28 @@ namespace SparseLinearChainCRF {
 #define EDGE_FEATURE_SET 0
 #define INDEX_NOT_FOUND UINT_MAX
 
+// (label, index in the weight vector) of a parameter
+typedef std::pair<uint16_t, uint32_t> ParameterType;
+
+// The parameters of a feature, sorted by label
+class ParameterRange {
+  public:
+    ParameterRange(const ParameterType* begin, const ParameterType* end) : m_Begin(begin), m_End(end) {}
+
+    const ParameterType* begin() const { return m_Begin; }
+    const ParameterType* end() const { return m_End; }
+    size_t size() const { return m_End - m_Begin; }
+
+  private:
+    const ParameterType* m_Begin;
+    const ParameterType* m_End;
+};
+
 // ------------------------------------------------
 // SparseLinearModel class.
+// Features are looked up in flat arrays: an open addressing table per feature set maps the feature ids to uids, and
+// the parameters of all the uids are stored back to back. Loading a model builds them directly. The hash maps they
+// are built from are only filled while training expands or shrinks the model.
 // ------------------------------------------------
 class SparseLinearModel {
   public:
@@ -34,11 +55,14 @@ class SparseLinearModel {
     size_t Shrink(float truncation = 0.0f);
     size_t Expand(const std::vector<MLGFeatureSentence>& data);
 
-    size_t FindFeautureIdMap(uint32_t setId, uint32_t featId);
-    const std::unordered_map<uint16_t, size_t>& FindWeightIds(size_t uid) { return m_WeightIndex[uid]; }
-    const std::vector<std::pair<uint16_t, size_t>>& FindParameterVector(size_t uid) {
-        return m_ParameterVectorIndex[uid];
+    // uid of the feature, or INDEX_NOT_FOUND
+    size_t FindFeautureIdMap(uint32_t setId, uint32_t featId) const;
+    ParameterRange FindParameterVector(size_t uid) const {
+        const ParameterType* parameters = m_Parameters.data();
+        return ParameterRange(parameters + m_ParameterOffsets[uid], parameters + m_ParameterOffsets[uid + 1]);
     }
+    // index in the weight vector of the parameter of the feature for the label, or INDEX_NOT_FOUND
+    size_t FindParameterId(size_t uid, uint16_t labId) const;
 
     size_t Size() const { return m_WeightVector.size(); }
     uint16_t MaxLabel() const { return m_MaxLabelState; }
@@ -47,17 +71,33 @@ class SparseLinearModel {
     void Reset();
     void Reset(const std::vector<float>& paramVector);
     float* GetTransitionCache() const { return m_TrainsitionCache.get(); }
-    const std::unordered_map<uint32_t, size_t>& FindAllFeatures(uint32_t setId) { return m_FeatureToUid[setId]; }
     void BackPropagateTransitionWeight();
     void RefreshCache();
 
   private:
+    // A slot of the feature table of a feature set, uid + 1 being 0 for the empty slots
+    struct FeatureSlot {
+        uint32_t featId;
+        uint32_t uidPlusOne;
+    };
+
     void InsertParameter(uint32_t setId, uint32_t featId, uint16_t labId);
+    // Build the flat index from the hash maps
     void CreateParameterVectorIndex();
+    // Fill the hash maps from the flat index, if the model was loaded
+    void CreateHashIndex();
+    // Add the feature to a feature table, or return false if it is already there
+    static bool InsertFeatureSlot(std::vector<FeatureSlot>& table, uint32_t featId, size_t uid);
+    // (feature id, uid) of the features of a set, sorted by feature id
+    std::vector<std::pair<uint32_t, size_t>> SortedFeatures(uint32_t setId) const;
 
     std::vector<std::unordered_map<uint32_t, size_t>> m_FeatureToUid;
     std::vector<std::unordered_map<uint16_t, size_t>> m_WeightIndex;
-    std::vector<std::vector<std::pair<uint16_t, size_t>>> m_ParameterVectorIndex;
+    // the feature table of each set, a power of 2 of slots with at most half of them used
+    std::vector<std::vector<FeatureSlot>> m_FeatureTables;
+    // the parameters of uid are m_Parameters[m_ParameterOffsets[uid]] to m_Parameters[m_ParameterOffsets[uid + 1]]
+    std::vector<uint32_t> m_ParameterOffsets;
+    std::vector<ParameterType> m_Parameters;
     std::vector<float> m_WeightVector;
     uint16_t m_MaxLabelState;
     std::unique_ptr<float[]> m_TrainsitionCache;
@@ -7,6 +7,7 @@
 #include <numeric>
 #include <vector>
 
+#include "CRFKernels.h"
 #include "Common.h"
 #include "VectorUtils.h"
 
@@ -34,6 +35,35 @@ void VanillaCRF::Decode(const IndexedSentence& sentence, vector<uint16_t>& tags)
     }
 }
 
+void VanillaCRF::Decode(uint16_t wordCount, const vector<tuple<uint16_t, uint32_t, double>>& features, uint32_t setId,
+                        DecodeWorkspace& workspace, vector<uint16_t>& tags) const {
+    uint16_t T = wordCount;
+    uint16_t N = m_LinearModel->MaxLabel();
+    tags.resize(T);
+    if (T == 0) {
+        return;
+    }
+
+    // Same sums as CreateLinearFunctionCache, the features of each word being added in the same order
+    const auto& weight = m_LinearModel->WeightVector();
+    workspace.linearFunctionCache.assign(T * N, 0.0f);
+    for (const auto& f : features) {
+        // unknown features are dropped before their word is checked, as the IndexedSentence of Decode drops them
+        size_t uid = m_LinearModel->FindFeautureIdMap(setId, std::get<1>(f));
+        if (uid == INDEX_NOT_FOUND) {
+            continue;
+        }
+        LogAssert(std::get<0>(f) < T, "feature of word %d in a sentence of %d words", std::get<0>(f), T);
+        float* column = &workspace.linearFunctionCache[std::get<0>(f) * N];
+        auto value = static_cast<float>(std::get<2>(f));
+        for (const auto& param : m_LinearModel->FindParameterVector(uid)) {
+            column[param.first] += weight[param.second] * value;
+        }
+    }
+
+    Viterbi1Best(workspace.linearFunctionCache.data(), T, tags.data(), workspace);
+}
+
 double VanillaCRF::Infer(const IndexedSentence& sentence, float* probNode, float* probEdge) const {
     uint16_t T = (uint16_t)sentence.Size();
     uint16_t N = m_LinearModel->MaxLabel();
@@ -124,39 +154,33 @@ void VanillaCRF::CreateLinearFunctionCache(const IndexedSentence& sentence, floa
 
 // Runs vanilla Viterbi decoding algorithm.
 float VanillaCRF::Viterbi1Best(const float* linearFunctionCache, int wordCount, uint16_t* bestPathIds) const {
+    DecodeWorkspace workspace;
+    return Viterbi1Best(linearFunctionCache, wordCount, bestPathIds, workspace);
+}
+
+float VanillaCRF::Viterbi1Best(const float* linearFunctionCache, int wordCount, uint16_t* bestPathIds,
+                               DecodeWorkspace& workspace) const {
     int T = wordCount;
     uint16_t N = m_LinearModel->MaxLabel();
     const float* transitionCache = m_LinearModel->GetTransitionCache();
 
-    // initialize
-    std::vector<float> viterbiScore(T * N, 0.0f);
+    // initialize, every score and back pointer after the first column being set by ViterbiStep
+    auto& viterbiScore = workspace.viterbiScore;
+    viterbiScore.resize(T * N);
     memcpy(viterbiScore.data(), linearFunctionCache, N * sizeof(float));
 
-    std::vector<uint16_t> backtracer(T * N, 0);
+    auto& backtracer = workspace.backtracer;
+    backtracer.resize(T * N);
     memset(backtracer.data(), UCHAR_MAX, N * sizeof(uint16_t));
 
     // dynamic programming
     for (uint16_t t = 1; t < T; ++t) {
-        float* prevcolumn = &viterbiScore[(t - 1) * N];
+        const float* prevcolumn = &viterbiScore[(t - 1) * N];
         float* curScores = &viterbiScore[t * N];
         const float* curWeightedSum = &linearFunctionCache[t * N];
         uint16_t* curBackTrace = &backtracer[t * N];
 
-        for (uint16_t i = 0; i < N; ++i) {
-            float maxScore = -FLT_MAX;
-            uint16_t backTracer = UINT16_MAX;
-
-            for (uint16_t j = 0; j < N; ++j) {
-                float score = prevcolumn[j] + transitionCache[j * N + i];
-                if (maxScore < score) {
-                    maxScore = score;
-                    backTracer = j;
-                }
-            }
-
-            curScores[i] = maxScore + curWeightedSum[i];
-            curBackTrace[i] = backTracer;
-        }
+        ViterbiStep(prevcolumn, transitionCache, curWeightedSum, N, curScores, curBackTrace);
     }
 
     // backtrace
@@ -189,13 +213,7 @@ void VanillaCRF::Forward(const double* nodeMatrix, const double* edgeMatrix, uin
         double* prev = &alpha[(t - 1) * N];
         double* cur = &alpha[t * N];
         const double* obs = &nodeMatrix[t * N];
-        memset(cur, 0, sizeof(double) * N);
-
-        for (uint16_t outgoing = 0; outgoing < N; ++outgoing) {
-            const double* trans = &edgeMatrix[outgoing * N];
-            VectorAdd(cur, trans, prev[outgoing], N);
-        }
-        VectorMultiply(cur, obs, N);
+        ForwardStep(prev, edgeMatrix, obs, N, cur);
 
         sum = VectorSum(cur, N);
         scales[t] = (sum != 0.0) ? 1.0 / sum : 1.0;
@@ -216,11 +234,7 @@ void VanillaCRF::Backward(const double* nodeMatrix, const double* edgeMatrix, ui
 
         VectorCopy(column.data(), next, N);
         VectorMultiply(column.data(), obs, N);
-
-        for (uint16_t outgoing = 0; outgoing < N; ++outgoing) {
-            const double* trans = &edgeMatrix[outgoing * N];
-            cur[outgoing] = VectorDotProduct(column.data(), trans, N);
-        }
+        BackwardStep(column.data(), edgeMatrix, N, cur);
         VectorScale(cur, scales[t], N);
     }
 }
@@ -4,6 +4,7 @@
 #pragma once
 
 #include <memory>
+#include <tuple>
 #include <vector>
 
 #include "ILinearChainCRF.h"
@@ -17,13 +18,27 @@ namespace SparseLinearChainCRF {
 // ------------------------------------------------
 class VanillaCRF : public ILinearChainCRF {
   public:
+    // Buffers of the decoding of a sentence, which keep their capacity for the next sentences
+    struct DecodeWorkspace {
+        std::vector<float> linearFunctionCache;
+        std::vector<float> viterbiScore;
+        std::vector<uint16_t> backtracer;
+    };
+
     virtual void Initialize(std::shared_ptr<SparseLinearModel> model);
     virtual void Decode(const IndexedSentence& sentence, std::vector<uint16_t>& tags) const;
+    // Decode a sentence of wordCount words given its (word index, feature id, value) triples, the features of set
+    // setId, without building an IndexedSentence. Features not in the model are ignored, and a known feature of a word
+    // past wordCount throws. Threads decoding with their own workspace may run concurrently.
+    void Decode(uint16_t wordCount, const std::vector<std::tuple<uint16_t, uint32_t, double>>& features,
+                uint32_t setId, DecodeWorkspace& workspace, std::vector<uint16_t>& tags) const;
     virtual double Infer(const IndexedSentence& sentence, float* probNode, float* probEdge) const;
 
   protected:
     virtual void CreateLinearFunctionCache(const IndexedSentence& sentence, float* linearFunctionCache) const;
     virtual float Viterbi1Best(const float* linearFunctionCache, int wordCount, uint16_t* bestPathIds) const;
+    float Viterbi1Best(const float* linearFunctionCache, int wordCount, uint16_t* bestPathIds,
+                       DecodeWorkspace& workspace) const;
     virtual void Forward(const double* node, const double* edge, uint16_t wordCount, uint16_t labelCount,
                          double* matrix, double* scales) const;
     virtual void Backward(const double* node, const double* edge, uint16_t wordCount, uint16_t labelCount,
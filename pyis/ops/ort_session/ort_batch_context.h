@@ -2,30 +2,51 @@
 // Licensed under the MIT license.
 
 #pragma once
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <future>
 
 #include "ort_globals.h"
 
 namespace pyis {
 namespace ops {
+
+// called with the outputs of a request, or with an error message if it failed
+using BatchCallback =
+    std::function<void(std::vector<std::shared_ptr<Ort::Value>>& outputs, const std::string& error_message)>;
+
+struct BatchRequest {
+    // rows of the request in the batch, and its own length along the second dimension of the sequence inputs
+    std::pair<size_t, size_t> index_span_;
+    size_t sequence_length_;
+    std::chrono::steady_clock::time_point deadline_;
+    std::shared_ptr<std::atomic<bool>> cancelled_;
+    BatchCallback callback_;
+};
+
 struct BatchContext {
-    BatchContext(size_t input_size, size_t output_size) {
+    BatchContext(size_t input_size, size_t output_size) : create_time_(std::chrono::steady_clock::now()) {
         concat_inputs_.reserve(input_size);
         concat_outputs_.reserve(output_size);
     }
 
+    // Inputs of the first request while the batch holds a single request. Once another request joins, staging
+    // tensors with room for a full batch, into which each request copies its rows at its own offset.
     std::vector<std::shared_ptr<Ort::Value>> concat_inputs_;
     std::vector<std::shared_ptr<Ort::Value>> concat_outputs_;
-    std::vector<std::shared_ptr<std::promise<std::string>>> error_message_promises_;
-
-    size_t BatchSize() const { return error_message_promises_.size(); }
-    size_t BatchTileCount() const {
-        if (BatchSize() > 0) {
-            // get the tile count
-            return concat_inputs_[0]->GetTensorTypeAndShapeInfo().GetShape()[0];
-        }
-        return 0;
-    }
+    std::vector<BatchRequest> requests_;
+    // when the first request joined this batch, used to enforce the max queue delay
+    std::chrono::steady_clock::time_point create_time_;
+    // the earliest deadline of the requests in this batch
+    std::chrono::steady_clock::time_point deadline_ = std::chrono::steady_clock::time_point::max();
+    bool staged_ = false;
+    size_t tile_count_ = 0;
+    // length along the second dimension the sequence inputs are padded to once the batch holds several requests
+    size_t bucket_length_ = 0;
+
+    size_t BatchSize() const { return requests_.size(); }
+    size_t BatchTileCount() const { return tile_count_; }
 };
 }  // namespace ops
 }  // namespace pyis
\ No newline at end of file
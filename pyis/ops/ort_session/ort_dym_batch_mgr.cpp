@@ -3,139 +3,427 @@
 
 #include "ort_dym_batch_mgr.h"
 
+#include <algorithm>
 #include <functional>
 
 #include "ort_tensor_utils.h"
+#include "pyis/share/hardware_utils.h"
 #include "pyis/share/str_utils.h"
 
 namespace pyis {
 namespace ops {
 
-DynamicBatchManager::DynamicBatchManager(int max_batch_size, std::shared_ptr<Ort::Session> ort_session,
-                                         std::vector<const char*>& input_names, std::vector<const char*>& output_names)
-    : max_batch_size_(max_batch_size),
-      ort_session_(std::move(ort_session)),
+DynamicBatchManager::DynamicBatchManager(int max_batch_size, int64_t max_queue_delay_us,
+                                         std::vector<int> preferred_batch_sizes,
+                                         std::vector<std::shared_ptr<Ort::Session>> ort_sessions, int worker_num,
+                                         std::vector<std::vector<int>> worker_cores, std::vector<int> padding_buckets,
+                                         std::vector<int> pad_values, std::vector<bool> sequence_inputs,
+                                         std::vector<bool> sequence_outputs, std::vector<const char*>& input_names,
+                                         std::vector<const char*>& output_names)
+    : ort_sessions_(std::move(ort_sessions)),
+      worker_cores_(std::move(worker_cores)),
+      max_batch_size_(max_batch_size),
+      max_queue_delay_(max_queue_delay_us),
+      preferred_batch_sizes_(std::move(preferred_batch_sizes)),
+      padding_buckets_(std::move(padding_buckets)),
+      pad_values_(std::move(pad_values)),
+      sequence_inputs_(std::move(sequence_inputs)),
+      sequence_outputs_(std::move(sequence_outputs)),
       input_names_(std::move(input_names)),
       output_names_(std::move(output_names)) {
-    worker_thread_ = std::make_unique<std::thread>(&DynamicBatchManager::WorkerLoop, this);
-    worker_thread_->detach();
+    if (max_batch_size_ < 1) {
+        PYIS_THROW("DynamicBatchManager : batch size must be positive, got %d", max_batch_size_);
+    }
+    if (max_queue_delay_.count() < 0) {
+        PYIS_THROW("DynamicBatchManager : max queue delay must not be negative");
+    }
+    for (int size : preferred_batch_sizes_) {
+        if (size < 1 || size > max_batch_size_) {
+            PYIS_THROW("DynamicBatchManager : preferred batch size %d is out of range [1, %d]", size, max_batch_size_);
+        }
+    }
+    for (int bucket : padding_buckets_) {
+        if (bucket < 1) {
+            PYIS_THROW("DynamicBatchManager : padding bucket length must be positive, got %d", bucket);
+        }
+    }
+    std::sort(padding_buckets_.begin(), padding_buckets_.end());
+    if (pad_values_.empty()) {
+        pad_values_.resize(input_names_.size(), 0);
+    }
+    if (pad_values_.size() != input_names_.size()) {
+        PYIS_THROW("DynamicBatchManager : expect %zu pad values, got %zu", input_names_.size(), pad_values_.size());
+    }
+    if (sequence_inputs_.empty()) {
+        sequence_inputs_.resize(input_names_.size(), false);
+    }
+    if (sequence_outputs_.empty()) {
+        sequence_outputs_.resize(output_names_.size(), false);
+    }
+    if (sequence_inputs_.size() != input_names_.size() || sequence_outputs_.size() != output_names_.size()) {
+        PYIS_THROW("DynamicBatchManager : expect a sequence flag for each of the %zu inputs and %zu outputs",
+                   input_names_.size(), output_names_.size());
+    }
+    if (!padding_buckets_.empty() && std::none_of(sequence_inputs_.begin(), sequence_inputs_.end(),
+                                                  [](bool is_sequence) { return is_sequence; })) {
+        PYIS_THROW("DynamicBatchManager : padding requires at least one sequence input");
+    }
+    if (worker_num < 1 || ort_sessions_.empty()) {
+        PYIS_THROW("DynamicBatchManager : at least one worker and one session are required");
+    }
+    if (!worker_cores_.empty() && worker_cores_.size() != static_cast<size_t>(worker_num)) {
+        PYIS_THROW("DynamicBatchManager : expect cores for %d workers, got %zu", worker_num, worker_cores_.size());
+    }
+
+    worker_threads_.reserve(worker_num);
+    for (size_t i = 0; i < static_cast<size_t>(worker_num); i++) {
+        worker_threads_.emplace_back(&DynamicBatchManager::WorkerLoop, this, i);
+    }
+}
+
+DynamicBatchManager::~DynamicBatchManager() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        stopped_ = true;
+    }
+    cv_.notify_all();
+    for (auto& worker_thread : worker_threads_) {
+        worker_thread.join();
+    }
+
+    // fail the requests which never got a worker
+    while (!batch_queue_.empty()) {
+        NotifyResults(batch_queue_.front(), "DynamicBatchManager is stopped");
+        batch_queue_.pop();
+    }
 }
 
 void DynamicBatchManager::Execute(const std::vector<std::shared_ptr<Ort::Value>>& inputs,
                                   std::vector<std::shared_ptr<Ort::Value>>& outputs) {
+    // shared with the callback, which may still run after this call gave up waiting
+    struct Result {
+        std::promise<std::string> error_message_promise;
+        std::vector<std::shared_ptr<Ort::Value>> outputs;
+    };
+    auto result = std::make_shared<Result>();
+    auto future = result->error_message_promise.get_future();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(5000) + max_queue_delay_;
+
+    ExecuteAsync(
+        inputs,
+        [result](std::vector<std::shared_ptr<Ort::Value>>& results, const std::string& error_message) {
+            result->outputs = std::move(results);
+            result->error_message_promise.set_value(error_message);
+        },
+        deadline);
+
+    // Waiting for results
+    if (future.wait_until(deadline) != std::future_status::ready) {
+        PYIS_THROW("Dynamic Batch Timeout");
+    }
+    auto error_message = future.get();
+    if (!error_message.empty()) {
+        PYIS_THROW("Dynamic Batch Failed: %s", error_message.c_str());
+    }
+    outputs = std::move(result->outputs);
+}
+
+void DynamicBatchManager::ExecuteAsync(const std::vector<std::shared_ptr<Ort::Value>>& inputs, BatchCallback callback,
+                                       std::chrono::steady_clock::time_point deadline,
+                                       std::shared_ptr<std::atomic<bool>> cancelled) {
     bool first_query(false);
-    auto error_message_promise = std::make_shared<std::promise<std::string>>();
+
+    // reject malformed inputs before they touch a batch, which they would fail for all the requests sharing it
+    size_t tile_count = 0;
+    size_t sequence_length = 0;
+    auto error_message = CheckInputs(inputs, tile_count, sequence_length);
+    if (!error_message.empty()) {
+        std::vector<std::shared_ptr<Ort::Value>> no_outputs;
+        callback(no_outputs, error_message);
+        return;
+    }
+    size_t bucket_length = GetBucketLength(sequence_length);
 
     std::unique_lock<std::mutex> lock(queue_mutex_);
 
+    if (stopped_) {
+        lock.unlock();
+        std::vector<std::shared_ptr<Ort::Value>> no_outputs;
+        callback(no_outputs, "DynamicBatchManager is stopped");
+        return;
+    }
+
     if (batch_queue_.empty()) {
         first_query = true;
     }
 
-    if (first_query || batch_queue_.back()->BatchSize() == max_batch_size_) {
-        auto context = std::make_shared<BatchContext>(inputs.size(), outputs.size());
+    // start a new batch if the pending one has no room left for the rows of this request
+    bool new_batch = first_query || !CanJoinBatch(*batch_queue_.back(), inputs, tile_count, bucket_length);
+    if (new_batch) {
+        auto context = std::make_shared<BatchContext>(inputs.size(), output_names_.size());
+        context->bucket_length_ = bucket_length;
         batch_queue_.emplace(context);
     }
 
     auto batch_context = batch_queue_.back();
 
-    size_t output_index_start = batch_context->BatchTileCount();
-    size_t output_index_end =
-        batch_context->BatchTileCount() + static_cast<size_t>(inputs[0]->GetTensorTypeAndShapeInfo().GetShape()[0]);
-    batch_context->error_message_promises_.push_back(error_message_promise);
+    BatchRequest request;
+    request.index_span_ = std::make_pair(batch_context->BatchTileCount(), batch_context->BatchTileCount() + tile_count);
+    request.sequence_length_ = sequence_length;
+    request.deadline_ = deadline;
+    request.cancelled_ = std::move(cancelled);
+    request.callback_ = std::move(callback);
+    batch_context->requests_.emplace_back(std::move(request));
+    batch_context->deadline_ = std::min(batch_context->deadline_, deadline);
     ConcatInputs(batch_context, inputs);
 
     lock.unlock();
 
-    // Tell WorkerExecute there's a new query
-    if (first_query) {
+    // Tell an idle worker there's a new batch. When batches are held back for a delay, the waiting workers also
+    // have to re-check whether the pending batch became ready.
+    if (max_queue_delay_.count() > 0) {
+        cv_.notify_all();
+    } else if (new_batch) {
         cv_.notify_one();
     }
+}
 
-    auto future = error_message_promise->get_future();
-    auto timeout_point = std::chrono::system_clock::now() + std::chrono::milliseconds(5000);
-
-    if (std::future_status::ready == future.wait_until(timeout_point)) {
-        auto error_message = future.get();
-        auto index_span = std::make_pair(output_index_start, output_index_end);
-        SliceOutputs(batch_context, outputs, index_span);
-
-    } else {
-        PYIS_THROW("Dynamic Batch Timeout");
+void DynamicBatchManager::WorkerLoop(size_t worker_index) {
+    if (!worker_cores_.empty()) {
+        bind_current_thread(worker_cores_[worker_index]);
     }
-}
+    auto& ort_session = *ort_sessions_[worker_index % ort_sessions_.size()];
 
-void DynamicBatchManager::WorkerLoop() {
     std::unique_lock<std::mutex> lock(queue_mutex_);
 
     while (true) {
-        while (batch_queue_.empty()) {
-            // WorkerLoop will be notified when there's a new request
-            cv_.wait(lock);
+        // WorkerLoop will be notified when there's a new request
+        cv_.wait(lock, [this]() { return stopped_ || !batch_queue_.empty(); });
+        if (stopped_) {
+            break;
+        }
+
+        // Hold the first BatchContext back until it is ready or its delay expires. A BatchContext followed by
+        // another one in the queue can not grow anymore, so it is dispatched right away.
+        if (max_queue_delay_.count() > 0) {
+            auto front = batch_queue_.front();
+            // do not hold a batch back past the deadline of any of its requests
+            auto deadline = std::min(front->create_time_ + max_queue_delay_, front->deadline_);
+            cv_.wait_until(lock, deadline, [this, &front]() {
+                return stopped_ || batch_queue_.empty() || batch_queue_.front() != front || batch_queue_.size() > 1 ||
+                       IsBatchReady(*front);
+            });
+            // another worker took the batch while waiting, start over with the next one
+            if (stopped_ || batch_queue_.empty() || batch_queue_.front() != front) {
+                continue;
+            }
         }
 
         // Take first BatchContext out of queue
         auto batch_context = batch_queue_.front();
         batch_queue_.pop();
-        queue_mutex_.unlock();
+        lock.unlock();
 
-        const auto begin = std::chrono::high_resolution_clock::now();
-        ModelExecute(batch_context);
+        // skip the run if no request in the batch is waiting for it anymore
+        auto now = std::chrono::steady_clock::now();
+        bool any_pending =
+            std::any_of(batch_context->requests_.begin(), batch_context->requests_.end(),
+                        [&now](const BatchRequest& request) {
+                            return !(request.cancelled_ && *request.cancelled_) && now <= request.deadline_;
+                        });
 
-        const auto end = std::chrono::high_resolution_clock::now();
-        const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+        std::string error_message;
+        if (any_pending) {
+#ifndef PYIS_NO_EXCEPTIONS
+            try {
+                ModelExecute(batch_context, ort_session);
+            } catch (const std::exception& e) {
+                error_message = e.what();
+            }
+#else
+            ModelExecute(batch_context, ort_session);
+#endif
+        }
+
+        NotifyResults(batch_context, error_message);
+
+        // Lock the queue. In next iteration if batch_queue_ is empty, cv_ will release the lock and wait.
+        lock.lock();
+    }
+}
 
-        NotifyResults(batch_context, std::string());
+bool DynamicBatchManager::IsBatchReady(const BatchContext& batch_context) const {
+    auto tile_count = static_cast<int>(batch_context.BatchTileCount());
+    if (tile_count >= max_batch_size_) {
+        return true;
+    }
+    return std::find(preferred_batch_sizes_.begin(), preferred_batch_sizes_.end(), tile_count) !=
+           preferred_batch_sizes_.end();
+}
 
-        // Lock the queue. In next iteration if m_contextQueue.size() == 0, m_cv will release the lock and wait.
-        queue_mutex_.lock();
+bool DynamicBatchManager::CanJoinBatch(const BatchContext& batch_context,
+                                       const std::vector<std::shared_ptr<Ort::Value>>& inputs, size_t tile_count,
+                                       size_t bucket_length) const {
+    if (batch_context.BatchTileCount() + tile_count > static_cast<size_t>(max_batch_size_) ||
+        batch_context.concat_inputs_.size() != inputs.size() || batch_context.bucket_length_ != bucket_length) {
+        return false;
+    }
+    for (size_t i = 0; i < inputs.size(); i++) {
+        // the second dimension of padded inputs may differ within a bucket
+        size_t start_dim = IsPaddedInput(i) ? 2 : 1;
+        auto batch_info = batch_context.concat_inputs_[i]->GetTensorTypeAndShapeInfo();
+        auto input_info = inputs[i]->GetTensorTypeAndShapeInfo();
+        auto batch_shape = batch_info.GetShape();
+        auto input_shape = input_info.GetShape();
+        if (batch_info.GetElementType() != input_info.GetElementType() ||
+            !CheckTensorDimensionMatch(batch_shape, input_shape, start_dim)) {
+            return false;
+        }
     }
+    return true;
 }
 
-void DynamicBatchManager::ModelExecute(std::shared_ptr<BatchContext>& batch_context) {
+std::string DynamicBatchManager::CheckInputs(const std::vector<std::shared_ptr<Ort::Value>>& inputs,
+                                             size_t& tile_count, size_t& sequence_length) const {
+    if (inputs.size() != input_names_.size()) {
+        return fmt_str("DynamicBatchManager : expect %zu inputs, got %zu", input_names_.size(), inputs.size());
+    }
+    for (size_t i = 0; i < inputs.size(); i++) {
+        auto shape = inputs[i]->GetTensorTypeAndShapeInfo().GetShape();
+        if (shape.empty() || (sequence_inputs_[i] && shape.size() < 2)) {
+            return fmt_str("DynamicBatchManager : input %s has too few dimensions", input_names_[i]);
+        }
+        if (i == 0) {
+            tile_count = static_cast<size_t>(shape[0]);
+        } else if (static_cast<size_t>(shape[0]) != tile_count) {
+            return fmt_str("DynamicBatchManager : input %s has %lld rows, expect %zu", input_names_[i],
+                           static_cast<long long>(shape[0]), tile_count);
+        }
+        if (!sequence_inputs_[i]) {
+            continue;
+        }
+        if (sequence_length != 0 && static_cast<size_t>(shape[1]) != sequence_length) {
+            return fmt_str("DynamicBatchManager : sequence input %s has length %lld, expect %zu", input_names_[i],
+                           static_cast<long long>(shape[1]), sequence_length);
+        }
+        sequence_length = static_cast<size_t>(shape[1]);
+    }
+    return "";
+}
+
+bool DynamicBatchManager::IsPaddedInput(size_t input_index) const {
+    return !padding_buckets_.empty() && sequence_inputs_[input_index];
+}
+
+size_t DynamicBatchManager::GetBucketLength(size_t sequence_length) const {
+    auto bucket = std::lower_bound(padding_buckets_.begin(), padding_buckets_.end(), static_cast<int>(sequence_length));
+    if (bucket == padding_buckets_.end()) {
+        return sequence_length;
+    }
+    return static_cast<size_t>(*bucket);
+}
+
+void DynamicBatchManager::ModelExecute(std::shared_ptr<BatchContext>& batch_context, Ort::Session& ort_session) {
     std::vector<Ort::Value> input_tensor_data;
     input_tensor_data.reserve(batch_context->concat_inputs_.size());
     for (const auto& tensor_ptr : batch_context->concat_inputs_) {
-        input_tensor_data.emplace_back(CopyTensor(*tensor_ptr));
+        // feed the filled rows to ORT without copying them
+        input_tensor_data.emplace_back(CreateTensorView(*tensor_ptr, 0, batch_context->BatchTileCount()));
     }
 
-    auto outputs = ort_session_->Run(Ort::RunOptions(), input_names_.data(), input_tensor_data.data(),
-                                     batch_context->concat_inputs_.size(), output_names_.data(), output_names_.size());
+    auto outputs = ort_session.Run(Ort::RunOptions(), input_names_.data(), input_tensor_data.data(),
+                                   batch_context->concat_inputs_.size(), output_names_.data(), output_names_.size());
 
     for (auto& output_tensor : outputs) {
-        batch_context->concat_outputs_.emplace_back(std::make_shared<Ort::Value>(CopyTensor(output_tensor)));
+        batch_context->concat_outputs_.emplace_back(std::make_shared<Ort::Value>(std::move(output_tensor)));
     }
 }
 
 void DynamicBatchManager::ConcatInputs(const std::shared_ptr<BatchContext>& batch_context,
                                        const std::vector<std::shared_ptr<Ort::Value>>& inputs) {
     if (batch_context->BatchSize() == 1) {
+        // a single request runs as is, without padding
         batch_context->concat_inputs_ = inputs;
-        return;
-    }
-    for (size_t i = 0; i < inputs.size(); i++) {
-        batch_context->concat_inputs_[i] = ConcatTensors(batch_context->concat_inputs_[i], inputs[i]);
+    } else {
+        // CheckInputs and CanJoinBatch made sure the rows of the request fit into the staging tensors
+        if (!batch_context->staged_) {
+            // the second request joins, allocate the staging tensors once and move the rows of the first request in
+            for (size_t i = 0; i < inputs.size(); i++) {
+                auto& first_input = *batch_context->concat_inputs_[i];
+                std::shared_ptr<Ort::Value> staging_tensor;
+                if (IsPaddedInput(i)) {
+                    staging_tensor = std::make_shared<Ort::Value>(
+                        CreateBatchTensor(first_input, max_batch_size_, batch_context->bucket_length_));
+                    PadTensorRows(first_input, *staging_tensor, 0, pad_values_[i]);
+                } else {
+                    staging_tensor = std::make_shared<Ort::Value>(CreateBatchTensor(first_input, max_batch_size_));
+                    CopyTensorRows(first_input, *staging_tensor, 0);
+                }
+                batch_context->concat_inputs_[i] = staging_tensor;
+            }
+            batch_context->staged_ = true;
+        }
+        for (size_t i = 0; i < inputs.size(); i++) {
+            if (IsPaddedInput(i)) {
+                PadTensorRows(*inputs[i], *batch_context->concat_inputs_[i], batch_context->BatchTileCount(),
+                              pad_values_[i]);
+            } else {
+                CopyTensorRows(*inputs[i], *batch_context->concat_inputs_[i], batch_context->BatchTileCount());
+            }
+        }
     }
+    batch_context->tile_count_ += static_cast<size_t>(inputs[0]->GetTensorTypeAndShapeInfo().GetShape()[0]);
 }
 
-void DynamicBatchManager::SliceOutputs(const std::shared_ptr<BatchContext>& batch_context,
-                                       std::vector<std::shared_ptr<Ort::Value>>& targets,
-                                       std::pair<size_t, size_t>& index_span) {
+std::string DynamicBatchManager::SliceOutputs(const std::shared_ptr<BatchContext>& batch_context,
+                                              std::vector<std::shared_ptr<Ort::Value>>& targets,
+                                              BatchRequest& request) {
+    auto& index_span = request.index_span_;
+    size_t sequence_length = request.sequence_length_;
     targets.reserve(batch_context->concat_outputs_.size());
+    // a single request runs as is, and a batch of requests as long as the bucket is not padded
+    bool padded = batch_context->BatchSize() > 1 && batch_context->bucket_length_ != sequence_length;
     for (size_t i = 0; i < batch_context->concat_outputs_.size(); i++) {
+        auto& output = batch_context->concat_outputs_[i];
         if (batch_context->BatchSize() == 1) {
-            targets.emplace_back(batch_context->concat_outputs_[i]);
+            targets.emplace_back(output);
+            continue;
+        }
+
+        // sequence outputs, like token embeddings or logits, are cut back to the request length
+        if (padded && sequence_outputs_[i]) {
+            auto output_shape = output->GetTensorTypeAndShapeInfo().GetShape();
+            if (output_shape.size() < 2 || static_cast<size_t>(output_shape[1]) != batch_context->bucket_length_) {
+                return fmt_str("DynamicBatchManager : sequence output %s is not of the padded length %zu",
+                               output_names_[i], batch_context->bucket_length_);
+            }
+            targets.emplace_back(UnpadTensorSliceByIndexSpan(output, index_span, sequence_length));
         } else {
-            targets.emplace_back(GetTensorSliceByIndexSpan(batch_context->concat_outputs_[i], index_span));
+            targets.emplace_back(GetTensorSliceByIndexSpan(output, index_span));
         }
     }
+    return "";
 }
 
 void DynamicBatchManager::NotifyResults(const std::shared_ptr<BatchContext>& batch_context,
                                         const std::string& message) {
-    for (size_t i = 0; i < batch_context->BatchSize(); i++) {
+    auto now = std::chrono::steady_clock::now();
+    for (auto& request : batch_context->requests_) {
         // Notify waiting thread when it's finished
-        batch_context->error_message_promises_[i]->set_value(std::string(message));
+        std::vector<std::shared_ptr<Ort::Value>> outputs;
+        if (request.cancelled_ && *request.cancelled_) {
+            request.callback_(outputs, "Dynamic Batch Cancelled");
+        } else if (!message.empty()) {
+            request.callback_(outputs, message);
+        } else if (batch_context->concat_outputs_.empty() && now > request.deadline_) {
+            request.callback_(outputs, "Dynamic Batch Timeout");
+        } else {
+            auto slice_error_message = SliceOutputs(batch_context, outputs, request);
+            if (!slice_error_message.empty()) {
+                outputs.clear();
+            }
+            request.callback_(outputs, slice_error_message);
+        }
     }
 }
 }  // namespace ops
@@ -6,33 +6,76 @@
 #include <functional>
 #include <memory>
 #include <queue>
+#include <vector>
 
 #include "ort_batch_context.h"
 
 namespace pyis {
 namespace ops {
 
+/// <summary>
+/// Coalesces concurrent requests into batches along the first dimension and runs them on a pool of worker threads.
+/// A batch is dispatched as soon as it holds max_batch_size rows or one of the preferred batch sizes, or once
+/// its first request has waited max_queue_delay_us microseconds, whichever comes first. With a zero delay, a
+/// batch is dispatched as soon as a worker is idle.
+/// Worker i runs its batches on ort_sessions[i % ort_sessions.size()], and is bound to worker_cores[i] if
+/// worker_cores is not empty.
+/// If padding_buckets is not empty, requests of different lengths join the same batch as long as they fall into the
+/// same bucket, i.e. the smallest bucket length not less than theirs. The length of a request is the second dimension
+/// of the inputs flagged in sequence_inputs, which must all share it. Only these inputs are padded to the bucket
+/// length, with pad_values (one per input, 0 by default), and only the outputs flagged in sequence_outputs are cut back
+/// to the length of each request. All the other dims must match, like without padding. Requests longer than the
+/// largest bucket only batch with requests of the same length.
+/// </summary>
 class DynamicBatchManager final {
   public:
-    explicit DynamicBatchManager(int max_batch_size, std::shared_ptr<Ort::Session> ort_session,
-                                 std::vector<const char*>& input_names, std::vector<const char*>& output_names);
+    explicit DynamicBatchManager(int max_batch_size, int64_t max_queue_delay_us, std::vector<int> preferred_batch_sizes,
+                                 std::vector<std::shared_ptr<Ort::Session>> ort_sessions, int worker_num,
+                                 std::vector<std::vector<int>> worker_cores, std::vector<int> padding_buckets,
+                                 std::vector<int> pad_values, std::vector<bool> sequence_inputs,
+                                 std::vector<bool> sequence_outputs, std::vector<const char*>& input_names,
+                                 std::vector<const char*>& output_names);
+    ~DynamicBatchManager();
 
     void Execute(const std::vector<std::shared_ptr<Ort::Value>>& inputs,
                  std::vector<std::shared_ptr<Ort::Value>>& outputs);
 
+    /// <summary>
+    /// Queue a request and return without waiting for it. callback is called on a worker thread once the batch of
+    /// the request has run. A request which is cancelled, or whose deadline passes before its batch runs, fails
+    /// without running. A request whose inputs do not fit the model fails right away, without joining a batch.
+    /// </summary>
+    void ExecuteAsync(const std::vector<std::shared_ptr<Ort::Value>>& inputs, BatchCallback callback,
+                      std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max(),
+                      std::shared_ptr<std::atomic<bool>> cancelled = nullptr);
+
   private:
-    void WorkerLoop();
-    void ModelExecute(std::shared_ptr<BatchContext>& batch_context);
+    void WorkerLoop(size_t worker_index);
+    bool IsBatchReady(const BatchContext& batch_context) const;
+    bool CanJoinBatch(const BatchContext& batch_context, const std::vector<std::shared_ptr<Ort::Value>>& inputs,
+                      size_t tile_count, size_t bucket_length) const;
+    std::string CheckInputs(const std::vector<std::shared_ptr<Ort::Value>>& inputs, size_t& tile_count,
+                            size_t& sequence_length) const;
+    bool IsPaddedInput(size_t input_index) const;
+    size_t GetBucketLength(size_t sequence_length) const;
+    void ModelExecute(std::shared_ptr<BatchContext>& batch_context, Ort::Session& ort_session);
     void ConcatInputs(const std::shared_ptr<BatchContext>& batch_context,
                       const std::vector<std::shared_ptr<Ort::Value>>& inputs);
 
-    void SliceOutputs(const std::shared_ptr<BatchContext>& batch_context,
-                      std::vector<std::shared_ptr<Ort::Value>>& targets, std::pair<size_t, size_t>& index_span);
+    std::string SliceOutputs(const std::shared_ptr<BatchContext>& batch_context,
+                             std::vector<std::shared_ptr<Ort::Value>>& targets, BatchRequest& request);
     void NotifyResults(const std::shared_ptr<BatchContext>& batch_context, const std::string& message);
 
-    std::unique_ptr<std::thread> worker_thread_;
-    std::shared_ptr<Ort::Session> ort_session_;
+    std::vector<std::thread> worker_threads_;
+    std::vector<std::shared_ptr<Ort::Session>> ort_sessions_;
+    std::vector<std::vector<int>> worker_cores_;
     int max_batch_size_;
+    std::chrono::microseconds max_queue_delay_;
+    std::vector<int> preferred_batch_sizes_;
+    std::vector<int> padding_buckets_;
+    std::vector<int> pad_values_;
+    std::vector<bool> sequence_inputs_;
+    std::vector<bool> sequence_outputs_;
 
     std::vector<const char*> input_names_;
     std::vector<const char*> output_names_;
@@ -40,6 +83,7 @@ class DynamicBatchManager final {
     std::queue<std::shared_ptr<BatchContext>> batch_queue_;
     std::mutex queue_mutex_;
     std::condition_variable cv_;
+    bool stopped_ = false;
 };
 
 }  // namespace ops
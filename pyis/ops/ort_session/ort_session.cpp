@@ -7,6 +7,7 @@
 #include <cassert>   /* assert */
 
 #include "pyis/share/file_system.h"
+#include "pyis/share/hardware_utils.h"
 #include "pyis/share/json_persist_helper.h"
 #include "pyis/share/str_utils.h"
 
@@ -18,24 +19,48 @@ bool OrtSession::ort_initialized = false;
 
 OrtSession::OrtSession(std::string model_file, std::vector<std::string> input_names,
                        std::vector<std::string> output_names, int inter_op_thread_num, int intra_op_thread_num,
-                       bool dynamic_batching, int batch_size)
-    : src_model_file_(std::move(model_file)),
+                       bool dynamic_batching, int batch_size, int64_t max_queue_delay_us,
+                       std::vector<int> preferred_batch_sizes, int worker_num, bool session_per_worker,
+                       bool pin_workers, std::vector<int> padding_buckets, std::vector<int> pad_values,
+                       std::vector<std::string> sequence_inputs, std::vector<std::string> sequence_outputs,
+                       std::string attention_mask_input)
+    : inter_op_thread_num_(inter_op_thread_num),
+      intra_op_thread_num_(intra_op_thread_num),
       dynamic_batching_(dynamic_batching),
       batch_size_(batch_size),
-      inter_op_thread_num_(inter_op_thread_num),
-      intra_op_thread_num_(intra_op_thread_num),
+      max_queue_delay_us_(max_queue_delay_us),
+      preferred_batch_sizes_(std::move(preferred_batch_sizes)),
+      worker_num_(worker_num),
+      session_per_worker_(session_per_worker),
+      pin_workers_(pin_workers),
+      padding_buckets_(std::move(padding_buckets)),
+      pad_values_(std::move(pad_values)),
+      sequence_inputs_(std::move(sequence_inputs)),
+      sequence_outputs_(std::move(sequence_outputs)),
+      attention_mask_input_(std::move(attention_mask_input)),
       input_names_str_repr_(std::move(input_names)),
-      output_names_str_repr_(std::move(output_names)) {
+      output_names_str_repr_(std::move(output_names)),
+      src_model_file_(std::move(model_file)) {
     src_model_storage_ = std::make_shared<ModelStorageLocal>();
     BuildSession();
 }
 
 std::vector<std::shared_ptr<Ort::Value>> OrtSession::Run(const std::vector<std::shared_ptr<Ort::Value>>& inputs) {
+    std::vector<std::shared_ptr<Ort::Value>> model_inputs;
+    auto error_message = AddAttentionMask(inputs, model_inputs);
+    if (!error_message.empty()) {
+        PYIS_THROW("%s", error_message.c_str());
+    }
+    return RunModel(model_inputs);
+}
+
+std::vector<std::shared_ptr<Ort::Value>> OrtSession::RunModel(
+    const std::vector<std::shared_ptr<Ort::Value>>& model_inputs) {
     if (dynamic_batching_) {
         // run batch manager
         std::vector<std::shared_ptr<Ort::Value>> outputs;
         outputs.reserve(output_names_.size());
-        batch_mgr_->Execute(inputs, outputs);
+        batch_mgr_->Execute(model_inputs, outputs);
         return outputs;
     }
 
@@ -43,11 +68,11 @@ std::vector<std::shared_ptr<Ort::Value>> OrtSession::Run(const std::vector<std::
     input_tensor_data.reserve(input_names_.size());
     std::vector<std::shared_ptr<Ort::Value>> outputs;
     outputs.reserve(output_names_.size());
-    for (const auto& tensor_ptr : inputs) {
+    for (const auto& tensor_ptr : model_inputs) {
         input_tensor_data.emplace_back(ShallowCopyTensor(*tensor_ptr));
     }
-    auto output_tensor_data = session_->Run(Ort::RunOptions(), input_names_.data(), input_tensor_data.data(),
-                                            inputs.size(), output_names_.data(), output_names_.size());
+    auto output_tensor_data = sessions_[0]->Run(Ort::RunOptions(), input_names_.data(), input_tensor_data.data(),
+                                                model_inputs.size(), output_names_.data(), output_names_.size());
 
     for (auto& output_tensor : output_tensor_data) {
         outputs.emplace_back(std::make_shared<Ort::Value>(std::move(output_tensor)));
@@ -55,17 +80,80 @@ std::vector<std::shared_ptr<Ort::Value>> OrtSession::Run(const std::vector<std::
     return outputs;
 }
 
+void OrtSession::RunAsync(const std::vector<std::shared_ptr<Ort::Value>>& inputs, BatchCallback callback,
+                          int64_t timeout_ms, std::shared_ptr<std::atomic<bool>> cancelled) {
+    if (timeout_ms < 0) {
+        PYIS_THROW("OrtSession : timeout must not be negative, got %lld", static_cast<long long>(timeout_ms));
+    }
+
+    std::vector<std::shared_ptr<Ort::Value>> outputs;
+    std::vector<std::shared_ptr<Ort::Value>> model_inputs;
+    auto error_message = AddAttentionMask(inputs, model_inputs);
+    if (!error_message.empty()) {
+        callback(outputs, error_message);
+        return;
+    }
+
+    if (dynamic_batching_) {
+        auto deadline = std::chrono::steady_clock::time_point::max();
+        if (timeout_ms > 0) {
+            deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        }
+        batch_mgr_->ExecuteAsync(model_inputs, std::move(callback), deadline, std::move(cancelled));
+        return;
+    }
+
+    // without a batch manager there is no worker to hand the request to
+    if (cancelled && *cancelled) {
+        callback(outputs, "Dynamic Batch Cancelled");
+        return;
+    }
+#ifndef PYIS_NO_EXCEPTIONS
+    try {
+        outputs = RunModel(model_inputs);
+    } catch (const std::exception& e) {
+        error_message = e.what();
+    }
+#else
+    outputs = RunModel(model_inputs);
+#endif
+    callback(outputs, error_message);
+}
+
+std::future<RunResult> OrtSession::RunAsync(const std::vector<std::shared_ptr<Ort::Value>>& inputs,
+                                            int64_t timeout_ms) {
+    auto promise = std::make_shared<std::promise<RunResult>>();
+    auto future = promise->get_future();
+    RunAsync(
+        inputs,
+        [promise](std::vector<std::shared_ptr<Ort::Value>>& outputs, const std::string& error_message) {
+            promise->set_value(RunResult{std::move(outputs), error_message});
+        },
+        timeout_ms);
+    return future;
+}
+
 std::string OrtSession::Serialize(ModelStorage& storage) {
     std::string onnx_model_file = storage.uniq_file("ort_session", ".model.onnx");
     ModelStorage::copy_file(*src_model_storage_, src_model_file_, storage, onnx_model_file);
     std::string config_file = storage.uniq_file("ort_session", ".config.json");
 
-    JsonPersistHelper jph(1);
+    JsonPersistHelper jph(5);
     jph.add_file("onnx_model_file", onnx_model_file);
     jph.add<int>("inter_thread_op_num", inter_op_thread_num_, true);
     jph.add<int>("intra_thread_op_num", intra_op_thread_num_, true);
     jph.add<bool>("dynamic_batching", dynamic_batching_);
     jph.add<int>("batch_size", batch_size_);
+    jph.add<int64_t>("max_queue_delay_us", max_queue_delay_us_, true);
+    jph.add<int>("preferred_batch_sizes", preferred_batch_sizes_, true);
+    jph.add<int>("worker_num", worker_num_, true);
+    jph.add<bool>("session_per_worker", session_per_worker_, true);
+    jph.add<bool>("pin_workers", pin_workers_, true);
+    jph.add<int>("padding_buckets", padding_buckets_, true);
+    jph.add<int>("pad_values", pad_values_);
+    jph.add("sequence_inputs", sequence_inputs_);
+    jph.add("sequence_outputs", sequence_outputs_);
+    jph.add("attention_mask_input", attention_mask_input_);
     jph.add("input_names", input_names_str_repr_);
     jph.add("output_names", output_names_str_repr_);
     std::string state = jph.serialize(config_file, storage);
@@ -75,11 +163,42 @@ std::string OrtSession::Serialize(ModelStorage& storage) {
 void OrtSession::Deserialize(const std::string& state, ModelStorage& storage) {
     JsonPersistHelper jph(state, storage);
     int version = jph.version();
-    if (1 == version) {
+    if (version >= 1 && version <= 5) {
         src_model_file_ = jph.get_file("onnx_model_file");
         src_model_storage_ = storage.clone();
         dynamic_batching_ = jph.get<bool>("dynamic_batching");
         batch_size_ = jph.get<int>("batch_size");
+        // v1 has no batching policy, which means dispatching batches without delay
+        max_queue_delay_us_ = 0;
+        preferred_batch_sizes_.clear();
+        if (version >= 2) {
+            max_queue_delay_us_ = jph.get<int64_t>("max_queue_delay_us");
+            preferred_batch_sizes_ = jph.get<std::vector<int>>("preferred_batch_sizes");
+        }
+        // v1 and v2 run batches on a single worker
+        worker_num_ = 1;
+        session_per_worker_ = false;
+        pin_workers_ = false;
+        if (version >= 3) {
+            worker_num_ = jph.get<int>("worker_num");
+            session_per_worker_ = jph.get<bool>("session_per_worker");
+            pin_workers_ = jph.get<bool>("pin_workers");
+        }
+        // Before v4 requests of different lengths are never padded. v4 padded all the inputs and guessed the outputs
+        // to cut back from their shape, which can not be told apart from other inputs and outputs, so v4 sessions
+        // also run without padding.
+        padding_buckets_.clear();
+        pad_values_.clear();
+        sequence_inputs_.clear();
+        sequence_outputs_.clear();
+        attention_mask_input_.clear();
+        if (version >= 5) {
+            padding_buckets_ = jph.get<std::vector<int>>("padding_buckets");
+            pad_values_ = jph.get<std::vector<int>>("pad_values");
+            sequence_inputs_ = jph.get<std::vector<std::string>>("sequence_inputs");
+            sequence_outputs_ = jph.get<std::vector<std::string>>("sequence_outputs");
+            attention_mask_input_ = jph.get("attention_mask_input");
+        }
         inter_op_thread_num_ = jph.get<int>("inter_thread_op_num");
         intra_op_thread_num_ = jph.get<int>("intra_thread_op_num");
         input_names_str_repr_ = jph.get<std::vector<std::string>>("input_names");
@@ -91,10 +210,28 @@ void OrtSession::Deserialize(const std::string& state, ModelStorage& storage) {
 }
 
 void OrtSession::BuildSession() {
+    if (worker_num_ < 1) {
+        PYIS_THROW("OrtSession : worker_num must be positive, got %d", worker_num_);
+    }
+    size_t session_num = (dynamic_batching_ && session_per_worker_) ? worker_num_ : 1;
+    std::vector<std::vector<int>> worker_cores;
+    if (dynamic_batching_ && pin_workers_) {
+        worker_cores = partition_cores(worker_num_);
+    }
+
     // initialize Session options
     session_options_ = std::make_shared<Ort::SessionOptions>();
 
-    session_options_->SetIntraOpNumThreads(intra_op_thread_num_);
+    int intra_op_thread_num = intra_op_thread_num_;
+    if (session_num > 1 && intra_op_thread_num == 0) {
+        // sessions would oversubscribe the cores if each of them used all the cores, split the cores among them
+        int core_num = 0;
+        for (const auto& node_cores : get_numa_node_cores()) {
+            core_num += static_cast<int>(node_cores.size());
+        }
+        intra_op_thread_num = std::max(1, core_num / static_cast<int>(session_num));
+    }
+    session_options_->SetIntraOpNumThreads(intra_op_thread_num);
     session_options_->SetInterOpNumThreads(inter_op_thread_num_);
 
     // convert input_names and output_names
@@ -108,15 +245,91 @@ void OrtSession::BuildSession() {
     std::transform(output_names_str_repr_.begin(), output_names_str_repr_.end(), output_names_.begin(),
                    [](std::string& name) { return name.c_str(); });
 
+    // flag the sequence inputs and outputs by position, the generated attention mask is a sequence input padded with 0
+    std::vector<bool> sequence_input_flags(input_names_str_repr_.size(), false);
+    std::vector<bool> sequence_output_flags(output_names_str_repr_.size(), false);
+    for (const auto& name : sequence_inputs_) {
+        auto it = std::find(input_names_str_repr_.begin(), input_names_str_repr_.end(), name);
+        if (it == input_names_str_repr_.end()) {
+            PYIS_THROW("OrtSession : sequence input %s is not an input", name.c_str());
+        }
+        sequence_input_flags[it - input_names_str_repr_.begin()] = true;
+    }
+    for (const auto& name : sequence_outputs_) {
+        auto it = std::find(output_names_str_repr_.begin(), output_names_str_repr_.end(), name);
+        if (it == output_names_str_repr_.end()) {
+            PYIS_THROW("OrtSession : sequence output %s is not an output", name.c_str());
+        }
+        sequence_output_flags[it - output_names_str_repr_.begin()] = true;
+    }
+    std::vector<int> pad_values = pad_values_;
+    if (!attention_mask_input_.empty()) {
+        auto it = std::find(input_names_str_repr_.begin(), input_names_str_repr_.end(), attention_mask_input_);
+        if (it == input_names_str_repr_.end()) {
+            PYIS_THROW("OrtSession : attention mask %s is not an input", attention_mask_input_.c_str());
+        }
+        attention_mask_index_ = it - input_names_str_repr_.begin();
+        auto shape_input = std::find_if(sequence_inputs_.begin(), sequence_inputs_.end(),
+                                        [this](const std::string& name) { return name != attention_mask_input_; });
+        if (shape_input == sequence_inputs_.end()) {
+            PYIS_THROW("OrtSession : the attention mask requires a sequence input to take its length from");
+        }
+        attention_mask_shape_index_ =
+            std::find(input_names_str_repr_.begin(), input_names_str_repr_.end(), *shape_input) -
+            input_names_str_repr_.begin();
+        sequence_input_flags[attention_mask_index_] = true;
+        if (attention_mask_index_ < pad_values.size()) {
+            pad_values[attention_mask_index_] = 0;
+        }
+    }
+
     // load model from memory buffer. https://github.com/microsoft/onnxruntime/issues/6475
     auto model_stream = src_model_storage_->open_istream(src_model_file_);
     std::vector<char> model_buffer((std::istreambuf_iterator<char>(*model_stream)), std::istreambuf_iterator<char>());
-    session_.reset(new Ort::Session(*OrtGlobals::Env, model_buffer.data(), model_buffer.size(), *session_options_));
+    sessions_.clear();
+    for (size_t i = 0; i < session_num; i++) {
+        // intra-op threads are created along with the session and inherit the affinity of the creating thread on
+        // linux, so build each session while bound to the cores of the worker that uses it
+        std::vector<int> previous_cores;
+        bool bound = session_num > 1 && !worker_cores.empty() && bind_current_thread(worker_cores[i], &previous_cores);
+        sessions_.emplace_back(std::make_shared<Ort::Session>(*OrtGlobals::Env, model_buffer.data(),
+                                                              model_buffer.size(), *session_options_));
+        if (bound) {
+            bind_current_thread(previous_cores);
+        }
+    }
 
     // use dynamic batching or not
     if (dynamic_batching_) {
-        this->batch_mgr_ = std::make_unique<DynamicBatchManager>(batch_size_, session_, input_names_, output_names_);
+        this->batch_mgr_ =
+            std::make_unique<DynamicBatchManager>(batch_size_, max_queue_delay_us_, preferred_batch_sizes_, sessions_,
+                                                  worker_num_, worker_cores, padding_buckets_, pad_values,
+                                                  sequence_input_flags, sequence_output_flags, input_names_,
+                                                  output_names_);
+    }
+}
+
+std::string OrtSession::AddAttentionMask(const std::vector<std::shared_ptr<Ort::Value>>& inputs,
+                                         std::vector<std::shared_ptr<Ort::Value>>& model_inputs) const {
+    model_inputs = inputs;
+    if (attention_mask_input_.empty()) {
+        return "";
+    }
+    // input_names_ is handed over to the batch manager, the names are only left in input_names_str_repr_
+    if (inputs.size() + 1 != input_names_str_repr_.size()) {
+        return fmt_str("OrtSession : expect %zu inputs besides the attention mask, got %zu",
+                       input_names_str_repr_.size() - 1, inputs.size());
+    }
+    // the caller passes all the inputs but the mask
+    size_t shape_index = attention_mask_shape_index_ - (attention_mask_shape_index_ > attention_mask_index_ ? 1 : 0);
+    auto shape = inputs[shape_index]->GetTensorTypeAndShapeInfo().GetShape();
+    if (shape.size() < 2) {
+        return fmt_str("OrtSession : input %s has no sequence dimension for the attention mask",
+                       input_names_str_repr_[attention_mask_shape_index_].c_str());
     }
+    auto mask = CreateAttentionMask(static_cast<size_t>(shape[0]), static_cast<size_t>(shape[1]));
+    model_inputs.insert(model_inputs.begin() + attention_mask_index_, std::make_shared<Ort::Value>(std::move(mask)));
+    return "";
 }
 
 void OrtSession::InitializeOrt(const std::string& ort_dll_file) {
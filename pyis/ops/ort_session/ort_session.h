@@ -3,7 +3,9 @@
 
 #pragma once
 
+#include <atomic>
 #include <codecvt>
+#include <future>
 #include <locale>
 #include <memory>
 #include <string>
@@ -19,10 +21,21 @@
 namespace pyis {
 namespace ops {
 
+// outputs of a request run by RunAsync, or the error message if it failed. The error is passed as a value, so that
+// it also reaches the caller in builds without exceptions.
+struct RunResult {
+    std::vector<std::shared_ptr<Ort::Value>> outputs_;
+    std::string error_message_;
+};
+
 class OrtSession : public CachedObject<OrtSession> {
   public:
     OrtSession(std::string model_file, std::vector<std::string> input_names, std::vector<std::string> output_names,
-               int inter_op_thread_num, int intra_op_thread_num, bool dynamic_batching = false, int batch_size = 1);
+               int inter_op_thread_num, int intra_op_thread_num, bool dynamic_batching = false, int batch_size = 1,
+               int64_t max_queue_delay_us = 0, std::vector<int> preferred_batch_sizes = {}, int worker_num = 1,
+               bool session_per_worker = false, bool pin_workers = false, std::vector<int> padding_buckets = {},
+               std::vector<int> pad_values = {}, std::vector<std::string> sequence_inputs = {},
+               std::vector<std::string> sequence_outputs = {}, std::string attention_mask_input = "");
 
     // For deserialization
     OrtSession() = default;
@@ -32,6 +45,19 @@ class OrtSession : public CachedObject<OrtSession> {
 
     std::vector<std::shared_ptr<Ort::Value>> Run(const std::vector<std::shared_ptr<Ort::Value>>& inputs);
 
+    /// <summary>
+    /// Queue a request without blocking the caller. With dynamic batching, callback is called on a batch worker
+    /// thread once the batch of the request has run, otherwise the request runs on the calling thread before
+    /// RunAsync returns.
+    /// </summary>
+    /// <param name="timeout_ms">fail the request if its batch has not run in time, 0 for no timeout</param>
+    /// <param name="cancelled">set it to true to drop the request before its batch runs</param>
+    void RunAsync(const std::vector<std::shared_ptr<Ort::Value>>& inputs, BatchCallback callback,
+                  int64_t timeout_ms = 0, std::shared_ptr<std::atomic<bool>> cancelled = nullptr);
+
+    // like RunAsync with a callback, with the outputs or the error of the request delivered through the future
+    std::future<RunResult> RunAsync(const std::vector<std::shared_ptr<Ort::Value>>& inputs, int64_t timeout_ms = 0);
+
     /// <summary>
     /// Initialize onnxruntime dynamically by loading ort dll
     /// </summary>
@@ -40,16 +66,34 @@ class OrtSession : public CachedObject<OrtSession> {
 
   private:
     void BuildSession();
+    std::vector<std::shared_ptr<Ort::Value>> RunModel(const std::vector<std::shared_ptr<Ort::Value>>& model_inputs);
+    std::string AddAttentionMask(const std::vector<std::shared_ptr<Ort::Value>>& inputs,
+                                 std::vector<std::shared_ptr<Ort::Value>>& model_inputs) const;
 
     static std::mutex ort_initialization_mutex;
     static bool ort_initialized;
     std::shared_ptr<Ort::SessionOptions> session_options_;
-    std::shared_ptr<Ort::Session> session_;
+    // the first session serves Run without dynamic batching, all of them serve the workers of batch_mgr_
+    std::vector<std::shared_ptr<Ort::Session>> sessions_;
 
     int inter_op_thread_num_;
     int intra_op_thread_num_;
     bool dynamic_batching_;
     int batch_size_;
+    int64_t max_queue_delay_us_;
+    std::vector<int> preferred_batch_sizes_;
+    int worker_num_;
+    bool session_per_worker_;
+    bool pin_workers_;
+    std::vector<int> padding_buckets_;
+    std::vector<int> pad_values_;
+    std::vector<std::string> sequence_inputs_;
+    std::vector<std::string> sequence_outputs_;
+    // an int64 input which is not passed by the caller, but generated with ones along the length of the request
+    std::string attention_mask_input_;
+    // position of the attention mask, and of the sequence input it takes its shape from, among the model inputs
+    size_t attention_mask_index_ = 0;
+    size_t attention_mask_shape_index_ = 0;
 
     std::vector<const char*> input_names_;
     std::vector<const char*> output_names_;
@@ -3,12 +3,14 @@
 
 #include "ort_tensor_utils.h"
 
+#include <algorithm>
+
 namespace pyis {
 namespace ops {
 
-bool CheckTensorDimensionMatch(std::vector<int64_t>& shape_src, std::vector<int64_t>& shape_tgt) {
+bool CheckTensorDimensionMatch(std::vector<int64_t>& shape_src, std::vector<int64_t>& shape_tgt, size_t start_dim) {
     if (shape_src.size() != shape_tgt.size()) return false;
-    for (int i = 1; i < shape_src.size(); i++) {
+    for (size_t i = start_dim; i < shape_src.size(); i++) {
         if (shape_src[i] != shape_tgt[i]) return false;
     }
     return true;
@@ -47,17 +49,6 @@ std::shared_ptr<Ort::Value> CreateConcatOrtTensor(const std::shared_ptr<Ort::Val
     return concat_tensor;
 }
 
-template <typename T>
-std::shared_ptr<Ort::Value> CreateSliceOrtTensor(void* data_ptr, size_t numel, std::vector<int64_t>& shape,
-                                                 size_t dim) {
-    auto& allocator = OrtGlobals::Allocator;
-    auto tensor_ptr = std::make_shared<Ort::Value>(Ort::Value::CreateTensor<T>(*allocator, shape.data(), dim));
-    T* data_map = tensor_ptr->template GetTensorMutableData<T>();
-    memcpy(static_cast<void*>(data_map), data_ptr, numel * sizeof(T));
-
-    return tensor_ptr;
-}
-
 size_t GetTensorElementBytes(Ort::Value& tensor) {
     switch (tensor.GetTensorTypeAndShapeInfo().GetElementType()) {
         case ONNXTensorElementDataType::ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT:
@@ -176,44 +167,168 @@ std::shared_ptr<Ort::Value> ConcatTensors(const std::shared_ptr<Ort::Value>& src
 std::shared_ptr<Ort::Value> GetTensorSliceByIndexSpan(const std::shared_ptr<Ort::Value>& tensor,
                                                       std::pair<size_t, size_t>& slice_span) {
     auto tensor_shape = tensor->GetTensorTypeAndShapeInfo().GetShape();
-    auto base_elem_type = tensor->GetTensorTypeAndShapeInfo().GetElementType();
-    auto base_dim = tensor->GetTensorTypeAndShapeInfo().GetDimensionsCount();
     if (tensor_shape.empty()) PYIS_THROW("GetTensorSliceByIndexSpan : empty tensor");
     if (slice_span.first > slice_span.second || slice_span.second > tensor_shape[0])
         PYIS_THROW("GetTensorSliceByIndexSpan : invalid slice indexes");
 
-    size_t elem_per_slice = 1;
-    for (int i = 1; i < tensor_shape.size(); i++) {
-        elem_per_slice *= static_cast<size_t>(tensor_shape[i]);
+    // the view does not own its data, keep the sliced tensor alive as long as the view is alive
+    std::shared_ptr<Ort::Value> owner = tensor;
+    auto* view = new Ort::Value(CreateTensorView(*tensor, slice_span.first, slice_span.second));
+    return std::shared_ptr<Ort::Value>(view, [owner](Ort::Value* v) { delete v; });
+}
+
+size_t GetTensorRowBytes(Ort::Value& tensor) {
+    auto tensor_shape = tensor.GetTensorTypeAndShapeInfo().GetShape();
+    size_t elem_per_row = 1;
+    for (size_t i = 1; i < tensor_shape.size(); i++) {
+        elem_per_row *= static_cast<size_t>(tensor_shape[i]);
     }
+    return elem_per_row * GetTensorElementBytes(tensor);
+}
 
-    size_t new_numel = (slice_span.second - slice_span.first) * elem_per_slice;
-    std::shared_ptr<Ort::Value> ret_tensor_ptr;
-    auto& allocator = OrtGlobals::Allocator;
-    size_t start_offset = slice_span.first * elem_per_slice;
-    void* src_data_ptr = nullptr;
+Ort::Value CreateBatchTensor(Ort::Value& sample_tensor, size_t row_count, size_t sequence_length) {
+    auto shape = sample_tensor.GetTensorTypeAndShapeInfo().GetShape();
+    if (shape.empty()) PYIS_THROW("CreateBatchTensor : empty tensor");
+    shape[0] = static_cast<int64_t>(row_count);
+    if (sequence_length != 0 && shape.size() > 1) {
+        shape[1] = static_cast<int64_t>(sequence_length);
+    }
+    return Ort::Value::CreateTensor(*OrtGlobals::Allocator, shape.data(), shape.size(),
+                                    sample_tensor.GetTensorTypeAndShapeInfo().GetElementType());
+}
+
+void CopyTensorRows(Ort::Value& src_tensor, Ort::Value& dst_tensor, size_t row_offset) {
+    auto src_shape = src_tensor.GetTensorTypeAndShapeInfo().GetShape();
+    auto dst_shape = dst_tensor.GetTensorTypeAndShapeInfo().GetShape();
+    if (!CheckTensorDimensionMatch(src_shape, dst_shape) ||
+        src_tensor.GetTensorTypeAndShapeInfo().GetElementType() !=
+            dst_tensor.GetTensorTypeAndShapeInfo().GetElementType()) {
+        PYIS_THROW("CopyTensorRows : dimension or shape or type mismatch");
+    }
+    if (row_offset + src_shape[0] > static_cast<size_t>(dst_shape[0])) {
+        PYIS_THROW("CopyTensorRows : not enough rows in target tensor");
+    }
 
-    tensor_shape[0] = (slice_span.second - slice_span.first);
+    size_t row_bytes = GetTensorRowBytes(src_tensor);
+    memcpy(static_cast<char*>(dst_tensor.GetTensorMutableData<void>()) + row_offset * row_bytes,
+           src_tensor.GetTensorData<void>(), src_shape[0] * row_bytes);
+}
 
-    switch (base_elem_type) {
-        case ::ONNXTensorElementDataType::ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT:
-            src_data_ptr = static_cast<char*>(tensor->GetTensorMutableData<void>()) + start_offset * sizeof(float);
-            return CreateSliceOrtTensor<float>(src_data_ptr, new_numel, tensor_shape, base_dim);
-        case ::ONNXTensorElementDataType::ONNX_TENSOR_ELEMENT_DATA_TYPE_DOUBLE:
-            src_data_ptr = static_cast<char*>(tensor->GetTensorMutableData<void>()) + start_offset * sizeof(double);
-            return CreateSliceOrtTensor<double>(src_data_ptr, new_numel, tensor_shape, base_dim);
-        case ::ONNXTensorElementDataType::ONNX_TENSOR_ELEMENT_DATA_TYPE_INT32:
-            src_data_ptr = static_cast<char*>(tensor->GetTensorMutableData<void>()) + start_offset * sizeof(int);
-            return CreateSliceOrtTensor<int>(src_data_ptr, new_numel, tensor_shape, base_dim);
-        case ::ONNXTensorElementDataType::ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64:
-            src_data_ptr = static_cast<char*>(tensor->GetTensorMutableData<void>()) + start_offset * sizeof(int64_t);
-            return CreateSliceOrtTensor<int64_t>(src_data_ptr, new_numel, tensor_shape, base_dim);
-        case ::ONNXTensorElementDataType::ONNX_TENSOR_ELEMENT_DATA_TYPE_BOOL:
-            src_data_ptr = static_cast<char*>(tensor->GetTensorMutableData<void>()) + start_offset * sizeof(bool);
-            return CreateSliceOrtTensor<bool>(src_data_ptr, new_numel, tensor_shape, base_dim);
+template <typename T>
+void FillTensorData(void* data_ptr, size_t numel, int64_t value) {
+    std::fill_n(static_cast<T*>(data_ptr), numel, static_cast<T>(value));
+}
+
+void FillTensorData(ONNXTensorElementDataType elem_type, void* data_ptr, size_t numel, int64_t value) {
+    switch (elem_type) {
+        case ONNXTensorElementDataType::ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT:
+            return FillTensorData<float>(data_ptr, numel, value);
+        case ONNXTensorElementDataType::ONNX_TENSOR_ELEMENT_DATA_TYPE_DOUBLE:
+            return FillTensorData<double>(data_ptr, numel, value);
+        case ONNXTensorElementDataType::ONNX_TENSOR_ELEMENT_DATA_TYPE_INT32:
+            return FillTensorData<int>(data_ptr, numel, value);
+        case ONNXTensorElementDataType::ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64:
+            return FillTensorData<int64_t>(data_ptr, numel, value);
+        case ONNXTensorElementDataType::ONNX_TENSOR_ELEMENT_DATA_TYPE_BOOL:
+            return FillTensorData<bool>(data_ptr, numel, value);
         default:
-            PYIS_THROW("ConcatTensor : data type not supported");
+            PYIS_THROW("FillTensorData : data type not supported");
+    }
+}
+
+void PadTensorRows(Ort::Value& src_tensor, Ort::Value& dst_tensor, size_t row_offset, int64_t pad_value) {
+    auto src_shape = src_tensor.GetTensorTypeAndShapeInfo().GetShape();
+    auto dst_shape = dst_tensor.GetTensorTypeAndShapeInfo().GetShape();
+    if (src_shape.size() < 2 || src_shape.size() != dst_shape.size() || src_shape[1] == dst_shape[1]) {
+        CopyTensorRows(src_tensor, dst_tensor, row_offset);
+        return;
+    }
+
+    auto elem_type = src_tensor.GetTensorTypeAndShapeInfo().GetElementType();
+    if (!CheckTensorDimensionMatch(src_shape, dst_shape, 2) ||
+        elem_type != dst_tensor.GetTensorTypeAndShapeInfo().GetElementType()) {
+        PYIS_THROW("PadTensorRows : dimension or shape or type mismatch");
+    }
+    if (src_shape[1] > dst_shape[1]) {
+        PYIS_THROW("PadTensorRows : sequence is longer than the target tensor");
+    }
+    if (row_offset + src_shape[0] > static_cast<size_t>(dst_shape[0])) {
+        PYIS_THROW("PadTensorRows : not enough rows in target tensor");
+    }
+
+    size_t elem_per_step = 1;
+    for (size_t i = 2; i < src_shape.size(); i++) {
+        elem_per_step *= static_cast<size_t>(src_shape[i]);
+    }
+    size_t elem_bytes = GetTensorElementBytes(src_tensor);
+    size_t src_row_numel = src_shape[1] * elem_per_step;
+    size_t dst_row_numel = dst_shape[1] * elem_per_step;
+
+    const auto* src_data = static_cast<const char*>(src_tensor.GetTensorData<void>());
+    auto* dst_data = static_cast<char*>(dst_tensor.GetTensorMutableData<void>());
+    dst_data += row_offset * dst_row_numel * elem_bytes;
+    for (int64_t row = 0; row < src_shape[0]; row++) {
+        memcpy(dst_data, src_data, src_row_numel * elem_bytes);
+        FillTensorData(elem_type, dst_data + src_row_numel * elem_bytes, dst_row_numel - src_row_numel, pad_value);
+        src_data += src_row_numel * elem_bytes;
+        dst_data += dst_row_numel * elem_bytes;
+    }
+}
+
+std::shared_ptr<Ort::Value> UnpadTensorSliceByIndexSpan(const std::shared_ptr<Ort::Value>& tensor,
+                                                        std::pair<size_t, size_t>& slice_span, size_t sequence_length) {
+    auto tensor_shape = tensor->GetTensorTypeAndShapeInfo().GetShape();
+    if (tensor_shape.size() < 2) PYIS_THROW("UnpadTensorSliceByIndexSpan : tensor has no sequence dimension");
+    if (slice_span.first > slice_span.second || slice_span.second > static_cast<size_t>(tensor_shape[0]))
+        PYIS_THROW("UnpadTensorSliceByIndexSpan : invalid slice indexes");
+    if (sequence_length > static_cast<size_t>(tensor_shape[1]))
+        PYIS_THROW("UnpadTensorSliceByIndexSpan : invalid sequence length");
+
+    size_t elem_per_step = 1;
+    for (size_t i = 2; i < tensor_shape.size(); i++) {
+        elem_per_step *= static_cast<size_t>(tensor_shape[i]);
+    }
+    size_t elem_bytes = GetTensorElementBytes(*tensor);
+    size_t src_row_bytes = tensor_shape[1] * elem_per_step * elem_bytes;
+    size_t dst_row_bytes = sequence_length * elem_per_step * elem_bytes;
+
+    auto result_shape = tensor_shape;
+    result_shape[0] = static_cast<int64_t>(slice_span.second - slice_span.first);
+    result_shape[1] = static_cast<int64_t>(sequence_length);
+    auto result = std::make_shared<Ort::Value>(
+        Ort::Value::CreateTensor(*OrtGlobals::Allocator, result_shape.data(), result_shape.size(),
+                                 tensor->GetTensorTypeAndShapeInfo().GetElementType()));
+
+    const auto* src_data = static_cast<const char*>(tensor->GetTensorData<void>()) + slice_span.first * src_row_bytes;
+    auto* dst_data = static_cast<char*>(result->GetTensorMutableData<void>());
+    for (size_t row = slice_span.first; row < slice_span.second; row++) {
+        memcpy(dst_data, src_data, dst_row_bytes);
+        src_data += src_row_bytes;
+        dst_data += dst_row_bytes;
     }
+    return result;
+}
+
+Ort::Value CreateAttentionMask(size_t row_count, size_t sequence_length) {
+    std::vector<int64_t> shape{static_cast<int64_t>(row_count), static_cast<int64_t>(sequence_length)};
+    auto mask = Ort::Value::CreateTensor<int64_t>(*OrtGlobals::Allocator, shape.data(), shape.size());
+    std::fill_n(mask.GetTensorMutableData<int64_t>(), row_count * sequence_length, 1);
+    return mask;
+}
+
+Ort::Value CreateTensorView(Ort::Value& tensor, size_t row_begin, size_t row_end) {
+    auto shape = tensor.GetTensorTypeAndShapeInfo().GetShape();
+    if (shape.empty()) PYIS_THROW("CreateTensorView : empty tensor");
+    if (row_begin > row_end || row_end > static_cast<size_t>(shape[0]))
+        PYIS_THROW("CreateTensorView : invalid row indexes");
+
+    size_t row_bytes = GetTensorRowBytes(tensor);
+    shape[0] = static_cast<int64_t>(row_end - row_begin);
+    auto memory_info = Ort::MemoryInfo::CreateCpu(OrtAllocatorType::OrtArenaAllocator, OrtMemType::OrtMemTypeDefault);
+    return Ort::Value::CreateTensor(memory_info,
+                                    static_cast<char*>(tensor.GetTensorMutableData<void>()) + row_begin * row_bytes,
+                                    (row_end - row_begin) * row_bytes, shape.data(), shape.size(),
+                                    tensor.GetTensorTypeAndShapeInfo().GetElementType());
 }
 
 Ort::Value CopyTensor(Ort::Value& src_tensor) {
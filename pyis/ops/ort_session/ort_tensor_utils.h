@@ -11,7 +11,8 @@
 namespace pyis {
 namespace ops {
 
-bool CheckTensorDimensionMatch(std::vector<int64_t>& shape_src, std::vector<int64_t>& shape_tgt);
+// check if two tensors have the same rank and the same dims from start_dim on
+bool CheckTensorDimensionMatch(std::vector<int64_t>& shape_src, std::vector<int64_t>& shape_tgt, size_t start_dim = 1);
 
 template <typename T>
 std::shared_ptr<Ort::Value> CreateConcatOrtTensor(const std::vector<std::shared_ptr<Ort::Value>>& tensors,
@@ -22,9 +23,6 @@ std::shared_ptr<Ort::Value> CreateConcatOrtTensor(const std::shared_ptr<Ort::Val
                                                   const std::shared_ptr<Ort::Value>& tgt_tensor,
                                                   const std::vector<int64_t>& shape, size_t dim);
 
-template <typename T>
-std::shared_ptr<Ort::Value> CreateSliceOrtTensor(void* data_ptr, size_t numel, std::vector<int64_t>& shape, size_t dim);
-
 size_t GetTensorElementBytes(Ort::Value& tensor);
 
 void* GetTensorDatamap(Ort::Value& tensor);
@@ -34,9 +32,33 @@ std::shared_ptr<Ort::Value> ConcatTensors(std::vector<std::shared_ptr<Ort::Value
 std::shared_ptr<Ort::Value> ConcatTensors(const std::shared_ptr<Ort::Value>& src_tensor,
                                           const std::shared_ptr<Ort::Value>& tgt_tensor);
 
+// return a view on the rows in slice_span, which shares the ownership of the sliced tensor instead of copying it
 std::shared_ptr<Ort::Value> GetTensorSliceByIndexSpan(const std::shared_ptr<Ort::Value>& tensor,
                                                       std::pair<size_t, size_t>& slice_span);
 
+size_t GetTensorRowBytes(Ort::Value& tensor);
+
+// allocate a tensor with row_count rows along the first dimension, and the same other dims and type as sample_tensor.
+// The second dimension is set to sequence_length if sequence_length is not 0 and sample_tensor has one.
+Ort::Value CreateBatchTensor(Ort::Value& sample_tensor, size_t row_count, size_t sequence_length = 0);
+
+// copy all rows of src_tensor into dst_tensor, starting from row row_offset of dst_tensor
+void CopyTensorRows(Ort::Value& src_tensor, Ort::Value& dst_tensor, size_t row_offset);
+
+// copy all rows of src_tensor into dst_tensor like CopyTensorRows, while padding the second dimension of each row
+// with pad_value up to that of dst_tensor
+void PadTensorRows(Ort::Value& src_tensor, Ort::Value& dst_tensor, size_t row_offset, int64_t pad_value);
+
+// copy the rows in slice_span, keeping the first sequence_length elements along the second dimension
+std::shared_ptr<Ort::Value> UnpadTensorSliceByIndexSpan(const std::shared_ptr<Ort::Value>& tensor,
+                                                        std::pair<size_t, size_t>& slice_span, size_t sequence_length);
+
+// create an int64 tensor of row_count rows of sequence_length ones, the attention mask of sequences without padding
+Ort::Value CreateAttentionMask(size_t row_count, size_t sequence_length);
+
+// create a non-owning tensor on the rows [row_begin, row_end) of tensor
+Ort::Value CreateTensorView(Ort::Value& tensor, size_t row_begin, size_t row_end);
+
 Ort::Value CopyTensor(Ort::Value& src_tensor);
 
 Ort::Value ShallowCopyTensor(Ort::Value& src_tensor);
@@ -54,6 +54,8 @@ Expected<int> CedarTrie::Lookup(const std::string& key) const {
     return Expected<int>(ret);
 }
 
+int CedarTrie::Traverse(const char* key, size_t len, uint64_t& from) const { return trie_->Traverse(key, len, from); }
+
 int CedarTrie::Erase(const std::string& key) { return trie_->Erase(key.c_str()); }
 
 // 1 for reserved value, 0 for inserted, -1 for updated.
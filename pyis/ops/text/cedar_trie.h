@@ -40,6 +40,10 @@ class CedarTrie : public CachedObject<CedarTrie> {
 
     Expected<int> Lookup(const std::string& key) const;
 
+    // Extend the search left at node `from` by a previous call with key[0, len). Starts from the root when from is
+    // 0. Returns the value of the key searched so far, or CEDAR_NO_VALUE / CEDAR_NO_PATH.
+    int Traverse(const char* key, size_t len, uint64_t& from) const;
+
     int Erase(const std::string& key);
 
     // 1 for reserved value, 0 for inserted, -1 for updated.
@@ -0,0 +1,99 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PYIS_EDGE_LIST_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define PYIS_EDGE_LIST_NEON
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace pyis {
+namespace ops {
+
+// An edge list of ImmutableTrie is a sequence of (char, offset) records, `stride` bytes each, with 1 to 4 bytes of
+// offset. It holds at most 15 records, so it spans at most 75 bytes.
+constexpr uint32_t EDGE_LIST_MAX_STRIDE = 5;
+constexpr uint32_t EDGE_LIST_MAX_BYTES = 15 * EDGE_LIST_MAX_STRIDE;
+// the vectorized search reads whole 16 bytes blocks, up to this many bytes past the end of a list
+constexpr uint32_t EDGE_LIST_OVERREAD = 15;
+
+// index of the record whose char is ch, or -1
+inline int FindEdgeScalar(const uint8_t* edges, uint8_t ch, uint32_t stride, uint32_t edges_cnt) {
+    for (uint32_t i = 0; i < edges_cnt; i++, edges += stride) {
+        if (*edges == ch) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+#if defined(PYIS_EDGE_LIST_SSE2) || defined(PYIS_EDGE_LIST_NEON)
+
+// bits of the bytes of the 16 bytes block that start a record, by stride and block index
+static const uint16_t EDGE_CHAR_MASKS[4][5] = {
+    {0x5555, 0x5555, 0x5555, 0x5555, 0x5555},
+    {0x9249, 0x4924, 0x2492, 0x9249, 0x4924},
+    {0x1111, 0x1111, 0x1111, 0x1111, 0x1111},
+    {0x8421, 0x4210, 0x2108, 0x1084, 0x0842},
+};
+
+inline uint32_t CountTrailingZeros(uint32_t bits) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, bits);
+    return static_cast<uint32_t>(index);
+#else
+    return static_cast<uint32_t>(__builtin_ctz(bits));
+#endif
+}
+
+// a bit for each byte of the 16 bytes block at data which equals ch
+inline uint32_t MatchBytes(const uint8_t* data, uint8_t ch) {
+#ifdef PYIS_EDGE_LIST_SSE2
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8(static_cast<char>(ch)))));
+#else
+    static const uint8_t weights[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    uint8x16_t matched = vandq_u8(vceqq_u8(vld1q_u8(data), vdupq_n_u8(ch)), vld1q_u8(weights));
+    return static_cast<uint32_t>(vaddv_u8(vget_low_u8(matched))) |
+           (static_cast<uint32_t>(vaddv_u8(vget_high_u8(matched))) << 8);
+#endif
+}
+
+// Same as FindEdgeScalar, comparing 16 bytes at a time. Only the bytes starting a record are considered, so offset
+// bytes equal to ch never match. Requires EDGE_LIST_OVERREAD readable bytes past the end of the list.
+inline int FindEdge(const uint8_t* edges, uint8_t ch, uint32_t stride, uint32_t edges_cnt) {
+    uint32_t length = stride * edges_cnt;
+    const uint16_t* char_masks = EDGE_CHAR_MASKS[stride - 2];
+    for (uint32_t base = 0; base < length; base += 16) {
+        uint32_t bits = MatchBytes(edges + base, ch) & char_masks[base / 16];
+        if (length - base < 16) {
+            bits &= (1U << (length - base)) - 1;
+        }
+        if (bits != 0) {
+            return static_cast<int>((base + CountTrailingZeros(bits)) / stride);
+        }
+    }
+    return -1;
+}
+
+#else
+
+inline int FindEdge(const uint8_t* edges, uint8_t ch, uint32_t stride, uint32_t edges_cnt) {
+    return FindEdgeScalar(edges, ch, stride, edges_cnt);
+}
+
+#endif
+
+}  // namespace ops
+}  // namespace pyis
@@ -3,9 +3,35 @@
 
 #include "pyis/ops/text/immutable_trie.h"
 
+#include "pyis/ops/text/edge_list_search.h"
+#include "pyis/share/hardware_utils.h"
+
 namespace pyis {
 namespace ops {
 
+// header of the memory mappable trie format, followed by the single follow LUT and the trie data at page aligned
+// offsets. Integers are stored little endian.
+struct MappedTrieHeader {
+    char magic_[8];
+    uint32_t version_;
+    uint32_t max_char_val_;
+    uint32_t payload_size_;
+    uint32_t has_single_follow_dec_;
+    uint32_t size_single_follow_dec_;
+    uint32_t trie_data_size_;
+    uint64_t single_follow_dec_offset_;
+    uint64_t trie_data_offset_;
+    uint8_t translate_[256];
+};
+
+static const char MAPPED_TRIE_MAGIC[8] = {'P', 'Y', 'I', 'S', 'T', 'R', 'I', 'E'};
+// v2 pads the buffers for the edge list search, v1 files lack the padding and are rejected
+static const uint32_t MAPPED_TRIE_VERSION = 2;
+static const uint64_t MAPPED_TRIE_ALIGNMENT = 4096;
+// decoding reads a few bytes past the end of a buffer, and the edge list search up to a 16 bytes block
+static const uint64_t TRIE_DATA_PADDING = 16;
+static_assert(TRIE_DATA_PADDING >= EDGE_LIST_OVERREAD + 1, "trie data padding is too small for the edge list search");
+
 constexpr int BinaryWriter::BUFFER_LEN;
 constexpr int ImmutableTrie::TRANSLATE_TABLE_SIZE;
 
@@ -398,11 +424,11 @@ void ImmutableTrieConstructor::WriteToTrie(ImmutableTrie& trie) {
     memcpy(trie.translate_, translation_, sizeof(trie.translate_));
     if (single_follow_enc_ != nullptr) {
         trie.size_single_follow_dec_ = single_follow_dec_.size();
-        trie.single_follow_dec_ = new uint16_t[trie.size_single_follow_dec_ + 4];
+        trie.single_follow_dec_ = new uint16_t[trie.size_single_follow_dec_ + TRIE_DATA_PADDING]();
         memcpy(trie.single_follow_dec_, single_follow_dec_.data(), sizeof(uint16_t) * trie.size_single_follow_dec_);
     }
     trie.trie_data_size_ = trie_data_.size();
-    trie.trie_data_ = new uint8_t[trie.trie_data_size_ + 4];
+    trie.trie_data_ = new uint8_t[trie.trie_data_size_ + TRIE_DATA_PADDING]();
     memcpy(trie.trie_data_, trie_data_.data(), sizeof(uint8_t) * trie.trie_data_size_);
     for (uint8_t& i : trie.detranslate_) {
         i = ' ';
@@ -747,24 +773,18 @@ int ImmutableTrie::DecodeEdgeList(TrieData& trie_ptr, uint8_t ch, bool& has_data
     uint32_t offset_list = (offset_size + 1) * edges_cnt;
 
     // match against nodes in list
-    uint32_t i;
-    TrieData offset_edge = trie_ptr;
-    for (i = 0; i < edges_cnt; i++) {
-        uint8_t char_decoded = *offset_edge++;
-        if (char_decoded == ch) {
-            // read offset from edge table
-            int state;
-            uint32_t offset = DecodeOffset(offset_edge, offset_size, has_data, state);
-
-            // set offset to the next node
-            trie_ptr += offset_list + offset;
-            return state;
-        }
-
-        offset_edge += offset_size;
+    int i = FindEdge(trie_ptr, ch, offset_size + 1, edges_cnt);
+    if (i < 0) {
+        return NO_MATCH;
     }
 
-    return NO_MATCH;
+    // read offset from edge table
+    int state;
+    uint32_t offset = DecodeOffset(trie_ptr + i * (offset_size + 1) + 1, offset_size, has_data, state);
+
+    // set offset to the next node
+    trie_ptr += offset_list + offset;
+    return state;
 }
 
 int ImmutableTrie::DecodeSingleFollow(uint32_t tag, TrieData& trie_ptr, uint8_t ch, bool& has_data) {
@@ -992,19 +1012,37 @@ void ImmutableTrie::ListChildrenSingleFollow(
 }
 
 void ImmutableTrie::CleanUp() {
-    delete[] single_follow_dec_;
-    delete[] trie_data_;
+    if (mapped_file_ != nullptr) {
+        mapped_file_.reset();
+    } else {
+        delete[] single_follow_dec_;
+        delete[] trie_data_;
+    }
+    single_follow_dec_ = nullptr;
+    trie_data_ = nullptr;
+}
+
+void ImmutableTrie::BuildDetranslateTable() {
+    for (uint8_t& i : detranslate_) {
+        i = ' ';
+    }
+    for (size_t i = 0; i < TRANSLATE_TABLE_SIZE; i++) {
+        detranslate_[translate_[i]] = i;
+    }
+
+    detranslate_[translate_[' ']] = ' ';
+    detranslate_[BYTE_NO_MATCH] = ' ';
 }
 
 ImmutableTrie::ImmutableTrie(const std::string& path)
-    : trie_data_(nullptr),
-      single_follow_dec_(nullptr),
+    : max_char_val_(3),
       payload_size_(0),
+      single_follow_dec_(nullptr),
+      trie_data_(nullptr),
       trie_data_size_(0),
-      detranslate_{0},
-      max_char_val_(3),
       size_single_follow_dec_(0),
-      translate_{0} {
+      translate_{0},
+      detranslate_{0} {
     auto result = Initialize(path);
     if (result.has_error()) {
         PYIS_THROW(result.error().what());
@@ -1012,50 +1050,44 @@ ImmutableTrie::ImmutableTrie(const std::string& path)
 }
 
 ImmutableTrie::ImmutableTrie(const std::vector<std::tuple<std::string, uint32_t>>& data)
-    : trie_data_(nullptr),
-      single_follow_dec_(nullptr),
+    : max_char_val_(3),
       payload_size_(0),
+      single_follow_dec_(nullptr),
+      trie_data_(nullptr),
       trie_data_size_(0),
-      detranslate_{0},
-      max_char_val_(3),
       size_single_follow_dec_(0),
-      translate_{0} {
+      translate_{0},
+      detranslate_{0} {
     ImmutableTrieConstructor constructor(data);
     constructor.WriteToTrie(*this);
 }
 
 ImmutableTrie::ImmutableTrie(BinaryReader& reader)
-    : trie_data_(nullptr),
-      single_follow_dec_(nullptr),
+    : max_char_val_(3),
       payload_size_(0),
+      single_follow_dec_(nullptr),
+      trie_data_(nullptr),
       trie_data_size_(0),
-      detranslate_{0},
-      max_char_val_(3),
       size_single_follow_dec_(0),
-      translate_{0} {
+      translate_{0},
+      detranslate_{0} {
     Initialize(reader);
 }
 
 ImmutableTrie::~ImmutableTrie() { CleanUp(); }
 
-Expected<uint32_t> ImmutableTrie::Match(const uint8_t* match_str, const uint8_t* match_str_end, TrieData& data_ptr) {
-    if (trie_data_ == nullptr) {
-        return Expected<uint32_t>(std::runtime_error("Trie not initialized"));
-    }
-    // continue decoding or start from the beginning
-    TrieData curr_ptr = (data_ptr == nullptr) ? trie_data_ : data_ptr;
-    data_ptr = nullptr;
-
+bool ImmutableTrie::Walk(const uint8_t* str, const uint8_t* str_end, TrieData& curr_ptr, uint32_t& data) {
     // decode string
     int state = NO_MATCH;
     bool has_data = false;
-    for (/**/; *match_str != 0U && match_str != match_str_end; match_str++) {
-        uint8_t ch = *match_str;
+    for (/**/; *str != 0U && str != str_end; str++) {
+        uint8_t ch = *str;
 
         ch = translate_[ch];
 
         if (ch == BYTE_NO_MATCH) {
-            return Expected<uint32_t>(std::runtime_error("Key not found"));
+            curr_ptr = nullptr;
+            return false;
         }
         uint32_t tag = *curr_ptr++;
 
@@ -1067,31 +1099,53 @@ Expected<uint32_t> ImmutableTrie::Match(const uint8_t* match_str, const uint8_t*
             state = DecodeEdgeTable(curr_ptr, ch, has_data);
         }
 
-        if ((state == NO_MATCH) || (state == MATCH_LEAF && match_str != match_str_end - 1)) {
-            return Expected<uint32_t>(std::runtime_error("Key not found"));
+        if ((state == NO_MATCH) || (state == MATCH_LEAF && str != str_end - 1)) {
+            curr_ptr = nullptr;
+            return false;
         }
     }
 
+    bool found = has_data;
     if (has_data) {
-        uint32_t data = DecodeData(curr_ptr);
-
-        if (state != MATCH_LEAF) {
-            state = Decode(curr_ptr, BYTE_SEPERATOR, has_data);
-
-            // match further only for internal nodes
-            data_ptr = (state != MATCH_INTERNAL) ? nullptr : curr_ptr;
-        }
-
-        return Expected<uint32_t>(data);
+        data = DecodeData(curr_ptr);
     }
     if (state != MATCH_LEAF) {
         state = Decode(curr_ptr, BYTE_SEPERATOR, has_data);
         // match further only for internal nodes
-        data_ptr = (state != MATCH_INTERNAL) ? nullptr : curr_ptr;
+        curr_ptr = (state != MATCH_INTERNAL) ? nullptr : curr_ptr;
+    } else {
+        curr_ptr = nullptr;
+    }
+    return found;
+}
+
+Expected<uint32_t> ImmutableTrie::Match(const uint8_t* match_str, const uint8_t* match_str_end, TrieData& data_ptr) {
+    if (trie_data_ == nullptr) {
+        return Expected<uint32_t>(std::runtime_error("Trie not initialized"));
+    }
+    // continue decoding or start from the beginning
+    TrieData curr_ptr = (data_ptr == nullptr) ? trie_data_ : data_ptr;
+
+    uint32_t data = 0;
+    bool found = Walk(match_str, match_str_end, curr_ptr, data);
+    data_ptr = curr_ptr;
+    if (found) {
+        return Expected<uint32_t>(data);
     }
     return Expected<uint32_t>(std::runtime_error("Key not found"));
 }
 
+bool ImmutableTrie::MatchNext(const uint8_t* str, const uint8_t* str_end, TrieData& data_ptr, uint32_t& data) {
+    if (trie_data_ == nullptr) {
+        data_ptr = nullptr;
+        return false;
+    }
+    if (data_ptr == nullptr) {
+        data_ptr = trie_data_;
+    }
+    return Walk(str, str_end, data_ptr, data);
+}
+
 Expected<uint32_t> ImmutableTrie::Match(const std::string& str, TrieData& data_ptr) {
     return Match(reinterpret_cast<const uint8_t*>(str.c_str()),
                  reinterpret_cast<const uint8_t*>(str.c_str()) + str.length(), data_ptr);
@@ -1104,6 +1158,79 @@ Expected<uint32_t> ImmutableTrie::Match(const std::string& str) {
 
 bool ImmutableTrie::Contains(const std::string& str) { return Match(str).has_value(); }
 
+void ImmutableTrie::MatchAll(const std::vector<std::pair<const uint8_t*, const uint8_t*>>& tokens,
+                             std::vector<MatchHit>& hits) {
+    if (trie_data_ == nullptr) {
+        PYIS_THROW("Trie not initialized");
+    }
+    for (size_t start = 0; start < tokens.size(); start++) {
+        TrieData curr_ptr = trie_data_;
+        uint32_t data = 0;
+        // the separator between two tokens is consumed by Walk, curr_ptr is null once no key continues
+        for (size_t end = start; end < tokens.size() && curr_ptr != nullptr; end++) {
+            if (Walk(tokens[end].first, tokens[end].second, curr_ptr, data)) {
+                hits.emplace_back(start, end + 1, data);
+            }
+        }
+    }
+}
+
+std::vector<ImmutableTrie::MatchHit> ImmutableTrie::MatchAll(const std::vector<std::string>& tokens) {
+    std::vector<std::pair<const uint8_t*, const uint8_t*>> spans;
+    spans.reserve(tokens.size());
+    for (const auto& token : tokens) {
+        const auto* begin = reinterpret_cast<const uint8_t*>(token.c_str());
+        spans.emplace_back(begin, begin + token.length());
+    }
+    std::vector<MatchHit> hits;
+    MatchAll(spans, hits);
+    return hits;
+}
+
+std::vector<ImmutableTrie::MatchHit> ImmutableTrie::MatchAll(const std::string& sentence) {
+    std::vector<std::pair<const uint8_t*, const uint8_t*>> spans;
+    const auto* begin = reinterpret_cast<const uint8_t*>(sentence.c_str());
+    const auto* end = begin + sentence.length();
+    for (const auto* p = begin; p != end; /**/) {
+        if (*p == ' ') {
+            p++;
+            continue;
+        }
+        const auto* token_end = std::find(p, end, ' ');
+        spans.emplace_back(p, token_end);
+        p = token_end;
+    }
+
+    std::vector<MatchHit> hits;
+    MatchAll(spans, hits);
+    // token indices to byte offsets
+    for (auto& hit : hits) {
+        std::get<1>(hit) = spans[std::get<1>(hit) - 1].second - begin;
+        std::get<0>(hit) = spans[std::get<0>(hit)].first - begin;
+    }
+    return hits;
+}
+
+std::vector<std::vector<ImmutableTrie::MatchHit>> ImmutableTrie::MatchAllBatch(
+    const std::vector<std::string>& sentences) {
+    std::vector<std::vector<MatchHit>> results;
+    results.reserve(sentences.size());
+    for (const auto& sentence : sentences) {
+        results.emplace_back(MatchAll(sentence));
+    }
+    return results;
+}
+
+std::vector<std::vector<ImmutableTrie::MatchHit>> ImmutableTrie::MatchAllBatch(
+    const std::vector<std::vector<std::string>>& sentences) {
+    std::vector<std::vector<MatchHit>> results;
+    results.reserve(sentences.size());
+    for (const auto& tokens : sentences) {
+        results.emplace_back(MatchAll(tokens));
+    }
+    return results;
+}
+
 std::vector<std::tuple<std::string, uint32_t>> ImmutableTrie::Items() {
     std::vector<std::tuple<std::string, uint32_t>> data;
     if (trie_data_ == nullptr) {
@@ -1157,13 +1284,92 @@ void ImmutableTrie::LoadItems(const std::vector<std::tuple<std::string, uint32_t
 Expected<void> ImmutableTrie::Load(const std::string& path) { return Initialize(path); }
 
 Expected<void> ImmutableTrie::Initialize(const std::string& path) {
+    char magic[sizeof(MAPPED_TRIE_MAGIC)] = {0};
+    {
+        std::ifstream ifs(path, std::ios::in | std::ios::binary);
+        ifs.read(magic, sizeof(magic));
+    }
+    if (memcmp(magic, MAPPED_TRIE_MAGIC, sizeof(magic)) == 0) {
+        return InitializeMapped(path);
+    }
+
     BinaryReader reader(path);
     return Initialize(reader);
 }
 
+Expected<void> ImmutableTrie::InitializeMapped(const std::string& path) {
+    if (!MappedFile::is_supported()) {
+        std::ifstream ifs(path, std::ios::in | std::ios::binary);
+        if (!ifs.good()) {
+            return Expected<void>(std::runtime_error(pyis::fmt_str("Cannot open file %s", path.c_str())));
+        }
+        return InitializeMapped(ifs);
+    }
+    auto mapped_file = std::make_shared<MappedFile>(path);
+    return InitializeMapped(mapped_file->data(), mapped_file->size(), mapped_file);
+}
+
+Expected<void> ImmutableTrie::InitializeMapped(std::istream& is) {
+    std::vector<uint8_t> buffer((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+    return InitializeMapped(buffer.data(), buffer.size(), nullptr);
+}
+
+Expected<void> ImmutableTrie::InitializeMapped(const uint8_t* data, size_t size,
+                                               std::shared_ptr<MappedFile> mapped_file) {
+    if (!is_little_endian()) {
+        return Expected<void>(std::runtime_error("mapped trie format is only supported on little endian hosts"));
+    }
+    MappedTrieHeader header;
+    if (size < sizeof(header)) {
+        return Expected<void>(std::runtime_error("mapped trie file is truncated"));
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic_, MAPPED_TRIE_MAGIC, sizeof(MAPPED_TRIE_MAGIC)) != 0) {
+        return Expected<void>(std::runtime_error("not a mapped trie file"));
+    }
+    if (header.version_ != MAPPED_TRIE_VERSION) {
+        return Expected<void>(
+            std::runtime_error(pyis::fmt_str("mapped trie v%u is incompatible with the runtime", header.version_)));
+    }
+    uint64_t single_follow_dec_bytes = sizeof(uint16_t) * static_cast<uint64_t>(header.size_single_follow_dec_);
+    if ((header.has_single_follow_dec_ != 0 &&
+         (header.single_follow_dec_offset_ % sizeof(uint16_t) != 0 ||
+          header.single_follow_dec_offset_ + single_follow_dec_bytes + TRIE_DATA_PADDING > size)) ||
+        header.trie_data_offset_ + header.trie_data_size_ + TRIE_DATA_PADDING > size) {
+        return Expected<void>(std::runtime_error("mapped trie file is truncated"));
+    }
+
+    CleanUp();
+    max_char_val_ = header.max_char_val_;
+    payload_size_ = header.payload_size_;
+    memcpy(translate_, header.translate_, sizeof(translate_));
+    size_single_follow_dec_ = header.size_single_follow_dec_;
+    trie_data_size_ = header.trie_data_size_;
+
+    const uint8_t* single_follow_dec = data + header.single_follow_dec_offset_;
+    const uint8_t* trie_data = data + header.trie_data_offset_;
+    if (mapped_file != nullptr) {
+        // decoding never writes to the buffers, the pages of the read only mapping are shared between processes
+        if (header.has_single_follow_dec_ != 0) {
+            single_follow_dec_ = reinterpret_cast<uint16_t*>(const_cast<uint8_t*>(single_follow_dec));
+        }
+        trie_data_ = const_cast<uint8_t*>(trie_data);
+        mapped_file_ = std::move(mapped_file);
+    } else {
+        if (header.has_single_follow_dec_ != 0) {
+            single_follow_dec_ = new uint16_t[size_single_follow_dec_ + TRIE_DATA_PADDING]();
+            memcpy(single_follow_dec_, single_follow_dec, single_follow_dec_bytes);
+        }
+        trie_data_ = new uint8_t[trie_data_size_ + TRIE_DATA_PADDING];
+        memcpy(trie_data_, trie_data, trie_data_size_ + TRIE_DATA_PADDING);
+    }
+
+    BuildDetranslateTable();
+    return Expected<void>();
+}
+
 Expected<void> ImmutableTrie::Initialize(BinaryReader& reader) {
     CleanUp();
-    single_follow_dec_ = nullptr;
     reader.ReadUInt32('MCHV', &max_char_val_);
     reader.ReadUInt32('CBPL', &payload_size_);
     reader.ReadBuffer('TLTB', translate_, 256);
@@ -1176,22 +1382,18 @@ Expected<void> ImmutableTrie::Initialize(BinaryReader& reader) {
         }
     }
     reader.ReadUInt32('TREL', &trie_data_size_);
-    trie_data_ = new uint8_t[trie_data_size_ + 4];
+    trie_data_ = new uint8_t[trie_data_size_ + TRIE_DATA_PADDING]();
     reader.ReadBuffer('TREN', trie_data_, trie_data_size_);
-    for (uint8_t& i : detranslate_) {
-        i = ' ';
-    }
-    for (size_t i = 0; i < TRANSLATE_TABLE_SIZE; i++) {
-        detranslate_[translate_[i]] = i;
-    }
-
-    detranslate_[translate_[' ']] = ' ';
-    detranslate_[BYTE_NO_MATCH] = ' ';
+    BuildDetranslateTable();
     return Expected<void>();
 }
 
 Expected<void> ImmutableTrie::Compile(const std::vector<std::tuple<std::string, uint32_t>>& data,
-                                      const std::string& path) {
+                                      const std::string& path, bool mapped) {
+    if (mapped) {
+        ImmutableTrie trie(data);
+        return trie.SaveMapped(path);
+    }
     ImmutableTrieConstructor constructor(data);
     return constructor.WriteToFile(path);
 }
@@ -1220,13 +1422,72 @@ void ImmutableTrie::Save(BinaryWriter& writer) {
     writer.WriteBuffer('TREN', trie_data_, trie_data_size_);
 }
 
+Expected<void> ImmutableTrie::SaveMapped(const std::string& path) {
+    std::ofstream ofs(path, std::ios::out | std::ios::binary);
+    if (!ofs.good()) {
+        return Expected<void>(std::runtime_error(pyis::fmt_str("Cannot open file %s", path.c_str())));
+    }
+    return SaveMapped(ofs);
+}
+
+Expected<void> ImmutableTrie::SaveMapped(std::ostream& os) {
+    if (trie_data_ == nullptr) {
+        return Expected<void>(std::runtime_error("Trie not initialized"));
+    }
+    if (!is_little_endian()) {
+        return Expected<void>(std::runtime_error("mapped trie format is only supported on little endian hosts"));
+    }
+    auto align = [](uint64_t offset) {
+        return (offset + MAPPED_TRIE_ALIGNMENT - 1) / MAPPED_TRIE_ALIGNMENT * MAPPED_TRIE_ALIGNMENT;
+    };
+
+    MappedTrieHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic_, MAPPED_TRIE_MAGIC, sizeof(MAPPED_TRIE_MAGIC));
+    header.version_ = MAPPED_TRIE_VERSION;
+    header.max_char_val_ = max_char_val_;
+    header.payload_size_ = payload_size_;
+    memcpy(header.translate_, translate_, sizeof(translate_));
+    header.has_single_follow_dec_ = single_follow_dec_ != nullptr ? 1 : 0;
+    header.size_single_follow_dec_ = single_follow_dec_ != nullptr ? size_single_follow_dec_ : 0;
+    header.trie_data_size_ = trie_data_size_;
+    uint64_t single_follow_dec_bytes = sizeof(uint16_t) * static_cast<uint64_t>(header.size_single_follow_dec_);
+    header.single_follow_dec_offset_ = align(sizeof(header));
+    header.trie_data_offset_ =
+        align(header.single_follow_dec_offset_ + single_follow_dec_bytes + TRIE_DATA_PADDING);
+
+    std::vector<char> zeros(MAPPED_TRIE_ALIGNMENT, 0);
+    uint64_t written = 0;
+    auto write = [&os, &written](const void* buffer, uint64_t size) {
+        os.write(static_cast<const char*>(buffer), static_cast<std::streamsize>(size));
+        written += size;
+    };
+
+    write(&header, sizeof(header));
+    write(zeros.data(), header.single_follow_dec_offset_ - written);
+    if (single_follow_dec_bytes > 0) {
+        write(single_follow_dec_, single_follow_dec_bytes);
+    }
+    write(zeros.data(), header.trie_data_offset_ - written);
+    write(trie_data_, trie_data_size_);
+    write(zeros.data(), TRIE_DATA_PADDING);
+
+    if (!os.good()) {
+        return Expected<void>(std::runtime_error("failed to write mapped trie"));
+    }
+    return Expected<void>();
+}
+
 std::string ImmutableTrie::Serialize(ModelStorage& storage) {
     std::string data_file = storage.uniq_file("immutable_trie", ".data.bin");
-    BinaryWriter writer(storage.open_ostream(data_file));
-
-    Save(writer);
+    auto os = storage.open_ostream(data_file);
+    auto result = SaveMapped(*os);
+    if (result.has_error()) {
+        PYIS_THROW(result.error().what());
+    }
+    os.reset();
 
-    JsonPersistHelper jph(1);
+    JsonPersistHelper jph(2);
     jph.add_file("data", data_file);
 
     std::string config_file = storage.uniq_file("immutable_trie", ".config.json");
@@ -1243,6 +1504,17 @@ void ImmutableTrie::Deserialize(const std::string& state, ModelStorage& storage)
         Initialize(reader);
         return;
     }
+    if (2 == version) {
+        // map the data file in place when the storage keeps it on the local file system
+        std::string data_file = jph.get_file("data");
+        std::string data_path = storage.local_path(data_file);
+        auto result = data_path.empty() ? InitializeMapped(*storage.open_istream(data_file))
+                                        : InitializeMapped(data_path);
+        if (result.has_error()) {
+            PYIS_THROW(result.error().what());
+        }
+        return;
+    }
 
     PYIS_THROW("ImmutableTrie v%d is incompatible with the runtime", version);
 }
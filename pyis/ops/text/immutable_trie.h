@@ -16,6 +16,7 @@
 #include "pyis/share/cached_object.h"
 #include "pyis/share/expected.hpp"
 #include "pyis/share/json_persist_helper.h"
+#include "pyis/share/mapped_file.h"
 #include "pyis/share/model_storage_local.h"
 
 namespace pyis {
@@ -156,6 +157,8 @@ class ImmutableTrieConstructor {
 class ImmutableTrie : public CachedObject<ImmutableTrie> {
   public:
     using TrieData = uint8_t*;
+    // (start, end, value) of a key found in a sequence, end is exclusive
+    using MatchHit = std::tuple<size_t, size_t, uint32_t>;
     friend class ImmutableTrieConstructor;
 
     ImmutableTrie() = default;  // For deserialize only
@@ -166,15 +169,32 @@ class ImmutableTrie : public CachedObject<ImmutableTrie> {
     Expected<uint32_t> Match(const uint8_t*, const uint8_t*, TrieData&);
     Expected<uint32_t> Match(const std::string& str, TrieData&);
     Expected<uint32_t> Match(const std::string& str);
+    // Same as Match(str, str_end, data_ptr), without building an error for missing keys. Returns whether the key
+    // exists, with its value in data.
+    bool MatchNext(const uint8_t* str, const uint8_t* str_end, TrieData& data_ptr, uint32_t& data);
     bool Contains(const std::string& str);
 
+    // Find all keys made of consecutive tokens in one pass. Walks from each token as long as some key continues, so
+    // the cost is bounded by the length of the matches instead of one Match call per span. Hits are token indices.
+    std::vector<MatchHit> MatchAll(const std::vector<std::string>& tokens);
+    // Same as above for tokens separated by spaces in sentence. Hits are byte offsets in sentence.
+    std::vector<MatchHit> MatchAll(const std::string& sentence);
+    std::vector<std::vector<MatchHit>> MatchAllBatch(const std::vector<std::string>& sentences);
+    std::vector<std::vector<MatchHit>> MatchAllBatch(const std::vector<std::vector<std::string>>& sentences);
+
     std::vector<std::tuple<std::string, uint32_t>> Items();
     void LoadItems(const std::vector<std::tuple<std::string, uint32_t>>& data);
     Expected<void> Load(const std::string& path);
 
-    static Expected<void> Compile(const std::vector<std::tuple<std::string, uint32_t>>& data, const std::string& path);
+    // mapped=true writes the memory mappable format, see SaveMapped
+    static Expected<void> Compile(const std::vector<std::tuple<std::string, uint32_t>>& data, const std::string& path,
+                                  bool mapped = false);
     void Save(const std::string& path);
     void Save(BinaryWriter& writer);
+    // Save in a raw format whose single follow LUT and trie data are page aligned, so that loading it maps the file
+    // instead of decoding it into private buffers. Load and the path constructor detect the format by itself.
+    Expected<void> SaveMapped(const std::string& path);
+    Expected<void> SaveMapped(std::ostream& os);
     void Deserialize(const std::string& state, ModelStorage& storage);
     std::string Serialize(ModelStorage& storage);
 
@@ -208,9 +228,9 @@ class ImmutableTrie : public CachedObject<ImmutableTrie> {
     // size of payload
     uint32_t payload_size_;
     // LUT for single follow decoding
-    uint16_t* single_follow_dec_;
+    uint16_t* single_follow_dec_ = nullptr;
     // byte array encoding of trie
-    uint8_t* trie_data_;
+    uint8_t* trie_data_ = nullptr;
     // size of trie data byte array
     uint32_t trie_data_size_;
     // size of single follow decoding LUT
@@ -221,6 +241,9 @@ class ImmutableTrie : public CachedObject<ImmutableTrie> {
     uint8_t translate_[TRANSLATE_TABLE_SIZE];
     uint8_t detranslate_[TRANSLATE_TABLE_SIZE];
 
+    // file single_follow_dec_ and trie_data_ point into when loaded from the mapped format, they are owned otherwise
+    std::shared_ptr<MappedFile> mapped_file_;
+
     uint32_t DecodeUInt32(const TrieData&, uint32_t);
     uint32_t DecodeData(const TrieData&);
     uint32_t DecodeOffset(const TrieData&, uint32_t, bool&, int& state);
@@ -229,6 +252,8 @@ class ImmutableTrie : public CachedObject<ImmutableTrie> {
     int DecodeEdgeList(TrieData&, uint8_t ch, bool&);
     int DecodeSingleFollow(uint32_t tag, TrieData&, uint8_t ch, bool&);
     int Decode(TrieData&, uint8_t ch, bool&);
+    bool Walk(const uint8_t* str, const uint8_t* str_end, TrieData& curr_ptr, uint32_t& data);
+    void MatchAll(const std::vector<std::pair<const uint8_t*, const uint8_t*>>& tokens, std::vector<MatchHit>& hits);
 
     void ListChildren(TrieData, std::vector<std::tuple<TrieData, uint8_t, uint32_t, int, bool>>& children);
     void ListChildrenEdgeTable(TrieData, std::vector<std::tuple<TrieData, uint8_t, uint32_t, int, bool>>& children);
@@ -236,9 +261,14 @@ class ImmutableTrie : public CachedObject<ImmutableTrie> {
     void ListChildrenSingleFollow(TrieData, uint32_t tag,
                                   std::vector<std::tuple<TrieData, uint8_t, uint32_t, int, bool>>& children);
     void CleanUp();
+    void BuildDetranslateTable();
 
     Expected<void> Initialize(BinaryReader& reader);
     Expected<void> Initialize(const std::string& path);
+    Expected<void> InitializeMapped(const std::string& path);
+    Expected<void> InitializeMapped(std::istream& is);
+    // point to the buffers in data when mapped_file is set, or copy them otherwise
+    Expected<void> InitializeMapped(const uint8_t* data, size_t size, std::shared_ptr<MappedFile> mapped_file);
 };
 
 }  // namespace ops
@@ -0,0 +1,943 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include "multi_regex.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace pyis {
+namespace ops {
+
+namespace {
+
+enum Assertion : uint32_t { ASSERT_BOL, ASSERT_EOL, ASSERT_WORD_BOUNDARY, ASSERT_NOT_WORD_BOUNDARY };
+
+// bounds of the compiled program, beyond which a pattern is left to std::regex
+constexpr int MAX_REPEAT = 1000;
+constexpr size_t MAX_PATTERN_INSTS = 20000;
+constexpr int MAX_NESTING = 256;
+// number of instructions held by the cached DFA states before the cache is dropped
+constexpr size_t MAX_DFA_CACHED_INSTS = 1U << 22;
+
+// classes of the "C" locale, the one std::regex uses by default
+bool IsWordChar(uint8_t ch) {
+    return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') || ch == '_';
+}
+
+std::bitset<256> ClassOf(char escape) {
+    std::bitset<256> chars;
+    switch (escape) {
+        case 'd':
+        case 'D':
+            for (int ch = '0'; ch <= '9'; ch++) {
+                chars.set(ch);
+            }
+            break;
+        case 'w':
+        case 'W':
+            for (int ch = 0; ch < 256; ch++) {
+                chars.set(ch, IsWordChar(static_cast<uint8_t>(ch)));
+            }
+            break;
+        default:
+            for (char ch : {' ', '\t', '\n', '\v', '\f', '\r'}) {
+                chars.set(static_cast<uint8_t>(ch));
+            }
+            break;
+    }
+    return (escape >= 'A' && escape <= 'Z') ? ~chars : chars;
+}
+
+int HexValue(char ch) {
+    if (ch >= '0' && ch <= '9') {
+        return ch - '0';
+    }
+    if (ch >= 'a' && ch <= 'f') {
+        return ch - 'a' + 10;
+    }
+    if (ch >= 'A' && ch <= 'F') {
+        return ch - 'A' + 10;
+    }
+    return -1;
+}
+
+bool IsAlnum(char ch) { return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9'); }
+
+}  // namespace
+
+struct MultiRegex::Node {
+    enum Kind { CONCAT, ALTERNATE, CHARS, REPEAT, ASSERT };
+
+    explicit Node(Kind kind) : kind_(kind) {}
+
+    Kind kind_;
+    std::bitset<256> chars_;
+    uint32_t assertion_ = 0;
+    int min_ = 0;
+    // -1 for unbounded
+    int max_ = 0;
+    bool greedy_ = true;
+    std::vector<std::unique_ptr<Node>> children_;
+};
+
+// Recursive descent parser of the ECMAScript grammar. Returns nullptr for whatever it does not support, which is
+// then left to std::regex, so it only has to be exact on the subset it accepts.
+class MultiRegex::Parser {
+  public:
+    explicit Parser(const std::string& pattern) : p_(pattern.data()), end_(pattern.data() + pattern.size()) {}
+
+    std::unique_ptr<Node> Parse() {
+        auto node = ParseAlternation(0);
+        if (node == nullptr || p_ != end_) {
+            return nullptr;
+        }
+        return node;
+    }
+
+  private:
+    std::unique_ptr<Node> ParseAlternation(int depth) {
+        if (depth > MAX_NESTING) {
+            return nullptr;
+        }
+        std::unique_ptr<Node> alternation(new Node(Node::ALTERNATE));
+        while (true) {
+            auto sequence = ParseSequence(depth);
+            if (sequence == nullptr) {
+                return nullptr;
+            }
+            alternation->children_.emplace_back(std::move(sequence));
+            if (p_ == end_ || *p_ != '|') {
+                break;
+            }
+            p_++;
+        }
+        if (alternation->children_.size() == 1) {
+            return std::move(alternation->children_[0]);
+        }
+        return alternation;
+    }
+
+    std::unique_ptr<Node> ParseSequence(int depth) {
+        std::unique_ptr<Node> sequence(new Node(Node::CONCAT));
+        while (p_ != end_ && *p_ != '|' && *p_ != ')') {
+            auto atom = ParseAtom(depth);
+            if (atom == nullptr) {
+                return nullptr;
+            }
+            if (p_ != end_ && IsQuantifier(*p_)) {
+                // libstdc++ has its own way of ending loops over empty matches
+                if (IsNullable(*atom)) {
+                    return nullptr;
+                }
+                atom = ParseQuantifier(std::move(atom));
+                if (atom == nullptr || (p_ != end_ && IsQuantifier(*p_))) {
+                    return nullptr;
+                }
+            }
+            sequence->children_.emplace_back(std::move(atom));
+        }
+        return sequence;
+    }
+
+    static bool IsNullable(const Node& node) {
+        switch (node.kind_) {
+            case Node::CHARS:
+                return false;
+            case Node::ASSERT:
+                return true;
+            case Node::REPEAT:
+                return node.min_ == 0 || IsNullable(*node.children_[0]);
+            case Node::CONCAT:
+                return std::all_of(node.children_.begin(), node.children_.end(),
+                                   [](const std::unique_ptr<Node>& child) { return IsNullable(*child); });
+            default:
+                return std::any_of(node.children_.begin(), node.children_.end(),
+                                   [](const std::unique_ptr<Node>& child) { return IsNullable(*child); });
+        }
+    }
+
+    static bool IsQuantifier(char ch) { return ch == '*' || ch == '+' || ch == '?' || ch == '{'; }
+
+    std::unique_ptr<Node> ParseQuantifier(std::unique_ptr<Node> atom) {
+        std::unique_ptr<Node> repeat(new Node(Node::REPEAT));
+        char ch = *p_++;
+        if (ch == '*') {
+            repeat->min_ = 0;
+            repeat->max_ = -1;
+        } else if (ch == '+') {
+            repeat->min_ = 1;
+            repeat->max_ = -1;
+        } else if (ch == '?') {
+            repeat->min_ = 0;
+            repeat->max_ = 1;
+        } else {
+            if (!ParseInt(repeat->min_)) {
+                return nullptr;
+            }
+            repeat->max_ = repeat->min_;
+            if (p_ != end_ && *p_ == ',') {
+                p_++;
+                repeat->max_ = -1;
+                if (p_ != end_ && *p_ != '}' && !ParseInt(repeat->max_)) {
+                    return nullptr;
+                }
+            }
+            if (p_ == end_ || *p_ != '}') {
+                return nullptr;
+            }
+            p_++;
+            if (repeat->max_ >= 0 && repeat->max_ < repeat->min_) {
+                return nullptr;
+            }
+        }
+        if (p_ != end_ && *p_ == '?') {
+            p_++;
+            repeat->greedy_ = false;
+        }
+        repeat->children_.emplace_back(std::move(atom));
+        return repeat;
+    }
+
+    bool ParseInt(int& value) {
+        value = 0;
+        const char* begin = p_;
+        while (p_ != end_ && *p_ >= '0' && *p_ <= '9') {
+            value = value * 10 + (*p_++ - '0');
+            if (value > MAX_REPEAT) {
+                return false;
+            }
+        }
+        return p_ != begin;
+    }
+
+    std::unique_ptr<Node> ParseAtom(int depth) {
+        char ch = *p_++;
+        switch (ch) {
+            case '^':
+                return MakeAssertion(ASSERT_BOL);
+            case '$':
+                return MakeAssertion(ASSERT_EOL);
+            case '.': {
+                std::bitset<256> chars;
+                chars.set();
+                chars.reset('\n');
+                chars.reset('\r');
+                return MakeChars(chars);
+            }
+            case '(': {
+                if (p_ != end_ && *p_ == '?') {
+                    // only non capturing groups, lookaheads are left to std::regex
+                    if (end_ - p_ < 2 || p_[1] != ':') {
+                        return nullptr;
+                    }
+                    p_ += 2;
+                }
+                auto group = ParseAlternation(depth + 1);
+                if (group == nullptr || p_ == end_ || *p_ != ')') {
+                    return nullptr;
+                }
+                p_++;
+                return group;
+            }
+            case '[':
+                return ParseClass();
+            case '\\':
+                return ParseEscape();
+            case '*':
+            case '+':
+            case '?':
+            case '{':
+            case '}':
+            case ']':
+                return nullptr;
+            default: {
+                std::bitset<256> chars;
+                chars.set(static_cast<uint8_t>(ch));
+                return MakeChars(chars);
+            }
+        }
+    }
+
+    std::unique_ptr<Node> ParseEscape() {
+        if (p_ == end_) {
+            return nullptr;
+        }
+        char ch = *p_;
+        if (ch == 'b' || ch == 'B') {
+            p_++;
+            return MakeAssertion(ch == 'b' ? ASSERT_WORD_BOUNDARY : ASSERT_NOT_WORD_BOUNDARY);
+        }
+        std::bitset<256> chars;
+        if (!ParseClassEscape(chars, false)) {
+            return nullptr;
+        }
+        return MakeChars(chars);
+    }
+
+    // The escape after a backslash, either a class such as \d or a single character. \b is a backspace in a class.
+    bool ParseClassEscape(std::bitset<256>& chars, bool in_class) {
+        char ch = *p_++;
+        switch (ch) {
+            case 'd':
+            case 'D':
+            case 'w':
+            case 'W':
+            case 's':
+            case 'S':
+                chars |= ClassOf(ch);
+                return true;
+            case 't':
+                chars.set('\t');
+                return true;
+            case 'n':
+                chars.set('\n');
+                return true;
+            case 'r':
+                chars.set('\r');
+                return true;
+            case 'v':
+                chars.set('\v');
+                return true;
+            case 'f':
+                chars.set('\f');
+                return true;
+            case 'b':
+                if (!in_class) {
+                    return false;
+                }
+                chars.set('\b');
+                return true;
+            case '0':
+                if (p_ != end_ && *p_ >= '0' && *p_ <= '9') {
+                    return false;
+                }
+                chars.set(0);
+                return true;
+            case 'x': {
+                if (end_ - p_ < 2 || HexValue(p_[0]) < 0 || HexValue(p_[1]) < 0) {
+                    return false;
+                }
+                int value = HexValue(p_[0]) * 16 + HexValue(p_[1]);
+                p_ += 2;
+                // std::regex works on signed chars, leave the upper half to it
+                if (value >= 0x80) {
+                    return false;
+                }
+                chars.set(value);
+                return true;
+            }
+            default:
+                // backreferences, \c, \u and the like
+                if (IsAlnum(ch) || static_cast<uint8_t>(ch) >= 0x80) {
+                    return false;
+                }
+                chars.set(static_cast<uint8_t>(ch));
+                return true;
+        }
+    }
+
+    // One member of a bracket expression. single is set for a single character, whose value is in ch.
+    bool ParseClassAtom(std::bitset<256>& chars, bool& single, uint8_t& ch) {
+        if (p_ == end_) {
+            return false;
+        }
+        if (*p_ == '[' && end_ - p_ >= 2 && (p_[1] == ':' || p_[1] == '.' || p_[1] == '=')) {
+            // POSIX classes, collating elements and equivalence classes
+            return false;
+        }
+        if (*p_ == '\\') {
+            p_++;
+            if (p_ == end_) {
+                return false;
+            }
+            std::bitset<256> escaped;
+            if (!ParseClassEscape(escaped, true)) {
+                return false;
+            }
+            single = escaped.count() == 1;
+            if (single) {
+                for (int i = 0; i < 256; i++) {
+                    if (escaped.test(i)) {
+                        ch = static_cast<uint8_t>(i);
+                    }
+                }
+            }
+            chars |= escaped;
+            return true;
+        }
+        single = true;
+        ch = static_cast<uint8_t>(*p_++);
+        chars.set(ch);
+        return true;
+    }
+
+    std::unique_ptr<Node> ParseClass() {
+        bool negate = false;
+        if (p_ != end_ && *p_ == '^') {
+            negate = true;
+            p_++;
+        }
+        // the meaning of a leading ']' varies between implementations
+        if (p_ == end_ || *p_ == ']') {
+            return nullptr;
+        }
+        std::bitset<256> chars;
+        while (true) {
+            if (p_ == end_) {
+                return nullptr;
+            }
+            if (*p_ == ']') {
+                p_++;
+                break;
+            }
+            std::bitset<256> member;
+            bool single = false;
+            uint8_t low = 0;
+            if (!ParseClassAtom(member, single, low)) {
+                return nullptr;
+            }
+            if (end_ - p_ >= 2 && p_[0] == '-' && p_[1] != ']') {
+                p_++;
+                std::bitset<256> ignored;
+                bool high_single = false;
+                uint8_t high = 0;
+                if (!single || !ParseClassAtom(ignored, high_single, high) || !high_single || low > high ||
+                    high >= 0x80) {
+                    return nullptr;
+                }
+                for (int i = low; i <= high; i++) {
+                    chars.set(i);
+                }
+                continue;
+            }
+            chars |= member;
+        }
+        return MakeChars(negate ? ~chars : chars);
+    }
+
+    static std::unique_ptr<Node> MakeChars(const std::bitset<256>& chars) {
+        std::unique_ptr<Node> node(new Node(Node::CHARS));
+        node->chars_ = chars;
+        return node;
+    }
+
+    static std::unique_ptr<Node> MakeAssertion(uint32_t assertion) {
+        std::unique_ptr<Node> node(new Node(Node::ASSERT));
+        node->assertion_ = assertion;
+        return node;
+    }
+
+    const char* p_;
+    const char* end_;
+};
+
+uint32_t MultiRegex::Add(const std::string& pattern) {
+    // throws for invalid patterns, and keeps the exact behavior for the unsupported ones
+    std::unique_ptr<std::regex> regex(new std::regex(pattern));
+
+    auto index = static_cast<uint32_t>(patterns_.size());
+    patterns_.emplace_back();
+    if (!Compile(pattern, index)) {
+        patterns_[index].fallback_ = std::move(regex);
+    }
+    return index;
+}
+
+bool MultiRegex::Compile(const std::string& pattern, uint32_t index) {
+    Parser parser(pattern);
+    auto root = parser.Parse();
+    if (root == nullptr) {
+        return false;
+    }
+
+    size_t start = prog_.size();
+    if (!Emit(*root, start + MAX_PATTERN_INSTS)) {
+        prog_.resize(start);
+        return false;
+    }
+    prog_.push_back(Inst{OP_MATCH, index, 0, 0});
+
+    auto& compiled = patterns_[index];
+    compiled.start_ = static_cast<uint32_t>(start);
+    compiled.end_ = static_cast<uint32_t>(prog_.size());
+    ComputeFirstBytes(compiled);
+    max_pattern_insts_ = std::max(max_pattern_insts_, prog_.size() - start);
+    return true;
+}
+
+bool MultiRegex::Emit(const Node& node, size_t max_insts) {
+    if (prog_.size() >= max_insts) {
+        return false;
+    }
+    switch (node.kind_) {
+        case Node::CHARS:
+            prog_.push_back(Inst{OP_CHAR_CLASS, AddClass(node.chars_), 0, 0});
+            return true;
+        case Node::ASSERT:
+            prog_.push_back(Inst{OP_ASSERT, node.assertion_, 0, 0});
+            return true;
+        case Node::CONCAT:
+            for (const auto& child : node.children_) {
+                if (!Emit(*child, max_insts)) {
+                    return false;
+                }
+            }
+            return true;
+        case Node::ALTERNATE: {
+            // split to each alternative in turn, then jump to the end
+            std::vector<size_t> jumps;
+            for (size_t i = 0; i < node.children_.size(); i++) {
+                size_t split = prog_.size();
+                bool last = i + 1 == node.children_.size();
+                if (!last) {
+                    prog_.push_back(Inst{OP_SPLIT, 0, static_cast<uint32_t>(split + 1), 0});
+                }
+                if (!Emit(*node.children_[i], max_insts)) {
+                    return false;
+                }
+                if (!last) {
+                    jumps.push_back(prog_.size());
+                    prog_.push_back(Inst{OP_JMP, 0, 0, 0});
+                    prog_[split].y_ = static_cast<uint32_t>(prog_.size());
+                }
+            }
+            for (auto jump : jumps) {
+                prog_[jump].x_ = static_cast<uint32_t>(prog_.size());
+            }
+            return true;
+        }
+        case Node::REPEAT: {
+            const Node& child = *node.children_[0];
+            for (int i = 0; i < node.min_; i++) {
+                if (!Emit(child, max_insts)) {
+                    return false;
+                }
+            }
+            if (node.max_ < 0) {
+                size_t split = prog_.size();
+                prog_.push_back(Inst{OP_SPLIT, 0, 0, 0});
+                if (!Emit(child, max_insts)) {
+                    return false;
+                }
+                prog_.push_back(Inst{OP_JMP, 0, static_cast<uint32_t>(split), 0});
+                auto body = static_cast<uint32_t>(split + 1);
+                auto out = static_cast<uint32_t>(prog_.size());
+                prog_[split].x_ = node.greedy_ ? body : out;
+                prog_[split].y_ = node.greedy_ ? out : body;
+                return true;
+            }
+            // x{0,2} is (x(x)?)?, the next optional occurrence is only tried after the previous one
+            std::vector<size_t> splits;
+            for (int i = node.min_; i < node.max_; i++) {
+                splits.push_back(prog_.size());
+                prog_.push_back(Inst{OP_SPLIT, 0, 0, 0});
+                if (!Emit(child, max_insts)) {
+                    return false;
+                }
+            }
+            auto out = static_cast<uint32_t>(prog_.size());
+            for (auto split : splits) {
+                auto body = static_cast<uint32_t>(split + 1);
+                prog_[split].x_ = node.greedy_ ? body : out;
+                prog_[split].y_ = node.greedy_ ? out : body;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t MultiRegex::AddClass(const std::bitset<256>& chars) {
+    auto it = class_index_.find(chars);
+    if (it != class_index_.end()) {
+        return it->second;
+    }
+    auto index = static_cast<uint32_t>(classes_.size());
+    classes_.push_back(chars);
+    class_index_.emplace(chars, index);
+    return index;
+}
+
+void MultiRegex::ComputeFirstBytes(Pattern& pattern) const {
+    pattern.first_bytes_.reset();
+    pattern.nullable_ = false;
+    std::vector<bool> visited(pattern.end_ - pattern.start_);
+    std::vector<uint32_t> stack{pattern.start_};
+    while (!stack.empty()) {
+        uint32_t pc = stack.back();
+        stack.pop_back();
+        if (visited[pc - pattern.start_]) {
+            continue;
+        }
+        visited[pc - pattern.start_] = true;
+        const Inst& inst = prog_[pc];
+        switch (inst.op_) {
+            case OP_CHAR_CLASS:
+                pattern.first_bytes_ |= classes_[inst.arg_];
+                break;
+            case OP_MATCH:
+                pattern.nullable_ = true;
+                break;
+            case OP_JMP:
+                stack.push_back(inst.x_);
+                break;
+            case OP_SPLIT:
+                stack.push_back(inst.x_);
+                stack.push_back(inst.y_);
+                break;
+            case OP_ASSERT:
+                stack.push_back(pc + 1);
+                break;
+        }
+    }
+}
+
+bool MultiRegex::CheckAssertion(uint32_t assertion, const uint8_t* text, size_t begin, size_t len, size_t pos) const {
+    switch (assertion) {
+        case ASSERT_BOL:
+            return pos == begin;
+        case ASSERT_EOL:
+            return pos == len;
+        default: {
+            bool left = pos > begin && IsWordChar(text[pos - 1]);
+            bool right = pos < len && IsWordChar(text[pos]);
+            return (left != right) == (assertion == ASSERT_WORD_BOUNDARY);
+        }
+    }
+}
+
+void MultiRegex::AddThread(ThreadList& list, const Pattern& pattern, uint32_t pc, uint32_t match_begin,
+                           const uint8_t* text, size_t begin, size_t len, size_t pos,
+                           std::vector<uint32_t>& stack) const {
+    // depth first, so that the threads stay in priority order
+    stack.clear();
+    stack.push_back(pc);
+    while (!stack.empty()) {
+        pc = stack.back();
+        stack.pop_back();
+        uint32_t local = pc - pattern.start_;
+        uint32_t slot = list.sparse_[local];
+        if (slot < list.size_ && list.dense_[slot].first == pc) {
+            continue;
+        }
+        list.sparse_[local] = static_cast<uint32_t>(list.size_);
+        list.dense_[list.size_++] = std::make_pair(pc, match_begin);
+
+        const Inst& inst = prog_[pc];
+        switch (inst.op_) {
+            case OP_JMP:
+                stack.push_back(inst.x_);
+                break;
+            case OP_SPLIT:
+                stack.push_back(inst.y_);
+                stack.push_back(inst.x_);
+                break;
+            case OP_ASSERT:
+                if (CheckAssertion(inst.arg_, text, begin, len, pos)) {
+                    stack.push_back(pc + 1);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+bool MultiRegex::Search(const Pattern& pattern, const uint8_t* text, size_t begin, size_t len, size_t start,
+                        bool not_null, bool continuous, Scratch& scratch, size_t& match_begin,
+                        size_t& match_end) const {
+    ThreadList* clist = &scratch.clist_;
+    ThreadList* nlist = &scratch.nlist_;
+    clist->size_ = 0;
+    bool matched = false;
+
+    for (size_t pos = start;; pos++) {
+        // a new thread for a match starting here, with the lowest priority
+        if (!matched && (!continuous || pos == start)) {
+            if (clist->size_ == 0 && !continuous && !pattern.nullable_) {
+                while (pos < len && !pattern.first_bytes_.test(text[pos])) {
+                    pos++;
+                }
+                if (pos == len) {
+                    break;
+                }
+            }
+            AddThread(*clist, pattern, pattern.start_, static_cast<uint32_t>(pos), text, begin, len, pos,
+                      scratch.stack_);
+        }
+        if (clist->size_ == 0) {
+            break;
+        }
+
+        nlist->size_ = 0;
+        for (size_t i = 0; i < clist->size_; i++) {
+            uint32_t pc = clist->dense_[i].first;
+            uint32_t thread_begin = clist->dense_[i].second;
+            const Inst& inst = prog_[pc];
+            if (inst.op_ == OP_MATCH) {
+                if (not_null && thread_begin == pos) {
+                    continue;
+                }
+                // the threads after this one have a lower priority
+                matched = true;
+                match_begin = thread_begin;
+                match_end = pos;
+                break;
+            }
+            if (inst.op_ == OP_CHAR_CLASS && pos < len && classes_[inst.arg_].test(text[pos])) {
+                AddThread(*nlist, pattern, pc + 1, thread_begin, text, begin, len, pos + 1, scratch.stack_);
+            }
+        }
+        std::swap(clist, nlist);
+        if (pos == len) {
+            break;
+        }
+    }
+    return matched;
+}
+
+void MultiRegex::FindAll(const char* text, size_t len, std::vector<Match>& matches) const {
+    if (patterns_.empty()) {
+        return;
+    }
+    const auto* data = reinterpret_cast<const uint8_t*>(text);
+    std::vector<char> candidates(patterns_.size(), 0);
+    Prefilter(data, len, candidates);
+
+    Scratch scratch(max_pattern_insts_);
+    for (uint32_t index = 0; index < patterns_.size(); index++) {
+        if (!candidates[index]) {
+            continue;
+        }
+        const auto& pattern = patterns_[index];
+        if (pattern.fallback_ != nullptr) {
+            std::regex_iterator<const char*> ite(text, text + len, *pattern.fallback_);
+            std::regex_iterator<const char*> rend;
+            for (/**/; ite != rend; ite++) {
+                auto begin = static_cast<uint32_t>(ite->position());
+                matches.emplace_back(index, begin, begin + static_cast<uint32_t>(ite->length()));
+            }
+            continue;
+        }
+
+        // The same steps as std::regex_iterator: after an empty match, look for a non empty one at the same position
+        // before moving on. Assertions only look behind the start of a search once match_prev_avail is set, which
+        // libstdc++ does from the first search which is not such a retry on.
+        size_t begin = 0;
+        size_t end = 0;
+        bool prev_avail = false;
+        if (!Search(pattern, data, 0, len, 0, false, false, scratch, begin, end)) {
+            continue;
+        }
+        while (true) {
+            matches.emplace_back(index, static_cast<uint32_t>(begin), static_cast<uint32_t>(end));
+            size_t start = end;
+            if (begin == end) {
+                if (start == len) {
+                    break;
+                }
+                if (Search(pattern, data, prev_avail ? 0 : start, len, start, true, true, scratch, begin, end)) {
+                    continue;
+                }
+                start++;
+            }
+            prev_avail = true;
+            if (!Search(pattern, data, 0, len, start, false, false, scratch, begin, end)) {
+                break;
+            }
+        }
+    }
+}
+
+void MultiRegex::Prefilter(const uint8_t* text, size_t len, std::vector<char>& candidates) const {
+    for (uint32_t index = 0; index < patterns_.size(); index++) {
+        const auto& pattern = patterns_[index];
+        candidates[index] = pattern.fallback_ != nullptr || pattern.nullable_;
+    }
+
+    // take a cache no other call is using, so the scan below runs without the lock
+    std::unique_ptr<Dfa> dfa;
+    {
+        std::lock_guard<std::mutex> lock(dfa_mutex_);
+        if (!dfa_pool_.empty()) {
+            dfa = std::move(dfa_pool_.back());
+            dfa_pool_.pop_back();
+        }
+    }
+    if (dfa == nullptr || dfa->pattern_count_ != patterns_.size()) {
+        dfa = BuildDfa();
+    }
+
+    if (!dfa->start_.empty()) {
+        auto class_count = static_cast<uint32_t>(dfa->class_bytes_.size());
+        int32_t state = 0;
+        for (size_t i = 0; i < len; i++) {
+            uint32_t byte_class = dfa->byte_classes_[text[i]];
+            int32_t next = dfa->next_[state * class_count + byte_class];
+            if (next < 0) {
+                next = DfaStep(*dfa, state, byte_class);
+            }
+            state = next;
+            for (auto index : dfa->accepts_[state]) {
+                candidates[index] = 1;
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(dfa_mutex_);
+    dfa_pool_.push_back(std::move(dfa));
+}
+
+std::unique_ptr<MultiRegex::Dfa> MultiRegex::BuildDfa() const {
+    std::unique_ptr<Dfa> result(new Dfa());
+    Dfa& dfa = *result;
+    dfa.pattern_count_ = static_cast<uint32_t>(patterns_.size());
+    dfa.marks_.assign(prog_.size(), 0);
+
+    // bytes no class tells apart share a column of the transition table
+    std::array<uint32_t, 256> partition{};
+    uint32_t count = 1;
+    for (const auto& chars : classes_) {
+        std::vector<int32_t> split(count * 2, -1);
+        uint32_t next_count = 0;
+        for (int ch = 0; ch < 256; ch++) {
+            auto& id = split[partition[ch] * 2 + (chars.test(ch) ? 1 : 0)];
+            if (id < 0) {
+                id = static_cast<int32_t>(next_count++);
+            }
+            partition[ch] = static_cast<uint32_t>(id);
+        }
+        count = next_count;
+    }
+    dfa.class_bytes_.assign(count, 0);
+    for (int ch = 255; ch >= 0; ch--) {
+        dfa.byte_classes_[ch] = static_cast<uint8_t>(partition[ch]);
+        dfa.class_bytes_[partition[ch]] = static_cast<uint8_t>(ch);
+    }
+    dfa.start_steps_.assign(count, std::vector<uint32_t>());
+    dfa.start_steps_ready_.assign(count, false);
+
+    dfa.epoch_++;
+    for (const auto& pattern : patterns_) {
+        if (pattern.fallback_ == nullptr && !pattern.nullable_) {
+            DfaClosure(dfa, pattern.start_, dfa.start_);
+        }
+    }
+    ResetDfaStates(dfa);
+    return result;
+}
+
+void MultiRegex::ResetDfaStates(Dfa& dfa) const {
+    dfa.states_.clear();
+    dfa.accepts_.clear();
+    dfa.next_.clear();
+    dfa.index_.clear();
+    dfa.cached_insts_ = 0;
+    dfa.resets_++;
+    std::vector<uint32_t> empty;
+    AddDfaState(dfa, empty);
+}
+
+int32_t MultiRegex::AddDfaState(Dfa& dfa, std::vector<uint32_t>& insts) const {
+    std::sort(insts.begin(), insts.end());
+    auto it = dfa.index_.find(insts);
+    if (it != dfa.index_.end()) {
+        return it->second;
+    }
+    if (dfa.cached_insts_ + insts.size() > MAX_DFA_CACHED_INSTS) {
+        // keeps the memory bounded, the states in use are rebuilt as they are visited again
+        std::vector<uint32_t> kept(std::move(insts));
+        ResetDfaStates(dfa);
+        return AddDfaState(dfa, kept);
+    }
+
+    auto state = static_cast<int32_t>(dfa.states_.size());
+    std::vector<uint32_t> accepts;
+    for (auto pc : insts) {
+        if (prog_[pc].op_ == OP_MATCH) {
+            accepts.push_back(prog_[pc].arg_);
+        }
+    }
+    dfa.cached_insts_ += insts.size();
+    dfa.index_.emplace(insts, state);
+    dfa.states_.emplace_back(std::move(insts));
+    dfa.accepts_.emplace_back(std::move(accepts));
+    dfa.next_.resize(dfa.next_.size() + dfa.class_bytes_.size(), -1);
+    return state;
+}
+
+int32_t MultiRegex::DfaStep(Dfa& dfa, int32_t state, uint32_t byte_class) const {
+    uint8_t ch = dfa.class_bytes_[byte_class];
+
+    // the threads started at the previous byte are the same for every state
+    if (!dfa.start_steps_ready_[byte_class]) {
+        dfa.epoch_++;
+        for (auto pc : dfa.start_) {
+            dfa.marks_[pc] = dfa.epoch_;
+        }
+        for (auto pc : dfa.start_) {
+            if (prog_[pc].op_ == OP_CHAR_CLASS && classes_[prog_[pc].arg_].test(ch)) {
+                DfaClosure(dfa, pc + 1, dfa.start_steps_[byte_class]);
+            }
+        }
+        dfa.start_steps_ready_[byte_class] = true;
+    }
+
+    dfa.epoch_++;
+    for (auto pc : dfa.start_) {
+        dfa.marks_[pc] = dfa.epoch_;
+    }
+    std::vector<uint32_t> insts;
+    for (auto pc : dfa.start_steps_[byte_class]) {
+        dfa.marks_[pc] = dfa.epoch_;
+        insts.push_back(pc);
+    }
+    for (auto pc : dfa.states_[state]) {
+        if (prog_[pc].op_ == OP_CHAR_CLASS && classes_[prog_[pc].arg_].test(ch)) {
+            DfaClosure(dfa, pc + 1, insts);
+        }
+    }
+
+    size_t resets = dfa.resets_;
+    int32_t next = AddDfaState(dfa, insts);
+    // state is gone if the cache has been dropped meanwhile
+    if (resets == dfa.resets_) {
+        dfa.next_[state * dfa.class_bytes_.size() + byte_class] = next;
+    }
+    return next;
+}
+
+void MultiRegex::DfaClosure(Dfa& dfa, uint32_t pc, std::vector<uint32_t>& insts) const {
+    auto& stack = dfa.stack_;
+    stack.clear();
+    stack.push_back(pc);
+    while (!stack.empty()) {
+        pc = stack.back();
+        stack.pop_back();
+        if (dfa.marks_[pc] == dfa.epoch_) {
+            continue;
+        }
+        dfa.marks_[pc] = dfa.epoch_;
+        const Inst& inst = prog_[pc];
+        switch (inst.op_) {
+            case OP_CHAR_CLASS:
+            case OP_MATCH:
+                insts.push_back(pc);
+                break;
+            case OP_JMP:
+                stack.push_back(inst.x_);
+                break;
+            case OP_SPLIT:
+                stack.push_back(inst.y_);
+                stack.push_back(inst.x_);
+                break;
+            case OP_ASSERT:
+                stack.push_back(pc + 1);
+                break;
+        }
+    }
+}
+
+}  // namespace ops
+}  // namespace pyis
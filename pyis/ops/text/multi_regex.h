@@ -0,0 +1,146 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace pyis {
+namespace ops {
+
+// A set of ECMAScript regular expressions searched together, as a replacement for running std::regex_iterator with
+// each of them. All patterns are compiled into one Thompson NFA. A lazily built DFA over the whole set scans the text
+// once to find the patterns that may match, and only those are run by a Pike VM to report the exact matches, which
+// are the same as the ones of std::regex_iterator (leftmost, first alternative first).
+// Patterns outside the supported syntax, e.g. with backreferences or lookaheads, fall back to std::regex.
+class MultiRegex {
+  public:
+    // (pattern index, match begin, match end)
+    using Match = std::tuple<uint32_t, uint32_t, uint32_t>;
+
+    MultiRegex() = default;
+    ~MultiRegex() = default;
+
+    MultiRegex(const MultiRegex& o) = delete;
+    MultiRegex& operator=(const MultiRegex& o) = delete;
+
+    // Compile the pattern and return its index. Throws std::regex_error for invalid patterns, same as std::regex.
+    uint32_t Add(const std::string& pattern);
+    size_t size() const { return patterns_.size(); }
+    // whether the pattern is run by std::regex
+    bool IsFallback(uint32_t index) const { return patterns_[index].fallback_ != nullptr; }
+
+    // Append the non overlapping matches of every pattern in text[0, len) to matches, ordered by pattern and then by
+    // position. Safe to call concurrently.
+    void FindAll(const char* text, size_t len, std::vector<Match>& matches) const;
+
+  private:
+    enum Op : uint8_t { OP_CHAR_CLASS, OP_SPLIT, OP_JMP, OP_ASSERT, OP_MATCH };
+
+    // syntax tree of a pattern
+    struct Node;
+    class Parser;
+
+    // OP_CHAR_CLASS consumes a byte of classes_[arg_] and continues at the next instruction. OP_SPLIT continues at x_
+    // first, then at y_. OP_ASSERT checks the assertion arg_ and continues at the next instruction. OP_MATCH reports
+    // a match of the pattern arg_.
+    struct Inst {
+        Op op_;
+        uint32_t arg_;
+        uint32_t x_;
+        uint32_t y_;
+    };
+
+    struct Pattern {
+        // instructions [start_, end_) of prog_
+        uint32_t start_ = 0;
+        uint32_t end_ = 0;
+        // bytes a non empty match may start with
+        std::bitset<256> first_bytes_;
+        // whether the pattern may match an empty string
+        bool nullable_ = false;
+        std::unique_ptr<std::regex> fallback_;
+    };
+
+    // threads of the Pike VM, a sparse set of instructions in priority order with the start of their match
+    struct ThreadList {
+        explicit ThreadList(size_t capacity) : sparse_(capacity), dense_(capacity), size_(0) {}
+        std::vector<uint32_t> sparse_;
+        std::vector<std::pair<uint32_t, uint32_t>> dense_;
+        size_t size_;
+    };
+
+    struct Scratch {
+        explicit Scratch(size_t capacity) : clist_(capacity), nlist_(capacity) {}
+        ThreadList clist_;
+        ThreadList nlist_;
+        std::vector<uint32_t> stack_;
+    };
+
+    // Cache of the DFA states visited so far. A state is the set of OP_CHAR_CLASS and OP_MATCH instructions reached
+    // by the threads started at previous bytes. Threads starting at the current byte are implied, so they are not
+    // part of the state. Assertions are taken as always true, so the DFA may report more patterns than those which
+    // actually match, never less.
+    struct Dfa {
+        uint32_t pattern_count_ = 0;
+        std::vector<uint32_t> start_;
+        std::array<uint8_t, 256> byte_classes_;
+        std::vector<uint8_t> class_bytes_;
+        std::vector<std::vector<uint32_t>> start_steps_;
+        std::vector<bool> start_steps_ready_;
+
+        std::vector<std::vector<uint32_t>> states_;
+        std::vector<std::vector<uint32_t>> accepts_;
+        std::vector<int32_t> next_;
+        std::map<std::vector<uint32_t>, int32_t> index_;
+        size_t cached_insts_ = 0;
+        size_t resets_ = 0;
+
+        std::vector<uint32_t> marks_;
+        uint32_t epoch_ = 0;
+        std::vector<uint32_t> stack_;
+    };
+
+    bool Compile(const std::string& pattern, uint32_t index);
+    bool Emit(const Node& node, size_t max_insts);
+    uint32_t AddClass(const std::bitset<256>& chars);
+    void ComputeFirstBytes(Pattern& pattern) const;
+
+    // Leftmost first match of text[start, len), assertions taking text[begin] as the beginning of the text.
+    bool Search(const Pattern& pattern, const uint8_t* text, size_t begin, size_t len, size_t start, bool not_null,
+                bool continuous, Scratch& scratch, size_t& match_begin, size_t& match_end) const;
+    void AddThread(ThreadList& list, const Pattern& pattern, uint32_t pc, uint32_t match_begin, const uint8_t* text,
+                   size_t begin, size_t len, size_t pos, std::vector<uint32_t>& stack) const;
+    bool CheckAssertion(uint32_t assertion, const uint8_t* text, size_t begin, size_t len, size_t pos) const;
+
+    void Prefilter(const uint8_t* text, size_t len, std::vector<char>& candidates) const;
+    std::unique_ptr<Dfa> BuildDfa() const;
+    void ResetDfaStates(Dfa& dfa) const;
+    int32_t AddDfaState(Dfa& dfa, std::vector<uint32_t>& insts) const;
+    int32_t DfaStep(Dfa& dfa, int32_t state, uint32_t byte_class) const;
+    void DfaClosure(Dfa& dfa, uint32_t pc, std::vector<uint32_t>& insts) const;
+
+    std::vector<Pattern> patterns_;
+    std::vector<Inst> prog_;
+    std::vector<std::bitset<256>> classes_;
+    std::unordered_map<std::bitset<256>, uint32_t> class_index_;
+    size_t max_pattern_insts_ = 0;
+
+    // DFA caches not in use. A Prefilter call takes one and puts it back when done, so concurrent calls each scan
+    // with their own cache, and only hold the mutex to take and put it.
+    mutable std::mutex dfa_mutex_;
+    mutable std::vector<std::unique_ptr<Dfa>> dfa_pool_;
+};
+
+}  // namespace ops
+}  // namespace pyis
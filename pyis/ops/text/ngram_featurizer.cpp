@@ -86,86 +86,54 @@ void NGramFeaturizer::DumpNGram(std::string& ngram_file) {
 
 std::vector<TextFeature> NGramFeaturizer::Transform(const std::vector<std::string>& tokens) const {
     std::vector<TextFeature> res;
+    Extract(tokens, false, res);
+    return res;
+}
+
+std::vector<TextFeature> NGramFeaturizer::TransformAllOrders(const std::vector<std::string>& tokens) const {
+    std::vector<TextFeature> res;
+    Extract(tokens, true, res);
+    return res;
+}
 
+void NGramFeaturizer::Extract(const std::vector<std::string>& tokens, bool all_orders,
+                              std::vector<TextFeature>& res) const {
     auto token_count = static_cast<int>(tokens.size());
-    if (token_count < order_) {
-        return res;
-    }
-
-    // compute sentence length
-    int sentence_len = 0;
-    for (int idx = 0; idx < token_count; idx++) {
-        sentence_len += static_cast<int>(tokens[idx].length());
-    }
-    sentence_len += (token_count - 1);
-    if (sentence_len <= 0) {
-        return res;
-    }
-
-    std::vector<char> sentence(sentence_len + NGramFeaturizer::BOS_MARK.length() + NGramFeaturizer::EOS_MARK.length() +
-                               3);
-    std::vector<uint32_t> begin_indexes(token_count + 2);
-    std::vector<uint32_t> end_indexes(token_count + 2);
-
-    uint32_t cur = 0;
-    memcpy(sentence.data(), NGramFeaturizer::BOS_MARK.data(), NGramFeaturizer::BOS_MARK.length());
-    begin_indexes[0] = cur;
-    end_indexes[0] = cur + static_cast<uint32_t>(NGramFeaturizer::BOS_MARK.length());
-    cur += static_cast<uint32_t>(NGramFeaturizer::BOS_MARK.length());
-    sentence[cur] = ' ';
-    cur += 1;
-    for (int idx = 0; idx < token_count; idx++) {
-        const char* text = tokens[idx].data();
-        auto len = static_cast<uint32_t>(tokens[idx].length());
-        memcpy(sentence.data() + cur, text, len);
-        begin_indexes[idx + 1] = cur;
-        end_indexes[idx + 1] = cur + len;
-        cur += len;
-        sentence[cur] = ' ';
-        cur += 1;
-    }
-    memcpy(sentence.data() + cur, NGramFeaturizer::EOS_MARK.data(), NGramFeaturizer::EOS_MARK.length());
-    begin_indexes[token_count + 1] = cur;
-    end_indexes[token_count + 1] = cur + static_cast<uint32_t>(NGramFeaturizer::EOS_MARK.length());
-    cur += static_cast<uint32_t>(NGramFeaturizer::EOS_MARK.length());
-    sentence[sentence.size() - 1] = '\0';
+    if ((!all_orders && token_count < order_) || token_count == 0 || (token_count == 1 && tokens[0].empty())) {
+        return;
+    }
+
+    // Each walk resumes the trie search from where the previous token left it, so that all the ngrams starting at
+    // the same token are looked up in one traversal rather than one search from the root per ngram.
+    uint32_t id = 0;
 
     // e.g. query:a b c, order:2, this is to check "BeginningOfDoc a b"
     if (boundaries_) {
-        char* begin = sentence.data() + begin_indexes[0];
-        char* end = sentence.data() + end_indexes[order_];
-        (*end) = '\0';
-        auto id = trie_.Lookup(begin);
-        if (id.has_value()) {
-            res.emplace_back(id.value(), 1.0, 0, order_ - 1);
+        Trie::Cursor cursor;
+        trie_.Walk(NGramFeaturizer::BOS_MARK, cursor, id);
+        for (int k = 0; k < order_ && k < token_count && cursor.valid_; k++) {
+            if (trie_.Walk(tokens[k], cursor, id) && (all_orders || k == order_ - 1)) {
+                res.emplace_back(id, 1.0, 0, k);
+            }
         }
-        (*end) = ' ';
     }
 
-    // this is to check "a b", "b c"
-    for (int i = 0; i <= token_count - order_; i++) {
-        char* begin = sentence.data() + begin_indexes[i + 1];
-        char* end = sentence.data() + end_indexes[i + order_];
-        (*end) = '\0';
-        auto id = trie_.Lookup(begin);
-        if (id.has_value()) {
-            res.emplace_back(id.value(), 1.0, i, i + order_ - 1);
+    // this is to check "a b", "b c", and "b c EndOfDoc" on the way
+    int last_start = all_orders ? token_count - 1 : token_count - order_;
+    for (int i = 0; i <= last_start; i++) {
+        Trie::Cursor cursor;
+        int k = 0;
+        for (/**/; k < order_ && i + k < token_count && cursor.valid_; k++) {
+            if (trie_.Walk(tokens[i + k], cursor, id) && (all_orders || k == order_ - 1)) {
+                res.emplace_back(id, 1.0, i, i + k);
+            }
         }
-        (*end) = ' ';
-    }
-
-    // this is to check "b c EndOfDoc"
-    if (boundaries_) {
-        char* begin = sentence.data() + begin_indexes[token_count - order_ + 1];
-        char* end = sentence.data() + end_indexes[end_indexes.size() - 1];
-        (*end) = '\0';
-        auto id = trie_.Lookup(begin);
-        if (id.has_value()) {
-            res.emplace_back(id.value(), 1.0, token_count - order_, token_count - 1);
+        if (boundaries_ && i + k == token_count && (all_orders || k == order_) && cursor.valid_) {
+            if (trie_.Walk(NGramFeaturizer::EOS_MARK, cursor, id)) {
+                res.emplace_back(id, 1.0, i, token_count - 1);
+            }
         }
     }
-
-    return res;
 }
 
 void NGramFeaturizer::AddNGram(std::vector<std::string>& tokens, int begin, int end) {
@@ -30,6 +30,8 @@ class NGramFeaturizer : public CachedObject<NGramFeaturizer> {
 
     void Fit(const std::vector<std::string>& tokens);
     std::vector<TextFeature> Transform(const std::vector<std::string>& tokens) const;
+    // Same as Transform, but extracts the known ngrams of every order from 1 to n.
+    std::vector<TextFeature> TransformAllOrders(const std::vector<std::string>& tokens) const;
 
     void DumpNGram(std::string& ngram_file);
     void LoadNGram(std::string& ngram_file);
@@ -37,6 +39,7 @@ class NGramFeaturizer : public CachedObject<NGramFeaturizer> {
     void Deserialize(const std::string& state, ModelStorage& storage);
 
   private:
+    void Extract(const std::vector<std::string>& tokens, bool all_orders, std::vector<TextFeature>& res) const;
     void AddNGram(std::vector<std::string>& tokens, int begin, int end);
     void AddNGram(const std::string& ngram, uint32_t id);
 
@@ -3,6 +3,7 @@
 
 #include "regex_featurizer.h"
 
+#include <cstdint>
 #include <fstream>  // std::ifstream
 #include <sstream>
 
@@ -14,21 +15,27 @@
 namespace pyis {
 namespace ops {
 
+// marks a sentence offset where no token starts or ends
+static const uint32_t NO_TOKEN_INDEX = UINT32_MAX;
+
 RegexFeaturizer::RegexFeaturizer(const std::vector<std::string>& regexes) {
     for (const auto& p : regexes) {
         regex_patterns_.emplace_back(p);
-        regexes_.emplace_back(p);
+        regexes_.Add(p);
     }
 }
 
 void RegexFeaturizer::AddRegex(const std::string& regex) {
     regex_patterns_.emplace_back(regex);
-    regexes_.emplace_back(regex);
+    regexes_.Add(regex);
 }
 
 std::vector<TextFeature> RegexFeaturizer::Transform(const std::vector<std::string>& tokens) const {
     std::vector<TextFeature> res;
     auto token_count = static_cast<uint32_t>(tokens.size());
+    if (token_count == 0) {
+        return res;
+    }
 
     // compute sentence length
     uint32_t sentence_len = 0;
@@ -41,8 +48,8 @@ std::vector<TextFeature> RegexFeaturizer::Transform(const std::vector<std::strin
     }
 
     std::vector<char> sentence(sentence_len + 1);
-    std::vector<std::pair<uint32_t, uint32_t>> token_inverse_indexes(sentence_len + 1,
-                                                                     std::pair<uint32_t, uint32_t>(-1, -1));
+    std::vector<std::pair<uint32_t, uint32_t>> token_inverse_indexes(
+        sentence_len + 1, std::pair<uint32_t, uint32_t>(NO_TOKEN_INDEX, NO_TOKEN_INDEX));
 
     uint32_t offset = 0;
     const char delim = ' ';
@@ -50,8 +57,6 @@ std::vector<TextFeature> RegexFeaturizer::Transform(const std::vector<std::strin
     for (const auto& token : tokens) {
         // copy value to query
         memcpy(sentence.data() + offset, token.c_str(), token.length());
-        std::pair<uint32_t, uint32_t> token_index(-1, -1);
-        std::pair<uint32_t, uint32_t> token_inverse_index(-1, -1);
         token_inverse_indexes[offset].first = index;
         offset += token.length();
         token_inverse_indexes[offset].second = index;
@@ -62,23 +67,14 @@ std::vector<TextFeature> RegexFeaturizer::Transform(const std::vector<std::strin
     }
     sentence[sentence.size() - 1] = '\0';
 
-    uint32_t id = 0;
-    for (const auto& p : regexes_) {
-        std::regex_iterator<const char*> ite(sentence.data(), sentence.data() + sentence_len, p);
-        std::regex_iterator<const char*> rend;
-
-        while (ite != rend) {
-            uint32_t match_pos = ite->position();
-            uint32_t match_length = ite->length();
-
-            uint32_t start_index = token_inverse_indexes[match_pos].first;
-            uint32_t end_index = token_inverse_indexes[match_pos + match_length].second;
-            if (start_index != -1 && end_index != -1) {
-                res.emplace_back(id, 1.0, start_index, end_index);
-            }
-            ite++;
+    std::vector<MultiRegex::Match> matches;
+    regexes_.FindAll(sentence.data(), sentence_len, matches);
+    for (const auto& match : matches) {
+        uint32_t start_index = token_inverse_indexes[std::get<1>(match)].first;
+        uint32_t end_index = token_inverse_indexes[std::get<2>(match)].second;
+        if (start_index != NO_TOKEN_INDEX && end_index != NO_TOKEN_INDEX) {
+            res.emplace_back(std::get<0>(match), 1.0, start_index, end_index);
         }
-        id++;
     }
     return res;
 }
@@ -100,7 +96,7 @@ void RegexFeaturizer::Load(const std::string& regex_file, ModelStorage& storage)
             continue;
         }
         regex_patterns_.emplace_back(line);
-        regexes_.emplace_back(line);
+        regexes_.Add(line);
     }
 }
 
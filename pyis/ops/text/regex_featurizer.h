@@ -6,11 +6,11 @@
 #include <istream>
 #include <memory>
 #include <ostream>
-#include <regex>
 #include <string>
 #include <vector>
 
 #include "pyis/ops/text/cedar_trie.h"
+#include "pyis/ops/text/multi_regex.h"
 #include "pyis/ops/text/text_feature.h"
 #include "pyis/share/cached_object.h"
 #include "pyis/share/model_storage.h"
@@ -39,7 +39,8 @@ class RegexFeaturizer {
 
   private:
     std::vector<std::string> regex_patterns_;
-    std::vector<std::regex> regexes_;
+    // all the patterns compiled together, so that a sentence is scanned once whatever the number of patterns
+    MultiRegex regexes_;
 };
 
 }  // namespace ops
@@ -50,6 +50,41 @@ Expected<uint32_t> Trie::Lookup(const std::string& key) const {
     return immutable_trie_->Match(key);
 }
 
+bool Trie::Walk(const std::string& token, Cursor& cursor, uint32_t& value) const {
+    if (!cursor.valid_) {
+        return false;
+    }
+    if (cedar_trie_ != nullptr) {
+        int ret = 0;
+        if (cursor.started_) {
+            ret = cedar_trie_->Traverse(" ", 1, cursor.cedar_from_);
+        }
+        if (ret != CedarTrie::CEDAR_NO_PATH) {
+            ret = cedar_trie_->Traverse(token.data(), token.length(), cursor.cedar_from_);
+        }
+        cursor.started_ = true;
+        if (ret == CedarTrie::CEDAR_NO_PATH) {
+            cursor.valid_ = false;
+            return false;
+        }
+        if (ret == CedarTrie::CEDAR_NO_VALUE) {
+            return false;
+        }
+        value = static_cast<uint32_t>(ret);
+        return true;
+    }
+
+    // the immutable trie consumes the separator following the token itself, and leaves a null pointer once no key
+    // continues
+    const auto* begin = reinterpret_cast<const uint8_t*>(token.data());
+    cursor.started_ = true;
+    bool found = immutable_trie_->MatchNext(begin, begin + token.length(), cursor.immutable_ptr_, value);
+    if (cursor.immutable_ptr_ == nullptr) {
+        cursor.valid_ = false;
+    }
+    return found;
+}
+
 void Trie::Save(const std::string& path) {
     if (cedar_trie_ != nullptr) {
         std::vector<std::tuple<std::string, uint32_t>> data;
@@ -9,6 +9,14 @@ namespace ops {
 
 class Trie : public CachedObject<Trie> {
   public:
+    // position of an incremental search, keys are matched one space separated token at a time
+    struct Cursor {
+        uint64_t cedar_from_ = 0;
+        ImmutableTrie::TrieData immutable_ptr_ = nullptr;
+        bool started_ = false;
+        bool valid_ = true;
+    };
+
     Trie();
     explicit Trie(const std::string& path);
 
@@ -18,6 +26,9 @@ class Trie : public CachedObject<Trie> {
     void Erase(const std::string& key);
     Expected<uint32_t> Lookup(const std::string& key) const;
     bool Contains(const std::string& key) const;
+    // Extend the key searched by cursor with the next token. Returns whether the key made of all the tokens walked
+    // so far exists, with its value in value. The cursor is no longer valid once no key continues.
+    bool Walk(const std::string& token, Cursor& cursor, uint32_t& value) const;
     void Save(const std::string& path);
     void Save(std::shared_ptr<std::ostream> os);
     void Load(const std::string& path);
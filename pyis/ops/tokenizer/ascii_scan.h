@@ -0,0 +1,189 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PYIS_ASCII_SCAN_SSE2
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PYIS_ASCII_SCAN_AVX2
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define PYIS_ASCII_SCAN_NEON
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace pyis {
+namespace ops {
+
+// Classes of ASCII bytes, which the tokenizers split text on. The fast paths skip a run of bytes of some classes 16
+// (or 32 with AVX2) at a time, and the tokenizers decode the characters one by one only for the other bytes.
+enum AsciiClass : uint32_t {
+    ASCII_LETTER = 1,
+    ASCII_DIGIT = 2,
+    ASCII_SPACE = 4,
+    // the other printable characters and the controls, except ' '
+    ASCII_OTHER = 8,
+    ASCII_ANY = 15,
+};
+
+inline uint32_t AsciiClassOf(uint8_t c) {
+    if (c >= 0x80) {
+        return 0;
+    }
+    if ((c | 0x20) >= 'a' && (c | 0x20) <= 'z') {
+        return ASCII_LETTER;
+    }
+    if (c >= '0' && c <= '9') {
+        return ASCII_DIGIT;
+    }
+    return c == ' ' ? ASCII_SPACE : ASCII_OTHER;
+}
+
+// end of the run of bytes from pos whose classes are in CLASSES, or len
+template <uint32_t CLASSES>
+size_t SkipAsciiScalar(const uint8_t* text, size_t pos, size_t len) {
+    while (pos < len && (AsciiClassOf(text[pos]) & CLASSES) != 0) {
+        pos++;
+    }
+    return pos;
+}
+
+#if defined(PYIS_ASCII_SCAN_SSE2) || defined(PYIS_ASCII_SCAN_NEON)
+
+inline uint32_t CountTrailingZeroBits(uint32_t bits) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, bits);
+    return static_cast<uint32_t>(index);
+#else
+    return static_cast<uint32_t>(__builtin_ctz(bits));
+#endif
+}
+
+#ifdef PYIS_ASCII_SCAN_SSE2
+
+// signed compares, so the bytes from 0x80 are negative and fall in no class
+template <uint32_t CLASSES>
+inline __m128i MatchAscii(__m128i block) {
+    __m128i matched = _mm_setzero_si128();
+    if ((CLASSES & ASCII_LETTER) != 0) {
+        __m128i folded = _mm_or_si128(block, _mm_set1_epi8(0x20));
+        matched = _mm_or_si128(matched, _mm_and_si128(_mm_cmpgt_epi8(folded, _mm_set1_epi8('a' - 1)),
+                                                      _mm_cmplt_epi8(folded, _mm_set1_epi8('z' + 1))));
+    }
+    if ((CLASSES & ASCII_DIGIT) != 0) {
+        matched = _mm_or_si128(matched, _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8('0' - 1)),
+                                                      _mm_cmplt_epi8(block, _mm_set1_epi8('9' + 1))));
+    }
+    if ((CLASSES & ASCII_SPACE) != 0) {
+        matched = _mm_or_si128(matched, _mm_cmpeq_epi8(block, _mm_set1_epi8(' ')));
+    }
+    if ((CLASSES & ASCII_OTHER) != 0) {
+        // ASCII, and in none of the other classes
+        __m128i others = _mm_andnot_si128(MatchAscii<ASCII_LETTER | ASCII_DIGIT | ASCII_SPACE>(block),
+                                          _mm_cmpgt_epi8(block, _mm_set1_epi8(-1)));
+        matched = _mm_or_si128(matched, others);
+    }
+    return matched;
+}
+
+#ifdef PYIS_ASCII_SCAN_AVX2
+template <uint32_t CLASSES>
+inline __m256i MatchAscii(__m256i block) {
+    __m256i matched = _mm256_setzero_si256();
+    if ((CLASSES & ASCII_LETTER) != 0) {
+        __m256i folded = _mm256_or_si256(block, _mm256_set1_epi8(0x20));
+        matched = _mm256_or_si256(matched, _mm256_and_si256(_mm256_cmpgt_epi8(folded, _mm256_set1_epi8('a' - 1)),
+                                                            _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), folded)));
+    }
+    if ((CLASSES & ASCII_DIGIT) != 0) {
+        matched = _mm256_or_si256(matched, _mm256_and_si256(_mm256_cmpgt_epi8(block, _mm256_set1_epi8('0' - 1)),
+                                                            _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), block)));
+    }
+    if ((CLASSES & ASCII_SPACE) != 0) {
+        matched = _mm256_or_si256(matched, _mm256_cmpeq_epi8(block, _mm256_set1_epi8(' ')));
+    }
+    if ((CLASSES & ASCII_OTHER) != 0) {
+        __m256i others = _mm256_andnot_si256(MatchAscii<ASCII_LETTER | ASCII_DIGIT | ASCII_SPACE>(block),
+                                             _mm256_cmpgt_epi8(block, _mm256_set1_epi8(-1)));
+        matched = _mm256_or_si256(matched, others);
+    }
+    return matched;
+}
+#endif
+
+#else
+
+template <uint32_t CLASSES>
+inline uint8x16_t MatchAscii(uint8x16_t block) {
+    uint8x16_t matched = vdupq_n_u8(0);
+    if ((CLASSES & ASCII_LETTER) != 0) {
+        uint8x16_t folded = vorrq_u8(block, vdupq_n_u8(0x20));
+        matched = vorrq_u8(matched, vandq_u8(vcgeq_u8(folded, vdupq_n_u8('a')), vcleq_u8(folded, vdupq_n_u8('z'))));
+    }
+    if ((CLASSES & ASCII_DIGIT) != 0) {
+        matched = vorrq_u8(matched, vandq_u8(vcgeq_u8(block, vdupq_n_u8('0')), vcleq_u8(block, vdupq_n_u8('9'))));
+    }
+    if ((CLASSES & ASCII_SPACE) != 0) {
+        matched = vorrq_u8(matched, vceqq_u8(block, vdupq_n_u8(' ')));
+    }
+    if ((CLASSES & ASCII_OTHER) != 0) {
+        uint8x16_t others = vbicq_u8(vcltq_u8(block, vdupq_n_u8(0x80)),
+                                     MatchAscii<ASCII_LETTER | ASCII_DIGIT | ASCII_SPACE>(block));
+        matched = vorrq_u8(matched, others);
+    }
+    return matched;
+}
+
+#endif
+
+// Same as SkipAsciiScalar, classifying 16 or 32 bytes at a time
+template <uint32_t CLASSES>
+size_t SkipAscii(const uint8_t* text, size_t pos, size_t len) {
+#ifdef PYIS_ASCII_SCAN_AVX2
+    for (; pos + 32 <= len; pos += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + pos));
+        auto bits = static_cast<uint32_t>(_mm256_movemask_epi8(MatchAscii<CLASSES>(block)));
+        if (bits != 0xFFFFFFFFU) {
+            return pos + CountTrailingZeroBits(~bits);
+        }
+    }
+#endif
+    for (; pos + 16 <= len; pos += 16) {
+#ifdef PYIS_ASCII_SCAN_SSE2
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + pos));
+        auto bits = static_cast<uint32_t>(_mm_movemask_epi8(MatchAscii<CLASSES>(block)));
+        if (bits != 0xFFFFU) {
+            return pos + CountTrailingZeroBits(~bits);
+        }
+#else
+        uint8x16_t matched = MatchAscii<CLASSES>(vld1q_u8(text + pos));
+        if (vminvq_u8(matched) != 0xFF) {
+            return SkipAsciiScalar<CLASSES>(text, pos, pos + 16);
+        }
+#endif
+    }
+    return SkipAsciiScalar<CLASSES>(text, pos, len);
+}
+
+#else
+
+template <uint32_t CLASSES>
+size_t SkipAscii(const uint8_t* text, size_t pos, size_t len) {
+    return SkipAsciiScalar<CLASSES>(text, pos, len);
+}
+
+#endif
+
+}  // namespace ops
+}  // namespace pyis
@@ -3,69 +3,285 @@
 
 #include "basic_tokenizer.h"
 
-std::vector<std::string> pyis::ops::BasicTokenizer::Tokenize(const std::string& str) const {
-    std::string text(str);
+#include <array>
+#include <cstdint>
+#include <map>
+
+#include "pyis/ops/tokenizer/ascii_scan.h"
+
+namespace pyis {
+namespace ops {
+
+namespace {
+
+enum CharFlag : uint8_t {
+    CHAR_CJK = 1,
+    CHAR_ACCENT = 2,
+    CHAR_PUNCTUATION = 4,
+    CHAR_SPACE = 8,
+    CHAR_CONTROL = 16,
+    // changed by to_lower_char and strip_accent
+    CHAR_UPPER = 32,
+    CHAR_ACCENTED = 64,
+};
+
+// code point of the bytes which are not valid utf-8, which are copied as they are
+const char32_t INVALID_CHAR = 0x110000;
+
+uint8_t classify_char(char32_t c) {
+    uint8_t flags = 0;
+    if (is_CJK(c)) {
+        flags |= CHAR_CJK;
+    }
+    if (is_accent(c)) {
+        flags |= CHAR_ACCENT;
+    }
+    if (is_unicode_punctuation(c) || c == 0x2019) {
+        flags |= CHAR_PUNCTUATION;
+    }
+    // same as iswspace and iswcntrl of the C locale for ASCII
+    if (c < 128 ? (c == ' ' || (c >= '\t' && c <= '\r')) : is_unicode_space(c)) {
+        flags |= CHAR_SPACE;
+    } else if (c < 32 || (c >= 127 && c < 160) || c == 0xAD || (c >= 0x600 && c <= 0x605) || c == 0x61C ||
+               c == 0x6DD || c == 0x70F || c == 0x180E || (c >= 0x200B && c <= 0x200F) ||
+               (c >= 0x202A && c <= 0x202E) || (c >= 0x2060 && c <= 0x206F) || c == 0xFEFF ||
+               (c >= 0xFFF9 && c <= 0xFFFB) || c == 0xFFFD) {
+        // Cc and Cf, and the replacement character
+        flags |= CHAR_CONTROL;
+    }
+    if (to_lower_char(c) != c) {
+        flags |= CHAR_UPPER;
+    }
+    if (strip_accent(c) != c) {
+        flags |= CHAR_ACCENTED;
+    }
+    return flags;
+}
+
+// Flags of the characters in the Basic Multilingual Plane, computed once by classify_char. The plane is split into
+// blocks of 256 characters and identical blocks are stored once, which leaves a few dozen of them.
+class CharTable {
+  public:
+    static const CharTable& Get() {
+        static const CharTable table;
+        return table;
+    }
+
+    uint8_t Flags(char32_t c) const {
+        if (c < 0x10000) {
+            return blocks_[index_[c >> 8]][c & 0xFF];
+        }
+        return c == INVALID_CHAR ? 0 : classify_char(c);
+    }
+
+  private:
+    CharTable() {
+        std::map<std::array<uint8_t, 256>, uint16_t> block_ids;
+        std::array<uint8_t, 256> block;
+        for (char32_t high = 0; high < 256; high++) {
+            for (char32_t low = 0; low < 256; low++) {
+                block[low] = classify_char((high << 8) | low);
+            }
+            auto it = block_ids.emplace(block, static_cast<uint16_t>(blocks_.size())).first;
+            if (it->second == blocks_.size()) {
+                blocks_.push_back(block);
+            }
+            index_[high] = it->second;
+        }
+    }
+
+    std::array<uint16_t, 256> index_;
+    std::vector<std::array<uint8_t, 256>> blocks_;
+};
+
+// Decode the code point at text[pos] and set next to the position after it. Returns INVALID_CHAR for a byte which
+// does not start a valid sequence.
+char32_t decode_utf8(const uint8_t* text, size_t len, size_t pos, size_t& next) {
+    uint8_t c = text[pos];
+    next = pos + 1;
+    if (c < 0x80) {
+        return c;
+    }
+    size_t n = c >= 0xF5 ? 0 : c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC2 ? 1 : 0;
+    if (n == 0 || pos + n >= len) {
+        return INVALID_CHAR;
+    }
+    char32_t cp = c & (0x3F >> n);
+    for (size_t i = 1; i <= n; i++) {
+        uint8_t cc = text[pos + i];
+        if ((cc & 0xC0) != 0x80) {
+            return INVALID_CHAR;
+        }
+        cp = (cp << 6) | (cc & 0x3F);
+    }
+    if ((n == 2 && cp < 0x800) || (n == 3 && (cp < 0x10000 || cp > 0x10FFFF))) {
+        return INVALID_CHAR;
+    }
+    next = pos + n + 1;
+    return cp;
+}
+
+void append_utf8(std::string& str, char32_t c) {
+    if (c < 0x80) {
+        str += static_cast<char>(c);
+    } else if (c < 0x800) {
+        str += static_cast<char>(0xC0 | (c >> 6));
+        str += static_cast<char>(0x80 | (c & 0x3F));
+    } else if (c < 0x10000) {
+        str += static_cast<char>(0xE0 | (c >> 12));
+        str += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+        str += static_cast<char>(0x80 | (c & 0x3F));
+    } else {
+        str += static_cast<char>(0xF0 | (c >> 18));
+        str += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+        str += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+        str += static_cast<char>(0x80 | (c & 0x3F));
+    }
+}
+
+}  // namespace
+
+std::vector<std::string> BasicTokenizer::Tokenize(const std::string& str) const {
+    std::vector<std::string> result;
+    Split(str, &result, nullptr);
+    return result;
+}
+
+std::vector<std::string> BasicTokenizer::Tokenize(const std::string& str,
+                                                  std::vector<std::pair<size_t, size_t>>& char_spans) const {
     std::vector<std::string> result;
+    char_spans.clear();
+    Split(str, &result, nullptr, &char_spans);
+    return result;
+}
+
+std::vector<std::pair<size_t, size_t>> BasicTokenizer::TokenOffsets(const std::string& str) const {
+    std::vector<std::pair<size_t, size_t>> result;
+    Split(str, nullptr, &result);
+    return result;
+}
+
+void BasicTokenizer::Split(const std::string& str, std::vector<std::string>* tokens,
+                           std::vector<std::pair<size_t, size_t>>* offsets,
+                           std::vector<std::pair<size_t, size_t>>* char_spans) const {
+    const CharTable& table = CharTable::Get();
+    const auto* text = reinterpret_cast<const uint8_t*>(str.data());
+    size_t len = str.size();
+
     std::string token;
-    auto push_current_token_and_clear = [&result, &token]() {
-        if (!token.empty()) {
-            result.emplace_back(token);
+    bool in_token = false;
+    size_t begin = 0;
+    size_t end = 0;
+    auto push_current_token_and_clear = [&]() {
+        if (!in_token) {
+            return;
+        }
+        if (tokens != nullptr) {
+            tokens->emplace_back(token);
             token.clear();
         }
+        if (offsets != nullptr) {
+            offsets->emplace_back(begin, end);
+        }
+        in_token = false;
+    };
+    auto append_char = [&](char32_t c, size_t pos, size_t next) {
+        if (!in_token) {
+            begin = pos;
+            in_token = true;
+        }
+        end = next;
+        if (tokens != nullptr) {
+            size_t size = token.size();
+            if (c == INVALID_CHAR) {
+                token.append(str, pos, next - pos);
+            } else {
+                append_utf8(token, c);
+            }
+            if (char_spans != nullptr) {
+                char_spans->insert(char_spans->end(), token.size() - size, std::make_pair(pos, next));
+            }
+        }
     };
-    auto push_single_char_and_clear = [&result, &token](char32_t c) {
-        token += c;
-        result.emplace_back(token);
-        token.clear();
+
+    // a run of ASCII letters and digits is part of a token as it is, except for lower case
+    auto append_alnum_run = [&](size_t pos, size_t next) {
+        if (!in_token) {
+            begin = pos;
+            in_token = true;
+        }
+        end = next;
+        if (tokens != nullptr) {
+            size_t size = token.size();
+            token.append(str, pos, next - pos);
+            if (do_lower_case_) {
+                for (size_t i = size; i < token.size(); i++) {
+                    token[i] = static_cast<char>(token[i] + ((token[i] >= 'A' && token[i] <= 'Z') ? 32 : 0));
+                }
+            }
+            if (char_spans != nullptr) {
+                for (size_t i = pos; i < next; i++) {
+                    char_spans->emplace_back(i, i + 1);
+                }
+            }
+        }
     };
 
-    if (strip_accents_) {
-        for (auto& c : text) {
+    for (size_t pos = 0, next = 0; pos < len; pos = next) {
+        if ((AsciiClassOf(text[pos]) & (ASCII_LETTER | ASCII_DIGIT)) != 0) {
+            next = SkipAscii<ASCII_LETTER | ASCII_DIGIT>(text, pos + 1, len);
+            append_alnum_run(pos, next);
+            continue;
+        }
+        char32_t c = decode_utf8(text, len, pos, next);
+        uint8_t flags = table.Flags(c);
+        if (strip_accents_ && (flags & CHAR_ACCENTED) != 0) {
             c = strip_accent(c);
+            flags = table.Flags(c);
         }
-    }
-
-    if (do_lower_case_) {
-        for (auto& c : text) {
-            c = ::tolower(c);
+        if (do_lower_case_ && (flags & CHAR_UPPER) != 0) {
+            c = to_lower_char(c);
+            flags = table.Flags(c);
         }
-    }
 
-    for (auto c : text) {
-        if (tokenize_chinese_chars_ && is_CJK(c)) {
+        if (tokenize_chinese_chars_ && (flags & CHAR_CJK) != 0) {
+            push_current_token_and_clear();
+            append_char(c, pos, next);
             push_current_token_and_clear();
-            push_single_char_and_clear(c);
             continue;
         }
-        if (strip_accents_ && is_accent(c)) {
+        if (strip_accents_ && (flags & CHAR_ACCENT) != 0) {
             continue;
         }
 
-        if (tokenize_punctuation_ && (::iswpunct(c) != 0 || c == wint_t(0x2019))) {
+        if (tokenize_punctuation_ && (flags & CHAR_PUNCTUATION) != 0) {
+            push_current_token_and_clear();
+            append_char(c, pos, next);
             push_current_token_and_clear();
-            push_single_char_and_clear(c);
             continue;
         }
 
-        if (::iswspace(c) != 0) {
+        if ((flags & CHAR_SPACE) != 0) {
             push_current_token_and_clear();
             continue;
         }
 
-        if (remove_control_chars_ && ::iswcntrl(c) != 0) {
+        if (remove_control_chars_ && (flags & CHAR_CONTROL) != 0) {
             continue;
         }
 
-        token += c;
+        append_char(c, pos, next);
     }
     push_current_token_and_clear();
-    return result;
 }
 
-pyis::ops::BasicTokenizer::BasicTokenizer(bool do_lower_case, bool tokenize_chinese_chars, bool strip_accents,
-                                          bool tokenize_punctuation, bool remove_control_chars)
+BasicTokenizer::BasicTokenizer(bool do_lower_case, bool tokenize_chinese_chars, bool strip_accents,
+                               bool tokenize_punctuation, bool remove_control_chars)
     : do_lower_case_(do_lower_case),
-      tokenize_chinese_chars_(tokenize_chinese_chars),
       strip_accents_(strip_accents),
+      tokenize_chinese_chars_(tokenize_chinese_chars),
       tokenize_punctuation_(tokenize_punctuation),
       remove_control_chars_(remove_control_chars) {}
+
+}  // namespace ops
+}  // namespace pyis
@@ -14,6 +14,11 @@ namespace ops {
 class BasicTokenizer {
   public:
     std::vector<std::string> Tokenize(const std::string& str) const;
+    // Tokenize, and set char_spans to the [begin, end) bytes in str of the character each byte of the tokens comes
+    // from, for the bytes of all the tokens in order
+    std::vector<std::string> Tokenize(const std::string& str, std::vector<std::pair<size_t, size_t>>& char_spans) const;
+    // byte offsets [begin, end) in str of the tokens returned by Tokenize
+    std::vector<std::pair<size_t, size_t>> TokenOffsets(const std::string& str) const;
     explicit BasicTokenizer(bool do_lower_case, bool tokenize_chinese_chars, bool strip_accents,
                             bool tokenize_punctuation, bool remove_control_chars);
 
@@ -23,6 +28,11 @@ class BasicTokenizer {
     bool tokenize_chinese_chars_;
     bool tokenize_punctuation_;
     bool remove_control_chars_;
+
+    // Decode, normalize and split str in one pass. Fill tokens, offsets and char_spans when they are not null.
+    void Split(const std::string& str, std::vector<std::string>* tokens,
+               std::vector<std::pair<size_t, size_t>>* offsets,
+               std::vector<std::pair<size_t, size_t>>* char_spans = nullptr) const;
 };
 
 }  // namespace ops
@@ -40,13 +40,35 @@ std::vector<std::string> BertTokenizer::Tokenize(const std::string& str) {
     return wordpiece_tokenizer_->Tokenize(str);
 }
 
+std::vector<int64_t> BertTokenizer::EncodeIdsWithOffsets(const std::string& str,
+                                                         std::vector<std::pair<int64_t, int64_t>>& offsets) {
+    if (!do_basic_tokenize_) {
+        return wordpiece_tokenizer_->EncodeIdsWithOffsets(str, offsets);
+    }
+
+    // pieces are located in the normalized words, map them back to the characters of str they come from
+    std::vector<std::pair<size_t, size_t>> char_spans;
+    std::vector<std::pair<size_t, size_t>> spans;
+    std::vector<std::string> words = basic_tokenizer_->Tokenize(str, char_spans);
+    std::vector<std::string> pieces = wordpiece_tokenizer_->Tokenize(words, spans);
+    std::vector<int64_t> ids(pieces.size());
+    for (size_t i = 0; i < pieces.size(); i++) {
+        ids[i] = ConvertTokenToId(pieces[i]);
+        offsets.emplace_back(char_spans[spans[i].first].first, char_spans[spans[i].second - 1].second);
+    }
+    return ids;
+}
+
 std::string BertTokenizer::Serialize(ModelStorage& fs) {
-    std::string vocab_path = fs.uniq_file("bert_tokenizer", ".vocab.txt");
-    fs.add_file(vocab_file_, vocab_path);
+    // the vocab is saved as a snapshot, which Deserialize maps instead of parsing it
+    std::string snapshot_file = fs.uniq_file("bert_tokenizer", ".vocab.bin");
+    auto os = fs.open_ostream(snapshot_file);
+    wordpiece_tokenizer_->SaveSnapshot(*os);
+    os.reset();
     std::string config_file = fs.uniq_file("bert_tokenizer", ".config.json");
 
-    JsonPersistHelper jph(1);
-    jph.add_file("vocab_file", vocab_path);
+    JsonPersistHelper jph(2);
+    jph.add_file("vocab_snapshot", snapshot_file);
     jph.add("start_token", cls_token_);
     jph.add("end_token", sep_token_);
     jph.add("unk_token", unk_token_);
@@ -65,28 +87,41 @@ std::string BertTokenizer::Serialize(ModelStorage& fs) {
 void BertTokenizer::Deserialize(const std::string& state, ModelStorage& fs) {
     JsonPersistHelper jph(state, fs);
     int version = jph.version();
+    if (1 != version && 2 != version) {
+        PYIS_THROW("BertTokenizer v%d is incompatible with the runtime", version);
+    }
+    cls_token_ = jph.get("start_token");
+    sep_token_ = jph.get("end_token");
+    unk_token_ = jph.get("unk_token");
+    pad_token_ = jph.get("pad_token");
+    mask_token_ = jph.get("mask_token");
+    do_lower_case_ = jph.get<bool>("do_lower_case");
+    do_basic_tokenize_ = jph.get<bool>("do_basic_tokenize");
+    tokenize_chinese_chars_ = jph.get<bool>("tokenize_chinese_chars");
+    strip_accents_ = jph.get<bool>("strip_accents");
+    suffix_indicator_ = jph.get("suffix_indicator");
+    if (do_basic_tokenize_) {
+        basic_tokenizer_ =
+            std::make_shared<BasicTokenizer>(do_lower_case_, do_basic_tokenize_, strip_accents_, true, true);
+    }
     if (1 == version) {
         vocab_file_ = FileSystem::join_path({fs.root_dir(), jph.get_file("vocab_file")});
-        cls_token_ = jph.get("start_token");
-        sep_token_ = jph.get("end_token");
-        unk_token_ = jph.get("unk_token");
-        pad_token_ = jph.get("pad_token");
-        mask_token_ = jph.get("mask_token");
-        do_lower_case_ = jph.get<bool>("do_lower_case");
-        do_basic_tokenize_ = jph.get<bool>("do_basic_tokenize");
-        tokenize_chinese_chars_ = jph.get<bool>("tokenize_chinese_chars");
-        strip_accents_ = jph.get<bool>("strip_accents");
-        suffix_indicator_ = jph.get("suffix_indicator");
         LoadVocabFile();
-        if (do_basic_tokenize_) {
-            basic_tokenizer_ =
-                std::make_shared<BasicTokenizer>(do_lower_case_, do_basic_tokenize_, strip_accents_, true, true);
-        }
         wordpiece_tokenizer_ = std::make_shared<WordpieceTokenizer>(vocab_file_, cls_token_, sep_token_, unk_token_,
                                                                     pad_token_, mask_token_, suffix_indicator_);
-    } else {
-        PYIS_THROW(fmt_str("BertTokenizer v{} is incompatible with the runtime", version).c_str());
+        return;
     }
+
+    // map the snapshot in place when the storage keeps it on the local file system, and share it with the wordpiece
+    // tokenizer
+    std::string snapshot_file = jph.get_file("vocab_snapshot");
+    std::string snapshot_path = fs.local_path(snapshot_file);
+    vocab_map_.clear();
+    vocab_map_reverse_.clear();
+    vocab_snapshot_ = snapshot_path.empty() ? VocabSnapshot::Read(*fs.open_istream(snapshot_file))
+                                            : VocabSnapshot::Open(snapshot_path);
+    wordpiece_tokenizer_ = std::make_shared<WordpieceTokenizer>(vocab_snapshot_, cls_token_, sep_token_, unk_token_,
+                                                                pad_token_, mask_token_, suffix_indicator_);
 }
 
 std::string BertTokenizer::Decode(const std::vector<int64_t>& code, bool skip_special_tokens,
@@ -112,5 +147,50 @@ std::string BertTokenizer::Decode(const std::vector<int64_t>& code, bool skip_sp
     return text;
 }
 
+// Joins the tokens with spaces and the pieces starting with the suffix indicator to the token before them, the same
+// as Decode.
+class BertTokenizer::Decoder : public IncrementalDecoder {
+  public:
+    Decoder(BertTokenizer& tokenizer, bool skip_special_tokens, bool clean_up_tokenization_spaces)
+        : IncrementalDecoder(clean_up_tokenization_spaces),
+          tokenizer_(tokenizer),
+          skip_special_tokens_(skip_special_tokens),
+          special_tokens_({tokenizer.unk_token_, tokenizer.pad_token_, tokenizer.cls_token_, tokenizer.mask_token_,
+                           tokenizer.sep_token_}) {}
+
+  protected:
+    void AppendText(int64_t id, std::string& text) override {
+        std::string token = tokenizer_.ConvertIdToToken(id);
+        if (skip_special_tokens_ && special_tokens_.count(token) != 0U) {
+            return;
+        }
+        const std::string& suffix_indicator = tokenizer_.suffix_indicator_;
+        if (has_text_ && token.length() > suffix_indicator.length() &&
+            token.compare(0, suffix_indicator.length(), suffix_indicator) == 0) {
+            text.append(token, suffix_indicator.length(), std::string::npos);
+            return;
+        }
+        if (has_text_) {
+            text += ' ';
+        }
+        text += token;
+        has_text_ = true;
+    }
+
+    void FinishText(std::string& /*text*/) override { has_text_ = false; }
+
+  private:
+    BertTokenizer& tokenizer_;
+    bool skip_special_tokens_;
+    std::set<std::string> special_tokens_;
+    // whether a token is decoded, which the following pieces are joined to
+    bool has_text_ = false;
+};
+
+std::shared_ptr<IncrementalDecoder> BertTokenizer::CreateIncrementalDecoder(bool skip_special_tokens,
+                                                                            bool clean_up_tokenization_spaces) {
+    return std::make_shared<Decoder>(*this, skip_special_tokens, clean_up_tokenization_spaces);
+}
+
 }  // namespace ops
 }  // namespace pyis
@@ -31,6 +31,8 @@ class BertTokenizer : public Tokenizer, public CachedObject<BertTokenizer> {
                            const std::string& mask_token = "[MASK]", bool tokenize_chinese_chars = true,
                            bool strip_accents = false, const std::string& suffix_indicator = "##");
     std::vector<std::string> Tokenize(const std::string& str) override;
+    std::vector<int64_t> EncodeIdsWithOffsets(const std::string& str,
+                                              std::vector<std::pair<int64_t, int64_t>>& offsets) override;
     bool do_lower_case_;
     bool do_basic_tokenize_;
     bool tokenize_chinese_chars_;
@@ -43,6 +45,11 @@ class BertTokenizer : public Tokenizer, public CachedObject<BertTokenizer> {
     void Deserialize(const std::string& state, ModelStorage& fs);
     std::string Decode(const std::vector<int64_t>& code, bool skip_special_tokens,
                        bool clean_up_tokenization_spaces) override;
+    std::shared_ptr<IncrementalDecoder> CreateIncrementalDecoder(bool skip_special_tokens,
+                                                                 bool clean_up_tokenization_spaces) override;
+
+  private:
+    class Decoder;
 };
 
 }  // namespace ops
@@ -1,127 +1,248 @@
 #include "gpt2_tokenizer.h"
 
+#include <array>
+#include <numeric>
+
+#include "ascii_scan.h"
+
 namespace pyis {
 namespace ops {
 
+// Split text into the pre-tokens of GPT-2, same as the regular expression
+//   's|'t|'re|'ve|'m|'ll|'d| ?\p{L}+| ?\p{N}+| ?[^\s\p{L}\p{N}]+|\s+(?!\S)|\s+
+// The tokens are returned as byte ranges of the utf-8 text, which is decoded on the fly.
 class TokenWithRegularExp {
   public:
-    void Set(std::string val) { m_text_ = Ustring(val); }
+    void Set(const char* text, size_t len) {
+        text_ = reinterpret_cast<const uint8_t*>(text);
+        len_ = len;
+        pos_ = 0;
+        // a truncated sequence at the end of the text is dropped without checking its bytes, same as
+        // std::wstring_convert
+        for (size_t pos = SkipAscii<ASCII_ANY>(text_, 0, len_); pos < len_;
+             pos = SkipAscii<ASCII_ANY>(text_, pos, len_)) {
+            uint8_t c = text_[pos];
+            size_t n = c >= 0xF5 ? 1 : c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC2 ? 2 : 1;
+            if (pos + n > len_) {
+                len_ = pos;
+            }
+            pos += n;
+        }
+    }
 
-    std::pair<bool, std::string> GetNextToken() {
-        while (!m_text_.empty()) {
-            auto res = TryMatch();
-            if (res.empty()) {
-                m_text_ = Ustring(m_text_.substr(1));
+    // Return false at the end of the text, otherwise set [begin, end) to the bytes of the next token.
+    bool GetNextToken(size_t& begin, size_t& end) {
+        while (pos_ < len_) {
+            begin = pos_;
+            end = TryMatch(pos_);
+            if (end == pos_) {
+                // characters matched by none of the patterns are dropped
+                Decode(pos_, pos_);
                 continue;
             }
-            return {true, res};
+            pos_ = end;
+            return true;
         }
-        return {false, ""};
+        return false;
     }
 
   private:
-    std::string TryMatch() {
-        if ((m_text_[0] == U'\'') && (m_text_.size() > 1)) {
-            if ((m_text_[1] == U's') || (m_text_[1] == U't') || (m_text_[1] == U'm') || (m_text_[1] == U'd')) {
-                Ustring res = Ustring(m_text_.substr(0, 2));
-                m_text_ = Ustring(m_text_.substr(2));
-                return std::string(res);
-            }
-
-            if (m_text_.size() > 2) {
-                if (((m_text_[1] == U'r') && (m_text_[2] == U'e')) || ((m_text_[1] == U'v') && (m_text_[2] == U'e')) ||
-                    ((m_text_[1] == U'l') && (m_text_[2] == U'l'))) {
-                    Ustring res = Ustring(m_text_.substr(0, 3));
-                    m_text_ = Ustring(m_text_.substr(3));
-                    return std::string(res);
-                }
+    // Decode the code point at pos and set next to the position after it.
+    char32_t Decode(size_t pos, size_t& next) const {
+        uint8_t c = text_[pos];
+        size_t n = 0;
+        char32_t cp = 0;
+        if (c < 0x80) {
+            next = pos + 1;
+            return c;
+        }
+        if (c >= 0xC2 && c < 0xE0) {
+            n = 1;
+            cp = c & 0x1F;
+        } else if (c >= 0xE0 && c < 0xF0) {
+            n = 2;
+            cp = c & 0x0F;
+        } else if (c >= 0xF0 && c < 0xF5) {
+            n = 3;
+            cp = c & 0x07;
+        } else {
+            PYIS_THROW("Invalid utf-8 byte 0x%02x at %zu.", c, pos);
+        }
+        if (pos + n >= len_) {
+            PYIS_THROW("Truncated utf-8 sequence at %zu.", pos);
+        }
+        for (size_t i = 1; i <= n; ++i) {
+            uint8_t cc = text_[pos + i];
+            if ((cc & 0xC0) != 0x80) {
+                PYIS_THROW("Invalid utf-8 byte 0x%02x at %zu.", cc, pos + i);
             }
+            cp = (cp << 6) | (cc & 0x3F);
         }
+        if ((n == 2 && cp < 0x800) || (n == 3 && (cp < 0x10000 || cp > 0x10FFFF))) {
+            PYIS_THROW("Invalid utf-8 sequence at %zu.", pos);
+        }
+        next = pos + n + 1;
+        return cp;
+    }
 
-        // ?\p{L}+
-        if ((m_text_[0] == U' ') && (m_text_.size() > 1) && is_unicode_letter(m_text_[1])) {
-            size_t i = 2;
-            for (; i < m_text_.size(); ++i) {
-                if (!is_unicode_letter(m_text_[i])) break;
+    struct Category {
+        bool (*contains_)(const char32_t&);
+        // the ASCII characters of the category, which are skipped without decoding them
+        uint32_t ascii_classes_;
+    };
+
+    static bool Contains(const Category& category, char32_t c) {
+        return c < 0x80 ? (AsciiClassOf(static_cast<uint8_t>(c)) & category.ascii_classes_) != 0
+                        : category.contains_(c);
+    }
+
+    // position after the code points from pos which are in category
+    size_t SkipWhile(size_t pos, const Category& category) const {
+        while (pos < len_) {
+            switch (category.ascii_classes_) {
+                case ASCII_LETTER:
+                    pos = SkipAscii<ASCII_LETTER>(text_, pos, len_);
+                    break;
+                case ASCII_DIGIT:
+                    pos = SkipAscii<ASCII_DIGIT>(text_, pos, len_);
+                    break;
+                default:
+                    pos = SkipAscii<ASCII_OTHER>(text_, pos, len_);
+                    break;
             }
-            Ustring res = Ustring(m_text_.substr(0, i));
-            m_text_ = Ustring(m_text_.substr(i));
-            return std::string(res);
-        }
-        if (is_unicode_letter(m_text_[0])) {
-            size_t i = 1;
-            for (; i < m_text_.size(); ++i) {
-                if (!is_unicode_letter(m_text_[i])) break;
+            size_t next = 0;
+            if (pos == len_ || text_[pos] < 0x80 || !category.contains_(Decode(pos, next))) {
+                break;
             }
-            Ustring res = Ustring(m_text_.substr(0, i));
-            m_text_ = Ustring(m_text_.substr(i));
-            return std::string(res);
+            pos = next;
         }
+        return pos;
+    }
 
-        // ?\p{N}+
-        if ((m_text_[0] == U' ') && (m_text_.size() > 1) && is_unicode_number(m_text_[1])) {
-            size_t i = 2;
-            for (; i < m_text_.size(); ++i) {
-                if (!is_unicode_number(m_text_[i])) break;
+    // Return the end of the token starting at pos, or pos if there is none.
+    size_t TryMatch(size_t pos) const {
+        size_t next = 0;
+        char32_t c0 = Decode(pos, next);
+
+        if (c0 == U'\'' && next < len_) {
+            size_t next1 = 0;
+            char32_t c1 = Decode(next, next1);
+            if (c1 == U's' || c1 == U't' || c1 == U'm' || c1 == U'd') {
+                return next1;
             }
-            Ustring res = Ustring(m_text_.substr(0, i));
-            m_text_ = Ustring(m_text_.substr(i));
-            return std::string(res);
-        }
-        if (is_unicode_number(m_text_[0])) {
-            size_t i = 1;
-            for (; i < m_text_.size(); ++i) {
-                if (!is_unicode_number(m_text_[i])) break;
+            if (next1 < len_) {
+                size_t next2 = 0;
+                char32_t c2 = Decode(next1, next2);
+                if ((c1 == U'r' && c2 == U'e') || (c1 == U'v' && c2 == U'e') || (c1 == U'l' && c2 == U'l')) {
+                    return next2;
+                }
             }
-            Ustring res = Ustring(m_text_.substr(0, i));
-            m_text_ = Ustring(m_text_.substr(i));
-            return std::string(res);
         }
 
-        // ?[^\s\p{L}\p{N}]+
-        if ((m_text_[0] == U' ') && (m_text_.size() > 1) && (not_category_LNZ(m_text_[1]))) {
-            size_t i = 2;
-            for (; i < m_text_.size(); ++i) {
-                if (!not_category_LNZ(m_text_[i])) break;
+        // ?\p{L}+, ?\p{N}+ and ?[^\s\p{L}\p{N}]+
+        static const Category categories[] = {
+            {is_unicode_letter, ASCII_LETTER}, {is_unicode_number, ASCII_DIGIT}, {not_category_LNZ, ASCII_OTHER}};
+        for (const Category& category : categories) {
+            if (c0 == U' ' && next < len_) {
+                size_t next1 = 0;
+                if (Contains(category, Decode(next, next1))) {
+                    return SkipWhile(next1, category);
+                }
             }
-            Ustring res = Ustring(m_text_.substr(0, i));
-            m_text_ = Ustring(m_text_.substr(i));
-            return std::string(res);
-        }
-        if (not_category_LNZ(m_text_[0])) {
-            size_t i = 1;
-            for (; i < m_text_.size(); ++i) {
-                if (!not_category_LNZ(m_text_[i])) break;
+            if (Contains(category, c0)) {
+                return SkipWhile(next, category);
             }
-            Ustring res = Ustring(m_text_.substr(0, i));
-            m_text_ = Ustring(m_text_.substr(i));
-            return std::string(res);
         }
 
         // \s+(?!\S)|\s+
-        if ((!m_text_.empty()) && (is_unicode_seperator(m_text_[0]))) {
-            size_t i = 1;
-            for (; i < m_text_.size(); ++i) {
-                if (!is_unicode_seperator(m_text_[i])) break;
+        if (is_unicode_seperator(c0)) {
+            size_t last = pos;
+            size_t end = next;
+            while (end < len_) {
+                size_t following = 0;
+                if (!is_unicode_seperator(Decode(end, following))) {
+                    break;
+                }
+                last = end;
+                end = following;
             }
-            if ((i > 1) && (i != m_text_.size()))  //\s+(?!\S)
-            {
-                i--;
-                Ustring res = Ustring(m_text_.substr(0, i));
-                m_text_ = Ustring(m_text_.substr(i));
-                return std::string(res);
+            // leave the last space to the following token
+            if (last != pos && end != len_) {
+                return last;
             }
-            // \s+
-            Ustring res = Ustring(m_text_.substr(0, i));
-            m_text_ = Ustring(m_text_.substr(i));
-            return std::string(res);
+            return end;
         }
 
-        return "";
+        return pos;
     }
-    Ustring m_text_;
+
+    const uint8_t* text_ = nullptr;
+    size_t len_ = 0;
+    size_t pos_ = 0;
 };
 
+namespace {
+
+// the byte each character of a byte-level token stands for, -1 for the other characters. The inverse of the byte
+// encoding of Load, which maps the printable bytes to themselves and the others to 256 and above in order.
+const std::array<int16_t, 324>& byte_decoder() {
+    static const std::array<int16_t, 324> decoder = [] {
+        std::array<int16_t, 324> result;
+        result.fill(-1);
+        int index = 256;
+        for (int b = 0; b < 256; b++) {
+            bool printable = (b >= 33 && b <= 126) || (b >= 161 && b <= 172) || b >= 174;
+            result[printable ? b : index++] = static_cast<int16_t>(b);
+        }
+        return result;
+    }();
+    return decoder;
+}
+
+// Append the complete utf-8 sequences of bytes to out, with U+FFFD for each maximal invalid subsequence, and return
+// the number of bytes consumed. An incomplete sequence at the end is left for more bytes unless final is true.
+size_t append_valid_utf8(const std::string& bytes, bool final, std::string& out) {
+    const char* replacement = "\xEF\xBF\xBD";
+    size_t pos = 0;
+    while (pos < bytes.size()) {
+        auto c = static_cast<uint8_t>(bytes[pos]);
+        if (c < 0x80) {
+            out += static_cast<char>(c);
+            pos++;
+            continue;
+        }
+        if (c < 0xC2 || c > 0xF4) {
+            out += replacement;
+            pos++;
+            continue;
+        }
+
+        // number of continuation bytes, and the range of the first one which excludes overlong and surrogate forms
+        size_t n = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : 1;
+        uint8_t lo = c == 0xE0 ? 0xA0 : c == 0xF0 ? 0x90 : 0x80;
+        uint8_t hi = c == 0xED ? 0x9F : c == 0xF4 ? 0x8F : 0xBF;
+        size_t len = 1;
+        while (len <= n && pos + len < bytes.size()) {
+            auto cc = static_cast<uint8_t>(bytes[pos + len]);
+            if (cc < (len == 1 ? lo : 0x80) || cc > (len == 1 ? hi : 0xBF)) {
+                break;
+            }
+            len++;
+        }
+        if (len == n + 1) {
+            out.append(bytes, pos, len);
+        } else if (pos + len == bytes.size() && !final) {
+            break;
+        } else {
+            out += replacement;
+        }
+        pos += len;
+    }
+    return pos;
+}
+
+}  // namespace
+
 void GPT2Tokenizer::Add(std::string p_str, int p_id) {
     auto it = token_map_.find(p_str);
     if (it != token_map_.end()) {
@@ -129,82 +250,119 @@ void GPT2Tokenizer::Add(std::string p_str, int p_id) {
             PYIS_THROW("Duplicate special tokens.");
         }
     } else {
-        token_map_[p_str] = p_id;
-        token_list_.emplace_back(SpecialTokenInfo(std::move(p_str), p_id));
+        special_tokens_.Add(p_str, p_id);
+        token_map_[std::move(p_str)] = p_id;
     }
 }
 
-inline std::vector<std::string> GPT2Tokenizer::Tokenize(const std::string& input) {
-    std::vector<std::string> res;
-
+template <typename OnSpecial, typename OnIds>
+void GPT2Tokenizer::ForEachPiece(const std::string& input, OnSpecial on_special, OnIds on_ids) const {
     if (std::all_of(input.begin(), input.end(), is_unicode_space)) {
-        return res;
+        return;
     }
 
-    auto special_token_split_res = SplitBySpeicalTokens(input);
-
-    for (auto& seg_id : special_token_split_res) {
-        if (seg_id.second != -1) {
-            res.push_back(seg_id.first);
+    std::vector<SpecialTokenSplitter::Fragment> fragments;
+    special_tokens_.Split(input.data(), input.size(), fragments);
+
+    // reused by all the pre-tokens, so that only cache misses allocate
+    std::string key;
+    std::string special;
+    std::vector<int> ids;
+    for (const auto& fragment : fragments) {
+        if (fragment.id_ != -1) {
+            special.assign(input, fragment.begin_, fragment.end_ - fragment.begin_);
+            on_special(special, fragment.begin_);
             continue;
         }
 
-        auto cur_input = std::move(seg_id.first);
         TokenWithRegularExp reg;
-        reg.Set(cur_input);
-
-        while (true) {
-            auto token = reg.GetNextToken();
-            auto b = token.first;
-            auto tok = token.second;
-            if (!b) break;
-
-            std::string utf8_token = std::string(tok);
-
-            byte_list_.clear();
-            for (char& cp : utf8_token) {
-                byte_list_.push_back(byte_encoder_[static_cast<unsigned char>(cp)]);
+        reg.Set(input.data() + fragment.begin_, fragment.end_ - fragment.begin_);
+        size_t begin = 0;
+        size_t end = 0;
+        while (reg.GetNextToken(begin, end)) {
+            key.assign(input, fragment.begin_ + begin, end - begin);
+            if (!bpe_cache_.Get(key, ids)) {
+                ids.clear();
+                for (char c : key) {
+                    ids.push_back(byte_encoder_[static_cast<unsigned char>(c)]);
+                }
+                bpe(ids);
+                bpe_cache_.Put(key, ids);
             }
+            on_ids(ids, key, fragment.begin_ + begin);
+        }
+    }
+}
 
-            bpe(byte_list_);
-
-            for (auto p : byte_list_) {
+std::vector<std::string> GPT2Tokenizer::Tokenize(const std::string& input) {
+    std::vector<std::string> res;
+    ForEachPiece(
+        input, [&](const std::string& special, size_t /*offset*/) { res.push_back(special); },
+        [&](const std::vector<int>& ids, const std::string& /*pre_token*/, size_t /*offset*/) {
+            for (auto p : ids) {
                 res.push_back(ConvertIdToToken(p));
             }
-        }
-    }
+        });
     return res;
 }
 
-inline std::list<std::pair<std::string, int>> GPT2Tokenizer::SplitBySpeicalTokens(std::string input) const {
-    std::list<std::pair<std::string, int>> res;
-    res.emplace_back(std::move(input), -1);
-    for (const auto& st : token_list_) {
-        std::list<std::pair<std::string, int>> new_split_res;
-        for (auto& str : res) {
-            if (str.second != -1) {
-                new_split_res.push_back(std::move(str));
-                continue;
+std::vector<int64_t> GPT2Tokenizer::EncodeIds(const std::string& input) {
+    std::vector<int64_t> res;
+    ForEachPiece(
+        input, [&](const std::string& special, size_t /*offset*/) { res.push_back(ConvertTokenToId(special)); },
+        [&](const std::vector<int>& ids, const std::string& /*pre_token*/, size_t /*offset*/) {
+            for (auto p : ids) {
+                res.push_back(p >= 0 ? p : unk_id_);
             }
-            auto it = str.first.begin();
-            size_t search_pos = 0;
-            while (it != str.first.end()) {
-                auto search_it = std::search(it, str.first.end(), st.str_.begin(), st.str_.end());
-                if (search_it == str.first.end()) {
-                    new_split_res.emplace_back(str.first.substr(search_pos), -1);
-                    break;
-                }
-                auto prefix_len = search_it - it;
-                if (prefix_len != 0) {
-                    new_split_res.emplace_back(str.first.substr(search_pos, prefix_len), -1);
-                    search_pos += prefix_len;
+        });
+    return res;
+}
+
+std::vector<int64_t> GPT2Tokenizer::EncodeIdsWithOffsets(const std::string& input,
+                                                         std::vector<std::pair<int64_t, int64_t>>& offsets) {
+    std::vector<int64_t> res;
+    std::vector<int> merged;
+    std::vector<int> starts;
+    ForEachPiece(
+        input,
+        [&](const std::string& special, size_t offset) {
+            res.push_back(ConvertTokenToId(special));
+            offsets.emplace_back(offset, offset + special.size());
+        },
+        [&](const std::vector<int>& ids, const std::string& pre_token, size_t offset) {
+            // the length of an unknown id is lost, merge the pre-token again to know where its ids start
+            bool known = std::all_of(ids.begin(), ids.end(), [this](int p) {
+                return p >= 0 && static_cast<size_t>(p) < token_byte_lengths_.size() && token_byte_lengths_[p] > 0;
+            });
+            if (known) {
+                for (auto p : ids) {
+                    res.push_back(p);
+                    offsets.emplace_back(offset, offset + token_byte_lengths_[p]);
+                    offset += token_byte_lengths_[p];
                 }
-                new_split_res.emplace_back(str.first.substr(search_pos, st.str_.size()), st.id_);
-                it = search_it + st.str_.size();
-                search_pos += st.str_.size();
+                return;
             }
-        }
-        std::swap(new_split_res, res);
+
+            merged.clear();
+            for (char c : pre_token) {
+                merged.push_back(byte_encoder_[static_cast<unsigned char>(c)]);
+            }
+            bpe(merged, &starts);
+            for (size_t i = 0; i < merged.size(); i++) {
+                size_t end = i + 1 < merged.size() ? starts[i + 1] : pre_token.size();
+                res.push_back(merged[i] >= 0 ? merged[i] : unk_id_);
+                offsets.emplace_back(offset + starts[i], offset + end);
+            }
+        });
+    return res;
+}
+
+std::list<std::pair<std::string, int>> GPT2Tokenizer::SplitBySpeicalTokens(std::string input) const {
+    std::vector<SpecialTokenSplitter::Fragment> fragments;
+    special_tokens_.Split(input.data(), input.size(), fragments);
+    std::list<std::pair<std::string, int>> res;
+    for (const auto& fragment : fragments) {
+        res.emplace_back(input.substr(fragment.begin_, fragment.end_ - fragment.begin_), fragment.id_);
     }
     return res;
 }
@@ -213,7 +371,9 @@ inline void GPT2Tokenizer::Load(std::istream& vocab_stream, std::istream& merges
     rapidjson::Document tok_json;
     rapidjson::IStreamWrapper vocab_wrapper(vocab_stream);
     tok_json.ParseStream(vocab_wrapper);
+    vocab_snapshot_.reset();
     vocab_map_.clear();
+    bpe_map_.clear();
     for (auto ite = tok_json.MemberBegin(); ite != tok_json.MemberEnd(); ++ite) {
         vocab_map_.insert({ite->name.GetString(), ite->value.GetInt()});
     }
@@ -223,6 +383,7 @@ inline void GPT2Tokenizer::Load(std::istream& vocab_stream, std::istream& merges
         int id = static_cast<int>(vocab_map_.size());
         vocab_map_[unk_token] = id;
     }
+    unk_id_ = vocab_map_[unk_token];
 
     std::wstring_convert<std::codecvt_utf8<char32_t>, char32_t> str_convert;
     for (auto i = 33; i <= 126; ++i) {
@@ -268,17 +429,70 @@ inline void GPT2Tokenizer::Load(std::istream& vocab_stream, std::istream& merges
     }
 
     vocab_map_reverse_.clear();
+    token_byte_lengths_.clear();
     for (const auto& ite : vocab_map_) {
         vocab_map_reverse_[ite.second] = ite.first;
+        if (ite.second >= 0) {
+            if (static_cast<size_t>(ite.second) >= token_byte_lengths_.size()) {
+                token_byte_lengths_.resize(ite.second + 1, 0);
+            }
+            token_byte_lengths_[ite.second] = static_cast<int>(std::count_if(
+                ite.first.begin(), ite.first.end(), [](char c) { return (static_cast<uint8_t>(c) & 0xC0) != 0x80; }));
+        }
+    }
+    bpe_cache_.Clear();
+}
+
+void GPT2Tokenizer::Load(std::shared_ptr<VocabSnapshot> snapshot, const std::string& unk_token) {
+    if (snapshot->byte_encoder() == nullptr) {
+        PYIS_THROW("The vocab snapshot has no byte encoder for GPT2Tokenizer");
+    }
+    int64_t unk_id = snapshot->Find(unk_token);
+    if (unk_id < 0) {
+        PYIS_THROW("Unknown token %s is not in the vocab snapshot", unk_token.c_str());
+    }
+
+    vocab_map_.clear();
+    vocab_map_reverse_.clear();
+    bpe_map_.clear();
+    vocab_snapshot_ = std::move(snapshot);
+    unk_id_ = unk_id;
+    std::copy_n(vocab_snapshot_->byte_encoder(), 256, byte_encoder_);
+
+    token_byte_lengths_.assign(vocab_snapshot_->id_count(), 0);
+    for (size_t id = 0; id < token_byte_lengths_.size(); id++) {
+        const char* token = nullptr;
+        size_t len = 0;
+        if (vocab_snapshot_->Token(static_cast<int64_t>(id), token, len)) {
+            token_byte_lengths_[id] = static_cast<int>(
+                std::count_if(token, token + len, [](char c) { return (static_cast<uint8_t>(c) & 0xC0) != 0x80; }));
+        }
+    }
+    bpe_cache_.Clear();
+}
+
+void GPT2Tokenizer::SaveSnapshot(std::ostream& os) const {
+    if (vocab_snapshot_ != nullptr) {
+        vocab_snapshot_->Save(os);
+        return;
+    }
+    std::vector<VocabSnapshot::Merge> merges;
+    merges.reserve(bpe_map_.size());
+    for (const auto& item : bpe_map_) {
+        merges.push_back({item.first.first, item.first.second, item.second.id_, item.second.value_});
     }
+    // in rank order, so that the same vocab always gives the same snapshot
+    std::sort(merges.begin(), merges.end(),
+              [](const VocabSnapshot::Merge& a, const VocabSnapshot::Merge& b) { return a.rank_ < b.rank_; });
+    WriteVocabSnapshot(os, merges, byte_encoder_);
 }
 
-GPT2Tokenizer::GPT2Tokenizer() = default;
+GPT2Tokenizer::GPT2Tokenizer() : bpe_cache_(BPE_CACHE_CAPACITY) {}
 
 GPT2Tokenizer::GPT2Tokenizer(std::string vocab_file, std::string merges_file, const std::string& /*unk_token*/,
                              const std::string& /*bos_token*/, const std::string& /*eos_token*/,
                              bool /*add_prefix_space*/)
-    : Tokenizer(std::move(vocab_file)), merges_file_(std::move(merges_file)) {
+    : Tokenizer(std::move(vocab_file)), merges_file_(std::move(merges_file)), bpe_cache_(BPE_CACHE_CAPACITY) {
     LoadVocabFile();
 }
 
@@ -298,53 +512,211 @@ void GPT2Tokenizer::LoadVocabFile() {
     Load(vocab_stream, merges_stream, unk_token_);
 }
 
-void GPT2Tokenizer::bpe(std::list<int>& vals) const {
-    while (vals.size() >= 2) {
-        auto pos_it = vals.end();
-        int minval = INT_MAX;
-        int ori_id1 = 0;
-        int ori_id2 = 0;
-        int aim_id = 0;
-        for (auto it = vals.begin(); it != vals.end(); ++it) {
-            auto it2 = it;
-            ++it2;
-            if (it2 == vals.end()) break;
-            auto map_it = bpe_map_.find({*it, *it2});
-            if (map_it == bpe_map_.end()) continue;
-            if (minval > map_it->second.value_) {
-                ori_id1 = *it;
-                ori_id2 = *it2;
-                minval = map_it->second.value_;
-                pos_it = it;
-                aim_id = map_it->second.id_;
+bool GPT2Tokenizer::FindMerge(int left, int right, BpeNode& node) const {
+    if (vocab_snapshot_ != nullptr) {
+        VocabSnapshot::Merge merge;
+        if (!vocab_snapshot_->FindMerge(left, right, merge)) {
+            return false;
+        }
+        node = {merge.merged_, merge.rank_};
+        return true;
+    }
+    auto it = bpe_map_.find({left, right});
+    if (it == bpe_map_.end()) {
+        return false;
+    }
+    node = it->second;
+    return true;
+}
+
+// Merge the pairs of ids by rank, the same as applying the merges one by one to every occurrence from left to right.
+// The ids are kept in a linked list over the vector, and the candidate pairs in a heap ordered by (rank, position),
+// so each merge costs O(log n) instead of a rescan of the word. Heap entries are checked when popped, since a merge
+// invalidates the pairs overlapping with it.
+void GPT2Tokenizer::bpe(std::vector<int>& ids, std::vector<int>* starts) const {
+    if (starts != nullptr) {
+        starts->resize(ids.size());
+        std::iota(starts->begin(), starts->end(), 0);
+    }
+    if (ids.size() < 2) {
+        return;
+    }
+
+    struct Candidate {
+        int rank_;
+        int pos_;
+        int left_;
+        int right_;
+        int merged_;
+        bool operator>(const Candidate& o) const { return rank_ != o.rank_ ? rank_ > o.rank_ : pos_ > o.pos_; }
+    };
+
+    int n = static_cast<int>(ids.size());
+    std::vector<int> prev(n);
+    std::vector<int> next(n);
+    for (int i = 0; i < n; ++i) {
+        prev[i] = i - 1;
+        next[i] = i + 1;
+    }
+
+    std::vector<Candidate> heap;
+    // pairs found while merging the ones of a rank, which wait until all of them are merged
+    std::vector<Candidate> pending;
+    auto add_pair = [&](int pos, std::vector<Candidate>& candidates) {
+        if (pos < 0 || next[pos] >= n) {
+            return;
+        }
+        BpeNode node;
+        if (FindMerge(ids[pos], ids[next[pos]], node)) {
+            candidates.push_back({node.value_, pos, ids[pos], ids[next[pos]], node.id_});
+        }
+    };
+
+    heap.reserve(n);
+    for (int i = 0; i + 1 < n; ++i) {
+        add_pair(i, heap);
+    }
+    std::make_heap(heap.begin(), heap.end(), std::greater<Candidate>());
+
+    int rank = -1;
+    while (!heap.empty() || !pending.empty()) {
+        if (heap.empty() || heap.front().rank_ != rank) {
+            for (const auto& c : pending) {
+                heap.push_back(c);
+                std::push_heap(heap.begin(), heap.end(), std::greater<Candidate>());
+            }
+            pending.clear();
+            if (heap.empty()) {
+                break;
             }
         }
-        if (pos_it == vals.end()) break;
 
-        pos_it = vals.erase(pos_it);
-        *pos_it = aim_id;
-        for (++pos_it; pos_it != vals.end(); ++pos_it) {
-            if (*pos_it != ori_id1) continue;
-            auto it2 = pos_it;
-            ++it2;
-            if (it2 == vals.end()) break;
-            if (*it2 != ori_id2) continue;
-            pos_it = vals.erase(pos_it);
-            *pos_it = aim_id;
+        std::pop_heap(heap.begin(), heap.end(), std::greater<Candidate>());
+        Candidate c = heap.back();
+        heap.pop_back();
+
+        // skip pairs changed by the merges since they were pushed, next is -1 for the ids merged into their left
+        int pos = c.pos_;
+        if (next[pos] < 0 || next[pos] >= n || ids[pos] != c.left_ || ids[next[pos]] != c.right_) {
+            continue;
         }
+
+        rank = c.rank_;
+        int right = next[pos];
+        ids[pos] = c.merged_;
+        next[pos] = next[right];
+        next[right] = -1;
+        if (next[pos] < n) {
+            prev[next[pos]] = pos;
+        }
+
+        add_pair(prev[pos], pending);
+        add_pair(pos, pending);
+    }
+
+    int out = 0;
+    for (int i = 0; i < n; i = next[i]) {
+        if (starts != nullptr) {
+            (*starts)[out] = i;
+        }
+        ids[out++] = ids[i];
+    }
+    ids.resize(out);
+    if (starts != nullptr) {
+        starts->resize(out);
     }
 }
 
+// Decodes the byte-level tokens into their bytes, and returns the complete characters of them. Special tokens are
+// text rather than bytes, and end the characters before them like in transformers.
+class GPT2Tokenizer::Decoder : public IncrementalDecoder {
+  public:
+    Decoder(GPT2Tokenizer& tokenizer, bool skip_special_tokens, bool clean_up_tokenization_spaces)
+        : IncrementalDecoder(clean_up_tokenization_spaces),
+          tokenizer_(tokenizer),
+          skip_special_tokens_(skip_special_tokens),
+          special_tokens_({tokenizer.unk_token_, tokenizer.pad_token_, tokenizer.cls_token_, tokenizer.mask_token_,
+                           tokenizer.sep_token_}) {
+        for (const auto& item : tokenizer.token_map_) {
+            added_tokens_[item.second] = item.first;
+        }
+    }
+
+  protected:
+    void AppendText(int64_t id, std::string& text) override {
+        auto it = added_tokens_.find(id);
+        std::string token = it != added_tokens_.end() ? it->second : tokenizer_.ConvertIdToToken(id);
+        if (it != added_tokens_.end() || special_tokens_.count(token) != 0U) {
+            if (!skip_special_tokens_) {
+                FinishText(text);
+                text += token;
+            }
+            return;
+        }
+
+        const auto& decoder = byte_decoder();
+        for (size_t pos = 0; pos < token.size();) {
+            // vocab tokens are valid utf-8
+            auto c = static_cast<uint8_t>(token[pos]);
+            size_t len = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1;
+            char32_t cp = len == 1 ? c : c & (0x7F >> len);
+            for (size_t i = 1; i < len && pos + i < token.size(); i++) {
+                cp = (cp << 6) | (static_cast<uint8_t>(token[pos + i]) & 0x3F);
+            }
+            if (cp < decoder.size() && decoder[cp] >= 0) {
+                bytes_ += static_cast<char>(decoder[cp]);
+            } else {
+                bytes_.append(token, pos, len);
+            }
+            pos += len;
+        }
+        bytes_.erase(0, append_valid_utf8(bytes_, false, text));
+    }
+
+    void FinishText(std::string& text) override {
+        append_valid_utf8(bytes_, true, text);
+        bytes_.clear();
+    }
+
+  private:
+    GPT2Tokenizer& tokenizer_;
+    bool skip_special_tokens_;
+    std::set<std::string> special_tokens_;
+    // text of the special tokens added by Add
+    std::unordered_map<int64_t, std::string> added_tokens_;
+    // bytes of an incomplete character at the end of the tokens, at most 3
+    std::string bytes_;
+};
+
+std::string GPT2Tokenizer::Decode(const std::vector<int64_t>& code, bool skip_special_tokens,
+                                  bool clean_up_tokenization_spaces) {
+    Decoder decoder(*this, skip_special_tokens, false);
+    std::string text;
+    for (auto id : code) {
+        text += decoder.Step(id);
+    }
+    text += decoder.Flush();
+    if (clean_up_tokenization_spaces) {
+        CleanUpTokenization(text);
+    }
+    return text;
+}
+
+std::shared_ptr<IncrementalDecoder> GPT2Tokenizer::CreateIncrementalDecoder(bool skip_special_tokens,
+                                                                            bool clean_up_tokenization_spaces) {
+    return std::make_shared<Decoder>(*this, skip_special_tokens, clean_up_tokenization_spaces);
+}
+
 std::string GPT2Tokenizer::Serialize(ModelStorage& fs) {
-    std::string vocab_path = fs.uniq_file("gpt2_tokenizer", ".vocab.json");
-    std::string merges_path = fs.uniq_file("gpt2_tokenizer", ".mergex.txt");
-    fs.add_file(vocab_file_, vocab_path);
-    fs.add_file(merges_file_, merges_path);
+    // the vocab and merges are saved as a snapshot, which Deserialize maps instead of parsing them
+    std::string snapshot_file = fs.uniq_file("gpt2_tokenizer", ".vocab.bin");
+    auto os = fs.open_ostream(snapshot_file);
+    SaveSnapshot(*os);
+    os.reset();
     std::string config_file = fs.uniq_file("gpt2_tokenizer", ".config.json");
 
-    JsonPersistHelper jph(1);
-    jph.add_file("vocab_file", vocab_path);
-    jph.add_file("merges_file", merges_path);
+    JsonPersistHelper jph(2);
+    jph.add_file("vocab_snapshot", snapshot_file);
     jph.add("start_token", cls_token_);
     jph.add("end_token", sep_token_);
     jph.add("unk_token", unk_token_);
@@ -358,18 +730,27 @@ std::string GPT2Tokenizer::Serialize(ModelStorage& fs) {
 void GPT2Tokenizer::Deserialize(const std::string& state, ModelStorage& fs) {
     JsonPersistHelper jph(state, fs);
     int version = jph.version();
+    if (1 != version && 2 != version) {
+        PYIS_THROW("GPT2Tokenizer v%d is incompatible with the runtime", version);
+    }
+    cls_token_ = jph.get("start_token");
+    sep_token_ = jph.get("end_token");
+    unk_token_ = jph.get("unk_token");
+    pad_token_ = jph.get("pad_token");
+    mask_token_ = jph.get("mask_token");
     if (1 == version) {
         vocab_file_ = FileSystem::join_path({fs.root_dir(), jph.get_file("vocab_file")});
         merges_file_ = FileSystem::join_path({fs.root_dir(), jph.get_file("merges_file")});
-        cls_token_ = jph.get("start_token");
-        sep_token_ = jph.get("end_token");
-        unk_token_ = jph.get("unk_token");
-        pad_token_ = jph.get("pad_token");
-        mask_token_ = jph.get("mask_token");
         LoadVocabFile();
-    } else {
-        PYIS_THROW(fmt_str("BertTokenizer v{} is incompatible with the runtime", version).c_str());
+        return;
     }
+
+    // map the snapshot in place when the storage keeps it on the local file system
+    std::string snapshot_file = jph.get_file("vocab_snapshot");
+    std::string snapshot_path = fs.local_path(snapshot_file);
+    Load(snapshot_path.empty() ? VocabSnapshot::Read(*fs.open_istream(snapshot_file))
+                               : VocabSnapshot::Open(snapshot_path),
+         unk_token_);
 }
 
 }  // namespace ops
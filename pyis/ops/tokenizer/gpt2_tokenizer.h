@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <climits>
 #include <functional>
 #include <iostream>
@@ -8,12 +9,14 @@
 #include "pyis/share/exception.h"
 #include "pyis/share/file_system.h"
 #include "pyis/share/json_persist_helper.h"
+#include "pyis/share/lru_cache.h"
 #include "pyis/share/model_storage.h"
 #include "pyis/share/model_storage_local.h"
 #include "pyis/share/ustring.h"
 #include "rapidjson/document.h"
 #include "rapidjson/istreamwrapper.h"
 #include "rapidjson/rapidjson.h"
+#include "special_token_splitter.h"
 #include "tokenizer_base.h"
 
 namespace pyis {
@@ -24,36 +27,43 @@ struct BpeNode {
     int value_;
 };
 
-struct SpecialTokenInfo {
-    std::string str_;
-    int id_;
-    SpecialTokenInfo(std::string p_str, int p_id) : str_(std::move(p_str)), id_(p_id) {
-        if (str_.empty()) {
-            PYIS_THROW("Empty special token.");
-        }
-    }
-};
-
 class TokenWithRegularExp;
 
 class GPT2Tokenizer : public Tokenizer, public CachedObject<GPT2Tokenizer> {
   public:
     void Add(std::string p_str, int p_id);
     std::vector<std::string> Tokenize(const std::string& input) override;
+    std::vector<int64_t> EncodeIds(const std::string& input) override;
+    std::vector<int64_t> EncodeIdsWithOffsets(const std::string& input,
+                                              std::vector<std::pair<int64_t, int64_t>>& offsets) override;
     std::list<std::pair<std::string, int>> SplitBySpeicalTokens(std::string input) const;
     void Load(std::istream& vocab_stream, std::istream& merges_stream, const std::string& unk_token);
+    // Use the vocab, merges and byte encoder of a snapshot written by SaveSnapshot, in place
+    void Load(std::shared_ptr<VocabSnapshot> snapshot, const std::string& unk_token);
+    void SaveSnapshot(std::ostream& os) const;
     GPT2Tokenizer();
     GPT2Tokenizer(std::string vocab_file, std::string merges_file, const std::string& unk_token = "<|endoftext|>",
                   const std::string& bos_token = "<|endoftext|>", const std::string& eos_token = "<|endoftext|>",
                   bool add_prefix_space = false);
 
+    // Decode the bytes of the tokens as utf-8, with U+FFFD for invalid sequences
+    std::string Decode(const std::vector<int64_t>& code, bool skip_special_tokens,
+                       bool clean_up_tokenization_spaces) override;
+    std::shared_ptr<IncrementalDecoder> CreateIncrementalDecoder(bool skip_special_tokens,
+                                                                 bool clean_up_tokenization_spaces) override;
+
     std::vector<int64_t> AddSpecialToken(const std::vector<int64_t>& code) override;
     std::vector<int64_t> AddSpecialToken(const std::vector<int64_t>& ids1, const std::vector<int64_t>& ids2) override;
 
     std::string Serialize(ModelStorage& fs);
     void Deserialize(const std::string& state, ModelStorage& fs);
 
+    // number of pre-tokens whose bpe results are cached
+    static const size_t BPE_CACHE_CAPACITY = 10000;
+
   private:
+    class Decoder;
+
     struct HashPair {
         template <class T1, class T2>
         size_t operator()(const std::pair<T1, T2>& p) const {
@@ -63,15 +73,27 @@ class GPT2Tokenizer : public Tokenizer, public CachedObject<GPT2Tokenizer> {
         }
     };
 
-    std::list<int> byte_list_;
-    std::list<SpecialTokenInfo> token_list_;
     std::unordered_map<std::string, int> token_map_;
+    SpecialTokenSplitter special_tokens_;
     std::unordered_map<std::pair<int, int>, BpeNode, HashPair> bpe_map_;
     std::string merges_file_;
     int byte_encoder_[256] = {};
+    // id of the unknown token, for the bytes and merges missing in the vocab
+    int64_t unk_id_ = -1;
+    // number of bytes of each vocab token, which is its number of characters as bytes are encoded as characters
+    std::vector<int> token_byte_lengths_;
+    // bpe results of the pre-tokens seen recently, keyed by their utf-8 bytes
+    mutable LruCache<std::string, std::vector<int>> bpe_cache_;
 
     void LoadVocabFile() override;
-    void bpe(std::list<int>& vals) const;
+    // Set node to the merge of the pair of ids and return true, or return false if they are not merged
+    bool FindMerge(int left, int right, BpeNode& node) const;
+    // Merge the byte ids of a pre-token, and set starts to the byte where each merged id starts if it is not null.
+    void bpe(std::vector<int>& ids, std::vector<int>* starts = nullptr) const;
+    // Call on_special(segment, offset) for the special tokens in input and on_ids(ids, pre_token, offset) with the bpe
+    // ids of the other pre-tokens, in order. offset is where the segment or the pre-token starts in input.
+    template <typename OnSpecial, typename OnIds>
+    void ForEachPiece(const std::string& input, OnSpecial on_special, OnIds on_ids) const;
 };
 
 }  // namespace ops
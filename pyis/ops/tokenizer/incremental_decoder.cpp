@@ -0,0 +1,81 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include "incremental_decoder.h"
+
+#include <algorithm>
+#include <cstddef>
+
+#include "pyis/share/str_utils.h"
+
+namespace pyis {
+namespace ops {
+
+void clean_up_tokenization(std::string& str) {
+    replace_all(str, " .", ".");
+    replace_all(str, " ?", "?");
+    replace_all(str, " !", "!");
+    replace_all(str, " ,", ",");
+    replace_all(str, " ' ", "'");
+    replace_all(str, " n't", "n't");
+    replace_all(str, " 'm", "'m");
+    replace_all(str, " 's", "'s");
+    replace_all(str, " 've", "'ve");
+    replace_all(str, " 're", "'re");
+}
+
+IncrementalDecoder::IncrementalDecoder(bool clean_up_tokenization_spaces)
+    : clean_up_tokenization_spaces_(clean_up_tokenization_spaces) {}
+
+std::string IncrementalDecoder::Step(int64_t id) {
+    size_t checked = pending_.size();
+    AppendText(id, pending_);
+    std::string text;
+    if (!clean_up_tokenization_spaces_) {
+        text.swap(pending_);
+        return text;
+    }
+
+    // Every clean up pattern starts with a space, is at most 4 bytes long, and only removes spaces. The text is
+    // cleaned up the same in pieces if it is split where no match can cross:
+    //  - after 3 bytes without a space, which the space of a match before them cannot reach;
+    //  - before a space which is not after another space, the start of " ' ", or the start of " n't" which " ' t"
+    //    becomes.
+    // Whether a position is a split only depends on the text before it, so the positions up to the end of the text of
+    // the last step were not, except the end itself before a space, and only the appended text is scanned.
+    auto can_split = [this](size_t pos) {
+        if (pos == 0 || (pos < pending_.size() && (static_cast<uint8_t>(pending_[pos]) & 0xC0) == 0x80)) {
+            return false;
+        }
+        auto end = pending_.begin() + static_cast<std::ptrdiff_t>(pos);
+        if (std::find(end - static_cast<std::ptrdiff_t>(std::min<size_t>(pos, 3)), end, ' ') == end) {
+            return true;
+        }
+        return pos < pending_.size() && pending_[pos] == ' ' && pending_[pos - 1] != ' ' &&
+               (pos < 2 || (pending_.compare(pos - 2, 2, " '") != 0 && pending_.compare(pos - 2, 2, " n") != 0));
+    };
+    size_t split = pending_.size();
+    while (split > checked && !can_split(split)) {
+        split--;
+    }
+    if (!can_split(split)) {
+        return text;
+    }
+    text = pending_.substr(0, split);
+    pending_.erase(0, split);
+    clean_up_tokenization(text);
+    return text;
+}
+
+std::string IncrementalDecoder::Flush() {
+    FinishText(pending_);
+    std::string text;
+    text.swap(pending_);
+    if (clean_up_tokenization_spaces_) {
+        clean_up_tokenization(text);
+    }
+    return text;
+}
+
+}  // namespace ops
+}  // namespace pyis
@@ -0,0 +1,41 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace pyis {
+namespace ops {
+
+// Remove the spaces of the joined tokens before punctuation and English contractions
+void clean_up_tokenization(std::string& str);
+
+// Decode the ids of a stream, e.g. the output of a generation model, one at a time. What Step and Flush return adds
+// up to the Decode of all the ids, and Step only holds back the text the following ids may still change, so each id
+// costs O(1) amortized instead of decoding the stream again.
+class IncrementalDecoder {
+  public:
+    explicit IncrementalDecoder(bool clean_up_tokenization_spaces);
+    virtual ~IncrementalDecoder() = default;
+    // Decode one more id, and return the text which is final
+    std::string Step(int64_t id);
+    // Return the text held back, and start a new stream
+    std::string Flush();
+
+  protected:
+    // Append the text of id to text, as Decode joins it to the ids before it
+    virtual void AppendText(int64_t id, std::string& text) = 0;
+    // Append the text held back by AppendText, e.g. an incomplete utf-8 sequence, and forget the ids decoded so far
+    virtual void FinishText(std::string& text) = 0;
+
+  private:
+    bool clean_up_tokenization_spaces_;
+    // decoded text which is not returned yet, since clean up may still remove spaces from it: at most the text from
+    // the last space on, unless the spaces before it are close together
+    std::string pending_;
+};
+
+}  // namespace ops
+}  // namespace pyis
@@ -0,0 +1,131 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include "special_token_splitter.h"
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <queue>
+#include <utility>
+
+namespace pyis {
+namespace ops {
+
+void SpecialTokenSplitter::Add(std::string token, int id) {
+    tokens_.emplace_back(std::move(token), id);
+    Build();
+}
+
+void SpecialTokenSplitter::Build() {
+    byte_classes_.fill(0);
+    class_count_ = 1;
+    for (const auto& token : tokens_) {
+        for (char c : token.str_) {
+            auto& byte_class = byte_classes_[static_cast<uint8_t>(c)];
+            if (byte_class == 0) {
+                byte_class = static_cast<uint16_t>(class_count_++);
+            }
+        }
+    }
+
+    // trie of the tokens, -1 for missing edges
+    next_.assign(class_count_, -1);
+    output_.assign(1, -1);
+    for (size_t i = 0; i < tokens_.size(); i++) {
+        int32_t state = 0;
+        for (char c : tokens_[i].str_) {
+            size_t edge = state * class_count_ + byte_classes_[static_cast<uint8_t>(c)];
+            if (next_[edge] < 0) {
+                next_[edge] = static_cast<int32_t>(output_.size());
+                output_.push_back(-1);
+                next_.resize(next_.size() + class_count_, -1);
+            }
+            state = next_[edge];
+        }
+        // a token added again keeps its first position
+        if (output_[state] < 0) {
+            output_[state] = static_cast<int32_t>(i);
+        }
+    }
+
+    // turn the trie into the automaton breadth first, filling the missing edges from the suffix links
+    std::vector<int32_t> fail(output_.size(), 0);
+    output_link_.assign(output_.size(), -1);
+    std::queue<int32_t> states;
+    for (size_t c = 0; c < class_count_; c++) {
+        if (next_[c] < 0) {
+            next_[c] = 0;
+        } else {
+            states.push(next_[c]);
+        }
+    }
+    while (!states.empty()) {
+        int32_t state = states.front();
+        states.pop();
+        for (size_t c = 0; c < class_count_; c++) {
+            int32_t& target = next_[state * class_count_ + c];
+            int32_t fallback = next_[fail[state] * class_count_ + c];
+            if (target < 0) {
+                target = fallback;
+                continue;
+            }
+            fail[target] = fallback;
+            output_link_[target] = output_[fallback] >= 0 ? fallback : output_link_[fallback];
+            states.push(target);
+        }
+    }
+}
+
+void SpecialTokenSplitter::Split(const char* text, size_t len, std::vector<Fragment>& fragments) const {
+    fragments.clear();
+
+    // (token index, begin) of every occurrence of every token
+    std::vector<std::pair<int32_t, size_t>> occurrences;
+    if (!tokens_.empty()) {
+        int32_t state = 0;
+        for (size_t i = 0; i < len; i++) {
+            state = next_[state * class_count_ + byte_classes_[static_cast<uint8_t>(text[i])]];
+            for (int32_t s = output_[state] >= 0 ? state : output_link_[state]; s >= 0; s = output_link_[s]) {
+                occurrences.emplace_back(output_[s], i + 1 - tokens_[output_[s]].str_.size());
+            }
+        }
+    }
+
+    // accept the occurrences of a token in order if they do not overlap the ones accepted before
+    std::map<size_t, std::pair<size_t, int>> accepted;
+    std::sort(occurrences.begin(), occurrences.end());
+    size_t last_end = 0;
+    for (size_t i = 0; i < occurrences.size(); i++) {
+        int32_t index = occurrences[i].first;
+        size_t begin = occurrences[i].second;
+        size_t end = begin + tokens_[index].str_.size();
+        if (i > 0 && index != occurrences[i - 1].first) {
+            last_end = 0;
+        }
+        if (begin < last_end) {
+            continue;
+        }
+        auto it = accepted.lower_bound(end);
+        if (it != accepted.begin() && std::prev(it)->second.first > begin) {
+            continue;
+        }
+        accepted.emplace_hint(it, begin, std::make_pair(end, tokens_[index].id_));
+        last_end = end;
+    }
+
+    size_t pos = 0;
+    for (const auto& item : accepted) {
+        if (item.first > pos) {
+            fragments.push_back({pos, item.first, -1});
+        }
+        fragments.push_back({item.first, item.second.first, item.second.second});
+        pos = item.second.first;
+    }
+    if (pos < len) {
+        fragments.push_back({pos, len, -1});
+    }
+}
+
+}  // namespace ops
+}  // namespace pyis
@@ -0,0 +1,63 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "pyis/share/exception.h"
+
+namespace pyis {
+namespace ops {
+
+struct SpecialTokenInfo {
+    std::string str_;
+    int id_;
+    SpecialTokenInfo(std::string p_str, int p_id) : str_(std::move(p_str)), id_(p_id) {
+        if (str_.empty()) {
+            PYIS_THROW("Empty special token.");
+        }
+    }
+};
+
+// Splits text into special tokens and the fragments between them. The special tokens are compiled into an
+// Aho-Corasick automaton as they are added, so the text is scanned once whatever their number.
+// Tokens added first take precedence: the occurrences of each token are the leftmost non overlapping ones in the
+// fragments left by the tokens added before it, same as splitting the text by one token after another.
+class SpecialTokenSplitter {
+  public:
+    // [begin_, end_) bytes of the text, id_ is the id of the special token or -1 for the text between them
+    struct Fragment {
+        size_t begin_;
+        size_t end_;
+        int id_;
+    };
+
+    void Add(std::string token, int id);
+    size_t size() const { return tokens_.size(); }
+
+    // Set fragments to the special tokens and non empty fragments of text[0, len), in order.
+    void Split(const char* text, size_t len, std::vector<Fragment>& fragments) const;
+
+  private:
+    void Build();
+
+    std::vector<SpecialTokenInfo> tokens_;
+    // bytes which do not appear in any token share the class 0
+    std::array<uint16_t, 256> byte_classes_{};
+    size_t class_count_ = 1;
+    // transitions of the automaton, next_[state * class_count_ + class], 0 is the initial state
+    std::vector<int32_t> next_;
+    // index in tokens_ of the token ending at a state, or -1
+    std::vector<int32_t> output_;
+    // closest state on the suffix link chain with an output, or -1
+    std::vector<int32_t> output_link_;
+};
+
+}  // namespace ops
+}  // namespace pyis
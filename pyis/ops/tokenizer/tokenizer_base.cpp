@@ -3,6 +3,9 @@
 
 #include "tokenizer_base.h"
 
+#include <algorithm>
+#include <limits>
+
 #include <pyis/share/str_utils.h>
 
 namespace pyis {
@@ -72,13 +75,23 @@ void Tokenizer::Truncate(std::vector<int64_t>& input1, std::vector<int64_t>& inp
     PYIS_THROW("Unknown truncation strategy %s", truncate_strategy.c_str());
 }
 
-std::vector<int64_t> Tokenizer::Encode(const std::string& str, int64_t max_length) {
+std::vector<int64_t> Tokenizer::EncodeIds(const std::string& str) {
     std::vector<std::string> tokenized_result = Tokenize(str);
     std::vector<std::int64_t> encoded_result;
     encoded_result.resize(tokenized_result.size());
     for (size_t i = 0; i < tokenized_result.size(); i++) {
         encoded_result[i] = ConvertTokenToId(tokenized_result[i]);
     }
+    return encoded_result;
+}
+
+std::vector<int64_t> Tokenizer::EncodeIdsWithOffsets(const std::string& /*str*/,
+                                                     std::vector<std::pair<int64_t, int64_t>>& /*offsets*/) {
+    PYIS_THROW("Offset mapping is not supported by this tokenizer");
+}
+
+std::vector<int64_t> Tokenizer::Encode(const std::string& str, int64_t max_length) {
+    std::vector<std::int64_t> encoded_result = EncodeIds(str);
     Truncate(encoded_result, max_length);
     return AddSpecialToken(encoded_result);
 }
@@ -122,6 +135,73 @@ std::vector<std::tuple<int64_t, int64_t, int64_t>> Tokenizer::EncodePlus(const s
     return result;
 }
 
+BatchEncoding Tokenizer::EncodeBatch(const std::vector<std::string>& strs, int64_t max_length,
+                                     const std::string& padding) {
+    if (padding != "longest" && padding != "max_length") {
+        PYIS_THROW("Unknown padding strategy %s", padding.c_str());
+    }
+    if (padding == "max_length" && (max_length < 0 || max_length >= static_cast<int64_t>(1e15))) {
+        PYIS_THROW("Padding to max_length needs a max_length, got %lld", static_cast<long long>(max_length));
+    }
+
+    std::vector<std::vector<int64_t>> codes(strs.size());
+    std::shared_ptr<ThreadPool> pool = std::atomic_load(&thread_pool_);
+    if (pool == nullptr) {
+        pool = ThreadPool::Default();
+    }
+    pool->ParallelFor(strs.size(), [&](size_t i) { codes[i] = Encode(strs[i], max_length); });
+
+    BatchEncoding result;
+    result.batch_size_ = static_cast<int64_t>(strs.size());
+    if (padding == "max_length") {
+        result.sequence_length_ = static_cast<int64_t>(AddSpecialToken(std::vector<int64_t>()).size()) + max_length;
+    }
+    for (const auto& code : codes) {
+        result.sequence_length_ = std::max(result.sequence_length_, static_cast<int64_t>(code.size()));
+    }
+
+    int64_t pad_id = std::max<int64_t>(ConvertTokenToId(pad_token_), 0);
+    auto total = static_cast<size_t>(result.batch_size_ * result.sequence_length_);
+    result.input_ids_.assign(total, pad_id);
+    result.attention_mask_.assign(total, 0);
+    result.token_type_ids_.assign(total, 0);
+    for (size_t i = 0; i < codes.size(); i++) {
+        size_t row = i * result.sequence_length_;
+        std::copy(codes[i].begin(), codes[i].end(), result.input_ids_.begin() + row);
+        std::fill_n(result.attention_mask_.begin() + row, codes[i].size(), 1);
+    }
+    return result;
+}
+
+void Tokenizer::SetThreadNum(size_t thread_num) {
+    std::atomic_store(&thread_pool_, std::make_shared<ThreadPool>(thread_num));
+}
+
+std::vector<std::tuple<int64_t, int64_t, int64_t>> Tokenizer::EncodePlus(
+    const std::string& str, int64_t max_length, std::vector<std::pair<int64_t, int64_t>>& offset_mapping) {
+    std::vector<std::pair<int64_t, int64_t>> offsets;
+    std::vector<int64_t> ids = EncodeIdsWithOffsets(str, offsets);
+    Truncate(ids, max_length);
+    offsets.resize(ids.size());
+
+    // find where AddSpecialToken puts the ids, with an id no vocab has
+    const int64_t placeholder = std::numeric_limits<int64_t>::min();
+    auto special_tokens = AddSpecialToken(std::vector<int64_t>{placeholder});
+    auto prefix_len = std::find(special_tokens.begin(), special_tokens.end(), placeholder) - special_tokens.begin();
+
+    auto input_ids = AddSpecialToken(ids);
+    auto type_id = GenerateTypeId(ids);
+    offset_mapping.assign(input_ids.size(), std::make_pair(0, 0));
+    std::copy(offsets.begin(), offsets.end(), offset_mapping.begin() + prefix_len);
+
+    std::vector<std::tuple<int64_t, int64_t, int64_t>> result;
+    result.resize(input_ids.size());
+    for (size_t i = 0; i < result.size(); i++) {
+        result[i] = std::make_tuple(input_ids[i], type_id[i], 1);
+    }
+    return result;
+}
+
 std::string Tokenizer::Decode(const std::vector<int64_t>& code, bool skip_special_tokens,
                               bool clean_up_tokenization_spaces) {
     std::set<std::string> special_tokens({unk_token_, pad_token_, cls_token_, mask_token_, sep_token_});
@@ -140,6 +220,11 @@ std::string Tokenizer::Decode(const std::vector<int64_t>& code, bool skip_specia
 }
 
 std::string Tokenizer::ConvertIdToToken(int64_t id) {
+    if (vocab_snapshot_ != nullptr) {
+        const char* token = nullptr;
+        size_t len = 0;
+        return vocab_snapshot_->Token(id, token, len) ? std::string(token, len) : unk_token_;
+    }
     auto worditer = vocab_map_reverse_.find(id);
     if (worditer != vocab_map_reverse_.end()) {
         return worditer->second;
@@ -148,6 +233,9 @@ std::string Tokenizer::ConvertIdToToken(int64_t id) {
 }
 
 int64_t Tokenizer::ConvertTokenToId(const std::string& str) {
+    if (vocab_snapshot_ != nullptr) {
+        return vocab_snapshot_->Find(str);
+    }
     auto worditer = vocab_map_.find(str);
     if (worditer != vocab_map_.end()) {
         return worditer->second;
@@ -187,11 +275,33 @@ std::vector<int64_t> Tokenizer::GenerateTypeId(const std::vector<int64_t>& ids1,
     return result;
 }
 
-inline std::map<std::string, int64_t> Tokenizer::GetVocab() {
-    return std::map<std::string, int64_t>(vocab_map_.begin(), vocab_map_.end());
+std::map<std::string, int64_t> Tokenizer::GetVocab() {
+    std::map<std::string, int64_t> vocab;
+    ForEachToken([&vocab](const std::string& token, int64_t id) { vocab.emplace(token, id); });
+    return vocab;
+}
+
+void Tokenizer::WriteVocabSnapshot(std::ostream& os, const std::vector<VocabSnapshot::Merge>& merges,
+                                   const int* byte_encoder) const {
+    std::vector<std::string> tokens;
+    ForEachToken([&tokens](const std::string& token, int64_t id) {
+        if (id < 0) {
+            PYIS_THROW("Token %s has a negative id %lld", token.c_str(), static_cast<long long>(id));
+        }
+        if (static_cast<size_t>(id) >= tokens.size()) {
+            tokens.resize(id + 1);
+        }
+        if (!tokens[id].empty()) {
+            PYIS_THROW("Tokens %s and %s have the same id %lld", tokens[id].c_str(), token.c_str(),
+                       static_cast<long long>(id));
+        }
+        tokens[id] = token;
+    });
+    VocabSnapshot::Write(os, tokens, merges, byte_encoder);
 }
 
 void Tokenizer::LoadVocabFile() {
+    vocab_snapshot_.reset();
     auto file = std::ifstream(vocab_file_);
     std::string line;
     int64_t index = 0;
@@ -209,17 +319,11 @@ void Tokenizer::LoadVocabFile() {
     }
 }
 
-void Tokenizer::CleanUpTokenization(std::string& str) {
-    replace_all(str, " .", ".");
-    replace_all(str, " ?", "?");
-    replace_all(str, " !", "!");
-    replace_all(str, " ,", ",");
-    replace_all(str, " ' ", "'");
-    replace_all(str, " n't", "n't");
-    replace_all(str, " 'm", "'m");
-    replace_all(str, " 's", "'s");
-    replace_all(str, " 've", "'ve");
-    replace_all(str, " 're", "'re");
+void Tokenizer::CleanUpTokenization(std::string& str) { clean_up_tokenization(str); }
+
+std::shared_ptr<IncrementalDecoder> Tokenizer::CreateIncrementalDecoder(bool /*skip_special_tokens*/,
+                                                                        bool /*clean_up_tokenization_spaces*/) {
+    PYIS_THROW("Incremental decoding is not supported by this tokenizer");
 }
 
 }  // namespace ops
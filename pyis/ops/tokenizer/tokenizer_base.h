@@ -6,17 +6,30 @@
 #include <codecvt>
 #include <fstream>
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <tuple>
 #include <unordered_map>
 #include <vector>
 
+#include "pyis/ops/tokenizer/incremental_decoder.h"
+#include "pyis/ops/tokenizer/vocab_snapshot.h"
 #include "pyis/share/exception.h"
+#include "pyis/share/thread_pool.h"
 
 namespace pyis {
 namespace ops {
 
+// ids of a batch of sequences padded to the same length, as row-major [batch_size_, sequence_length_] buffers
+struct BatchEncoding {
+    int64_t batch_size_ = 0;
+    int64_t sequence_length_ = 0;
+    std::vector<int64_t> input_ids_;
+    std::vector<int64_t> attention_mask_;
+    std::vector<int64_t> token_type_ids_;
+};
+
 class Tokenizer {
   public:
     Tokenizer() = default;
@@ -34,9 +47,30 @@ class Tokenizer {
     std::vector<std::tuple<int64_t, int64_t, int64_t>> EncodePlus(
         const std::string& str1, const std::string& str2, int64_t max_length = 1e15,
         const std::string& truncation_strategy = "longest_first");
+    // EncodePlus, and set offset_mapping to the [begin, end) bytes in str of each token, (0, 0) for special tokens
+    std::vector<std::tuple<int64_t, int64_t, int64_t>> EncodePlus(
+        const std::string& str, int64_t max_length, std::vector<std::pair<int64_t, int64_t>>& offset_mapping);
+    // Encode the strings in parallel. padding is "longest" to pad them to the longest of the batch, or "max_length"
+    // to pad them to the longest Encode may return for max_length. Padding has the id of the pad token, or 0 if it is
+    // not in the vocab.
+    BatchEncoding EncodeBatch(const std::vector<std::string>& strs, int64_t max_length = 1e15,
+                              const std::string& padding = "longest");
+    // Run EncodeBatch on thread_num threads, 0 for one per core. The calls of EncodeBatch already running keep their
+    // pool.
+    void SetThreadNum(size_t thread_num);
     virtual std::vector<std::string> Tokenize(const std::string& str) = 0;
+    // ids of the tokens of str, without special tokens or truncation
+    virtual std::vector<int64_t> EncodeIds(const std::string& str);
+    // EncodeIds, and append the [begin, end) bytes in str of each token to offsets. Throws if the tokenizer does not
+    // track offsets.
+    virtual std::vector<int64_t> EncodeIdsWithOffsets(const std::string& str,
+                                                      std::vector<std::pair<int64_t, int64_t>>& offsets);
     virtual std::string Decode(const std::vector<int64_t>& code, bool skip_special_tokens,
                                bool clean_up_tokenization_spaces);
+    // Decoder of a stream of ids, which returns the text of Decode piece by piece. The decoder refers to the
+    // tokenizer, which must outlive it. Throws if the tokenizer does not support it.
+    virtual std::shared_ptr<IncrementalDecoder> CreateIncrementalDecoder(bool skip_special_tokens,
+                                                                         bool clean_up_tokenization_spaces);
     std::string ConvertIdToToken(int64_t id);
     int64_t ConvertTokenToId(const std::string& str);
     virtual std::vector<int64_t> AddSpecialToken(const std::vector<int64_t>& code);
@@ -48,6 +82,12 @@ class Tokenizer {
   protected:
     virtual void LoadVocabFile();
     void CleanUpTokenization(std::string& str);
+    // Call fn(token, id) for each token of the vocab, from the snapshot if there is one
+    template <typename Fn>
+    void ForEachToken(Fn fn) const;
+    // Write a snapshot of the vocab, with the merges and byte encoder of byte-level BPE tokenizers
+    void WriteVocabSnapshot(std::ostream& os, const std::vector<VocabSnapshot::Merge>& merges = {},
+                            const int* byte_encoder = nullptr) const;
     std::string cls_token_;
     std::string sep_token_;
     std::string unk_token_;
@@ -57,6 +97,29 @@ class Tokenizer {
     std::string vocab_file_;
     std::unordered_map<std::string, int64_t> vocab_map_;
     std::unordered_map<int64_t, std::string> vocab_map_reverse_;
+    // the vocab in place of vocab_map_ and vocab_map_reverse_, when it is loaded from a snapshot
+    std::shared_ptr<VocabSnapshot> vocab_snapshot_;
+    // pool of EncodeBatch, ThreadPool::Default() if null. Only accessed with std::atomic_load and std::atomic_store,
+    // as EncodeBatch runs without the GIL.
+    std::shared_ptr<ThreadPool> thread_pool_;
 };
+
+template <typename Fn>
+void Tokenizer::ForEachToken(Fn fn) const {
+    if (vocab_snapshot_ == nullptr) {
+        for (const auto& item : vocab_map_) {
+            fn(item.first, item.second);
+        }
+        return;
+    }
+    for (size_t id = 0; id < vocab_snapshot_->id_count(); id++) {
+        const char* token = nullptr;
+        size_t len = 0;
+        if (vocab_snapshot_->Token(static_cast<int64_t>(id), token, len)) {
+            fn(std::string(token, len), static_cast<int64_t>(id));
+        }
+    }
+}
+
 }  // namespace ops
 }  // namespace pyis
\ No newline at end of file
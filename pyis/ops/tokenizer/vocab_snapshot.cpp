@@ -0,0 +1,281 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include "vocab_snapshot.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "pyis/share/exception.h"
+#include "pyis/share/hardware_utils.h"
+
+namespace pyis {
+namespace ops {
+
+namespace {
+
+// header of the snapshot format, followed by the sections at 8 bytes aligned offsets. Integers are stored little
+// endian.
+struct VocabSnapshotHeader {
+    char magic_[8];
+    uint32_t version_;
+    uint32_t id_count_;
+    uint32_t token_slots_;
+    uint32_t merge_slots_;
+    uint32_t has_byte_encoder_;
+    uint32_t reserved_;
+    uint64_t pool_size_;
+    // uint32_t[id_count_ + 1], token i is pool[offsets[i], offsets[i + 1])
+    uint64_t offsets_offset_;
+    uint64_t pool_offset_;
+    // uint32_t[token_slots_], id + 1 of the token hashed to the slot, 0 for the empty slots
+    uint64_t token_index_offset_;
+    // Merge[merge_slots_]
+    uint64_t merges_offset_;
+    // int32_t[256]
+    uint64_t byte_encoder_offset_;
+};
+
+const char VOCAB_SNAPSHOT_MAGIC[8] = {'P', 'Y', 'I', 'S', 'V', 'O', 'C', 'B'};
+const uint32_t VOCAB_SNAPSHOT_VERSION = 1;
+
+// FNV-1a, which is stable across platforms and runs
+uint64_t hash_token(const char* token, size_t len) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ static_cast<uint8_t>(token[i])) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+uint64_t hash_pair(int32_t left, int32_t right) {
+    uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(left)) << 32) | static_cast<uint32_t>(right);
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return key;
+}
+
+// power of 2 with at most half of the slots used
+size_t slot_count(size_t count) {
+    size_t slots = 16;
+    while (slots < count * 2) {
+        slots *= 2;
+    }
+    return slots;
+}
+
+uint64_t align(uint64_t offset) { return (offset + 7) & ~static_cast<uint64_t>(7); }
+
+void write_at(std::ostream& os, uint64_t& pos, uint64_t offset, const void* data, size_t size) {
+    static const char zeros[8] = {0};
+    os.write(zeros, static_cast<std::streamsize>(offset - pos));
+    os.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    pos = offset + size;
+}
+
+}  // namespace
+
+void VocabSnapshot::Write(std::ostream& os, const std::vector<std::string>& tokens, const std::vector<Merge>& merges,
+                          const int* byte_encoder) {
+    if (!is_little_endian()) {
+        PYIS_THROW("vocab snapshots are only supported on little endian hosts");
+    }
+
+    std::vector<uint32_t> offsets(tokens.size() + 1, 0);
+    std::string pool;
+    for (size_t i = 0; i < tokens.size(); i++) {
+        pool += tokens[i];
+        offsets[i + 1] = static_cast<uint32_t>(pool.size());
+    }
+
+    size_t token_count = 0;
+    for (const auto& token : tokens) {
+        token_count += token.empty() ? 0 : 1;
+    }
+    std::vector<uint32_t> token_index(slot_count(token_count), 0);
+    size_t token_mask = token_index.size() - 1;
+    for (size_t i = 0; i < tokens.size(); i++) {
+        if (tokens[i].empty()) {
+            continue;
+        }
+        size_t slot = hash_token(tokens[i].data(), tokens[i].size()) & token_mask;
+        while (token_index[slot] != 0) {
+            if (tokens[token_index[slot] - 1] == tokens[i]) {
+                PYIS_THROW("Token %s has both ids %u and %zu", tokens[i].c_str(), token_index[slot] - 1, i);
+            }
+            slot = (slot + 1) & token_mask;
+        }
+        token_index[slot] = static_cast<uint32_t>(i + 1);
+    }
+
+    std::vector<Merge> merge_table;
+    if (!merges.empty()) {
+        merge_table.assign(slot_count(merges.size()), Merge{0, 0, 0, -1});
+        size_t merge_mask = merge_table.size() - 1;
+        for (const auto& merge : merges) {
+            size_t slot = hash_pair(merge.left_, merge.right_) & merge_mask;
+            while (merge_table[slot].rank_ >= 0 &&
+                   (merge_table[slot].left_ != merge.left_ || merge_table[slot].right_ != merge.right_)) {
+                slot = (slot + 1) & merge_mask;
+            }
+            merge_table[slot] = merge;
+        }
+    }
+
+    VocabSnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic_, VOCAB_SNAPSHOT_MAGIC, sizeof(VOCAB_SNAPSHOT_MAGIC));
+    header.version_ = VOCAB_SNAPSHOT_VERSION;
+    header.id_count_ = static_cast<uint32_t>(tokens.size());
+    header.token_slots_ = static_cast<uint32_t>(token_index.size());
+    header.merge_slots_ = static_cast<uint32_t>(merge_table.size());
+    header.has_byte_encoder_ = byte_encoder != nullptr ? 1 : 0;
+    header.pool_size_ = pool.size();
+    header.offsets_offset_ = align(sizeof(header));
+    header.pool_offset_ = align(header.offsets_offset_ + offsets.size() * sizeof(uint32_t));
+    header.token_index_offset_ = align(header.pool_offset_ + pool.size());
+    header.merges_offset_ = align(header.token_index_offset_ + token_index.size() * sizeof(uint32_t));
+    header.byte_encoder_offset_ = align(header.merges_offset_ + merge_table.size() * sizeof(Merge));
+
+    uint64_t pos = 0;
+    write_at(os, pos, 0, &header, sizeof(header));
+    write_at(os, pos, header.offsets_offset_, offsets.data(), offsets.size() * sizeof(uint32_t));
+    write_at(os, pos, header.pool_offset_, pool.data(), pool.size());
+    write_at(os, pos, header.token_index_offset_, token_index.data(), token_index.size() * sizeof(uint32_t));
+    write_at(os, pos, header.merges_offset_, merge_table.data(), merge_table.size() * sizeof(Merge));
+    if (byte_encoder != nullptr) {
+        std::vector<int32_t> encoder(byte_encoder, byte_encoder + 256);
+        write_at(os, pos, header.byte_encoder_offset_, encoder.data(), encoder.size() * sizeof(int32_t));
+    }
+    if (!os.good()) {
+        PYIS_THROW("Failed to write the vocab snapshot");
+    }
+}
+
+std::shared_ptr<VocabSnapshot> VocabSnapshot::Open(const std::string& path) {
+    if (!MappedFile::is_supported()) {
+        std::ifstream ifs(path, std::ios::in | std::ios::binary);
+        if (!ifs.good()) {
+            PYIS_THROW("Cannot open file %s", path.c_str());
+        }
+        return Read(ifs);
+    }
+    std::shared_ptr<VocabSnapshot> snapshot(new VocabSnapshot());
+    snapshot->mapped_file_ = std::make_shared<MappedFile>(path);
+    snapshot->Initialize(snapshot->mapped_file_->data(), snapshot->mapped_file_->size());
+    return snapshot;
+}
+
+std::shared_ptr<VocabSnapshot> VocabSnapshot::Read(std::istream& is) {
+    std::string content((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+    std::shared_ptr<VocabSnapshot> snapshot(new VocabSnapshot());
+    // 8 bytes aligned, as the sections are
+    snapshot->buffer_.resize((content.size() + 7) / 8);
+    memcpy(snapshot->buffer_.data(), content.data(), content.size());
+    snapshot->Initialize(reinterpret_cast<const uint8_t*>(snapshot->buffer_.data()), content.size());
+    return snapshot;
+}
+
+void VocabSnapshot::Initialize(const uint8_t* data, size_t size) {
+    if (!is_little_endian()) {
+        PYIS_THROW("vocab snapshots are only supported on little endian hosts");
+    }
+    VocabSnapshotHeader header;
+    if (size < sizeof(header)) {
+        PYIS_THROW("vocab snapshot is truncated");
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic_, VOCAB_SNAPSHOT_MAGIC, sizeof(VOCAB_SNAPSHOT_MAGIC)) != 0) {
+        PYIS_THROW("not a vocab snapshot");
+    }
+    if (header.version_ != VOCAB_SNAPSHOT_VERSION) {
+        PYIS_THROW("vocab snapshot v%u is incompatible with the runtime", header.version_);
+    }
+    // offset + bytes may wrap around, as both come from the file
+    auto fits = [size](uint64_t offset, uint64_t bytes) {
+        return offset % 8 == 0 && offset <= size && bytes <= size - offset;
+    };
+    if (!fits(header.offsets_offset_, (header.id_count_ + 1ULL) * sizeof(uint32_t)) ||
+        !fits(header.pool_offset_, header.pool_size_) ||
+        !fits(header.token_index_offset_, header.token_slots_ * sizeof(uint32_t)) ||
+        !fits(header.merges_offset_, header.merge_slots_ * sizeof(Merge)) ||
+        (header.has_byte_encoder_ != 0 && !fits(header.byte_encoder_offset_, 256 * sizeof(int32_t))) ||
+        header.token_slots_ == 0 || (header.token_slots_ & (header.token_slots_ - 1)) != 0 ||
+        (header.merge_slots_ & (header.merge_slots_ - 1)) != 0) {
+        PYIS_THROW("vocab snapshot is corrupted");
+    }
+
+    data_ = data;
+    size_ = size;
+    id_count_ = header.id_count_;
+    offsets_ = reinterpret_cast<const uint32_t*>(data + header.offsets_offset_);
+    pool_ = reinterpret_cast<const char*>(data + header.pool_offset_);
+    token_index_ = reinterpret_cast<const uint32_t*>(data + header.token_index_offset_);
+    token_slots_ = header.token_slots_;
+    merges_ = reinterpret_cast<const Merge*>(data + header.merges_offset_);
+    merge_slots_ = header.merge_slots_;
+    byte_encoder_ =
+        header.has_byte_encoder_ != 0 ? reinterpret_cast<const int32_t*>(data + header.byte_encoder_offset_) : nullptr;
+    // lookups trust the offsets to stay within the pool, and the probes of the hash tables to reach an empty slot
+    if (offsets_[0] != 0 || offsets_[id_count_] > header.pool_size_) {
+        PYIS_THROW("vocab snapshot is corrupted");
+    }
+    for (size_t i = 0; i < id_count_; i++) {
+        if (offsets_[i] > offsets_[i + 1]) {
+            PYIS_THROW("vocab snapshot is corrupted");
+        }
+    }
+    if (std::find(token_index_, token_index_ + token_slots_, 0) == token_index_ + token_slots_ ||
+        (merge_slots_ != 0 && std::none_of(merges_, merges_ + merge_slots_,
+                                           [](const Merge& merge) { return merge.rank_ < 0; }))) {
+        PYIS_THROW("vocab snapshot is corrupted");
+    }
+}
+
+void VocabSnapshot::Save(std::ostream& os) const {
+    os.write(reinterpret_cast<const char*>(data_), static_cast<std::streamsize>(size_));
+    if (!os.good()) {
+        PYIS_THROW("Failed to write the vocab snapshot");
+    }
+}
+
+int64_t VocabSnapshot::Find(const char* token, size_t len) const {
+    size_t mask = token_slots_ - 1;
+    for (size_t slot = hash_token(token, len) & mask; token_index_[slot] != 0; slot = (slot + 1) & mask) {
+        uint32_t id = token_index_[slot] - 1;
+        if (id < id_count_ && offsets_[id + 1] - offsets_[id] == len &&
+            memcmp(pool_ + offsets_[id], token, len) == 0) {
+            return id;
+        }
+    }
+    return -1;
+}
+
+bool VocabSnapshot::Token(int64_t id, const char*& token, size_t& len) const {
+    if (id < 0 || static_cast<uint64_t>(id) >= id_count_ || offsets_[id + 1] <= offsets_[id]) {
+        return false;
+    }
+    token = pool_ + offsets_[id];
+    len = offsets_[id + 1] - offsets_[id];
+    return true;
+}
+
+bool VocabSnapshot::FindMerge(int32_t left, int32_t right, Merge& merge) const {
+    if (merge_slots_ == 0) {
+        return false;
+    }
+    size_t mask = merge_slots_ - 1;
+    for (size_t slot = hash_pair(left, right) & mask; merges_[slot].rank_ >= 0; slot = (slot + 1) & mask) {
+        if (merges_[slot].left_ == left && merges_[slot].right_ == right) {
+            merge = merges_[slot];
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace ops
+}  // namespace pyis
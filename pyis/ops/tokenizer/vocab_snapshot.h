@@ -0,0 +1,80 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "pyis/share/mapped_file.h"
+
+namespace pyis {
+namespace ops {
+
+// A tokenizer vocab, and optionally the BPE merges and byte encoder of GPT-2, in a flat binary format which is used
+// in place. Loading maps the file instead of parsing text and filling hash maps, so it takes milliseconds and the
+// pages are shared by the processes using the same file.
+// The tokens are stored by id in a string pool, looked up through an open addressing hash table of ids. The merges
+// are stored in an open addressing hash table keyed by the pair of ids they merge.
+class VocabSnapshot {
+  public:
+    struct Merge {
+        int32_t left_;
+        int32_t right_;
+        int32_t merged_;
+        // -1 for the empty slots
+        int32_t rank_;
+    };
+
+    // Write a snapshot of tokens, indexed by id with empty strings for the unused ids. merges is empty and
+    // byte_encoder null for tokenizers which do not use them.
+    static void Write(std::ostream& os, const std::vector<std::string>& tokens, const std::vector<Merge>& merges,
+                      const int* byte_encoder);
+
+    // Map the snapshot at path, or read it if files cannot be mapped on this platform.
+    static std::shared_ptr<VocabSnapshot> Open(const std::string& path);
+    static std::shared_ptr<VocabSnapshot> Read(std::istream& is);
+
+    // Write the snapshot as it was loaded.
+    void Save(std::ostream& os) const;
+
+    // number of ids, including the unused ones
+    size_t id_count() const { return id_count_; }
+    // id of the token, or -1
+    int64_t Find(const char* token, size_t len) const;
+    int64_t Find(const std::string& token) const { return Find(token.data(), token.size()); }
+    // Set token and len to the token of id and return true, or return false if id is not used.
+    bool Token(int64_t id, const char*& token, size_t& len) const;
+
+    bool has_merges() const { return merge_slots_ != 0; }
+    // Set merge to the merge of the pair and return true, or return false if the pair is not merged.
+    bool FindMerge(int32_t left, int32_t right, Merge& merge) const;
+    // byte encoder of 256 ids, or null
+    const int32_t* byte_encoder() const { return byte_encoder_; }
+
+  private:
+    VocabSnapshot() = default;
+    void Initialize(const uint8_t* data, size_t size);
+
+    std::shared_ptr<MappedFile> mapped_file_;
+    // copy of the snapshot when it is not mapped
+    std::vector<uint64_t> buffer_;
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+
+    size_t id_count_ = 0;
+    const uint32_t* offsets_ = nullptr;
+    const char* pool_ = nullptr;
+    const uint32_t* token_index_ = nullptr;
+    size_t token_slots_ = 0;
+    const Merge* merges_ = nullptr;
+    size_t merge_slots_ = 0;
+    const int32_t* byte_encoder_ = nullptr;
+};
+
+}  // namespace ops
+}  // namespace pyis
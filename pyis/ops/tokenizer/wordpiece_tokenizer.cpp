@@ -10,64 +10,146 @@ pyis::ops::WordpieceTokenizer::WordpieceTokenizer(const std::string& vocab_file,
     : Tokenizer(vocab_file, cls_token, sep_token, unk_token, pad_token, mask_token),
       word_piece_prefix_(std::move(suffix_indicator)) {
     LoadVocabFile();
+    BuildTries();
+}
+
+pyis::ops::WordpieceTokenizer::WordpieceTokenizer(std::shared_ptr<VocabSnapshot> snapshot,
+                                                  const std::string& cls_token, const std::string& sep_token,
+                                                  const std::string& unk_token, const std::string& pad_token,
+                                                  const std::string& mask_token, std::string suffix_indicator)
+    : Tokenizer("", cls_token, sep_token, unk_token, pad_token, mask_token),
+      word_piece_prefix_(std::move(suffix_indicator)) {
+    vocab_snapshot_ = std::move(snapshot);
+    BuildTries();
+}
+
+void pyis::ops::WordpieceTokenizer::SaveSnapshot(std::ostream& os) const {
+    if (vocab_snapshot_ != nullptr) {
+        vocab_snapshot_->Save(os);
+        return;
+    }
+    WriteVocabSnapshot(os);
+}
+
+void pyis::ops::WordpieceTokenizer::BuildTries() {
+    word_trie_.Reset();
+    suffix_trie_.Reset();
+    size_t prefix_len = word_piece_prefix_.size();
+    ForEachToken([&](const std::string& piece, int64_t id) {
+        word_trie_.Insert(piece, static_cast<int>(id));
+        if (piece.size() > prefix_len && piece.compare(0, prefix_len, word_piece_prefix_) == 0) {
+            suffix_trie_.Insert(piece.substr(prefix_len), static_cast<int>(id));
+        }
+    });
 }
 
 std::vector<std::string> pyis::ops::WordpieceTokenizer::Tokenize(const std::string& str) {
     std::vector<std::string> result;
     std::string token;
-    for (auto c : str) {
-        if (c == ' ' && !token.empty()) {
-            GreedySearch(token, result);
-            token.clear();
-            continue;
-        }
-
-        token += c;
+    for (size_t begin = 0, end = 0; NextToken(str, begin, end); begin = end + 1) {
+        token.assign(str, begin, end - begin);
+        GreedySearch(token, result);
     }
+    return result;
+}
 
-    if (!token.empty()) {
+std::vector<std::string> pyis::ops::WordpieceTokenizer::Tokenize(const std::vector<std::string>& tokens) {
+    std::vector<std::string> result;
+    for (const auto& token : tokens) {
         GreedySearch(token, result);
     }
 
     return result;
 }
 
-std::vector<std::string> pyis::ops::WordpieceTokenizer::Tokenize(const std::vector<std::string>& tokens) {
+std::vector<std::string> pyis::ops::WordpieceTokenizer::Tokenize(const std::string& str,
+                                                                std::vector<std::pair<size_t, size_t>>& offsets) {
+    std::vector<std::string> result;
+    std::string token;
+    for (size_t begin = 0, end = 0; NextToken(str, begin, end); begin = end + 1) {
+        token.assign(str, begin, end - begin);
+        GreedySearch(token, result, &offsets, begin);
+    }
+    return result;
+}
+
+bool pyis::ops::WordpieceTokenizer::NextToken(const std::string& str, size_t begin, size_t& end) {
+    if (begin >= str.size()) {
+        return false;
+    }
+    // find is a vectorized memchr, instead of appending the bytes one by one
+    end = str.find(' ', begin + 1);
+    if (end == std::string::npos) {
+        end = str.size();
+    }
+    return true;
+}
+
+std::vector<std::string> pyis::ops::WordpieceTokenizer::Tokenize(const std::vector<std::string>& tokens,
+                                                                std::vector<std::pair<size_t, size_t>>& offsets) {
     std::vector<std::string> result;
+    size_t base = 0;
     for (const auto& token : tokens) {
-        GreedySearch(token, result);
+        GreedySearch(token, result, &offsets, base);
+        base += token.size();
     }
 
     return result;
 }
 
-inline void pyis::ops::WordpieceTokenizer::GreedySearch(const std::string& token,
-                                                        std::vector<std::string>& tokenized_result) {
-    int start = 0;
-    int end = -1;
-    std::string substr;
-    for (; start < token.size();) {
-        end = token.size();
-        bool is_found = false;
-        // try to found the longest matched sub-token in vocab
-        for (; start < end;) {
-            substr = token.substr(start, end - start);
-            if (start > 0) {
-                substr = word_piece_prefix_ + substr;  // NOLINT
-            }
-            if (vocab_map_.count(substr) != 0U) {
-                is_found = true;
-                break;
-            }
-            end -= 1;
+std::vector<int64_t> pyis::ops::WordpieceTokenizer::EncodeIdsWithOffsets(
+    const std::string& str, std::vector<std::pair<int64_t, int64_t>>& offsets) {
+    std::vector<std::pair<size_t, size_t>> spans;
+    std::vector<std::string> pieces = Tokenize(str, spans);
+    std::vector<int64_t> ids(pieces.size());
+    for (size_t i = 0; i < pieces.size(); i++) {
+        ids[i] = ConvertTokenToId(pieces[i]);
+        offsets.emplace_back(spans[i].first, spans[i].second);
+    }
+    return ids;
+}
+
+size_t pyis::ops::WordpieceTokenizer::LongestMatch(const CedarTrie& trie, const std::string& token,
+                                                  size_t start) const {
+    size_t end = start;
+    uint64_t from = 0;
+    // the trie takes '\0' as the end of a key, so keys never contain it
+    for (size_t pos = start; pos < token.size() && token[pos] != '\0'; ++pos) {
+        int value = trie.Traverse(token.data() + pos, 1, from);
+        if (value == CedarTrie::CEDAR_NO_PATH) {
+            break;
         }
+        if (value != CedarTrie::CEDAR_NO_VALUE) {
+            end = pos + 1;
+        }
+    }
+    return end;
+}
+
+inline void pyis::ops::WordpieceTokenizer::GreedySearch(const std::string& token,
+                                                        std::vector<std::string>& tokenized_result,
+                                                        std::vector<std::pair<size_t, size_t>>* offsets, size_t base) {
+    // the longest matched sub-token in vocab, walking the trie once from each start
+    for (size_t start = 0; start < token.size();) {
+        size_t end = LongestMatch(start == 0 ? word_trie_ : suffix_trie_, token, start);
         // token not found in vocab
-        if (!is_found) {
+        if (end == start) {
             tokenized_result.push_back(unk_token_);
+            if (offsets != nullptr) {
+                offsets->emplace_back(base + start, base + token.size());
+            }
             break;
         }
 
-        tokenized_result.push_back(substr);
+        if (start == 0) {
+            tokenized_result.emplace_back(token, 0, end);
+        } else {
+            tokenized_result.push_back(word_piece_prefix_);
+            tokenized_result.back().append(token, start, end - start);
+        }
+        if (offsets != nullptr) {
+            offsets->emplace_back(base + start, base + end);
+        }
         start = end;
     }
 }
@@ -1,6 +1,7 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // Licensed under the MIT license.
 
+#include "pyis/ops/text/cedar_trie.h"
 #include "pyis/ops/tokenizer/tokenizer_base.h"
 
 namespace pyis {
@@ -12,13 +13,38 @@ class WordpieceTokenizer : public Tokenizer {
                                 const std::string& sep_token = "[SEP]", const std::string& unk_token = "[UNK]",
                                 const std::string& pad_token = "[PAD]", const std::string& mask_token = "[MASK]",
                                 std::string suffix_indicator = "##");
+    // Use the vocab of a snapshot written by SaveSnapshot, in place
+    explicit WordpieceTokenizer(std::shared_ptr<VocabSnapshot> snapshot, const std::string& cls_token = "[CLS]",
+                                const std::string& sep_token = "[SEP]", const std::string& unk_token = "[UNK]",
+                                const std::string& pad_token = "[PAD]", const std::string& mask_token = "[MASK]",
+                                std::string suffix_indicator = "##");
+    void SaveSnapshot(std::ostream& os) const;
     std::vector<std::string> Tokenize(const std::string& str) override;
 
     std::vector<std::string> Tokenize(const std::vector<std::string>& tokens);
+    // Tokenize, and append the [begin, end) bytes in str of each piece to offsets
+    std::vector<std::string> Tokenize(const std::string& str, std::vector<std::pair<size_t, size_t>>& offsets);
+    // Tokenize, and append the [begin, end) bytes of each piece in the concatenation of tokens to offsets
+    std::vector<std::string> Tokenize(const std::vector<std::string>& tokens,
+                                      std::vector<std::pair<size_t, size_t>>& offsets);
+    std::vector<int64_t> EncodeIdsWithOffsets(const std::string& str,
+                                              std::vector<std::pair<int64_t, int64_t>>& offsets) override;
 
   private:
     std::string word_piece_prefix_;
-    void GreedySearch(const std::string& token, std::vector<std::string>& tokenized_result);
+    // the vocab, and the vocab entries starting with word_piece_prefix_ without the prefix, both mapping to ids
+    CedarTrie word_trie_;
+    CedarTrie suffix_trie_;
+
+    void BuildTries();
+    // Set end to the end of the token starting at begin and return true, or return false at the end of str. A token
+    // ends before the next space, and starts with any character, including a space after another one.
+    static bool NextToken(const std::string& str, size_t begin, size_t& end);
+    // end of the longest key of trie starting at token[start], or start if there is none
+    size_t LongestMatch(const CedarTrie& trie, const std::string& token, size_t start) const;
+    // Split token into pieces, and append their [begin, end) bytes shifted by base to offsets if it is not null
+    void GreedySearch(const std::string& token, std::vector<std::string>& tokenized_result,
+                      std::vector<std::pair<size_t, size_t>>* offsets = nullptr, size_t base = 0);
 };
 }  // namespace ops
 }  // namespace pyis
\ No newline at end of file
@@ -5,6 +5,18 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "str_utils.h"
 
 union EndianDetector {
     uint32_t i_;
@@ -22,3 +34,178 @@ void swap_byte_order(char* data, int size) {
         std::swap(data[i++], data[j--]);
     }
 }
+
+static std::vector<int> get_process_cores() {
+    std::vector<int> cores;
+#ifdef _WIN32
+    DWORD_PTR process_mask = 0;
+    DWORD_PTR system_mask = 0;
+    if (GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask) != 0) {
+        for (int i = 0; i < static_cast<int>(sizeof(DWORD_PTR) * 8); i++) {
+            if ((process_mask >> i) & 1) {
+                cores.push_back(i);
+            }
+        }
+    }
+#elif __linux__
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0) {
+        for (int i = 0; i < CPU_SETSIZE; i++) {
+            if (CPU_ISSET(i, &cpu_set)) {
+                cores.push_back(i);
+            }
+        }
+    }
+#endif
+    if (cores.empty()) {
+        int core_count = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+        for (int i = 0; i < core_count; i++) {
+            cores.push_back(i);
+        }
+    }
+    return cores;
+}
+
+#ifdef __linux__
+// parse a cpulist like "0-15,32-47"
+static std::vector<int> parse_cpu_list(const std::string& cpu_list) {
+    std::vector<int> cores;
+    for (const auto& range : pyis::split_str(cpu_list, ",\r\n")) {
+        auto dash = range.find('-');
+        int first = std::stoi(range.substr(0, dash));
+        int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for (int i = first; i <= last; i++) {
+            cores.push_back(i);
+        }
+    }
+    return cores;
+}
+#endif
+
+std::vector<std::vector<int>> get_numa_node_cores() {
+    std::vector<int> process_cores = get_process_cores();
+    std::vector<std::vector<int>> nodes;
+
+#ifdef __linux__
+    for (int node = 0;; node++) {
+        std::ifstream ifs("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        if (!ifs.is_open()) {
+            break;
+        }
+        std::string cpu_list;
+        std::getline(ifs, cpu_list);
+        std::vector<int> node_cores;
+        for (int core : parse_cpu_list(cpu_list)) {
+            if (std::find(process_cores.begin(), process_cores.end(), core) != process_cores.end()) {
+                node_cores.push_back(core);
+            }
+        }
+        if (!node_cores.empty()) {
+            nodes.emplace_back(std::move(node_cores));
+        }
+    }
+#endif
+
+    if (nodes.empty()) {
+        nodes.emplace_back(std::move(process_cores));
+    }
+    return nodes;
+}
+
+std::vector<std::vector<int>> partition_cores(int group_count) {
+    return partition_cores(get_numa_node_cores(), group_count);
+}
+
+std::vector<std::vector<int>> partition_cores(const std::vector<std::vector<int>>& nodes, int group_count) {
+    std::vector<std::vector<int>> groups;
+    size_t group_total = std::max(group_count, 0);
+    size_t core_total = 0;
+    for (const auto& node_cores : nodes) {
+        core_total += node_cores.size();
+    }
+    if (core_total == 0) {
+        groups.resize(group_total);
+        return groups;
+    }
+
+    // the groups of each node in proportion to its cores, rounded down, and the groups left go to the nodes with the
+    // largest remainders, then the most cores
+    std::vector<size_t> shares(nodes.size());
+    std::vector<size_t> order(nodes.size());
+    size_t assigned = 0;
+    for (size_t n = 0; n < nodes.size(); n++) {
+        shares[n] = group_total * nodes[n].size() / core_total;
+        assigned += shares[n];
+        order[n] = n;
+    }
+    auto remainder = [&](size_t n) { return group_total * nodes[n].size() % core_total; };
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return remainder(a) != remainder(b) ? remainder(a) > remainder(b) : nodes[a].size() > nodes[b].size();
+    });
+    for (size_t i = 0; assigned < group_total; i++, assigned++) {
+        shares[order[i]]++;
+    }
+
+    for (size_t n = 0; n < nodes.size(); n++) {
+        const auto& cores = nodes[n];
+        size_t core_count = cores.size();
+        for (size_t i = 0; i < shares[n]; i++) {
+            size_t begin = i * core_count / shares[n];
+            size_t end = (i + 1) * core_count / shares[n];
+            if (begin == end) {
+                groups.push_back({cores[i % core_count]});
+            } else {
+                groups.emplace_back(cores.begin() + begin, cores.begin() + end);
+            }
+        }
+    }
+    return groups;
+}
+
+bool bind_current_thread(const std::vector<int>& cores, std::vector<int>* previous_cores) {
+#ifdef _WIN32
+    DWORD_PTR mask = 0;
+    for (int core : cores) {
+        if (core < static_cast<int>(sizeof(DWORD_PTR) * 8)) {
+            mask |= static_cast<DWORD_PTR>(1) << core;
+        }
+    }
+    DWORD_PTR previous_mask = SetThreadAffinityMask(GetCurrentThread(), mask);
+    if (previous_mask == 0) {
+        return false;
+    }
+    if (previous_cores != nullptr) {
+        previous_cores->clear();
+        for (int i = 0; i < static_cast<int>(sizeof(DWORD_PTR) * 8); i++) {
+            if ((previous_mask >> i) & 1) {
+                previous_cores->push_back(i);
+            }
+        }
+    }
+    return true;
+#elif __linux__
+    cpu_set_t cpu_set;
+    if (previous_cores != nullptr) {
+        CPU_ZERO(&cpu_set);
+        if (pthread_getaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) != 0) {
+            return false;
+        }
+        previous_cores->clear();
+        for (int i = 0; i < CPU_SETSIZE; i++) {
+            if (CPU_ISSET(i, &cpu_set)) {
+                previous_cores->push_back(i);
+            }
+        }
+    }
+    CPU_ZERO(&cpu_set);
+    for (int core : cores) {
+        if (core < CPU_SETSIZE) {
+            CPU_SET(core, &cpu_set);
+        }
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+#else
+    return false;
+#endif
+}
@@ -3,5 +3,23 @@
 
 #pragma once
 
+#include <vector>
+
 bool is_little_endian();
 void swap_byte_order(char* data, int size);
+
+// ids of the cores this process is allowed to run on, grouped by NUMA node
+std::vector<std::vector<int>> get_numa_node_cores();
+
+// split the cores of this process into group_count groups of adjacent cores, see the overload below
+std::vector<std::vector<int>> partition_cores(int group_count);
+
+// split the cores of nodes, grouped by NUMA node, into group_count groups of adjacent cores. Groups never span nodes:
+// each node gets a share of the groups in proportion to its cores, and its cores are split evenly between them. With
+// fewer groups than nodes, the largest nodes get them. Groups of a node share its cores if it has more groups than
+// cores.
+std::vector<std::vector<int>> partition_cores(const std::vector<std::vector<int>>& nodes, int group_count);
+
+// bind the calling thread to cores. The cores it was bound to are saved in previous_cores if it is not null.
+// Returns false if thread affinity is not supported on this platform.
+bool bind_current_thread(const std::vector<int>& cores, std::vector<int>* previous_cores = nullptr);
@@ -49,6 +49,8 @@ class JsonPersistHelper {
     T get(const std::string& key);
     template <typename T, typename std::enable_if<std::is_same<T, double>::value, T>::type* = nullptr>
     T get(const std::string& key);
+    template <typename T, typename std::enable_if<std::is_same<T, std::vector<int>>::value, T>::type* = nullptr>
+    T get(const std::string& key);
     template <typename T, typename std::enable_if<std::is_same<T, std::vector<std::string>>::value, T>::type* = nullptr>
     T get(const std::string& key);
     std::string get(const std::string& key);
@@ -147,6 +149,18 @@ T JsonPersistHelper::get(const std::string& key) {
     return value.GetDouble();
 }
 
+template <typename T, typename std::enable_if<std::is_same<T, std::vector<int>>::value, T>::type*>
+T JsonPersistHelper::get(const std::string& key) {
+    const rapidjson::Value& value = doc_[key.c_str()];
+    std::vector<int> result;
+    auto arr = value.GetArray();
+    result.reserve(arr.Size());
+    for (const auto& elem : arr) {
+        result.emplace_back(elem.GetInt());
+    }
+    return result;
+}
+
 template <typename T, typename std::enable_if<std::is_same<T, std::vector<std::string>>::value, T>::type*>
 T JsonPersistHelper::get(const std::string& key) {
     const rapidjson::Value& value = doc_[key.c_str()];
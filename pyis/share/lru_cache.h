@@ -0,0 +1,78 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace pyis {
+
+// A bounded cache which evicts the least recently used entry once it holds capacity entries. Safe to call
+// concurrently. A capacity of 0 disables the cache.
+template <class K, class V, class Hash = std::hash<K>>
+class LruCache {
+  public:
+    explicit LruCache(size_t capacity) : capacity_(capacity) {}
+
+    LruCache(const LruCache& o) = delete;
+    LruCache& operator=(const LruCache& o) = delete;
+
+    // Copy the value of key to value and mark it as the most recently used one. Return false on a miss.
+    bool Get(const K& key, V& value) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it == index_.end()) {
+            return false;
+        }
+        entries_.splice(entries_.begin(), entries_, it->second);
+        value = it->second->second;
+        return true;
+    }
+
+    void Put(const K& key, V value) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (capacity_ == 0) {
+            return;
+        }
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            it->second->second = std::move(value);
+            entries_.splice(entries_.begin(), entries_, it->second);
+            return;
+        }
+        if (entries_.size() >= capacity_) {
+            index_.erase(entries_.back().first);
+            entries_.pop_back();
+        }
+        entries_.emplace_front(key, std::move(value));
+        index_.emplace(key, entries_.begin());
+    }
+
+    void Clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        index_.clear();
+        entries_.clear();
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return entries_.size();
+    }
+
+    size_t capacity() const { return capacity_; }
+
+  private:
+    using Entry = std::pair<K, V>;
+
+    size_t capacity_;
+    // most recently used first
+    std::list<Entry> entries_;
+    std::unordered_map<K, typename std::list<Entry>::iterator, Hash> index_;
+    mutable std::mutex mutex_;
+};
+
+}  // namespace pyis
@@ -38,6 +38,9 @@ class ModelStorage {
 
     virtual void add_file(const std::string& source_file, const std::string& internal_path) = 0;
 
+    // path of file_path on the local file system, or an empty string if the storage does not keep its files there
+    virtual std::string local_path(const std::string& /*file_path*/) { return std::string(); }
+
     // add src_file from src_storage to dst_storage as dst_file
     static void copy_file(ModelStorage& src_storage, const std::string& src_file, ModelStorage& dst_storage,
                           const std::string& dst_file);
@@ -90,6 +90,8 @@ std::shared_ptr<FILE> ModelStorageLocal::open_file(const char* file_path, const
     return fs::open_file(abs_path(file_path).c_str(), mode);
 }
 
+std::string ModelStorageLocal::local_path(const std::string& file_path) { return abs_path(file_path); }
+
 void ModelStorageLocal::add_file(const std::string& source_path, const std::string& internal_path) {
 #if defined(_WIN32) || defined(__unix__)
     efs::path path_src(source_path);
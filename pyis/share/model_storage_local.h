@@ -24,6 +24,8 @@ class ModelStorageLocal : public ModelStorage {
 
     void add_file(const std::string& source_path, const std::string& internal_path) override;
 
+    std::string local_path(const std::string& file_path) override;
+
   private:
     std::string abs_path(const std::string& path);
     bool file_exists(const std::string& path);
@@ -3,7 +3,9 @@
 
 #include "str_utils.h"
 
+#include <algorithm>
 #include <iostream>
+#include <iterator>
 
 namespace pyis {
 
@@ -113,7 +115,7 @@ bool is_accent(char32_t c) {
 
 char32_t strip_accent(char32_t c) {
     //   "ÀÁÂÃÄÅÆÇÈÉÊËÌÍÎÏÐÑÒÓÔÕÖ×ØÙÚÛÜÝÞßàáâãäåæçèéêëìíîïðñòóôõö÷øùúûüýþÿ"
-    const char* tr = "AAAAAAÆCEEEEIIIIÐNOOOOO×ØUUUUYÞßaaaaaaæceeeeiiiiðnooooo÷øuuuuyþy";
+    const char32_t* tr = U"AAAAAAÆCEEEEIIIIÐNOOOOO×ØUUUUYÞßaaaaaaæceeeeiiiiðnooooo÷øuuuuyþy";
     if (c < 192 || c > 255) {
         return c;
     }
@@ -131,7 +133,7 @@ void replace_all(std::string& data, const std::string& str_to_search, const std:
 
 bool is_unicode_letter(const char32_t& ch) {
     // Unicode Category L code range
-    const std::vector<std::pair<char32_t, char32_t>> l_category_table = {
+    static const std::vector<std::pair<char32_t, char32_t>> l_category_table = {
         {65, 90},         {97, 122},        {170, 170},       {181, 181},       {186, 186},       {192, 214},
         {216, 246},       {248, 705},       {710, 721},       {736, 740},       {748, 748},       {750, 750},
         {880, 884},       {886, 887},       {890, 893},       {895, 895},       {902, 902},       {904, 906},
@@ -251,7 +253,7 @@ bool is_unicode_letter(const char32_t& ch) {
 
 bool is_unicode_number(const char32_t& ch) {
     // Unicode Category N code range
-    const std::vector<std::pair<char32_t, char32_t>> n_category_table = {
+    static const std::vector<std::pair<char32_t, char32_t>> n_category_table = {
         {48, 57},         {178, 179},       {185, 185},       {188, 190},       {1632, 1641},     {1776, 1785},
         {1984, 1993},     {2406, 2415},     {2534, 2543},     {2548, 2553},     {2662, 2671},     {2790, 2799},
         {2918, 2927},     {2930, 2935},     {3046, 3058},     {3174, 3183},     {3192, 3198},     {3302, 3311},
@@ -290,7 +292,7 @@ bool is_unicode_number(const char32_t& ch) {
 
 bool is_unicode_seperator(const char32_t& ch) {
     // Unicode Category Z code range
-    const std::vector<std::pair<char32_t, char32_t>> z_category_table = {
+    static const std::vector<std::pair<char32_t, char32_t>> z_category_table = {
         {32, 32}, {160, 160}, {5760, 5760}, {8192, 8202}, {8232, 8233}, {8239, 8239}, {8287, 8287}, {12288, 12288}};
     for (const auto& r : z_category_table) {
         if (r.first <= ch && ch <= r.second) {
@@ -340,4 +342,121 @@ bool not_category_LNZ(const char32_t& ch) {
     return !is_unicode_letter(ch) && !is_unicode_number(ch) && !is_unicode_seperator(ch);
 }
 
+bool is_unicode_punctuation(const char32_t& ch) {
+    // ASCII symbols are taken as punctuation too, same as BERT
+    if (ch < 128) {
+        return (ch >= 33 && ch <= 47) || (ch >= 58 && ch <= 64) || (ch >= 91 && ch <= 96) || (ch >= 123 && ch <= 126);
+    }
+    // Unicode Category P code range, above ASCII
+    static const std::vector<std::pair<char32_t, char32_t>> p_category_table = {
+        {161, 161},       {167, 167},       {171, 171},       {182, 183},       {187, 187},       {191, 191},
+        {894, 894},       {903, 903},       {1370, 1375},     {1417, 1418},     {1470, 1470},     {1472, 1472},
+        {1475, 1475},     {1478, 1478},     {1523, 1524},     {1545, 1546},     {1548, 1549},     {1563, 1563},
+        {1565, 1567},     {1642, 1645},     {1748, 1748},     {1792, 1805},     {2039, 2041},     {2096, 2110},
+        {2142, 2142},     {2404, 2405},     {2416, 2416},     {2557, 2557},     {2678, 2678},     {2800, 2800},
+        {3191, 3191},     {3204, 3204},     {3572, 3572},     {3663, 3663},     {3674, 3675},     {3844, 3858},
+        {3860, 3860},     {3898, 3901},     {3973, 3973},     {4048, 4052},     {4057, 4058},     {4170, 4175},
+        {4347, 4347},     {4960, 4968},     {5120, 5120},     {5742, 5742},     {5787, 5788},     {5867, 5869},
+        {5941, 5942},     {6100, 6102},     {6104, 6106},     {6144, 6154},     {6468, 6469},     {6686, 6687},
+        {6816, 6822},     {6824, 6829},     {7002, 7008},     {7037, 7038},     {7164, 7167},     {7227, 7231},
+        {7294, 7295},     {7360, 7367},     {7379, 7379},     {8208, 8231},     {8240, 8259},     {8261, 8273},
+        {8275, 8286},     {8317, 8318},     {8333, 8334},     {8968, 8971},     {9001, 9002},     {10088, 10101},
+        {10181, 10182},   {10214, 10223},   {10627, 10648},   {10712, 10715},   {10748, 10749},   {11513, 11516},
+        {11518, 11519},   {11632, 11632},   {11776, 11822},   {11824, 11855},   {11858, 11869},   {12289, 12291},
+        {12296, 12305},   {12308, 12319},   {12336, 12336},   {12349, 12349},   {12448, 12448},   {12539, 12539},
+        {42238, 42239},   {42509, 42511},   {42611, 42611},   {42622, 42622},   {42738, 42743},   {43124, 43127},
+        {43214, 43215},   {43256, 43258},   {43260, 43260},   {43310, 43311},   {43359, 43359},   {43457, 43469},
+        {43486, 43487},   {43612, 43615},   {43742, 43743},   {43760, 43761},   {44011, 44011},   {64830, 64831},
+        {65040, 65049},   {65072, 65106},   {65108, 65121},   {65123, 65123},   {65128, 65128},   {65130, 65131},
+        {65281, 65283},   {65285, 65290},   {65292, 65295},   {65306, 65307},   {65311, 65312},   {65339, 65341},
+        {65343, 65343},   {65371, 65371},   {65373, 65373},   {65375, 65381},   {65792, 65794},   {66463, 66463},
+        {66512, 66512},   {66927, 66927},   {67671, 67671},   {67871, 67871},   {67903, 67903},   {68176, 68184},
+        {68223, 68223},   {68336, 68342},   {68409, 68415},   {68505, 68508},   {69293, 69293},   {69461, 69465},
+        {69510, 69513},   {69703, 69709},   {69819, 69820},   {69822, 69825},   {69952, 69955},   {70004, 70005},
+        {70085, 70088},   {70093, 70093},   {70107, 70107},   {70109, 70111},   {70200, 70205},   {70313, 70313},
+        {70731, 70735},   {70746, 70747},   {70749, 70749},   {70854, 70854},   {71105, 71127},   {71233, 71235},
+        {71264, 71276},   {71353, 71353},   {71484, 71486},   {71739, 71739},   {72004, 72006},   {72162, 72162},
+        {72255, 72262},   {72346, 72348},   {72350, 72354},   {72769, 72773},   {72816, 72817},   {73463, 73464},
+        {73727, 73727},   {74864, 74868},   {77809, 77810},   {92782, 92783},   {92917, 92917},   {92983, 92987},
+        {92996, 92996},   {93847, 93850},   {94178, 94178},   {113823, 113823}, {121479, 121483}, {125278, 125279}};
+    auto ite = std::upper_bound(p_category_table.begin(), p_category_table.end(), std::make_pair(ch, U'\U0010FFFF'));
+    if (ite == p_category_table.begin()) {
+        return false;
+    }
+    ite--;
+    return ch <= ite->second;
+}
+
+char32_t to_lower_char(char32_t c) {
+    if (c < 128) {
+        return (c >= U'A' && c <= U'Z') ? c + 32 : c;
+    }
+    // The simple lowercase mappings of Unicode 14.0, as runs of {first, last, delta, stride}: every stride-th character
+    // from first to last lowercases to c + delta. Being a per-character mapping, U+0130 lowers to a plain 'i' without
+    // the combining dot of its full mapping, and a final sigma lowers to U+03C3 as any other sigma does.
+    struct LowerCaseRun {
+        char32_t first;
+        char32_t last;
+        int32_t delta;
+        uint32_t stride;
+    };
+    static const LowerCaseRun lower_case_table[] = {
+        {0x41, 0x5A, 32, 1}, {0xC0, 0xD6, 32, 1}, {0xD8, 0xDE, 32, 1}, {0x100, 0x12E, 1, 2}, {0x130, 0x130, -199, 1},
+        {0x132, 0x136, 1, 2}, {0x139, 0x147, 1, 2}, {0x14A, 0x176, 1, 2}, {0x178, 0x178, -121, 1}, {0x179, 0x17D, 1, 2},
+        {0x181, 0x181, 210, 1}, {0x182, 0x184, 1, 2}, {0x186, 0x186, 206, 1}, {0x187, 0x187, 1, 1},
+        {0x189, 0x18A, 205, 1}, {0x18B, 0x18B, 1, 1}, {0x18E, 0x18E, 79, 1}, {0x18F, 0x18F, 202, 1},
+        {0x190, 0x190, 203, 1}, {0x191, 0x191, 1, 1}, {0x193, 0x193, 205, 1}, {0x194, 0x194, 207, 1},
+        {0x196, 0x196, 211, 1}, {0x197, 0x197, 209, 1}, {0x198, 0x198, 1, 1}, {0x19C, 0x19C, 211, 1},
+        {0x19D, 0x19D, 213, 1}, {0x19F, 0x19F, 214, 1}, {0x1A0, 0x1A4, 1, 2}, {0x1A6, 0x1A6, 218, 1},
+        {0x1A7, 0x1A7, 1, 1}, {0x1A9, 0x1A9, 218, 1}, {0x1AC, 0x1AC, 1, 1}, {0x1AE, 0x1AE, 218, 1},
+        {0x1AF, 0x1AF, 1, 1}, {0x1B1, 0x1B2, 217, 1}, {0x1B3, 0x1B5, 1, 2}, {0x1B7, 0x1B7, 219, 1},
+        {0x1B8, 0x1B8, 1, 1}, {0x1BC, 0x1BC, 1, 1}, {0x1C4, 0x1C4, 2, 1}, {0x1C5, 0x1C5, 1, 1}, {0x1C7, 0x1C7, 2, 1},
+        {0x1C8, 0x1C8, 1, 1}, {0x1CA, 0x1CA, 2, 1}, {0x1CB, 0x1DB, 1, 2}, {0x1DE, 0x1EE, 1, 2}, {0x1F1, 0x1F1, 2, 1},
+        {0x1F2, 0x1F4, 1, 2}, {0x1F6, 0x1F6, -97, 1}, {0x1F7, 0x1F7, -56, 1}, {0x1F8, 0x21E, 1, 2},
+        {0x220, 0x220, -130, 1}, {0x222, 0x232, 1, 2}, {0x23A, 0x23A, 10795, 1}, {0x23B, 0x23B, 1, 1},
+        {0x23D, 0x23D, -163, 1}, {0x23E, 0x23E, 10792, 1}, {0x241, 0x241, 1, 1}, {0x243, 0x243, -195, 1},
+        {0x244, 0x244, 69, 1}, {0x245, 0x245, 71, 1}, {0x246, 0x24E, 1, 2}, {0x370, 0x372, 1, 2}, {0x376, 0x376, 1, 1},
+        {0x37F, 0x37F, 116, 1}, {0x386, 0x386, 38, 1}, {0x388, 0x38A, 37, 1}, {0x38C, 0x38C, 64, 1},
+        {0x38E, 0x38F, 63, 1}, {0x391, 0x3A1, 32, 1}, {0x3A3, 0x3AB, 32, 1}, {0x3CF, 0x3CF, 8, 1}, {0x3D8, 0x3EE, 1, 2},
+        {0x3F4, 0x3F4, -60, 1}, {0x3F7, 0x3F7, 1, 1}, {0x3F9, 0x3F9, -7, 1}, {0x3FA, 0x3FA, 1, 1},
+        {0x3FD, 0x3FF, -130, 1}, {0x400, 0x40F, 80, 1}, {0x410, 0x42F, 32, 1}, {0x460, 0x480, 1, 2},
+        {0x48A, 0x4BE, 1, 2}, {0x4C0, 0x4C0, 15, 1}, {0x4C1, 0x4CD, 1, 2}, {0x4D0, 0x52E, 1, 2}, {0x531, 0x556, 48, 1},
+        {0x10A0, 0x10C5, 7264, 1}, {0x10C7, 0x10C7, 7264, 1}, {0x10CD, 0x10CD, 7264, 1}, {0x13A0, 0x13EF, 38864, 1},
+        {0x13F0, 0x13F5, 8, 1}, {0x1C90, 0x1CBA, -3008, 1}, {0x1CBD, 0x1CBF, -3008, 1}, {0x1E00, 0x1E94, 1, 2},
+        {0x1E9E, 0x1E9E, -7615, 1}, {0x1EA0, 0x1EFE, 1, 2}, {0x1F08, 0x1F0F, -8, 1}, {0x1F18, 0x1F1D, -8, 1},
+        {0x1F28, 0x1F2F, -8, 1}, {0x1F38, 0x1F3F, -8, 1}, {0x1F48, 0x1F4D, -8, 1}, {0x1F59, 0x1F5F, -8, 2},
+        {0x1F68, 0x1F6F, -8, 1}, {0x1F88, 0x1F8F, -8, 1}, {0x1F98, 0x1F9F, -8, 1}, {0x1FA8, 0x1FAF, -8, 1},
+        {0x1FB8, 0x1FB9, -8, 1}, {0x1FBA, 0x1FBB, -74, 1}, {0x1FBC, 0x1FBC, -9, 1}, {0x1FC8, 0x1FCB, -86, 1},
+        {0x1FCC, 0x1FCC, -9, 1}, {0x1FD8, 0x1FD9, -8, 1}, {0x1FDA, 0x1FDB, -100, 1}, {0x1FE8, 0x1FE9, -8, 1},
+        {0x1FEA, 0x1FEB, -112, 1}, {0x1FEC, 0x1FEC, -7, 1}, {0x1FF8, 0x1FF9, -128, 1}, {0x1FFA, 0x1FFB, -126, 1},
+        {0x1FFC, 0x1FFC, -9, 1}, {0x2126, 0x2126, -7517, 1}, {0x212A, 0x212A, -8383, 1}, {0x212B, 0x212B, -8262, 1},
+        {0x2132, 0x2132, 28, 1}, {0x2160, 0x216F, 16, 1}, {0x2183, 0x2183, 1, 1}, {0x24B6, 0x24CF, 26, 1},
+        {0x2C00, 0x2C2F, 48, 1}, {0x2C60, 0x2C60, 1, 1}, {0x2C62, 0x2C62, -10743, 1}, {0x2C63, 0x2C63, -3814, 1},
+        {0x2C64, 0x2C64, -10727, 1}, {0x2C67, 0x2C6B, 1, 2}, {0x2C6D, 0x2C6D, -10780, 1}, {0x2C6E, 0x2C6E, -10749, 1},
+        {0x2C6F, 0x2C6F, -10783, 1}, {0x2C70, 0x2C70, -10782, 1}, {0x2C72, 0x2C72, 1, 1}, {0x2C75, 0x2C75, 1, 1},
+        {0x2C7E, 0x2C7F, -10815, 1}, {0x2C80, 0x2CE2, 1, 2}, {0x2CEB, 0x2CED, 1, 2}, {0x2CF2, 0x2CF2, 1, 1},
+        {0xA640, 0xA66C, 1, 2}, {0xA680, 0xA69A, 1, 2}, {0xA722, 0xA72E, 1, 2}, {0xA732, 0xA76E, 1, 2},
+        {0xA779, 0xA77B, 1, 2}, {0xA77D, 0xA77D, -35332, 1}, {0xA77E, 0xA786, 1, 2}, {0xA78B, 0xA78B, 1, 1},
+        {0xA78D, 0xA78D, -42280, 1}, {0xA790, 0xA792, 1, 2}, {0xA796, 0xA7A8, 1, 2}, {0xA7AA, 0xA7AA, -42308, 1},
+        {0xA7AB, 0xA7AB, -42319, 1}, {0xA7AC, 0xA7AC, -42315, 1}, {0xA7AD, 0xA7AD, -42305, 1},
+        {0xA7AE, 0xA7AE, -42308, 1}, {0xA7B0, 0xA7B0, -42258, 1}, {0xA7B1, 0xA7B1, -42282, 1},
+        {0xA7B2, 0xA7B2, -42261, 1}, {0xA7B3, 0xA7B3, 928, 1}, {0xA7B4, 0xA7C2, 1, 2}, {0xA7C4, 0xA7C4, -48, 1},
+        {0xA7C5, 0xA7C5, -42307, 1}, {0xA7C6, 0xA7C6, -35384, 1}, {0xA7C7, 0xA7C9, 1, 2}, {0xA7D0, 0xA7D0, 1, 1},
+        {0xA7D6, 0xA7D8, 1, 2}, {0xA7F5, 0xA7F5, 1, 1}, {0xFF21, 0xFF3A, 32, 1}, {0x10400, 0x10427, 40, 1},
+        {0x104B0, 0x104D3, 40, 1}, {0x10570, 0x1057A, 39, 1}, {0x1057C, 0x1058A, 39, 1}, {0x1058C, 0x10592, 39, 1},
+        {0x10594, 0x10595, 39, 1}, {0x10C80, 0x10CB2, 64, 1}, {0x118A0, 0x118BF, 32, 1}, {0x16E40, 0x16E5F, 32, 1},
+        {0x1E900, 0x1E921, 34, 1}
+    };
+    auto ite = std::upper_bound(std::begin(lower_case_table), std::end(lower_case_table), c,
+                                [](char32_t ch, const LowerCaseRun& run) { return ch < run.first; });
+    if (ite == std::begin(lower_case_table)) {
+        return c;
+    }
+    ite--;
+    if (c > ite->last || (c - ite->first) % ite->stride != 0) {
+        return c;
+    }
+    return static_cast<char32_t>(static_cast<int32_t>(c) + ite->delta);
+}
+
 }  // namespace pyis
\ No newline at end of file
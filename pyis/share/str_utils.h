@@ -65,4 +65,8 @@ bool is_unicode_space(const char32_t& ch);
 
 bool not_category_LNZ(const char32_t& ch);
 
+bool is_unicode_punctuation(const char32_t& ch);
+
+char32_t to_lower_char(char32_t c);
+
 }  // namespace pyis
@@ -0,0 +1,115 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace pyis {
+
+ThreadPool::ThreadPool(size_t thread_num) {
+    if (thread_num == 0) {
+        thread_num = std::max(1U, std::thread::hardware_concurrency());
+    }
+    workers_.reserve(thread_num - 1);
+    for (size_t i = 1; i < thread_num; i++) {
+        workers_.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopped_ = true;
+    }
+    work_cv_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+std::shared_ptr<ThreadPool> ThreadPool::Default() {
+    static std::shared_ptr<ThreadPool> pool = std::make_shared<ThreadPool>();
+    return pool;
+}
+
+void ThreadPool::ParallelFor(size_t n, const std::function<void(size_t)>& fn) {
+    if (n == 0) {
+        return;
+    }
+    auto loop = std::make_shared<Loop>(n, fn);
+    if (n == 1 || workers_.empty()) {
+        Run(*loop);
+        if (loop->error_) {
+            std::rethrow_exception(loop->error_);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        loops_.push_back(loop);
+    }
+    work_cv_.notify_all();
+
+    Run(*loop);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [&loop]() { return loop->finished_ == loop->n_; });
+    auto it = std::find(loops_.begin(), loops_.end(), loop);
+    if (it != loops_.end()) {
+        loops_.erase(it);
+    }
+    if (loop->error_) {
+        std::rethrow_exception(loop->error_);
+    }
+}
+
+void ThreadPool::Run(Loop& loop) {
+    size_t count = 0;
+    std::exception_ptr error;
+    for (size_t i = loop.next_++; i < loop.n_; i = loop.next_++) {
+        try {
+            loop.fn_(i);
+        } catch (...) {
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+        count++;
+    }
+    if (count == 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (error && !loop.error_) {
+        loop.error_ = error;
+    }
+    loop.finished_ += count;
+    if (loop.finished_ == loop.n_) {
+        done_cv_.notify_all();
+    }
+}
+
+void ThreadPool::WorkerLoop() {
+    while (true) {
+        std::shared_ptr<Loop> loop;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_cv_.wait(lock, [this]() { return stopped_ || !loops_.empty(); });
+            if (stopped_) {
+                return;
+            }
+            loop = loops_.front();
+            // all the iterations are taken, the caller waits for those still running
+            if (loop->next_ >= loop->n_) {
+                loops_.pop_front();
+                continue;
+            }
+        }
+        Run(*loop);
+    }
+}
+
+}  // namespace pyis
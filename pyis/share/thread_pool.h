@@ -0,0 +1,61 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pyis {
+
+// A fixed set of worker threads running parallel loops. Loops of concurrent callers are queued and may overlap.
+class ThreadPool final {
+  public:
+    // thread_num counts the calling thread, which takes part in its loops, so thread_num - 1 workers are started.
+    // 0 means one thread per core.
+    explicit ThreadPool(size_t thread_num = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool& o) = delete;
+    ThreadPool& operator=(const ThreadPool& o) = delete;
+
+    // Run fn(i) for i in [0, n) and return once all of them have finished. The first exception thrown by fn is
+    // rethrown after the loop ends.
+    void ParallelFor(size_t n, const std::function<void(size_t)>& fn);
+
+    size_t size() const { return workers_.size() + 1; }
+
+    // pool with one thread per core, shared by the callers which do not own a pool
+    static std::shared_ptr<ThreadPool> Default();
+
+  private:
+    struct Loop {
+        Loop(size_t n, const std::function<void(size_t)>& fn) : n_(n), fn_(fn) {}
+        size_t n_;
+        const std::function<void(size_t)>& fn_;
+        std::atomic<size_t> next_{0};
+        // guarded by mutex_
+        size_t finished_ = 0;
+        std::exception_ptr error_;
+    };
+
+    void WorkerLoop();
+    void Run(Loop& loop);
+
+    std::vector<std::thread> workers_;
+    std::deque<std::shared_ptr<Loop>> loops_;
+    std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable done_cv_;
+    bool stopped_ = false;
+};
+
+}  // namespace pyis
@@ -0,0 +1,118 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "pyis/ops/tokenizer/basic_tokenizer.h"
+#include "pyis/ops/tokenizer/wordpiece_tokenizer.h"
+
+// Throughput benchmark of the tokenization hot loops on ASCII, mixed and CJK text, disabled by default. Run it with
+//   test_pyis_cpp --gtest_also_run_disabled_tests --gtest_filter=BasicTokenizerBench.*
+
+namespace {
+
+struct Corpus {
+    const char* name_;
+    std::vector<std::string> lines_;
+    size_t bytes_;
+};
+
+// English words and punctuation, with accented words and CJK characters mixed in at cjk_ratio of the words
+Corpus GenerateCorpus(const char* name, double accented_ratio, double cjk_ratio, std::mt19937& rng) {
+    const char charlist[] = "etaoinshrdlcumwfgypbvkjxqz";
+    const char* accented[] = {"café", "naïve", "Ærø", "résumé", "Ωμέγα", "мир"};
+    const char* punctuation[] = {",", ".", "!", "?", "'s", "(1984)"};
+    std::uniform_real_distribution<double> uniform(0, 1);
+    Corpus corpus{name, {}, 0};
+    for (int i = 0; i < 20000; i++) {
+        std::string line;
+        for (int j = 0; j < 20; j++) {
+            double u = uniform(rng);
+            std::string word;
+            if (u < cjk_ratio) {
+                // 1 to 4 characters from the CJK unified ideographs
+                for (size_t k = rng() % 4 + 1; k > 0; k--) {
+                    char32_t c = 0x4E00 + rng() % 0x5000;
+                    word += static_cast<char>(0xE0 | (c >> 12));
+                    word += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+                    word += static_cast<char>(0x80 | (c & 0x3F));
+                }
+            } else if (u < cjk_ratio + accented_ratio) {
+                word = accented[rng() % 6];
+            } else {
+                for (size_t k = rng() % 10 + 2; k > 0; k--) {
+                    word += charlist[std::min(rng() % 26, rng() % 26)];
+                }
+                if (rng() % 8 == 0) {
+                    word[0] = static_cast<char>(word[0] - 32);
+                }
+            }
+            line += (j == 0 ? "" : " ") + word + (rng() % 6 == 0 ? punctuation[rng() % 6] : "");
+        }
+        corpus.bytes_ += line.size();
+        corpus.lines_.emplace_back(line);
+    }
+    return corpus;
+}
+
+template <typename Fn>
+double MeasureMBPerSecond(const Corpus& corpus, Fn fn) {
+    auto start = std::chrono::steady_clock::now();
+    size_t tokens = 0;
+    for (const auto& line : corpus.lines_) {
+        tokens += fn(line);
+    }
+    auto end = std::chrono::steady_clock::now();
+    EXPECT_GT(tokens, 0U);
+    return corpus.bytes_ / std::chrono::duration<double>(end - start).count() / 1e6;
+}
+
+}  // namespace
+
+TEST(BasicTokenizerBench, DISABLED_Corpora) {
+    std::mt19937 rng(42);
+    std::vector<Corpus> corpora;
+    corpora.emplace_back(GenerateCorpus("ascii", 0, 0, rng));
+    corpora.emplace_back(GenerateCorpus("mixed", 0.1, 0.1, rng));
+    corpora.emplace_back(GenerateCorpus("cjk", 0, 0.9, rng));
+
+    // the words of the ASCII corpus split into halves, so that most words take 2 pieces
+    std::string vocab_file = testing::TempDir() + "basic_bench_vocab.txt";
+    {
+        std::ofstream out(vocab_file);
+        out << "[PAD]\n[UNK]\n[CLS]\n[SEP]\n[MASK]\n";
+        for (char c = 'a'; c <= 'z'; c++) {
+            out << c << "\n##" << c << "\n";
+        }
+        pyis::ops::BasicTokenizer tokenizer(true, true, true, true, true);
+        std::set<std::string> pieces;
+        for (const auto& line : corpora[0].lines_) {
+            for (const auto& word : tokenizer.Tokenize(line)) {
+                if (word.size() > 1) {
+                    pieces.insert(word.substr(0, word.size() / 2));
+                    pieces.insert("##" + word.substr(word.size() / 2));
+                }
+            }
+        }
+        for (const auto& piece : pieces) {
+            out << piece << "\n";
+        }
+    }
+
+    pyis::ops::BasicTokenizer basic(true, true, true, true, true);
+    pyis::ops::WordpieceTokenizer wordpiece(vocab_file);
+    for (const auto& corpus : corpora) {
+        double basic_speed = MeasureMBPerSecond(corpus, [&](const std::string& line) {
+            return basic.Tokenize(line).size();
+        });
+        double wordpiece_speed = MeasureMBPerSecond(corpus, [&](const std::string& line) {
+            return wordpiece.Tokenize(line).size();
+        });
+        std::cout << corpus.name_ << " text: BasicTokenizer " << basic_speed << " MB/s, WordpieceTokenizer "
+                  << wordpiece_speed << " MB/s" << std::endl;
+    }
+}
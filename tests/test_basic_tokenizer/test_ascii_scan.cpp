@@ -0,0 +1,59 @@
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "pyis/ops/tokenizer/ascii_scan.h"
+
+using namespace pyis::ops;
+
+namespace {
+
+template <uint32_t CLASSES>
+void ExpectSameAsScalar(const std::vector<uint8_t>& text) {
+    for (size_t pos = 0; pos <= text.size(); pos++) {
+        ASSERT_EQ(SkipAscii<CLASSES>(text.data(), pos, text.size()),
+                  SkipAsciiScalar<CLASSES>(text.data(), pos, text.size()))
+            << "classes " << CLASSES << " from " << pos;
+    }
+}
+
+}  // namespace
+
+TEST(TestAsciiScan, TestAsciiClassOf) {
+    ASSERT_EQ(AsciiClassOf('a'), ASCII_LETTER);
+    ASSERT_EQ(AsciiClassOf('Z'), ASCII_LETTER);
+    ASSERT_EQ(AsciiClassOf('0'), ASCII_DIGIT);
+    ASSERT_EQ(AsciiClassOf(' '), ASCII_SPACE);
+    ASSERT_EQ(AsciiClassOf('\t'), ASCII_OTHER);
+    ASSERT_EQ(AsciiClassOf('@'), ASCII_OTHER);
+    ASSERT_EQ(AsciiClassOf('['), ASCII_OTHER);
+    ASSERT_EQ(AsciiClassOf(0x7F), ASCII_OTHER);
+    ASSERT_EQ(AsciiClassOf(0x80), 0U);
+    ASSERT_EQ(AsciiClassOf(0xC1), 0U);
+}
+
+TEST(TestAsciiScan, TestSkipAscii) {
+    std::mt19937 rng(42);
+    // runs of bytes around the edges of the classes, so that every block ends at a different byte
+    const uint8_t bytes[] = {'a', 'z', 'A', 'Z', '`', '{', '@', '[', '0', '9', '/', ':', ' ', '\t', 0, 0x7F, 0x80, 0xFF};
+    for (int i = 0; i < 200; i++) {
+        std::vector<uint8_t> text(rng() % 80);
+        size_t run = rng() % 40 + 1;
+        for (size_t j = 0; j < text.size(); j++) {
+            text[j] = rng() % run == 0 ? bytes[rng() % sizeof(bytes)] : 'a' + rng() % 26;
+        }
+        ExpectSameAsScalar<ASCII_LETTER>(text);
+        ExpectSameAsScalar<ASCII_DIGIT>(text);
+        ExpectSameAsScalar<ASCII_SPACE>(text);
+        ExpectSameAsScalar<ASCII_OTHER>(text);
+        ExpectSameAsScalar<ASCII_LETTER | ASCII_DIGIT>(text);
+        ExpectSameAsScalar<ASCII_ANY>(text);
+    }
+
+    std::vector<uint8_t> text(100, 'x');
+    ASSERT_EQ(SkipAscii<ASCII_LETTER>(text.data(), 3, text.size()), 100U);
+    text[70] = 0xC3;
+    ASSERT_EQ(SkipAscii<ASCII_ANY>(text.data(), 0, text.size()), 70U);
+    ASSERT_EQ(SkipAscii<ASCII_DIGIT>(text.data(), 0, text.size()), 0U);
+}
@@ -0,0 +1,57 @@
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "pyis/ops/tokenizer/basic_tokenizer.h"
+
+using pyis::ops::BasicTokenizer;
+
+TEST(TestBasicTokenizer, TestAscii) {
+    BasicTokenizer tokenizer(true, true, true, true, true);
+    std::vector<std::string> expected{"hello", "!", "how", "are", "you", "?", "it", "'", "s", "a", "_", "b", "fine"};
+    ASSERT_EQ(tokenizer.Tokenize(" \tHeLLo!How  are\n you?  It's a_b\x01 fine\r\n"), expected);
+    ASSERT_TRUE(tokenizer.Tokenize("").empty());
+    ASSERT_TRUE(tokenizer.Tokenize(" \t\n").empty());
+
+    BasicTokenizer cased(false, true, false, false, false);
+    expected = {"HeLLo!", "It's", "a\x01"};
+    ASSERT_EQ(cased.Tokenize("HeLLo! It's a\x01"), expected);
+}
+
+TEST(TestBasicTokenizer, TestUnicode) {
+    BasicTokenizer tokenizer(true, true, true, true, true);
+    // combining accents are dropped and zero width spaces removed as format characters
+    std::vector<std::string> expected{"cafe", "北", "京", "amelie", "«", "ωμεγα", "»", "\xe2\x80\x99", "ok"};
+    ASSERT_EQ(tokenizer.Tokenize("Café北京ame\xcc\x80lie\xe3\x80\x80«ΩΜΕΓΑ»\xe2\x80\x99O\xe2\x80\x8bK"), expected);
+
+    BasicTokenizer cased(false, false, false, true, false);
+    expected = {"Café北京", "«", "Ω", "»"};
+    ASSERT_EQ(cased.Tokenize("Café北京 «Ω»"), expected);
+}
+
+TEST(TestBasicTokenizer, TestInvalidUtf8) {
+    BasicTokenizer tokenizer(true, true, true, true, true);
+    std::vector<std::string> expected{"a\xff\xc3", "b", "\xe4\xb8"};
+    ASSERT_EQ(tokenizer.Tokenize("A\xff\xc3 B \xe4\xb8"), expected);
+}
+
+TEST(TestBasicTokenizer, TestTokenOffsets) {
+    BasicTokenizer tokenizer(true, true, true, true, true);
+    std::string text = " Café, 北京\xe2\x80\x8b x\xff ";
+    std::vector<std::pair<size_t, size_t>> expected{{1, 6}, {6, 7}, {8, 11}, {11, 14}, {18, 20}};
+    ASSERT_EQ(tokenizer.TokenOffsets(text), expected);
+    ASSERT_EQ(tokenizer.Tokenize(text).size(), expected.size());
+    ASSERT_TRUE(tokenizer.TokenOffsets("").empty());
+}
+
+TEST(TestBasicTokenizer, TestCharSpans) {
+    BasicTokenizer tokenizer(true, true, true, true, true);
+    std::vector<std::pair<size_t, size_t>> char_spans;
+    // "É" is normalized to one byte, "\xff" is kept as it is
+    std::string text = " \xc3\x89t\xc3\xa9, x\xff";
+    std::vector<std::string> expected{"ete", ",", "x\xff"};
+    ASSERT_EQ(tokenizer.Tokenize(text, char_spans), expected);
+    std::vector<std::pair<size_t, size_t>> expected_spans{{1, 3}, {3, 4}, {4, 6}, {6, 7}, {8, 9}, {9, 10}};
+    ASSERT_EQ(char_spans, expected_spans);
+}
@@ -0,0 +1,79 @@
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "pyis/ops/tokenizer/bert_tokenizer.h"
+
+using pyis::ops::BertTokenizer;
+using Offsets = std::vector<std::pair<int64_t, int64_t>>;
+
+namespace {
+
+const char* VOCAB_FILE = "tests/test_wordpiece_tokenizer/data/vocab.txt";
+
+}  // namespace
+
+TEST(TestBertTokenizer, TestOffsets) {
+    BertTokenizer tokenizer(VOCAB_FILE, true, true, "[CLS]", "[SEP]", "[UNK]", "[PAD]", "[MASK]", true, true);
+    // "É" is lowercased and stripped, so the pieces are mapped back to the characters of the text
+    std::string text = " Unaffable, \xc3\x89T\xc3\x89\xc3\xa9 wanted";
+    Offsets offsets;
+    auto ids = tokenizer.EncodeIdsWithOffsets(text, offsets);
+    ASSERT_EQ(ids, tokenizer.EncodeIds(text));
+    std::vector<std::string> expected{"un", "##aff", "##able", ",", "[UNK]", "want", "##ed"};
+    ASSERT_EQ(tokenizer.Tokenize(text), expected);
+    Offsets expected_offsets{{1, 3}, {3, 6}, {6, 10}, {10, 11}, {12, 19}, {20, 24}, {24, 26}};
+    ASSERT_EQ(offsets, expected_offsets);
+
+    Offsets offset_mapping;
+    auto encoded = tokenizer.EncodePlus(text, 100, offset_mapping);
+    ASSERT_EQ(encoded.size(), ids.size() + 2);
+    Offsets specials{offset_mapping.front(), offset_mapping.back()};
+    ASSERT_EQ(specials, Offsets({{0, 0}, {0, 0}}));
+    ASSERT_EQ(Offsets(offset_mapping.begin() + 1, offset_mapping.end() - 1), offsets);
+}
+
+TEST(TestBertTokenizer, TestOffsetsWithoutBasicTokenize) {
+    BertTokenizer tokenizer(VOCAB_FILE, false, false);
+    Offsets offsets;
+    tokenizer.EncodeIdsWithOffsets("une wanted", offsets);
+    Offsets expected_offsets{{0, 3}, {4, 8}, {8, 10}};
+    ASSERT_EQ(offsets, expected_offsets);
+}
+
+TEST(TestBertTokenizer, TestIncrementalDecoder) {
+    BertTokenizer tokenizer(VOCAB_FILE);
+    auto ids = tokenizer.Encode("unaffable, wanted running");
+    auto decoder = tokenizer.CreateIncrementalDecoder(true, true);
+    std::vector<std::string> pieces;
+    for (auto id : ids) {
+        pieces.push_back(decoder->Step(id));
+    }
+    pieces.push_back(decoder->Flush());
+    // the text from a space on is held back until the next bytes show whether clean up removes the space, e.g. the
+    // one before ","
+    std::vector<std::string> expected{"", "un", "aff", "able", "", ", want", "ed", " running", "", ""};
+    ASSERT_EQ(pieces, expected);
+
+    std::mt19937 rng(7);
+    auto vocab_size = static_cast<int64_t>(tokenizer.GetVocab().size());
+    for (int round = 0; round < 1000; round++) {
+        std::vector<int64_t> code;
+        for (size_t i = rng() % 20; i > 0; i--) {
+            code.push_back(rng() % vocab_size);
+        }
+        for (bool clean_up : {false, true}) {
+            for (bool skip : {false, true}) {
+                decoder = tokenizer.CreateIncrementalDecoder(skip, clean_up);
+                std::string decoded;
+                for (auto id : code) {
+                    decoded += decoder->Step(id);
+                }
+                decoded += decoder->Flush();
+                ASSERT_EQ(decoded, tokenizer.Decode(code, skip, clean_up));
+            }
+        }
+    }
+}
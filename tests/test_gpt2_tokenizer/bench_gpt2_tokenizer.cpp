@@ -0,0 +1,140 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "pyis/ops/tokenizer/gpt2_tokenizer.h"
+
+// Throughput benchmark, disabled by default. It needs the vocab.json and merges.txt of GPT-2, e.g. the ones saved
+// by py/pyis-python/tests/test_gpt2_tokenizer, in the directory given by PYIS_GPT2_VOCAB_DIR (tmp by default). Run it
+// with
+//   test_pyis_cpp --gtest_also_run_disabled_tests --gtest_filter=GPT2TokenizerBench.*
+
+namespace {
+
+// sentences of words drawn from a skewed vocabulary, so that both frequent and rare words show up
+std::vector<std::string> GenerateSentences(size_t count, int min_word_len, int max_word_len, std::mt19937& rng) {
+    const char charlist[] = "etaoinshrdlcumwfgypbvkjxqz";
+    std::vector<std::string> vocab;
+    for (int i = 0; i < 50000; i++) {
+        std::string word;
+        int len = static_cast<int>(rng() % (max_word_len - min_word_len + 1)) + min_word_len;
+        for (int j = 0; j < len; j++) {
+            word += charlist[std::min(rng() % 26, rng() % 26)];
+        }
+        vocab.emplace_back(word);
+    }
+
+    std::vector<std::string> sentences;
+    for (size_t i = 0; i < count; i++) {
+        std::string sentence;
+        for (int j = 0; j < 20; j++) {
+            size_t index = std::min(rng() % vocab.size(), std::min(rng() % vocab.size(), rng() % vocab.size()));
+            sentence += (j == 0 ? "" : " ") + vocab[index] + (j % 7 == 6 ? "," : "");
+        }
+        sentences.emplace_back(sentence + ".");
+    }
+    return sentences;
+}
+
+}  // namespace
+
+TEST(GPT2TokenizerBench, DISABLED_Tokenize) {
+    const char* env_dir = std::getenv("PYIS_GPT2_VOCAB_DIR");
+    std::string dir = env_dir != nullptr ? env_dir : "tmp";
+    std::string vocab_file = dir + "/vocab.json";
+    std::string merges_file = dir + "/merges.txt";
+    if (!std::ifstream(vocab_file).good() || !std::ifstream(merges_file).good()) {
+        GTEST_SKIP() << "GPT-2 vocab not found in " << dir;
+    }
+
+    std::mt19937 rng(42);
+    // short words like in prose, and long ones like in urls or identifiers
+    for (auto word_len : {std::make_pair(2, 11), std::make_pair(40, 120)}) {
+        pyis::ops::GPT2Tokenizer tokenizer(vocab_file, merges_file);
+        auto sentences = GenerateSentences(20000, word_len.first, word_len.second, rng);
+
+        // the first pass mostly runs bpe, the following ones mostly hit the cache
+        for (int pass = 0; pass < 3; pass++) {
+            size_t tokens = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (const auto& s : sentences) {
+                tokens += tokenizer.Tokenize(s).size();
+            }
+            auto end = std::chrono::steady_clock::now();
+            double seconds = std::chrono::duration<double>(end - start).count();
+            std::cout << "words of " << word_len.first << " to " << word_len.second << " bytes, pass " << pass
+                      << ": " << tokens << " tokens, " << static_cast<size_t>(tokens / seconds) << " tokens/s"
+                      << std::endl;
+        }
+    }
+}
+
+TEST(GPT2TokenizerBench, DISABLED_EncodeDocument) {
+    const char* env_dir = std::getenv("PYIS_GPT2_VOCAB_DIR");
+    std::string dir = env_dir != nullptr ? env_dir : "tmp";
+    std::string vocab_file = dir + "/vocab.json";
+    std::string merges_file = dir + "/merges.txt";
+    if (!std::ifstream(vocab_file).good() || !std::ifstream(merges_file).good()) {
+        GTEST_SKIP() << "GPT-2 vocab not found in " << dir;
+    }
+
+    pyis::ops::GPT2Tokenizer tokenizer(vocab_file, merges_file);
+    std::mt19937 rng(42);
+    auto sentences = GenerateSentences(8000, 2, 11, rng);
+    // documents of 1k, 8k and 64k words, the time per token should not grow with the length
+    for (size_t count : {50, 400, 3200}) {
+        std::string document;
+        for (size_t i = 0; i < count; i++) {
+            document += (i == 0 ? "" : " ") + sentences[i];
+        }
+
+        for (int tokenize = 0; tokenize < 2; tokenize++) {
+            auto start = std::chrono::steady_clock::now();
+            size_t tokens = tokenize != 0 ? tokenizer.Tokenize(document).size() : tokenizer.Encode(document).size();
+            auto end = std::chrono::steady_clock::now();
+            double seconds = std::chrono::duration<double>(end - start).count();
+            std::cout << (tokenize != 0 ? "Tokenize" : "Encode") << " " << document.size() << " bytes: " << tokens
+                      << " tokens, " << static_cast<size_t>(tokens / seconds) << " tokens/s" << std::endl;
+        }
+    }
+}
+
+TEST(GPT2TokenizerBench, DISABLED_Load) {
+    const char* env_dir = std::getenv("PYIS_GPT2_VOCAB_DIR");
+    std::string dir = env_dir != nullptr ? env_dir : "tmp";
+    std::string vocab_file = dir + "/vocab.json";
+    std::string merges_file = dir + "/merges.txt";
+    if (!std::ifstream(vocab_file).good() || !std::ifstream(merges_file).good()) {
+        GTEST_SKIP() << "GPT-2 vocab not found in " << dir;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    pyis::ops::GPT2Tokenizer tokenizer(vocab_file, merges_file);
+    auto end = std::chrono::steady_clock::now();
+    std::cout << "load json and merges: " << std::chrono::duration<double, std::milli>(end - start).count() << " ms"
+              << std::endl;
+
+    std::string snapshot_file = dir + "/vocab.bin";
+    {
+        std::ofstream os(snapshot_file, std::ios::out | std::ios::binary);
+        tokenizer.SaveSnapshot(os);
+    }
+    start = std::chrono::steady_clock::now();
+    pyis::ops::GPT2Tokenizer loaded;
+    loaded.Load(pyis::ops::VocabSnapshot::Open(snapshot_file), "[UNK]");
+    end = std::chrono::steady_clock::now();
+    std::cout << "load snapshot: " << std::chrono::duration<double, std::milli>(end - start).count() << " ms"
+              << std::endl;
+    std::remove(snapshot_file.c_str());
+
+    std::mt19937 rng(42);
+    for (const auto& s : GenerateSentences(1000, 2, 11, rng)) {
+        ASSERT_EQ(loaded.Encode(s), tokenizer.Encode(s));
+    }
+}
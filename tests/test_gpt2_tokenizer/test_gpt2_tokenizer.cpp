@@ -0,0 +1,328 @@
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "pyis/ops/tokenizer/gpt2_tokenizer.h"
+
+using pyis::ops::GPT2Tokenizer;
+
+namespace {
+
+const char* VOCAB_FILE = "tests/test_gpt2_tokenizer/data/vocab.json";
+const char* MERGES_FILE = "tests/test_gpt2_tokenizer/data/merges.txt";
+
+}  // namespace
+
+TEST(TestGPT2Tokenizer, TestTokenize) {
+    GPT2Tokenizer tokenizer(VOCAB_FILE, MERGES_FILE);
+    std::vector<std::string> expected{"low", "er", "Ġnew", "est", "Ġ", "Ġnew", "er"};
+    ASSERT_EQ(tokenizer.Tokenize("lower newest  newer"), expected);
+    ASSERT_TRUE(tokenizer.Tokenize("   ").empty());
+}
+
+TEST(TestGPT2Tokenizer, TestMergeOrder) {
+    GPT2Tokenizer tokenizer(VOCAB_FILE, MERGES_FILE);
+    // "aa a" is ranked before "a a", but only applies after every "a a" of the word is merged
+    std::vector<std::string> expected{"aa", "aa", "Ġ", "aa", "aaa", "Ġ", "a"};
+    ASSERT_EQ(tokenizer.Tokenize("aaaa aaaaa a"), expected);
+}
+
+TEST(TestGPT2Tokenizer, TestCachedWords) {
+    GPT2Tokenizer tokenizer(VOCAB_FILE, MERGES_FILE);
+    auto first = tokenizer.Tokenize("lower lower newest lower");
+    auto second = tokenizer.Tokenize("lower lower newest lower");
+    ASSERT_EQ(first, second);
+    std::vector<std::string> expected{"low", "er", "Ġlower", "Ġnew", "est", "Ġlower"};
+    ASSERT_EQ(second, expected);
+}
+
+TEST(TestGPT2Tokenizer, TestEncodeIds) {
+    GPT2Tokenizer tokenizer(VOCAB_FILE, MERGES_FILE);
+    std::string text = "It's lower  than the newest one's 123, isn't it?\t\n 中文 😙 aaaaa  ";
+    std::string document;
+    for (int i = 0; i < 100; i++) {
+        document += text;
+    }
+
+    for (const auto& query : {text, document}) {
+        auto tokens = tokenizer.Tokenize(query);
+        auto ids = tokenizer.EncodeIds(query);
+        ASSERT_EQ(ids.size(), tokens.size());
+        for (size_t i = 0; i < ids.size(); i++) {
+            ASSERT_EQ(ids[i], tokenizer.ConvertTokenToId(tokens[i]));
+        }
+        ASSERT_EQ(tokenizer.Encode(query), ids);
+    }
+}
+
+TEST(TestGPT2Tokenizer, TestInvalidUtf8) {
+    GPT2Tokenizer tokenizer(VOCAB_FILE, MERGES_FILE);
+    // a truncated character at the end is dropped
+    std::vector<std::string> expected{"low", "er", "Ġ", "Ã", "©"};
+    ASSERT_EQ(tokenizer.Tokenize("lower \xC3\xA9\xE4\xB8"), expected);
+    ASSERT_THROW(tokenizer.Tokenize("lower \xC3\xA9\xE4 lower"), std::runtime_error);
+    ASSERT_THROW(tokenizer.EncodeIds("\x80 lower"), std::runtime_error);
+}
+
+TEST(TestGPT2Tokenizer, TestConcurrentTokenize) {
+    GPT2Tokenizer tokenizer(VOCAB_FILE, MERGES_FILE);
+    std::vector<std::string> queries{"lower newest", "aaaa aaaaa", "newer lowest", "low low low"};
+    std::vector<std::vector<std::string>> expected;
+    for (const auto& q : queries) {
+        expected.emplace_back(GPT2Tokenizer(VOCAB_FILE, MERGES_FILE).Tokenize(q));
+    }
+
+    std::vector<std::thread> threads;
+    std::vector<int> failures(4, 0);
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < 1000; i++) {
+                size_t q = (i + t) % queries.size();
+                if (tokenizer.Tokenize(queries[q]) != expected[q]) {
+                    failures[t]++;
+                }
+            }
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    for (int f : failures) {
+        ASSERT_EQ(f, 0);
+    }
+}
+
+TEST(TestGPT2Tokenizer, TestEncodeBatch) {
+    GPT2Tokenizer tokenizer(VOCAB_FILE, MERGES_FILE);
+    tokenizer.SetThreadNum(3);
+    std::vector<std::string> queries{"lower newest", "", "aaaa aaaaa a", "low", "newer lowest", "low low low"};
+    auto batch = tokenizer.EncodeBatch(queries);
+    ASSERT_EQ(batch.batch_size_, queries.size());
+
+    size_t longest = 0;
+    for (const auto& q : queries) {
+        longest = std::max(longest, tokenizer.Encode(q).size());
+    }
+    ASSERT_EQ(batch.sequence_length_, longest);
+    ASSERT_EQ(batch.input_ids_.size(), queries.size() * longest);
+    ASSERT_EQ(batch.attention_mask_.size(), queries.size() * longest);
+    ASSERT_EQ(batch.token_type_ids_, std::vector<int64_t>(queries.size() * longest, 0));
+    for (size_t i = 0; i < queries.size(); i++) {
+        auto ids = tokenizer.Encode(queries[i]);
+        std::vector<int64_t> row(batch.input_ids_.begin() + i * longest, batch.input_ids_.begin() + (i + 1) * longest);
+        std::vector<int64_t> mask(batch.attention_mask_.begin() + i * longest,
+                                  batch.attention_mask_.begin() + (i + 1) * longest);
+        ids.resize(longest, 0);
+        ASSERT_EQ(row, ids) << queries[i];
+        ASSERT_EQ(std::count(mask.begin(), mask.end(), 1), tokenizer.Encode(queries[i]).size());
+        ASSERT_TRUE(std::is_sorted(mask.rbegin(), mask.rend()));
+    }
+
+    auto padded = tokenizer.EncodeBatch(queries, 2, "max_length");
+    ASSERT_EQ(padded.sequence_length_, 2);
+    ASSERT_EQ(padded.attention_mask_[2], 0);
+    ASSERT_EQ(padded.attention_mask_[3], 0);
+    ASSERT_THROW(tokenizer.EncodeBatch(queries, 1e15, "max_length"), std::runtime_error);
+    ASSERT_THROW(tokenizer.EncodeBatch(queries, 2, "right"), std::runtime_error);
+    ASSERT_EQ(tokenizer.EncodeBatch({}).input_ids_.size(), 0);
+}
+
+// Python threads may call SetThreadNum while EncodeBatch runs without the GIL
+TEST(TestGPT2Tokenizer, TestSetThreadNumDuringEncodeBatch) {
+    GPT2Tokenizer tokenizer(VOCAB_FILE, MERGES_FILE);
+    std::vector<std::string> queries(200, "lower newest aaaa low");
+    auto expected = tokenizer.EncodeBatch(queries).input_ids_;
+    std::vector<std::thread> workers;
+    for (int w = 0; w < 3; w++) {
+        workers.emplace_back([&]() {
+            for (int i = 0; i < 5; i++) {
+                EXPECT_EQ(tokenizer.EncodeBatch(queries).input_ids_, expected);
+            }
+        });
+    }
+    for (size_t i = 0; i < 20; i++) {
+        tokenizer.SetThreadNum(i % 4);
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+TEST(TestGPT2Tokenizer, TestOffsets) {
+    GPT2Tokenizer tokenizer(VOCAB_FILE, MERGES_FILE);
+    tokenizer.Add("<|endoftext|>", tokenizer.ConvertTokenToId("<|endoftext|>"));
+    std::string text = "lower newest<|endoftext|> caf\xc3\xa9  newer";
+    std::vector<std::pair<int64_t, int64_t>> offsets;
+    auto ids = tokenizer.EncodeIdsWithOffsets(text, offsets);
+    ASSERT_EQ(ids, tokenizer.EncodeIds(text));
+    ASSERT_EQ(offsets.size(), ids.size());
+    // the tokens cover the text in order, and each one is the bytes it was encoded from
+    int64_t pos = 0;
+    for (size_t i = 0; i < ids.size(); i++) {
+        ASSERT_EQ(offsets[i].first, pos);
+        ASSERT_GT(offsets[i].second, offsets[i].first);
+        pos = offsets[i].second;
+    }
+    ASSERT_EQ(pos, text.size());
+    using Offsets = std::vector<std::pair<int64_t, int64_t>>;
+    Offsets expected{{0, 3}, {3, 5}, {5, 9}, {9, 12}, {12, 25}};
+    ASSERT_EQ(Offsets(offsets.begin(), offsets.begin() + 5), expected);
+
+    Offsets offset_mapping;
+    auto encoded = tokenizer.EncodePlus(text, 3, offset_mapping);
+    ASSERT_EQ(encoded.size(), 3);
+    ASSERT_EQ(offset_mapping, Offsets(offsets.begin(), offsets.begin() + 3));
+}
+
+TEST(TestGPT2Tokenizer, TestOffsetsOfUnknownMerges) {
+    // the merges give "ab" and "aba", which are not in the vocab
+    std::istringstream vocab(R"({"a": 0, "b": 1, "c": 2, "<|endoftext|>": 3})");
+    std::istringstream merges("a b\nab a\n");
+    GPT2Tokenizer tokenizer;
+    tokenizer.Load(vocab, merges, "<|endoftext|>");
+    std::vector<std::pair<int64_t, int64_t>> offsets;
+    auto ids = tokenizer.EncodeIdsWithOffsets("cabacab", offsets);
+    ASSERT_EQ(ids, std::vector<int64_t>({2, 3, 2, 3}));
+    std::vector<std::pair<int64_t, int64_t>> expected{{0, 1}, {1, 4}, {4, 5}, {5, 7}};
+    ASSERT_EQ(offsets, expected);
+}
+
+TEST(TestGPT2Tokenizer, TestSnapshot) {
+    GPT2Tokenizer tokenizer(VOCAB_FILE, MERGES_FILE);
+    std::stringstream snapshot;
+    tokenizer.SaveSnapshot(snapshot);
+    GPT2Tokenizer loaded;
+    loaded.Load(pyis::ops::VocabSnapshot::Read(snapshot), "[UNK]");
+
+    std::string text = "It's lower  than the newest one's 123, isn't it?\t\n 中文 😙 aaaaa  ";
+    ASSERT_EQ(loaded.Tokenize(text), tokenizer.Tokenize(text));
+    ASSERT_EQ(loaded.Encode(text), tokenizer.Encode(text));
+    ASSERT_EQ(loaded.GetVocab(), tokenizer.GetVocab());
+    std::vector<std::pair<int64_t, int64_t>> offsets;
+    std::vector<std::pair<int64_t, int64_t>> loaded_offsets;
+    ASSERT_EQ(loaded.EncodeIdsWithOffsets(text, loaded_offsets), tokenizer.EncodeIdsWithOffsets(text, offsets));
+    ASSERT_EQ(loaded_offsets, offsets);
+    auto ids = tokenizer.EncodeIds("lower newest");
+    for (auto id : ids) {
+        ASSERT_EQ(loaded.ConvertIdToToken(id), tokenizer.ConvertIdToToken(id));
+    }
+
+    // saving a loaded snapshot gives the same bytes
+    std::stringstream saved;
+    loaded.SaveSnapshot(saved);
+    ASSERT_EQ(saved.str(), snapshot.str());
+}
+
+TEST(TestGPT2Tokenizer, TestCorruptedSnapshot) {
+    GPT2Tokenizer tokenizer(VOCAB_FILE, MERGES_FILE);
+    std::stringstream snapshot;
+    tokenizer.SaveSnapshot(snapshot);
+    std::string bytes = snapshot.str();
+
+    std::istringstream truncated(bytes.substr(0, bytes.size() / 2));
+    ASSERT_THROW(pyis::ops::VocabSnapshot::Read(truncated), std::runtime_error);
+    std::string wrong_magic = bytes;
+    wrong_magic[0] = 'X';
+    std::istringstream not_snapshot(wrong_magic);
+    ASSERT_THROW(pyis::ops::VocabSnapshot::Read(not_snapshot), std::runtime_error);
+    std::istringstream valid(bytes);
+    ASSERT_THROW(GPT2Tokenizer().Load(pyis::ops::VocabSnapshot::Read(valid), "<|missing|>"), std::runtime_error);
+
+    // an offset out of the pool, while the last one is still valid. The offsets start at the offset stored after the
+    // 32 bytes of magic and counts and the 8 bytes of the pool size.
+    uint64_t offsets_offset = 0;
+    memcpy(&offsets_offset, bytes.data() + 40, sizeof(offsets_offset));
+    std::string bad_offset = bytes;
+    uint32_t offset = 0xfffffff0;
+    memcpy(&bad_offset[offsets_offset + sizeof(uint32_t)], &offset, sizeof(offset));
+    std::istringstream bad_offset_snapshot(bad_offset);
+    ASSERT_THROW(pyis::ops::VocabSnapshot::Read(bad_offset_snapshot), std::runtime_error);
+
+    // a pool offset, stored after the offsets offset, which wraps around when the pool size is added to it
+    std::string wrapped = bytes;
+    uint64_t pool_offset = 0xfffffffffffffff8ULL;
+    memcpy(&wrapped[48], &pool_offset, sizeof(pool_offset));
+    std::istringstream wrapped_snapshot(wrapped);
+    ASSERT_THROW(pyis::ops::VocabSnapshot::Read(wrapped_snapshot), std::runtime_error);
+}
+
+TEST(TestGPT2Tokenizer, TestDecode) {
+    GPT2Tokenizer tokenizer(VOCAB_FILE, MERGES_FILE);
+    std::string text = "It's lower  than the newest one's 123, isn't it?\t\n 中文 😙 aaaaa  ";
+    ASSERT_EQ(tokenizer.Decode(tokenizer.Encode(text), false, false), text);
+    ASSERT_EQ(tokenizer.Decode(tokenizer.Encode("newer , isn't"), false, true), "newer, isn't");
+    // the bytes of a character split by the end of the ids are replaced
+    auto ids = tokenizer.Encode("中");
+    ids.pop_back();
+    ASSERT_EQ(tokenizer.Decode(ids, false, false), "\xEF\xBF\xBD");
+
+    auto eos = tokenizer.ConvertTokenToId("<|endoftext|>");
+    ids = tokenizer.Encode("lower");
+    ids.push_back(eos);
+    ASSERT_EQ(tokenizer.Decode(ids, false, false), "lower<|endoftext|>");
+    ASSERT_EQ(tokenizer.Decode(ids, true, false), "lower<|endoftext|>");
+    tokenizer.Add("<|endoftext|>", static_cast<int>(eos));
+    ASSERT_EQ(tokenizer.Decode(ids, true, false), "lower");
+}
+
+TEST(TestGPT2Tokenizer, TestIncrementalDecoder) {
+    GPT2Tokenizer tokenizer(VOCAB_FILE, MERGES_FILE);
+    std::string text = "中文 😙";
+    auto ids = tokenizer.Encode(text);
+    auto decoder = tokenizer.CreateIncrementalDecoder(false, false);
+    std::string decoded;
+    for (auto id : ids) {
+        std::string piece = decoder->Step(id);
+        // only complete characters are returned
+        ASSERT_TRUE(piece.empty() || (static_cast<uint8_t>(piece[0]) & 0xC0) != 0x80);
+        decoded += piece;
+    }
+    ASSERT_EQ(decoded + decoder->Flush(), text);
+
+    // with clean up, text without spaces still streams, and only the text from the last space on is held back
+    for (std::string text : {"中文中文中文中文", "https://github.com/microsoft/pyis", "Hello world, it"}) {
+        ids = tokenizer.Encode(text);
+        decoder = tokenizer.CreateIncrementalDecoder(false, true);
+        decoded.clear();
+        for (size_t i = 0; i < ids.size(); i++) {
+            decoded += decoder->Step(ids[i]);
+            if (i == ids.size() / 2) {
+                ASSERT_FALSE(decoded.empty());
+            }
+        }
+        ASSERT_EQ(decoded, text.substr(0, std::min(text.size(), text.rfind(' '))));
+        ASSERT_EQ(decoded + decoder->Flush(), text);
+    }
+
+    // random ids split characters and make invalid bytes, and the ones of spaces, quotes and punctuation make clean
+    // up patterns across the pieces
+    std::mt19937 rng(7);
+    auto vocab = tokenizer.GetVocab();
+    std::vector<int64_t> clean_up_ids;
+    for (const char* token : {"Ġ", "'", ".", ",", "?", "s", "n", "t", "m", "v", "e", "r", "a", "Ġn"}) {
+        clean_up_ids.push_back(tokenizer.ConvertTokenToId(token));
+    }
+    for (int round = 0; round < 2000; round++) {
+        std::vector<int64_t> code;
+        for (size_t i = rng() % 20; i > 0; i--) {
+            code.push_back(round % 2 == 0 ? rng() % vocab.size() : clean_up_ids[rng() % clean_up_ids.size()]);
+        }
+        for (bool clean_up : {false, true}) {
+            for (bool skip : {false, true}) {
+                decoder = tokenizer.CreateIncrementalDecoder(skip, clean_up);
+                decoded.clear();
+                for (auto id : code) {
+                    decoded += decoder->Step(id);
+                }
+                decoded += decoder->Flush();
+                ASSERT_EQ(decoded, tokenizer.Decode(code, skip, clean_up));
+            }
+        }
+    }
+}
@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <list>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "pyis/ops/tokenizer/special_token_splitter.h"
+
+using pyis::ops::SpecialTokenSplitter;
+
+namespace {
+
+using Pieces = std::vector<std::pair<std::string, int>>;
+
+Pieces split(const SpecialTokenSplitter& splitter, const std::string& text) {
+    std::vector<SpecialTokenSplitter::Fragment> fragments;
+    splitter.Split(text.data(), text.size(), fragments);
+    Pieces pieces;
+    for (const auto& f : fragments) {
+        pieces.emplace_back(text.substr(f.begin_, f.end_ - f.begin_), f.id_);
+    }
+    return pieces;
+}
+
+// split the text by one token after another with std::search, as GPT2Tokenizer did
+Pieces split_by_search(const std::vector<std::pair<std::string, int>>& tokens, const std::string& text) {
+    std::list<std::pair<std::string, int>> res{{text, -1}};
+    for (const auto& token : tokens) {
+        std::list<std::pair<std::string, int>> next;
+        for (auto& piece : res) {
+            if (piece.second != -1) {
+                next.push_back(piece);
+                continue;
+            }
+            size_t pos = 0;
+            while (pos < piece.first.size()) {
+                auto it = std::search(piece.first.begin() + pos, piece.first.end(), token.first.begin(),
+                                      token.first.end());
+                if (it == piece.first.end()) {
+                    next.emplace_back(piece.first.substr(pos), -1);
+                    break;
+                }
+                size_t found = it - piece.first.begin();
+                if (found != pos) {
+                    next.emplace_back(piece.first.substr(pos, found - pos), -1);
+                }
+                next.emplace_back(token.first, token.second);
+                pos = found + token.first.size();
+            }
+        }
+        res.swap(next);
+    }
+    Pieces pieces;
+    for (auto& piece : res) {
+        if (!piece.first.empty()) {
+            pieces.push_back(piece);
+        }
+    }
+    return pieces;
+}
+
+}  // namespace
+
+TEST(TestSpecialTokenSplitter, TestSplit) {
+    SpecialTokenSplitter splitter;
+    ASSERT_EQ(split(splitter, "abc"), Pieces({{"abc", -1}}));
+    ASSERT_TRUE(split(splitter, "").empty());
+
+    splitter.Add("<|endoftext|>", 0);
+    splitter.Add("<|end|>", 1);
+    Pieces expected{{"hi", -1}, {"<|end|>", 1}, {" ", -1}, {"<|endoftext|>", 0}, {"<|endoftext|>", 0}, {"!", -1}};
+    ASSERT_EQ(split(splitter, "hi<|end|> <|endoftext|><|endoftext|>!"), expected);
+    ASSERT_THROW(splitter.Add("", 2), std::runtime_error);
+}
+
+TEST(TestSpecialTokenSplitter, TestPrecedence) {
+    SpecialTokenSplitter splitter;
+    // "b" is added first, so "abc" never matches in "abc", while "ab" still does before it
+    splitter.Add("b", 0);
+    splitter.Add("abc", 1);
+    ASSERT_EQ(split(splitter, "abc"), Pieces({{"a", -1}, {"b", 0}, {"c", -1}}));
+    ASSERT_EQ(split(splitter, "aabcc"), Pieces({{"aa", -1}, {"b", 0}, {"cc", -1}}));
+
+    SpecialTokenSplitter overlapping;
+    overlapping.Add("aa", 0);
+    ASSERT_EQ(split(overlapping, "aaaaa"), Pieces({{"aa", 0}, {"aa", 0}, {"a", -1}}));
+}
+
+TEST(TestSpecialTokenSplitter, TestSameAsSearch) {
+    std::mt19937 rng(7);
+    auto random_string = [&rng](size_t max_len) {
+        std::string s(rng() % max_len + 1, 'a');
+        for (auto& c : s) {
+            c = static_cast<char>('a' + rng() % 3);
+        }
+        return s;
+    };
+    for (int round = 0; round < 2000; round++) {
+        SpecialTokenSplitter splitter;
+        std::vector<std::pair<std::string, int>> tokens;
+        size_t token_count = rng() % 6;
+        for (size_t i = 0; i < token_count; i++) {
+            std::string token = random_string(4);
+            if (std::none_of(tokens.begin(), tokens.end(), [&](const std::pair<std::string, int>& t) {
+                    return t.first == token;
+                })) {
+                tokens.emplace_back(token, static_cast<int>(i));
+                splitter.Add(token, static_cast<int>(i));
+            }
+        }
+        std::string text = random_string(30);
+        ASSERT_EQ(split(splitter, text), split_by_search(tokens, text)) << text;
+    }
+}
+
+// Throughput with many special tokens against splitting by one token after another. Disabled by default, run it with
+//   test_pyis_cpp --gtest_also_run_disabled_tests --gtest_filter=SpecialTokenSplitterBench.*
+TEST(SpecialTokenSplitterBench, DISABLED_Split) {
+    std::vector<std::pair<std::string, int>> tokens;
+    SpecialTokenSplitter splitter;
+    for (int i = 0; i < 300; i++) {
+        tokens.emplace_back("<|extra_" + std::to_string(i) + "|>", i);
+        splitter.Add(tokens.back().first, i);
+    }
+    std::string text;
+    for (int i = 0; i < 2000; i++) {
+        text += "the quick brown fox jumps over the lazy dog ";
+        if (i % 50 == 0) {
+            text += tokens[i % tokens.size()].first;
+        }
+    }
+
+    auto bench = [&text](const char* name, const std::function<Pieces()>& fn) {
+        auto start = std::chrono::steady_clock::now();
+        size_t pieces = 0;
+        for (int i = 0; i < 10; i++) {
+            pieces += fn().size();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << name << ": " << pieces << " pieces, " << static_cast<size_t>(10 * text.size() / seconds / 1e6)
+                  << " MB/s" << std::endl;
+    };
+    bench("automaton", [&]() { return split(splitter, text); });
+    bench("search", [&]() { return split_by_search(tokens, text); });
+    ASSERT_EQ(split(splitter, text), split_by_search(tokens, text));
+}
@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "pyis/ops/text/edge_list_search.h"
+#include "pyis/ops/text/immutable_trie.h"
+
+// Throughput benchmarks, disabled by default. Run them with
+//   test_pyis_cpp --gtest_also_run_disabled_tests --gtest_filter=ImmutableTrieBench.*
+
+namespace {
+
+template <typename F>
+double NanosecondsPerCall(size_t calls, F f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / static_cast<double>(calls);
+}
+
+// phrases of 1 to 3 words drawn from a skewed vocabulary, similar to a gazetteer
+std::vector<std::tuple<std::string, uint32_t>> GenerateGazetteer(size_t size, std::mt19937& rng) {
+    const char charlist[] = "abcdefghijklmnopqrstuvwxyz";
+    std::vector<std::string> vocab;
+    for (int i = 0; i < 20000; i++) {
+        std::string word;
+        int len = rng() % 8 + 3;
+        for (int j = 0; j < len; j++) {
+            // skew towards the first letters so that nodes have many children
+            word += charlist[std::min(rng() % 26, rng() % 26)];
+        }
+        vocab.emplace_back(word);
+    }
+
+    std::vector<std::tuple<std::string, uint32_t>> data;
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < size; i++) {
+        std::string phrase = vocab[rng() % vocab.size()];
+        for (int j = rng() % 3; j > 0; j--) {
+            phrase += " " + vocab[rng() % vocab.size()];
+        }
+        keys.emplace_back(phrase);
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    for (size_t i = 0; i < keys.size(); i++) {
+        data.emplace_back(keys[i], static_cast<uint32_t>(i));
+    }
+    return data;
+}
+
+}  // namespace
+
+TEST(ImmutableTrieBench, DISABLED_EdgeListSearch) {
+    std::mt19937 rng(42);
+    std::vector<uint8_t> buffer(pyis::ops::EDGE_LIST_MAX_BYTES + pyis::ops::EDGE_LIST_OVERREAD);
+    const size_t calls = 2000000;
+
+    for (uint32_t stride = 2; stride <= pyis::ops::EDGE_LIST_MAX_STRIDE; stride++) {
+        for (uint32_t edges_cnt : {2, 8, 15}) {
+            for (auto& b : buffer) {
+                b = static_cast<uint8_t>(rng());
+            }
+            for (uint32_t i = 0; i < edges_cnt; i++) {
+                buffer[i * stride] = static_cast<uint8_t>(i + 4);
+            }
+            std::vector<uint8_t> queries(1024);
+            for (auto& q : queries) {
+                q = static_cast<uint8_t>(rng() % (edges_cnt + 8) + 4);
+            }
+
+            int64_t checksum_scalar = 0;
+            int64_t checksum_simd = 0;
+            double scalar = NanosecondsPerCall(calls, [&]() {
+                for (size_t i = 0; i < calls; i++) {
+                    checksum_scalar += pyis::ops::FindEdgeScalar(buffer.data(), queries[i & 1023], stride, edges_cnt);
+                }
+            });
+            double simd = NanosecondsPerCall(calls, [&]() {
+                for (size_t i = 0; i < calls; i++) {
+                    checksum_simd += pyis::ops::FindEdge(buffer.data(), queries[i & 1023], stride, edges_cnt);
+                }
+            });
+            ASSERT_EQ(checksum_scalar, checksum_simd);
+            std::cout << "stride " << stride << ", " << edges_cnt << " edges: scalar " << scalar << " ns, vectorized "
+                      << simd << " ns" << std::endl;
+        }
+    }
+}
+
+TEST(ImmutableTrieBench, DISABLED_MatchLatency) {
+    std::mt19937 rng(42);
+    for (size_t size : {10000, 200000}) {
+        auto data = GenerateGazetteer(size, rng);
+        pyis::ops::ImmutableTrie trie(data);
+
+        std::vector<std::string> hits;
+        std::vector<std::string> misses;
+        for (size_t i = 0; i < 10000; i++) {
+            const auto& key = std::get<0>(data[rng() % data.size()]);
+            hits.emplace_back(key);
+            misses.emplace_back(key.substr(0, key.length() - 1) + "#");
+        }
+
+        size_t found = 0;
+        const size_t rounds = 50;
+        double hit = NanosecondsPerCall(rounds * hits.size(), [&]() {
+            for (size_t r = 0; r < rounds; r++) {
+                for (const auto& key : hits) {
+                    found += trie.Contains(key) ? 1 : 0;
+                }
+            }
+        });
+        double miss = NanosecondsPerCall(rounds * misses.size(), [&]() {
+            for (size_t r = 0; r < rounds; r++) {
+                for (const auto& key : misses) {
+                    found += trie.Contains(key) ? 1 : 0;
+                }
+            }
+        });
+        ASSERT_EQ(found, rounds * hits.size());
+        std::cout << data.size() << " keys: hit " << hit << " ns/lookup, miss " << miss << " ns/lookup" << std::endl;
+    }
+}
@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "gtest/gtest.h"
+#include "pyis/ops/text/edge_list_search.h"
 #include "pyis/ops/text/immutable_trie.h"
 
 TEST(ImmutableTrie, Basic) {
@@ -42,3 +43,83 @@ TEST(ImmutableTrie, Basic) {
         ASSERT_EQ(std::get<1>(x), match_result.value());
     }
 }
+
+TEST(ImmutableTrie, Mapped) {
+    std::vector<std::tuple<std::string, uint32_t>> data;
+    for (uint32_t i = 0; i < 5000; i++) {
+        data.emplace_back(std::make_tuple("key" + std::to_string(i * 7919), i));
+    }
+    system("mkdir tmp");
+    pyis::ops::ImmutableTrie::Compile(data, "tmp/trie_legacy.bin");
+    pyis::ops::ImmutableTrie::Compile(data, "tmp/trie_mapped.bin", true);
+
+    pyis::ops::ImmutableTrie legacy("tmp/trie_legacy.bin");
+    pyis::ops::ImmutableTrie mapped("tmp/trie_mapped.bin");
+    ASSERT_EQ(legacy.Items(), mapped.Items());
+    for (const auto& x : data) {
+        auto match_result = mapped.Match(std::get<0>(x));
+        ASSERT_FALSE(match_result.has_error());
+        ASSERT_EQ(std::get<1>(x), match_result.value());
+    }
+    ASSERT_FALSE(mapped.Contains("key1"));
+
+    // a mapped trie can be saved in either format again
+    mapped.Save("tmp/trie_resaved.bin");
+    pyis::ops::ImmutableTrie resaved("tmp/trie_resaved.bin");
+    ASSERT_EQ(legacy.Items(), resaved.Items());
+}
+
+TEST(ImmutableTrie, MappedVersion) {
+    std::vector<std::tuple<std::string, uint32_t>> data{std::make_tuple("key", 1)};
+    system("mkdir tmp");
+    pyis::ops::ImmutableTrie::Compile(data, "tmp/trie_v1.bin", true);
+
+    // files of the previous version have less padding than the edge list search reads past the trie data
+    std::fstream file("tmp/trie_v1.bin", std::ios::in | std::ios::out | std::ios::binary);
+    uint32_t version = 1;
+    file.seekp(8);
+    file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    file.close();
+    ASSERT_ANY_THROW(pyis::ops::ImmutableTrie("tmp/trie_v1.bin"));
+}
+
+TEST(ImmutableTrie, MatchAll) {
+    std::vector<std::tuple<std::string, uint32_t>> data{
+        {"new", 1}, {"new york", 2}, {"new york city", 3}, {"york", 4}, {"city", 5}, {"yo", 6}};
+    pyis::ops::ImmutableTrie trie(data);
+
+    std::vector<std::tuple<size_t, size_t, uint32_t>> expected{{0, 1, 1}, {0, 2, 2}, {0, 3, 3},
+                                                               {1, 2, 4}, {2, 3, 5}};
+    auto hits = trie.MatchAll(std::vector<std::string>{"new", "york", "city", "yorkshire"});
+    ASSERT_EQ(hits, expected);
+
+    // byte offsets of the same hits in a sentence, extra spaces are skipped
+    std::vector<std::tuple<size_t, size_t, uint32_t>> expected_offsets{{0, 3, 1}, {0, 8, 2}, {0, 14, 3},
+                                                                       {4, 8, 4}, {10, 14, 5}};
+    ASSERT_EQ(trie.MatchAll(std::string("new york  city yorkshire")), expected_offsets);
+
+    auto batch = trie.MatchAllBatch(std::vector<std::string>{"new york", "", "old york"});
+    ASSERT_EQ(batch.size(), 3);
+    ASSERT_EQ(batch[0].size(), 3);
+    ASSERT_TRUE(batch[1].empty());
+    ASSERT_EQ(batch[2], (std::vector<std::tuple<size_t, size_t, uint32_t>>{{4, 8, 4}}));
+}
+
+TEST(ImmutableTrie, FindEdge) {
+    std::vector<uint8_t> edges(pyis::ops::EDGE_LIST_MAX_BYTES + pyis::ops::EDGE_LIST_OVERREAD);
+    for (uint32_t stride = 2; stride <= pyis::ops::EDGE_LIST_MAX_STRIDE; stride++) {
+        for (uint32_t edges_cnt = 0; edges_cnt <= 15; edges_cnt++) {
+            // offset bytes and bytes past the list equal to the searched chars must not match
+            for (size_t i = 0; i < edges.size(); i++) {
+                edges[i] = static_cast<uint8_t>(i % 20);
+            }
+            for (uint32_t i = 0; i < edges_cnt; i++) {
+                edges[i * stride] = static_cast<uint8_t>(20 + i);
+            }
+            for (int ch = 0; ch < 40; ch++) {
+                ASSERT_EQ(pyis::ops::FindEdge(edges.data(), ch, stride, edges_cnt),
+                          pyis::ops::FindEdgeScalar(edges.data(), ch, stride, edges_cnt));
+            }
+        }
+    }
+}
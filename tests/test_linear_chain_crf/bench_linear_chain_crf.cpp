@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "linear_chain_crf_test_data.h"
+#include "pyis/ops/linear_chain_crf/linear_chain_crf.h"
+#include "pyis/ops/linear_chain_crf/src/CRFKernels.h"
+#include "pyis/ops/linear_chain_crf/src/VanillaCRF.h"
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+// Benchmarks of training and decoding, disabled by default. Run them with
+//   test_pyis_cpp --gtest_also_run_disabled_tests --gtest_filter=LinearChainCRFBench.*
+
+using pyis::ops::LinearChainCRF;
+using namespace SparseLinearChainCRF;
+using namespace linear_chain_crf_test;
+
+namespace {
+
+// microseconds per call of fn, over enough calls to take about 0.2 seconds
+template <typename Fn>
+double MeasureMicroseconds(Fn fn) {
+    size_t calls = 0;
+    auto start = std::chrono::steady_clock::now();
+    double seconds = 0;
+    for (size_t batch = 1; seconds < 0.2; batch *= 2) {
+        for (size_t i = 0; i < batch; i++) {
+            fn();
+        }
+        calls += batch;
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    return seconds * 1e6 / calls;
+}
+
+// bytes allocated on the heap, or 0 if it is unknown
+size_t HeapBytes() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    return mallinfo2().uordblks;
+#else
+    return 0;
+#endif
+}
+
+}  // namespace
+
+// Latency of the Viterbi and the forward-backward recurrences over a sentence, by number of labels and words
+TEST(LinearChainCRFBench, DISABLED_Kernels) {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> uniform(-2, 2);
+    for (uint16_t N : {10, 25, 50, 100, 200}) {
+        std::vector<float> trans(N * N);
+        for (auto& s : trans) {
+            s = uniform(rng);
+        }
+        std::vector<double> expTrans(trans.begin(), trans.end());
+        for (auto& s : expTrans) {
+            s = std::exp(s);
+        }
+        for (uint16_t T : {8, 32, 128}) {
+            std::vector<float> obs(T * N);
+            for (auto& s : obs) {
+                s = uniform(rng);
+            }
+            std::vector<double> expObs(obs.begin(), obs.end());
+            for (auto& s : expObs) {
+                s = std::exp(s) / N;
+            }
+            std::vector<float> score(T * N);
+            std::vector<uint16_t> back(T * N);
+            std::vector<double> alpha(T * N, 1.0);
+            std::vector<double> beta(T * N, 1.0);
+
+            auto viterbi = [&](bool scalar) {
+                for (uint16_t t = 1; t < T; ++t) {
+                    const float* prev = &score[(t - 1) * N];
+                    if (scalar) {
+                        ViterbiStepScalar(prev, trans.data(), &obs[t * N], N, &score[t * N], &back[t * N]);
+                    } else {
+                        ViterbiStep(prev, trans.data(), &obs[t * N], N, &score[t * N], &back[t * N]);
+                    }
+                }
+            };
+            auto forward_backward = [&](bool scalar) {
+                for (uint16_t t = 1; t < T; ++t) {
+                    const double* prev = &alpha[(t - 1) * N];
+                    if (scalar) {
+                        ForwardStepScalar(prev, expTrans.data(), &expObs[t * N], N, &alpha[t * N]);
+                    } else {
+                        ForwardStep(prev, expTrans.data(), &expObs[t * N], N, &alpha[t * N]);
+                    }
+                }
+                for (int t = T - 2; t >= 0; --t) {
+                    const double* next = &beta[(t + 1) * N];
+                    if (scalar) {
+                        BackwardStepScalar(next, expTrans.data(), N, &beta[t * N]);
+                    } else {
+                        BackwardStep(next, expTrans.data(), N, &beta[t * N]);
+                    }
+                }
+            };
+            std::cout << N << " labels, " << T << " words: viterbi "
+                      << MeasureMicroseconds([&]() { viterbi(true); }) << " us scalar, "
+                      << MeasureMicroseconds([&]() { viterbi(false); }) << " us simd; forward-backward "
+                      << MeasureMicroseconds([&]() { forward_backward(true); }) << " us scalar, "
+                      << MeasureMicroseconds([&]() { forward_backward(false); }) << " us simd" << std::endl;
+        }
+    }
+}
+
+// Training throughput and accuracy of l1sgd on one thread and with lock-free updates on one thread per core. The
+// learner prints the loss of every iteration, to compare how they converge.
+TEST(LinearChainCRFBench, DISABLED_L1SGDThreads) {
+    std::string dir = testing::TempDir();
+    const size_t sentences = 20000;
+    const int iterations = 15;
+    auto samples = GenerateData(dir + "lccrf_bench_train.txt", sentences, 8, 20000);
+
+    size_t cores = std::max(2U, std::thread::hardware_concurrency());
+    for (size_t threads : {static_cast<size_t>(1), cores}) {
+        std::string model_file = dir + "lccrf_bench_" + std::to_string(threads) + ".bin";
+        auto start = std::chrono::steady_clock::now();
+        LinearChainCRF::Train(dir + "lccrf_bench_train.txt", model_file, "l1sgd", iterations,
+                              static_cast<int>(threads));
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        LinearChainCRF crf(model_file);
+        double accuracy = TagAgreement(crf, samples, [](Sample& sample) { return sample.labels_; });
+        std::cout << "l1sgd with " << threads << " threads: "
+                  << static_cast<size_t>(sentences * iterations / seconds) << " sentences/s, training accuracy "
+                  << accuracy << std::endl;
+        std::remove(model_file.c_str());
+    }
+    RemoveData(dir, "lccrf_bench_train.txt");
+}
+
+// Decoding throughput of Predict one sentence at a time, and of PredictBatch on one thread and one thread per core
+TEST(LinearChainCRFBench, DISABLED_PredictBatch) {
+    std::string dir = testing::TempDir();
+    auto samples = GenerateData(dir + "lccrf_bench_train.txt", 5000, 8, 20000);
+    LinearChainCRF::Train(dir + "lccrf_bench_train.txt", dir + "lccrf_bench_predict.bin", "l1sgd", 5);
+    LinearChainCRF crf(dir + "lccrf_bench_predict.bin");
+
+    std::vector<uint16_t> lens;
+    std::vector<std::vector<std::tuple<uint16_t, uint32_t, double>>> features;
+    for (auto& sample : samples) {
+        lens.push_back(sample.len_);
+        features.push_back(sample.features_);
+    }
+    double us = MeasureMicroseconds([&]() {
+        for (auto& sample : samples) {
+            crf.Predict(sample.len_, sample.features_);
+        }
+    });
+    std::cout << "Predict: " << static_cast<size_t>(samples.size() / us * 1e6) << " sentences/s" << std::endl;
+
+    size_t cores = std::max(2U, std::thread::hardware_concurrency());
+    for (size_t threads : {static_cast<size_t>(1), cores}) {
+        crf.SetThreadNum(threads);
+        us = MeasureMicroseconds([&]() { crf.PredictBatch(lens, features); });
+        std::cout << "PredictBatch on " << threads << " threads: " << static_cast<size_t>(samples.size() / us * 1e6)
+                  << " sentences/s" << std::endl;
+    }
+    RemoveData(dir, "lccrf_bench_train.txt");
+    std::remove((dir + "lccrf_bench_predict.bin").c_str());
+}
+
+// Memory and decoding throughput of a model of 8 labels and 1M features of 4 labels each, built without training
+TEST(LinearChainCRFBench, DISABLED_LargeModel) {
+    const uint32_t features = 1000000;
+    std::mt19937 rng(42);
+    std::string bytes;
+    {
+        std::vector<MLGFeatureSentence> data;
+        for (uint32_t featId = 0; featId < features; featId++) {
+            MLGFeatureSentence sentence;
+            for (uint16_t t = 0; t < 4; t++) {
+                Word<MLGFeatureType> word(static_cast<uint16_t>((featId * 3 + t * 5) % 8), 1.0f);
+                word.Append(MLGFeatureType(1, featId, 1.0f));
+                sentence.Append(word);
+            }
+            data.push_back(sentence);
+        }
+        SparseLinearModel model;
+        model.Expand(data);
+        std::vector<float> weights(model.Size());
+        std::uniform_real_distribution<float> uniform(0.1f, 1.0f);
+        for (auto& w : weights) {
+            w = uniform(rng);
+        }
+        model.Reset(weights);
+        std::stringstream ss;
+        model.Serialize(ss);
+        bytes = ss.str();
+    }
+
+    std::stringstream ss(bytes);
+    size_t heap = HeapBytes();
+    auto model = std::make_shared<SparseLinearModel>(ss);
+    std::cout << "model of " << model->Size() << " parameters: " << (HeapBytes() - heap) / 1000000
+              << " MB on the heap, " << bytes.size() / 1000000 << " MB on disk" << std::endl;
+
+    VanillaCRF crf;
+    crf.Initialize(model);
+    std::vector<std::vector<std::tuple<uint16_t, uint32_t, double>>> sentences(1000);
+    for (auto& sentence : sentences) {
+        for (uint16_t t = 0; t < 20; t++) {
+            for (int f = 0; f < 10; f++) {
+                // some of the features are unknown
+                sentence.emplace_back(t, rng() % (features + features / 10), 1.0);
+            }
+        }
+    }
+    VanillaCRF::DecodeWorkspace workspace;
+    std::vector<uint16_t> tags;
+    double us = MeasureMicroseconds([&]() {
+        for (auto& sentence : sentences) {
+            crf.Decode(20, sentence, 1, workspace, tags);
+        }
+    });
+    std::cout << "Decode: " << static_cast<size_t>(sentences.size() / us * 1e6) << " sentences/s" << std::endl;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "pyis/ops/linear_chain_crf/linear_chain_crf.h"
+
+// Synthetic training data and helpers shared by the tests and the benchmarks of LinearChainCRF
+
+namespace linear_chain_crf_test {
+
+using Features = std::vector<std::tuple<uint16_t, uint32_t, double>>;
+
+struct Sample {
+    uint16_t len_;
+    Features features_;
+    std::vector<uint16_t> labels_;
+};
+
+// Sentences of 5 to 29 words over a vocab of word_count words, with 3 features each. The label of a word follows its
+// features, except after the last label, which the next label mostly follows instead. Write them to data_file in the
+// training format, with the features in set 1.
+inline std::vector<Sample> GenerateData(const std::string& data_file, size_t count, uint16_t label_count,
+                                        uint32_t word_count) {
+    std::mt19937 rng(42);
+    std::vector<Sample> samples;
+    std::ofstream out(data_file);
+    for (size_t i = 0; i < count; i++) {
+        Sample sample{static_cast<uint16_t>(rng() % 25 + 5), {}, {}};
+        uint16_t prev = 0;
+        for (uint16_t t = 0; t < sample.len_; t++) {
+            uint32_t word = std::min(rng() % word_count, rng() % word_count);
+            auto label = static_cast<uint16_t>(prev == label_count - 1 && rng() % 4 != 0 ? 0 : word % label_count);
+            uint32_t features[] = {word, word_count + word / 16, word_count * 2 + (word * 31) % 997};
+            out << label << " 1.0 w" << word << " |1";
+            for (uint32_t feature : features) {
+                out << " " << feature;
+                sample.features_.emplace_back(t, feature, 1.0);
+            }
+            out << "\n";
+            sample.labels_.push_back(label);
+            prev = label;
+        }
+        out << "\n";
+        samples.push_back(sample);
+    }
+    return samples;
+}
+
+// Fraction of the words of samples which crf tags as expected(sample) does
+template <typename Expected>
+double TagAgreement(pyis::ops::LinearChainCRF& crf, std::vector<Sample>& samples, Expected expected) {
+    size_t same = 0;
+    size_t total = 0;
+    for (auto& sample : samples) {
+        std::vector<uint16_t> expected_tags = expected(sample);
+        std::vector<uint16_t> tags = crf.Predict(sample.len_, sample.features_);
+        for (size_t t = 0; t < expected_tags.size(); t++) {
+            same += t < tags.size() && tags[t] == expected_tags[t] ? 1 : 0;
+            total++;
+        }
+    }
+    return total == 0 ? 1.0 : static_cast<double>(same) / total;
+}
+
+// Remove the data file of GenerateData, and the chunk of it which training saves next to it
+inline void RemoveData(const std::string& dir, const std::string& data_file) {
+    std::remove((dir + data_file).c_str());
+    std::remove((dir + "__0__" + data_file).c_str());
+}
+
+}  // namespace linear_chain_crf_test
@@ -0,0 +1,84 @@
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "pyis/ops/linear_chain_crf/src/CRFKernels.h"
+
+using namespace SparseLinearChainCRF;
+
+namespace {
+
+// scores drawn from a few integers, so that many of them tie
+template <typename T>
+std::vector<T> RandomScores(size_t size, std::mt19937& rng) {
+    std::vector<T> scores(size);
+    for (auto& s : scores) {
+        s = rng() % 4 == 0 ? static_cast<T>(rng() % 5) : static_cast<T>(rng() % 1000) / 100 - 5;
+    }
+    return scores;
+}
+
+template <typename T>
+void ExpectSameAsScalar(uint16_t N, std::mt19937& rng) {
+    auto prev = RandomScores<T>(N, rng);
+    auto trans = RandomScores<T>(N * N, rng);
+    auto obs = RandomScores<T>(N, rng);
+    if (N > 2) {
+        // no transition into label 1 is possible, as in the models which never saw it
+        for (uint16_t j = 0; j < N; ++j) {
+            trans[j * N + 1] = -INFINITY;
+        }
+    }
+
+    std::vector<T> score(N);
+    std::vector<T> expected_score(N);
+    std::vector<uint16_t> back(N);
+    std::vector<uint16_t> expected_back(N);
+    ViterbiStep(prev.data(), trans.data(), obs.data(), N, score.data(), back.data());
+    ViterbiStepScalar(prev.data(), trans.data(), obs.data(), N, expected_score.data(), expected_back.data());
+    ASSERT_EQ(score, expected_score) << "N = " << N;
+    ASSERT_EQ(back, expected_back) << "N = " << N;
+
+    // the sum-product steps run on exponentiated scores
+    for (auto* v : {&prev, &trans, &obs}) {
+        for (auto& s : *v) {
+            s = std::exp(s);
+        }
+    }
+    std::vector<T> cur(N);
+    std::vector<T> expected(N);
+    ForwardStep(prev.data(), trans.data(), obs.data(), N, cur.data());
+    ForwardStepScalar(prev.data(), trans.data(), obs.data(), N, expected.data());
+    ASSERT_EQ(cur, expected) << "N = " << N;
+
+    BackwardStep(prev.data(), trans.data(), N, cur.data());
+    BackwardStepScalar(prev.data(), trans.data(), N, expected.data());
+    for (uint16_t i = 0; i < N; ++i) {
+        ASSERT_NEAR(cur[i], expected[i], expected[i] * 1e-5) << "N = " << N;
+    }
+}
+
+}  // namespace
+
+TEST(TestCRFKernels, TestSameAsScalar) {
+    std::mt19937 rng(42);
+    for (uint16_t N = 1; N <= 40; ++N) {
+        ExpectSameAsScalar<float>(N, rng);
+        ExpectSameAsScalar<double>(N, rng);
+    }
+    ExpectSameAsScalar<float>(200, rng);
+    ExpectSameAsScalar<double>(200, rng);
+}
+
+TEST(TestCRFKernels, TestViterbiStep) {
+    // from label 0 to 1 and from 1 to 0 are the best transitions, and label 2 ties with 0
+    std::vector<float> prev{1, 0, 1};
+    std::vector<float> trans{0, 2, 0, 3, -1, 0, 0, 2, 0};
+    std::vector<float> obs{0, 0.5, -1};
+    std::vector<float> score(3);
+    std::vector<uint16_t> back(3);
+    ViterbiStep(prev.data(), trans.data(), obs.data(), 3, score.data(), back.data());
+    ASSERT_EQ(score, std::vector<float>({3, 3.5, 0}));
+    ASSERT_EQ(back, std::vector<uint16_t>({1, 0, 0}));
+}
@@ -0,0 +1,151 @@
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "linear_chain_crf_test_data.h"
+#include "pyis/ops/linear_chain_crf/linear_chain_crf.h"
+#include "pyis/ops/linear_chain_crf/sparse_linear_chain_crf_api.h"
+#include "pyis/ops/linear_chain_crf/src/VanillaCRF.h"
+
+using pyis::ops::LinearChainCRF;
+using namespace linear_chain_crf_test;
+
+namespace {
+
+std::string ReadFile(const std::string& file) {
+    std::ifstream in(file, std::ios::binary);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+// Tags of a sentence decoded as Predict did before it decoded the features in place: through an IndexedSentence of
+// the features found in set 1
+std::vector<uint16_t> DecodeIndexedSentence(const SparseLinearChainCRF::VanillaCRF& crf, uint16_t len,
+                                            const Features& features) {
+    using namespace SparseLinearChainCRF;
+    IndexedSentence sentence;
+    sentence.Resize(len, Word<IndexedParameterType>(0, 1.0, ""));
+    for (const auto& f : features) {
+        size_t uid = crf.m_LinearModel->FindFeautureIdMap(1, std::get<1>(f));
+        if (uid != INDEX_NOT_FOUND) {
+            sentence.GetWord(std::get<0>(f)).Append(std::make_pair(uid, static_cast<float>(std::get<2>(f))));
+        }
+    }
+    std::vector<uint16_t> tags;
+    crf.Decode(sentence, tags);
+    return tags;
+}
+
+}  // namespace
+
+TEST(TestLinearChainCRF, TestLBFGSThreads) {
+    std::string dir = testing::TempDir();
+    auto samples = GenerateData(dir + "lccrf_train.txt", 500, 3, 200);
+
+    LinearChainCRF::Train(dir + "lccrf_train.txt", dir + "lccrf_1.bin", "lbfgs", 20, 1);
+    LinearChainCRF::Train(dir + "lccrf_train.txt", dir + "lccrf_3.bin", "lbfgs", 20, 3);
+    LinearChainCRF::Train(dir + "lccrf_train.txt", dir + "lccrf_3_again.bin", "lbfgs", 20, 3);
+    // the shards are reduced in a fixed order, so the same number of threads trains the same model
+    ASSERT_EQ(ReadFile(dir + "lccrf_3.bin"), ReadFile(dir + "lccrf_3_again.bin"));
+
+    // and the sums only differ from the serial ones by rounding
+    LinearChainCRF serial(dir + "lccrf_1.bin");
+    LinearChainCRF parallel(dir + "lccrf_3.bin");
+    auto serial_tags = [&](Sample& sample) { return serial.Predict(sample.len_, sample.features_); };
+    ASSERT_GE(TagAgreement(parallel, samples, serial_tags), 0.99);
+
+    RemoveData(dir, "lccrf_train.txt");
+    for (const char* file : {"lccrf_1.bin", "lccrf_3.bin", "lccrf_3_again.bin"}) {
+        std::remove((dir + file).c_str());
+    }
+}
+
+TEST(TestLinearChainCRF, TestL1SGDThreads) {
+    std::string dir = testing::TempDir();
+    auto samples = GenerateData(dir + "lccrf_train.txt", 500, 3, 200);
+
+    LinearChainCRF::Train(dir + "lccrf_train.txt", dir + "lccrf_sgd_1.bin", "l1sgd", 20, 1);
+    LinearChainCRF::Train(dir + "lccrf_train.txt", dir + "lccrf_sgd_3.bin", "l1sgd", 20, 3);
+
+    // the lock-free updates may be lost or reordered, but the models are about as accurate, and agree on almost
+    // every tag
+    LinearChainCRF serial(dir + "lccrf_sgd_1.bin");
+    LinearChainCRF parallel(dir + "lccrf_sgd_3.bin");
+    auto labels = [](Sample& sample) { return sample.labels_; };
+    ASSERT_GE(TagAgreement(parallel, samples, labels), TagAgreement(serial, samples, labels) - 0.01);
+    auto serial_tags = [&](Sample& sample) { return serial.Predict(sample.len_, sample.features_); };
+    ASSERT_GE(TagAgreement(parallel, samples, serial_tags), 0.95);
+
+    RemoveData(dir, "lccrf_train.txt");
+    for (const char* file : {"lccrf_sgd_1.bin", "lccrf_sgd_3.bin"}) {
+        std::remove((dir + file).c_str());
+    }
+}
+
+TEST(TestLinearChainCRF, TestPredictBatch) {
+    std::string dir = testing::TempDir();
+    auto samples = GenerateData(dir + "lccrf_train.txt", 300, 3, 200);
+    LinearChainCRF::Train(dir + "lccrf_train.txt", dir + "lccrf_batch.bin", "perceptron", 5);
+    LinearChainCRF crf(dir + "lccrf_batch.bin");
+
+    std::vector<uint16_t> lens;
+    std::vector<Features> features;
+    for (auto& sample : samples) {
+        lens.push_back(sample.len_);
+        features.push_back(sample.features_);
+    }
+    // an empty sentence, and one whose features are not in the model
+    lens.push_back(0);
+    features.emplace_back();
+    lens.push_back(2);
+    features.push_back({{0, 99999, 1.0}, {1, 99998, 1.0}});
+
+    std::unique_ptr<void, void (*)(void*)> vanilla(SparseLinearChainCRFCreate(), SparseLinearChainCRFDelete);
+    SparseLinearChainCRFLoad(vanilla.get(), (dir + "lccrf_batch.bin").c_str());
+    const auto& old_crf = *static_cast<SparseLinearChainCRF::VanillaCRF*>(vanilla.get());
+
+    crf.SetThreadNum(3);
+    auto batch = crf.PredictBatch(lens, features);
+    ASSERT_EQ(batch.size(), lens.size());
+    for (size_t i = 0; i < lens.size(); i++) {
+        // the old decoding read the first column of the lattice of an empty sentence
+        if (lens[i] > 0) {
+            ASSERT_EQ(batch[i], DecodeIndexedSentence(old_crf, lens[i], features[i]));
+        }
+        ASSERT_EQ(batch[i], crf.Predict(lens[i], features[i]));
+    }
+    ASSERT_TRUE(batch[samples.size()].empty());
+    ASSERT_EQ(batch.back().size(), 2);
+
+    ASSERT_ANY_THROW(crf.PredictBatch({1, 2}, {{}}));
+    // a feature of a word past the end of the sentence, unless the feature is not in the model
+    ASSERT_ANY_THROW(crf.PredictBatch({2}, {{{2, 1, 1.0}}}));
+    Features unknown_past_end{{0, 1, 1.0}, {2, 99999, 1.0}};
+    ASSERT_EQ(crf.PredictBatch({2}, {unknown_past_end})[0], crf.PredictBatch({2}, {{{0, 1, 1.0}}})[0]);
+
+
+    // Python threads may call SetThreadNum while PredictBatch runs without the GIL
+    std::vector<std::thread> workers;
+    for (int w = 0; w < 3; w++) {
+        workers.emplace_back([&]() {
+            for (int i = 0; i < 3; i++) {
+                EXPECT_EQ(crf.PredictBatch(lens, features), batch);
+            }
+        });
+    }
+    for (size_t i = 0; i < 20; i++) {
+        crf.SetThreadNum(i % 4);
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    RemoveData(dir, "lccrf_train.txt");
+    std::remove((dir + "lccrf_batch.bin").c_str());
+}
@@ -0,0 +1,129 @@
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "pyis/ops/linear_chain_crf/src/SparseLinearModel.h"
+
+using namespace SparseLinearChainCRF;
+
+namespace {
+
+// Sentences of 3 words, word t having the label (featId + t) % 4 and the features featId in set 1 and featId / 10 in
+// set 2, for featId from begin to end
+std::vector<MLGFeatureSentence> MakeData(uint32_t begin, uint32_t end) {
+    std::vector<MLGFeatureSentence> data;
+    for (uint32_t featId = begin; featId < end; featId++) {
+        MLGFeatureSentence sentence;
+        for (uint32_t t = 0; t < 3; t++) {
+            Word<MLGFeatureType> word(static_cast<uint16_t>((featId + t) % 4), 1.0f);
+            word.Append(MLGFeatureType(1, featId, 1.0f));
+            word.Append(MLGFeatureType(2, featId / 10, 1.0f));
+            sentence.Append(word);
+        }
+        data.push_back(sentence);
+    }
+    return data;
+}
+
+// weight of the feature for the label, or 0 if it has none
+float Weight(SparseLinearModel& model, uint32_t setId, uint32_t featId, uint16_t labId) {
+    size_t uid = model.FindFeautureIdMap(setId, featId);
+    if (uid == INDEX_NOT_FOUND) {
+        return 0;
+    }
+    size_t paramId = model.FindParameterId(uid, labId);
+    return paramId == INDEX_NOT_FOUND ? 0 : model.WeightVector()[paramId];
+}
+
+std::string SerializeToString(const SparseLinearModel& model) {
+    std::stringstream ss;
+    model.Serialize(ss);
+    return ss.str();
+}
+
+}  // namespace
+
+TEST(TestSparseLinearModel, TestLookup) {
+    SparseLinearModel model;
+    model.Expand(MakeData(0, 1000));
+    ASSERT_EQ(model.MaxLabel(), 4);
+
+    for (uint32_t featId = 0; featId < 1000; featId++) {
+        size_t uid = model.FindFeautureIdMap(1, featId);
+        ASSERT_NE(uid, INDEX_NOT_FOUND);
+        ParameterRange params = model.FindParameterVector(uid);
+        ASSERT_EQ(params.size(), 3);
+        uint16_t missing = (featId + 3) % 4;
+        for (const auto& param : params) {
+            ASSERT_NE(param.first, missing);
+            ASSERT_EQ(model.FindParameterId(uid, param.first), param.second);
+        }
+        ASSERT_TRUE(params.begin()[0].first < params.begin()[1].first);
+        ASSERT_TRUE(params.begin()[1].first < params.begin()[2].first);
+        ASSERT_EQ(model.FindParameterId(uid, missing), INDEX_NOT_FOUND);
+    }
+    ASSERT_NE(model.FindFeautureIdMap(2, 99), INDEX_NOT_FOUND);
+    ASSERT_EQ(model.FindFeautureIdMap(2, 100), INDEX_NOT_FOUND);
+    ASSERT_EQ(model.FindFeautureIdMap(1, 1000), INDEX_NOT_FOUND);
+    ASSERT_EQ(model.FindFeautureIdMap(3, 0), INDEX_NOT_FOUND);
+    // the transitions seen, from label l to label l + 1
+    ASSERT_NE(model.FindFeautureIdMap(EDGE_FEATURE_SET, 0), INDEX_NOT_FOUND);
+}
+
+TEST(TestSparseLinearModel, TestSerialize) {
+    SparseLinearModel model;
+    model.Expand(MakeData(0, 1000));
+    std::vector<float> weights(model.Size());
+    for (size_t i = 0; i < weights.size(); i++) {
+        weights[i] = static_cast<float>(i % 7) - 3.5f;
+    }
+    model.Reset(weights);
+    std::string bytes = SerializeToString(model);
+
+    std::stringstream ss(bytes);
+    SparseLinearModel loaded(ss);
+    ASSERT_EQ(loaded.Size(), model.Size());
+    ASSERT_EQ(SerializeToString(loaded), bytes);
+    for (uint32_t featId = 0; featId < 1000; featId += 7) {
+        for (uint16_t labId = 0; labId < 4; labId++) {
+            ASSERT_EQ(Weight(loaded, 1, featId, labId), Weight(model, 1, featId, labId));
+            ASSERT_EQ(Weight(loaded, 2, featId / 10, labId), Weight(model, 2, featId / 10, labId));
+        }
+    }
+    for (size_t i = 0; i < 16; i++) {
+        ASSERT_EQ(loaded.GetTransitionCache()[i], model.GetTransitionCache()[i]);
+    }
+}
+
+// Expanding a loaded model, as training from a premodel does, keeps its parameters
+TEST(TestSparseLinearModel, TestExpandLoaded) {
+    SparseLinearModel model;
+    model.Expand(MakeData(0, 500));
+    std::vector<float> weights(model.Size());
+    for (size_t i = 0; i < weights.size(); i++) {
+        weights[i] = static_cast<float>(i % 5) + 1;
+    }
+    model.Reset(weights);
+    std::string bytes = SerializeToString(model);
+
+    std::stringstream ss(bytes);
+    SparseLinearModel loaded(ss);
+    loaded.Expand(MakeData(400, 700));
+    ASSERT_GT(loaded.Size(), model.Size());
+    for (uint32_t featId = 0; featId < 700; featId++) {
+        for (uint16_t labId = 0; labId < 4; labId++) {
+            ASSERT_EQ(Weight(loaded, 1, featId, labId), Weight(model, 1, featId, labId));
+        }
+        ASSERT_NE(loaded.FindFeautureIdMap(1, featId), INDEX_NOT_FOUND);
+    }
+
+    // the new parameters are all 0, so shrinking leaves the parameters of the loaded model
+    ASSERT_EQ(loaded.Shrink(), model.Size());
+    for (uint32_t featId = 0; featId < 500; featId++) {
+        for (uint16_t labId = 0; labId < 4; labId++) {
+            ASSERT_EQ(Weight(loaded, 1, featId, labId), Weight(model, 1, featId, labId));
+        }
+    }
+    ASSERT_EQ(loaded.FindFeautureIdMap(1, 600), INDEX_NOT_FOUND);
+}
@@ -10,4 +10,74 @@ TEST(TestNGramFeaturizer, TestLoad) {
     ASSERT_EQ(features.size(), 2);
     ASSERT_EQ(features[0].id(), 0);
     ASSERT_EQ(features[1].id(), 1);
-}
\ No newline at end of file
+}
+
+TEST(TestNGramFeaturizer, TestTransform) {
+    pyis::ops::NGramFeaturizer featurizer(2, true);
+    featurizer.Fit({"a", "b", "c"});
+
+    auto features = featurizer.Transform({"a", "b", "c"});
+    std::vector<std::tuple<uint64_t, int, int>> expected{{0, 0, 1}, {1, 0, 1}, {2, 1, 2}, {3, 1, 2}};
+    ASSERT_EQ(features.size(), expected.size());
+    for (size_t i = 0; i < features.size(); i++) {
+        ASSERT_EQ(features[i].id(), std::get<0>(expected[i]));
+        ASSERT_EQ(std::get<0>(features[i].pos()), std::get<1>(expected[i]));
+        ASSERT_EQ(std::get<1>(features[i].pos()), std::get<2>(expected[i]));
+    }
+
+    ASSERT_EQ(featurizer.Transform({"a"}).size(), 0);
+    ASSERT_EQ(featurizer.Transform({"b", "c", "a"}).size(), 1);
+}
+
+TEST(TestNGramFeaturizer, TestTransformAllOrders) {
+    std::string ngram_file = "tests/test_ngram_featurizer/data/ngram.txt";
+    pyis::ops::NGramFeaturizer featurizer(2, false);
+    featurizer.LoadNGram(ngram_file);
+    featurizer.Fit({"hello", "world"});
+
+    // unigrams from the ngram file, the bigram from fit
+    auto features = featurizer.TransformAllOrders({"hello", "world", "hello"});
+    ASSERT_EQ(features.size(), 4);
+    ASSERT_EQ(features[0].id(), 0);
+    ASSERT_EQ(features[1].id(), 2);
+    ASSERT_EQ(std::get<1>(features[1].pos()), 1);
+    ASSERT_EQ(features[2].id(), 1);
+    ASSERT_EQ(features[3].id(), 0);
+    ASSERT_EQ(std::get<0>(features[3].pos()), 2);
+
+    // only bigrams
+    features = featurizer.Transform({"hello", "world", "hello"});
+    ASSERT_EQ(features.size(), 1);
+    ASSERT_EQ(features[0].id(), 2);
+}
+
+TEST(TestNGramFeaturizer, TestTrieWalk) {
+    pyis::ops::Trie trie;
+    trie.Insert("new", 1);
+    trie.Insert("new york", 2);
+    trie.Insert("new york city", 3);
+    trie.Insert("york city", 4);
+
+    for (int frozen = 0; frozen < 2; frozen++) {
+        if (frozen == 1) {
+            trie.Freeze();
+        }
+        std::vector<std::string> tokens{"new", "york", "city", "hall"};
+        std::vector<bool> found{true, true, true, false};
+        pyis::ops::Trie::Cursor cursor;
+        for (size_t i = 0; i < tokens.size(); i++) {
+            uint32_t value = 0;
+            ASSERT_EQ(trie.Walk(tokens[i], cursor, value), found[i]);
+            if (found[i]) {
+                ASSERT_EQ(value, i + 1);
+            }
+        }
+        ASSERT_FALSE(cursor.valid_);
+
+        pyis::ops::Trie::Cursor prefix;
+        uint32_t value = 0;
+        ASSERT_FALSE(trie.Walk("yo", prefix, value));
+        ASSERT_FALSE(trie.Walk("rk", prefix, value));
+        ASSERT_FALSE(prefix.valid_);
+    }
+}
@@ -1,5 +1,8 @@
+#include <algorithm>
+#include <atomic>
 #include <codecvt>
 #include <functional>
+#include <future>
 #include <iostream>
 #include <locale>
 #include <string>
@@ -7,6 +10,7 @@
 
 #include "gtest/gtest.h"
 #include "pyis/ops/ort_session/ort_session.h"
+#include "pyis/ops/ort_session/ort_tensor_utils.h"
 #include "pyis/share/str_utils.h"
 
 static std::string model_file = "tests/test_ort_session/data/enus_emotion.onnx";
@@ -44,6 +48,103 @@ TEST(TestOrtSession, DISABLED_DynamicBatching) {
     std::cout << fut3.get()[0]->GetTensorTypeAndShapeInfo().GetElementCount() << std::endl;
 }
 
+TEST(TestOrtSession, RunAsyncDeliversErrors) {
+    pyis::OrtGlobals::Initialize();
+    std::vector<int64_t> shape{10};
+    std::vector<std::shared_ptr<Ort::Value>> inputs;
+    inputs.emplace_back(
+        std::make_shared<Ort::Value>(Ort::Value::CreateTensor<int64_t>(*pyis::OrtGlobals::Allocator, shape.data(), 1)));
+    std::fill_n(inputs[0]->GetTensorMutableData<int64_t>(), 10, 1);
+
+    for (bool dynamic_batching : {false, true}) {
+        pyis::ops::OrtSession session(model_file, {"tokens"}, {"label"}, 1, 0, dynamic_batching, 16);
+
+        // a request with a missing input fails on its own, the error is passed through the future
+        auto result = session.RunAsync({}).get();
+        ASSERT_TRUE(result.outputs_.empty());
+        ASSERT_FALSE(result.error_message_.empty());
+        result = session.RunAsync(inputs).get();
+        ASSERT_EQ(result.outputs_.size(), 1);
+        ASSERT_TRUE(result.error_message_.empty());
+
+        // or to the callback, like for a request cancelled before it runs
+        auto cancelled = std::make_shared<std::atomic<bool>>(true);
+        std::promise<std::string> error_message;
+        session.RunAsync(
+            inputs,
+            [&error_message](std::vector<std::shared_ptr<Ort::Value>>& outputs, const std::string& message) {
+                error_message.set_value(outputs.empty() ? message : "");
+            },
+            0, cancelled);
+        ASSERT_EQ(error_message.get_future().get(), "Dynamic Batch Cancelled");
+    }
+}
+
+TEST(TestOrtTensorUtils, StageAndSliceRows) {
+    pyis::OrtGlobals::Initialize();
+    std::vector<int64_t> shape{1, 3};
+    auto row0 = Ort::Value::CreateTensor<int64_t>(*pyis::OrtGlobals::Allocator, shape.data(), 2);
+    auto row1 = Ort::Value::CreateTensor<int64_t>(*pyis::OrtGlobals::Allocator, shape.data(), 2);
+    for (int64_t i = 0; i < 3; i++) {
+        row0.GetTensorMutableData<int64_t>()[i] = i;
+        row1.GetTensorMutableData<int64_t>()[i] = 10 + i;
+    }
+
+    auto staging = std::make_shared<Ort::Value>(pyis::ops::CreateBatchTensor(row0, 4));
+    pyis::ops::CopyTensorRows(row0, *staging, 0);
+    pyis::ops::CopyTensorRows(row1, *staging, 1);
+
+    auto filled = pyis::ops::CreateTensorView(*staging, 0, 2);
+    ASSERT_EQ(filled.GetTensorTypeAndShapeInfo().GetShape(), std::vector<int64_t>({2, 3}));
+
+    auto span = std::make_pair<size_t, size_t>(1, 2);
+    auto slice = pyis::ops::GetTensorSliceByIndexSpan(staging, span);
+    staging.reset();
+    ASSERT_EQ(slice->GetTensorTypeAndShapeInfo().GetShape(), std::vector<int64_t>({1, 3}));
+    ASSERT_EQ(slice->GetTensorData<int64_t>()[0], 10);
+    ASSERT_EQ(slice->GetTensorData<int64_t>()[2], 12);
+}
+
+TEST(TestOrtTensorUtils, PadAndUnpadRows) {
+    pyis::OrtGlobals::Initialize();
+    std::vector<int64_t> short_shape{1, 2};
+    std::vector<int64_t> long_shape{1, 4};
+    auto short_row = Ort::Value::CreateTensor<int64_t>(*pyis::OrtGlobals::Allocator, short_shape.data(), 2);
+    auto long_row = Ort::Value::CreateTensor<int64_t>(*pyis::OrtGlobals::Allocator, long_shape.data(), 2);
+    for (int64_t i = 0; i < 4; i++) {
+        if (i < 2) {
+            short_row.GetTensorMutableData<int64_t>()[i] = 1 + i;
+        }
+        long_row.GetTensorMutableData<int64_t>()[i] = 10 + i;
+    }
+
+    auto staging = std::make_shared<Ort::Value>(pyis::ops::CreateBatchTensor(short_row, 2, 4));
+    pyis::ops::PadTensorRows(short_row, *staging, 0, -1);
+    pyis::ops::PadTensorRows(long_row, *staging, 1, -1);
+    std::vector<int64_t> padded(staging->GetTensorData<int64_t>(), staging->GetTensorData<int64_t>() + 8);
+    ASSERT_EQ(padded, std::vector<int64_t>({1, 2, -1, -1, 10, 11, 12, 13}));
+
+    auto span = std::make_pair<size_t, size_t>(0, 1);
+    auto unpadded = pyis::ops::UnpadTensorSliceByIndexSpan(staging, span, 2);
+    ASSERT_EQ(unpadded->GetTensorTypeAndShapeInfo().GetShape(), std::vector<int64_t>({1, 2}));
+    ASSERT_EQ(unpadded->GetTensorData<int64_t>()[1], 2);
+}
+
+TEST(TestOrtTensorUtils, CreateAttentionMask) {
+    pyis::OrtGlobals::Initialize();
+    auto mask = pyis::ops::CreateAttentionMask(2, 3);
+    ASSERT_EQ(mask.GetTensorTypeAndShapeInfo().GetShape(), std::vector<int64_t>({2, 3}));
+    ASSERT_EQ(mask.GetTensorTypeAndShapeInfo().GetElementType(), ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64);
+    std::vector<int64_t> values(mask.GetTensorData<int64_t>(), mask.GetTensorData<int64_t>() + 6);
+    ASSERT_EQ(values, std::vector<int64_t>(6, 1));
+
+    // padded like any other sequence input, with 0
+    auto staging = pyis::ops::CreateBatchTensor(mask, 2, 5);
+    pyis::ops::PadTensorRows(mask, staging, 0, 0);
+    std::vector<int64_t> padded(staging.GetTensorData<int64_t>(), staging.GetTensorData<int64_t>() + 10);
+    ASSERT_EQ(padded, std::vector<int64_t>({1, 1, 1, 0, 0, 1, 1, 1, 0, 0}));
+}
+
 TEST(TestRunOrtSession, Basics) {
     pyis::OrtGlobals::Initialize();
     Ort::Env env(ORT_LOGGING_LEVEL_WARNING, "test_onnxruntime");
@@ -0,0 +1,110 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "pyis/ops/text/multi_regex.h"
+
+// Throughput benchmarks, disabled by default. Run them with
+//   test_pyis_cpp --gtest_also_run_disabled_tests --gtest_filter=RegexFeaturizerBench.*
+
+namespace {
+
+template <typename F>
+double MicrosecondsPerCall(size_t calls, F f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / static_cast<double>(calls);
+}
+
+std::string RandomWord(std::mt19937& rng) {
+    const char charlist[] = "abcdefghijklmnopqrstuvwxyz";
+    std::string word;
+    for (int len = rng() % 6 + 3; len > 0; len--) {
+        word += charlist[rng() % 26];
+    }
+    return word;
+}
+
+// keyword lists, entity formats and suffix rules, as found in featurizers of production models
+std::vector<std::string> GeneratePatterns(size_t size, std::mt19937& rng) {
+    std::vector<std::string> patterns;
+    for (size_t i = 0; i < size; i++) {
+        switch (i % 4) {
+            case 0:
+                patterns.emplace_back("\\b" + RandomWord(rng) + "\\b");
+                break;
+            case 1:
+                patterns.emplace_back("(" + RandomWord(rng) + "|" + RandomWord(rng) + ") \\d+");
+                break;
+            case 2:
+                patterns.emplace_back("\\d{1,2}:\\d\\d ?" + RandomWord(rng).substr(0, 2));
+                break;
+            default:
+                patterns.emplace_back("\\w+" + RandomWord(rng).substr(0, 3) + "\\b");
+                break;
+        }
+    }
+    return patterns;
+}
+
+}  // namespace
+
+TEST(RegexFeaturizerBench, DISABLED_MultiRegexVsStdRegex) {
+    std::mt19937 rng(42);
+    std::vector<std::string> sentences;
+    for (int i = 0; i < 100; i++) {
+        std::string sentence = RandomWord(rng);
+        for (int j = 0; j < 12; j++) {
+            sentence += (j % 5 == 4) ? " " + std::to_string(rng() % 100) : " " + RandomWord(rng);
+        }
+        sentences.emplace_back(sentence);
+    }
+
+    for (size_t size : {10, 100, 1000, 4000}) {
+        auto patterns = GeneratePatterns(size, rng);
+        std::vector<std::regex> regexes(patterns.begin(), patterns.end());
+        pyis::ops::MultiRegex multi_regex;
+        for (const auto& p : patterns) {
+            multi_regex.Add(p);
+        }
+
+        size_t std_count = 0;
+        size_t multi_count = 0;
+        const int rounds = size > 1000 ? 1 : 5;
+        double std_us = MicrosecondsPerCall(rounds * sentences.size(), [&]() {
+            for (int r = 0; r < rounds; r++) {
+                for (const auto& s : sentences) {
+                    for (const auto& regex : regexes) {
+                        std::regex_iterator<const char*> ite(s.data(), s.data() + s.size(), regex);
+                        std::regex_iterator<const char*> rend;
+                        for (/**/; ite != rend; ite++) {
+                            std_count++;
+                        }
+                    }
+                }
+            }
+        });
+        // the first pass fills the DFA cache
+        std::vector<pyis::ops::MultiRegex::Match> matches;
+        for (const auto& s : sentences) {
+            multi_regex.FindAll(s.data(), s.size(), matches);
+        }
+        double multi_us = MicrosecondsPerCall(rounds * sentences.size(), [&]() {
+            for (int r = 0; r < rounds; r++) {
+                for (const auto& s : sentences) {
+                    matches.clear();
+                    multi_regex.FindAll(s.data(), s.size(), matches);
+                    multi_count += matches.size();
+                }
+            }
+        });
+        ASSERT_EQ(std_count, multi_count);
+        std::cout << size << " patterns: std::regex " << std_us << " us, MultiRegex " << multi_us
+                  << " us per sentence" << std::endl;
+    }
+}
@@ -0,0 +1,140 @@
+#include <random>
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "pyis/ops/text/multi_regex.h"
+#include "pyis/ops/text/regex_featurizer.h"
+
+namespace {
+
+const std::vector<std::string> PATTERNS = {
+    R"(\d+)",
+    R"(\d+:\d+)",
+    R"(\d{1,2}(:\d\d)?\s?(am|pm))",
+    R"(\b\w+ing\b)",
+    R"(^\w+)",
+    R"(\w+$)",
+    R"(a|ab|abc)",
+    R"((ab|a)(bc|c)?)",
+    R"(a*)",
+    R"(a*?b)",
+    R"(x?)",
+    R"([^ ]+)",
+    R"([a-c]+[-.][0-9])",
+    R"(\Bb+\B)",
+    R"(colou?r)",
+    R"((?:new|old) york)",
+    R"(.{2,3}?c)",
+    R"([\d.]+ ?%)",
+    R"(\$\d+(\.\d{2})?)",
+    R"(\s+)",
+    R"(b*|a)",
+    R"(([a-z])\1)",
+    R"(a(?=b))",
+};
+
+std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> StdRegexMatches(const std::vector<std::string>& patterns,
+                                                                      const std::string& text) {
+    std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> matches;
+    for (uint32_t i = 0; i < patterns.size(); i++) {
+        std::regex regex(patterns[i]);
+        std::regex_iterator<const char*> ite(text.data(), text.data() + text.size(), regex);
+        std::regex_iterator<const char*> rend;
+        for (/**/; ite != rend; ite++) {
+            auto begin = static_cast<uint32_t>(ite->position());
+            matches.emplace_back(i, begin, begin + static_cast<uint32_t>(ite->length()));
+        }
+    }
+    return matches;
+}
+
+}  // namespace
+
+TEST(TestRegexFeaturizer, MultiRegexSameAsStdRegex) {
+    pyis::ops::MultiRegex multi_regex;
+    for (const auto& p : PATTERNS) {
+        multi_regex.Add(p);
+    }
+    // backreferences and lookaheads are left to std::regex
+    ASSERT_FALSE(multi_regex.IsFallback(0));
+    ASSERT_TRUE(multi_regex.IsFallback(PATTERNS.size() - 2));
+    ASSERT_TRUE(multi_regex.IsFallback(PATTERNS.size() - 1));
+
+    std::vector<std::string> texts = {"",
+                                      "set an alarm at 7:00 pm tomorrow",
+                                      "abcabc aab abbc bbb",
+                                      "running and jumping 10.5 % off $12.99",
+                                      "new york color colour old york",
+                                      "  a  "};
+    std::mt19937 rng(7);
+    const char charlist[] = "abcx 1:.-$%\n";
+    for (int i = 0; i < 300; i++) {
+        std::string text;
+        for (int j = rng() % 24; j > 0; j--) {
+            text += charlist[rng() % (sizeof(charlist) - 1)];
+        }
+        texts.emplace_back(text);
+    }
+
+    for (const auto& text : texts) {
+        std::vector<pyis::ops::MultiRegex::Match> matches;
+        multi_regex.FindAll(text.data(), text.size(), matches);
+        ASSERT_EQ(matches, StdRegexMatches(PATTERNS, text)) << text;
+    }
+}
+
+TEST(TestRegexFeaturizer, MultiRegexConcurrentFindAll) {
+    pyis::ops::MultiRegex multi_regex;
+    for (const auto& p : PATTERNS) {
+        multi_regex.Add(p);
+    }
+    std::mt19937 rng(11);
+    const char charlist[] = "abcx 1:.-$%\n";
+    std::vector<std::string> texts;
+    for (int i = 0; i < 200; i++) {
+        std::string text;
+        for (int j = rng() % 64; j > 0; j--) {
+            text += charlist[rng() % (sizeof(charlist) - 1)];
+        }
+        texts.emplace_back(text);
+    }
+
+    // the threads scan at the same time, each building the DFA states it visits
+    std::vector<std::vector<std::vector<pyis::ops::MultiRegex::Match>>> results(4);
+    std::vector<std::thread> threads;
+    for (auto& result : results) {
+        threads.emplace_back([&multi_regex, &texts, &result]() {
+            for (const auto& text : texts) {
+                result.emplace_back();
+                multi_regex.FindAll(text.data(), text.size(), result.back());
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (const auto& result : results) {
+        for (size_t i = 0; i < texts.size(); i++) {
+            ASSERT_EQ(result[i], StdRegexMatches(PATTERNS, texts[i])) << texts[i];
+        }
+    }
+}
+
+TEST(TestRegexFeaturizer, Transform) {
+    pyis::ops::RegexFeaturizer featurizer({R"(\d+)", R"(\d+:\d+)"});
+    auto features = featurizer.Transform({"the", "answer", "is", "42"});
+    ASSERT_EQ(features.size(), 1);
+    ASSERT_EQ(features[0].id(), 0);
+    ASSERT_EQ(features[0].pos(), std::make_tuple(3, 3));
+
+    // a match must cover whole tokens
+    features = featurizer.Transform({"set", "an", "alarm", "at", "7:00", "tomorrow"});
+    ASSERT_EQ(features.size(), 1);
+    ASSERT_EQ(features[0].id(), 1);
+    ASSERT_EQ(features[0].pos(), std::make_tuple(4, 4));
+
+    ASSERT_EQ(featurizer.Transform({}).size(), 0);
+}
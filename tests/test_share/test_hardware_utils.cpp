@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <set>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "pyis/share/hardware_utils.h"
+
+namespace {
+
+using Groups = std::vector<std::vector<int>>;
+
+std::vector<int> Range(int first, int last) {
+    std::vector<int> cores;
+    for (int i = first; i <= last; i++) {
+        cores.push_back(i);
+    }
+    return cores;
+}
+
+// index of the node of every core of a group, or -1 if the cores are not on a single node
+int NodeOf(const Groups& nodes, const std::vector<int>& group) {
+    for (size_t n = 0; n < nodes.size(); n++) {
+        if (std::all_of(group.begin(), group.end(), [&](int core) {
+                return std::find(nodes[n].begin(), nodes[n].end(), core) != nodes[n].end();
+            })) {
+            return static_cast<int>(n);
+        }
+    }
+    return -1;
+}
+
+}  // namespace
+
+TEST(TestHardwareUtils, TestPartitionCoresEvenNodes) {
+    Groups nodes = {Range(0, 5), Range(6, 11)};
+    ASSERT_EQ(partition_cores(nodes, 1), Groups({Range(0, 5)}));
+    ASSERT_EQ(partition_cores(nodes, 2), Groups({Range(0, 5), Range(6, 11)}));
+    // 3 groups do not split the 12 cores evenly, as a group of cores 4 to 7 would span the nodes
+    ASSERT_EQ(partition_cores(nodes, 3), Groups({Range(0, 2), Range(3, 5), Range(6, 11)}));
+    ASSERT_EQ(partition_cores(nodes, 4), Groups({Range(0, 2), Range(3, 5), Range(6, 8), Range(9, 11)}));
+}
+
+TEST(TestHardwareUtils, TestPartitionCoresUnevenNodes) {
+    Groups nodes = {Range(0, 3), Range(4, 11)};
+    ASSERT_EQ(partition_cores(nodes, 1), Groups({Range(4, 11)}));
+    ASSERT_EQ(partition_cores(nodes, 3), Groups({Range(0, 3), Range(4, 7), Range(8, 11)}));
+
+    // fewer groups than nodes go to the largest nodes
+    nodes = {Range(0, 1), Range(2, 5), Range(6, 7)};
+    ASSERT_EQ(partition_cores(nodes, 1), Groups({Range(2, 5)}));
+    ASSERT_EQ(partition_cores(nodes, 2), Groups({Range(0, 1), Range(2, 5)}));
+
+    for (int group_count = 0; group_count < 40; group_count++) {
+        Groups groups = partition_cores(nodes, group_count);
+        ASSERT_EQ(groups.size(), group_count);
+        for (const auto& group : groups) {
+            ASSERT_FALSE(group.empty());
+            ASSERT_NE(NodeOf(nodes, group), -1);
+        }
+    }
+}
+
+TEST(TestHardwareUtils, TestPartitionCoresMoreGroupsThanCores) {
+    Groups nodes = {Range(0, 1), Range(2, 3)};
+    ASSERT_EQ(partition_cores(nodes, 6), Groups({{0}, {0}, {1}, {2}, {2}, {3}}));
+    ASSERT_EQ(partition_cores({{}}, 2), Groups(2));
+    ASSERT_TRUE(partition_cores(nodes, -1).empty());
+}
+
+TEST(TestHardwareUtils, TestNumaNodeCores) {
+    Groups nodes = get_numa_node_cores();
+    ASSERT_FALSE(nodes.empty());
+    std::set<int> cores;
+    for (const auto& node_cores : nodes) {
+        ASSERT_FALSE(node_cores.empty());
+        for (int core : node_cores) {
+            ASSERT_TRUE(cores.insert(core).second);
+        }
+    }
+
+    Groups groups = partition_cores(static_cast<int>(cores.size()));
+    ASSERT_EQ(groups.size(), cores.size());
+    for (const auto& group : groups) {
+        ASSERT_EQ(group.size(), 1);
+        ASSERT_NE(NodeOf(nodes, group), -1);
+    }
+}
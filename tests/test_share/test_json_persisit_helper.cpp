@@ -81,3 +81,11 @@ TEST(TestJsonPersistHelper, SignFile) {
     std::string signature = jph.sign(&storage);
     ASSERT_EQ(signature, "e1db69a040ec6dbac5da37ab00506503");
 }
+
+TEST(TestJsonPersistHelper, GetIntList) {
+    pyis::JsonPersistHelper jph(1);
+    std::vector<int> l = {4, 8, 16};
+    jph.add("list", l);
+    pyis::JsonPersistHelper loaded(jph.serialize());
+    ASSERT_EQ(loaded.get<std::vector<int>>("list"), l);
+}
@@ -0,0 +1,46 @@
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "pyis/share/lru_cache.h"
+
+using pyis::LruCache;
+
+TEST(TestLruCache, TestGetPut) {
+    LruCache<std::string, std::vector<int>> cache(2);
+    std::vector<int> value;
+    ASSERT_FALSE(cache.Get("a", value));
+
+    cache.Put("a", {1});
+    cache.Put("b", {2, 3});
+    ASSERT_TRUE(cache.Get("b", value));
+    ASSERT_EQ(value, std::vector<int>({2, 3}));
+
+    cache.Put("b", {4});
+    ASSERT_TRUE(cache.Get("b", value));
+    ASSERT_EQ(value, std::vector<int>({4}));
+    ASSERT_EQ(cache.size(), 2);
+
+    cache.Clear();
+    ASSERT_EQ(cache.size(), 0);
+    ASSERT_FALSE(cache.Get("a", value));
+}
+
+TEST(TestLruCache, TestEviction) {
+    LruCache<std::string, int> cache(2);
+    int value = 0;
+    cache.Put("a", 1);
+    cache.Put("b", 2);
+    // "a" becomes the most recently used one, so "b" is evicted
+    ASSERT_TRUE(cache.Get("a", value));
+    cache.Put("c", 3);
+    ASSERT_FALSE(cache.Get("b", value));
+    ASSERT_TRUE(cache.Get("a", value));
+    ASSERT_EQ(value, 1);
+    ASSERT_TRUE(cache.Get("c", value));
+    ASSERT_EQ(value, 3);
+
+    LruCache<std::string, int> disabled(0);
+    disabled.Put("a", 1);
+    ASSERT_FALSE(disabled.Get("a", value));
+}
@@ -0,0 +1,53 @@
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "pyis/share/thread_pool.h"
+
+using pyis::ThreadPool;
+
+TEST(TestThreadPool, TestParallelFor) {
+    ThreadPool pool(4);
+    ASSERT_EQ(pool.size(), 4);
+    for (size_t n : {0, 1, 3, 1000}) {
+        std::vector<int> counts(n, 0);
+        pool.ParallelFor(n, [&counts](size_t i) { counts[i]++; });
+        ASSERT_EQ(counts, std::vector<int>(n, 1));
+    }
+}
+
+TEST(TestThreadPool, TestConcurrentCallers) {
+    ThreadPool pool(3);
+    std::atomic<size_t> total{0};
+    std::vector<std::thread> callers;
+    for (int t = 0; t < 4; t++) {
+        callers.emplace_back([&pool, &total] {
+            for (int i = 0; i < 50; i++) {
+                pool.ParallelFor(100, [&total](size_t j) { total += j; });
+            }
+        });
+    }
+    for (auto& caller : callers) {
+        caller.join();
+    }
+    ASSERT_EQ(total, 4 * 50 * 4950);
+}
+
+TEST(TestThreadPool, TestException) {
+    ThreadPool pool(2);
+    std::atomic<int> done{0};
+    ASSERT_THROW(pool.ParallelFor(100,
+                                  [&done](size_t i) {
+                                      if (i == 42) {
+                                          throw std::runtime_error("failed");
+                                      }
+                                      done++;
+                                  }),
+                 std::runtime_error);
+    ASSERT_EQ(done, 99);
+    ThreadPool single(1);
+    ASSERT_EQ(single.size(), 1);
+    ASSERT_THROW(single.ParallelFor(2, [](size_t) { throw std::runtime_error("failed"); }), std::runtime_error);
+}
@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "pyis/ops/tokenizer/wordpiece_tokenizer.h"
+
+// Throughput benchmark, disabled by default. Run it with
+//   test_pyis_cpp --gtest_also_run_disabled_tests --gtest_filter=WordpieceTokenizerBench.*
+
+namespace {
+
+// the greedy search of WordpieceTokenizer before it used tries, probing every substring from the longest one
+void ProbeSubstrings(const std::unordered_map<std::string, int64_t>& vocab, const std::string& token,
+                     std::vector<std::string>& result) {
+    for (size_t start = 0; start < token.size();) {
+        size_t end = token.size();
+        std::string substr;
+        for (; start < end; end--) {
+            substr = token.substr(start, end - start);
+            if (start > 0) {
+                substr = "##" + substr;
+            }
+            if (vocab.count(substr) != 0U) {
+                break;
+            }
+        }
+        if (start == end) {
+            result.emplace_back("[UNK]");
+            break;
+        }
+        result.push_back(substr);
+        start = end;
+    }
+}
+
+std::string RandomWord(size_t min_len, size_t max_len, std::mt19937& rng) {
+    const char charlist[] = "etaoinshrdlcumwfgypbvkjxqz";
+    std::string word;
+    size_t len = rng() % (max_len - min_len + 1) + min_len;
+    for (size_t i = 0; i < len; i++) {
+        word += charlist[std::min(rng() % 26, rng() % 26)];
+    }
+    return word;
+}
+
+}  // namespace
+
+TEST(WordpieceTokenizerBench, DISABLED_GreedySearch) {
+    std::mt19937 rng(42);
+    std::unordered_map<std::string, int64_t> vocab;
+    std::vector<std::string> pieces{"[PAD]", "[UNK]", "[CLS]", "[SEP]", "[MASK]"};
+    for (char c = 'a'; c <= 'z'; c++) {
+        pieces.emplace_back(1, c);
+        pieces.emplace_back("##" + std::string(1, c));
+    }
+    while (pieces.size() < 30000) {
+        pieces.emplace_back(RandomWord(2, 8, rng));
+        pieces.emplace_back("##" + RandomWord(2, 6, rng));
+    }
+    std::string vocab_file = testing::TempDir() + "wordpiece_bench_vocab.txt";
+    {
+        std::ofstream out(vocab_file);
+        for (const auto& piece : pieces) {
+            if (vocab.count(piece) == 0) {
+                vocab[piece] = static_cast<int64_t>(vocab.size());
+                out << piece << "\n";
+            }
+        }
+    }
+    pyis::ops::WordpieceTokenizer tokenizer(vocab_file);
+
+    struct Workload {
+        const char* name_;
+        size_t min_len_;
+        size_t max_len_;
+        const char* suffix_;
+    };
+    // short words, long words like identifiers or urls, and long words which end with a character out of the vocab
+    for (const auto& workload :
+         {Workload{"short", 3, 12, ""}, Workload{"long", 40, 120, ""}, Workload{"unknown", 40, 120, "Z"}}) {
+        std::vector<std::string> words;
+        size_t bytes = 0;
+        for (int i = 0; i < 20000; i++) {
+            words.emplace_back(RandomWord(workload.min_len_, workload.max_len_, rng) + workload.suffix_);
+            bytes += words.back().size();
+        }
+
+        std::vector<std::string> expected;
+        auto start = std::chrono::steady_clock::now();
+        for (const auto& word : words) {
+            ProbeSubstrings(vocab, word, expected);
+        }
+        auto end = std::chrono::steady_clock::now();
+        double probe_seconds = std::chrono::duration<double>(end - start).count();
+
+        start = std::chrono::steady_clock::now();
+        auto result = tokenizer.Tokenize(words);
+        end = std::chrono::steady_clock::now();
+        double trie_seconds = std::chrono::duration<double>(end - start).count();
+        ASSERT_EQ(result, expected);
+
+        std::cout << workload.name_ << " words: substring probes " << bytes / probe_seconds / 1e6 << " MB/s, trie "
+                  << bytes / trie_seconds / 1e6 << " MB/s" << std::endl;
+    }
+}
@@ -0,0 +1,85 @@
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "pyis/ops/tokenizer/wordpiece_tokenizer.h"
+
+using pyis::ops::WordpieceTokenizer;
+
+namespace {
+
+const char* VOCAB_FILE = "tests/test_wordpiece_tokenizer/data/vocab.txt";
+
+}  // namespace
+
+TEST(TestWordpieceTokenizer, TestTokenize) {
+    WordpieceTokenizer tokenizer(VOCAB_FILE);
+    std::vector<std::string> expected{"un", "##aff", "##able", "want", "##ed", ",", "running", "want", "##want"};
+    ASSERT_EQ(tokenizer.Tokenize("unaffable wanted , running wantwant"), expected);
+    ASSERT_TRUE(tokenizer.Tokenize("").empty());
+}
+
+TEST(TestWordpieceTokenizer, TestLongestMatch) {
+    WordpieceTokenizer tokenizer(VOCAB_FILE);
+    std::vector<std::pair<std::string, std::vector<std::string>>> cases{
+        {"une", {"une"}},
+        {"unaff", {"un", "##aff"}},
+        {"wa", {"wa"}},
+        {"#", {"#"}},
+        {"##", {"##"}},
+        {"####", {"###", "###"}},
+        {"été", {"été"}},
+        {"étéé", {"été", "##é"}},
+    };
+    for (const auto& c : cases) {
+        ASSERT_EQ(tokenizer.Tokenize(std::vector<std::string>{c.first}), c.second) << c.first;
+    }
+}
+
+TEST(TestWordpieceTokenizer, TestUnknown) {
+    WordpieceTokenizer tokenizer(VOCAB_FILE);
+    // the pieces matched before the unknown part are kept
+    std::vector<std::string> expected{"[UNK]", "un", "[UNK]", "want", "##a", "[UNK]"};
+    ASSERT_EQ(tokenizer.Tokenize(std::vector<std::string>{"xyz", "unknown", "wantab"}), expected);
+    ASSERT_EQ(tokenizer.Tokenize(std::vector<std::string>{std::string("un\0e", 4)}),
+              std::vector<std::string>({"un", "[UNK]"}));
+}
+
+TEST(TestWordpieceTokenizer, TestOffsets) {
+    WordpieceTokenizer tokenizer(VOCAB_FILE);
+    std::vector<std::pair<size_t, size_t>> offsets;
+    std::vector<std::string> expected{"un", "##aff", "##able", "want", "##ed", "[UNK]"};
+    ASSERT_EQ(tokenizer.Tokenize("unaffable wanted xyz", offsets), expected);
+    std::vector<std::pair<size_t, size_t>> expected_offsets{{0, 2}, {2, 5}, {5, 9}, {10, 14}, {14, 16}, {17, 20}};
+    ASSERT_EQ(offsets, expected_offsets);
+
+    // offsets in the concatenation of the tokens
+    offsets.clear();
+    ASSERT_EQ(tokenizer.Tokenize(std::vector<std::string>{"unaffable", "wanted", "xyz"}, offsets), expected);
+    expected_offsets = {{0, 2}, {2, 5}, {5, 9}, {9, 13}, {13, 15}, {15, 18}};
+    ASSERT_EQ(offsets, expected_offsets);
+
+    std::vector<std::pair<int64_t, int64_t>> offset_mapping;
+    auto encoded = tokenizer.EncodePlus("unaffable wanted", 4, offset_mapping);
+    ASSERT_EQ(encoded.size(), 6);
+    std::vector<std::pair<int64_t, int64_t>> expected_mapping{{0, 0}, {0, 2}, {2, 5}, {5, 9}, {10, 14}, {0, 0}};
+    ASSERT_EQ(offset_mapping, expected_mapping);
+}
+
+TEST(TestWordpieceTokenizer, TestSnapshot) {
+    WordpieceTokenizer tokenizer(VOCAB_FILE);
+    std::stringstream snapshot;
+    tokenizer.SaveSnapshot(snapshot);
+    WordpieceTokenizer loaded(pyis::ops::VocabSnapshot::Read(snapshot));
+
+    std::string text = "unaffable wanted xyz running [CLS] un";
+    ASSERT_EQ(loaded.Tokenize(text), tokenizer.Tokenize(text));
+    ASSERT_EQ(loaded.Encode(text), tokenizer.Encode(text));
+    ASSERT_EQ(loaded.GetVocab(), tokenizer.GetVocab());
+    ASSERT_EQ(loaded.ConvertTokenToId("##aff"), tokenizer.ConvertTokenToId("##aff"));
+    ASSERT_EQ(loaded.ConvertTokenToId("xyz"), -1);
+    ASSERT_EQ(loaded.ConvertIdToToken(1 << 20), "[UNK]");
+}
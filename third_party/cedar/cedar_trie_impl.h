@@ -1333,6 +1333,13 @@ private:
             return m_t->ExactMatchSearch<trie_t::result_t>(key);
         }
 
+        // continue a search from the node `from` left by a previous call, starting from the root when it is 0
+        int Traverse(const char* key, size_t len, npos_t& from) const
+        {
+            size_t pos(0);
+            return m_t->Traverse(key, from, pos, len);
+        }
+
         // high-level (trie-specific) predicates
         std::vector<TrieResult> Prefix(const char* key) const
         {